@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/initcall.h>
+#include <protura/mm/kmmap.h>
+#include <protura/mm/vm_area.h>
+
+#include <arch/cpuid.h>
+#include <arch/msr.h>
+#include <arch/drivers/lapic.h>
+
+static volatile uint32_t *lapic_base;
+static uint8_t lapic_id;
+
+static uint32_t lapic_read(uint32_t reg)
+{
+    return lapic_base[reg / 4];
+}
+
+static void lapic_write(uint32_t reg, uint32_t val)
+{
+    lapic_base[reg / 4] = val;
+}
+
+int lapic_is_enabled(void)
+{
+    return lapic_base != NULL;
+}
+
+void lapic_eoi(void)
+{
+    lapic_write(LAPIC_REG_EOI, 0);
+}
+
+uint32_t lapic_msi_address(void)
+{
+    return LAPIC_MSI_ADDRESS | ((uint32_t)lapic_id << LAPIC_MSI_DEST_SHIFT);
+}
+
+uint32_t lapic_msi_data(int vector)
+{
+    return vector;
+}
+
+static void lapic_init(void)
+{
+    if (!cpuid_has_apic()) {
+        kp(KP_NORMAL, "LAPIC: Not present, MSIs are disabled\n");
+        return;
+    }
+
+    uint64_t apic_base = x86_read_msr(MSR_IA32_APIC_BASE);
+    pa_t addr = apic_base & APIC_BASE_ADDR_MASK;
+
+    if (!(apic_base & APIC_BASE_ENABLE))
+        x86_write_msr(MSR_IA32_APIC_BASE, apic_base | APIC_BASE_ENABLE);
+
+    lapic_base = kmmap(addr, PG_SIZE, F(VM_MAP_READ) | F(VM_MAP_WRITE));
+    lapic_id = lapic_read(LAPIC_REG_ID) >> 24;
+
+    /* Keep the 8259 PIC connected through LINT0, and NMIs through LINT1. The
+     * LAPIC timer isn't used */
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_LVT_ERROR, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_LVT_LINT0, LAPIC_LVT_DELIVERY_EXTINT);
+    lapic_write(LAPIC_REG_LVT_LINT1, LAPIC_LVT_DELIVERY_NMI);
+
+    lapic_write(LAPIC_REG_TPR, 0);
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+
+    kp(KP_NORMAL, "LAPIC: ID %d, registers at 0x%08x\n", lapic_id, (uint32_t)addr);
+}
+initcall_core(lapic, lapic_init);
+initcall_dependency(lapic, vm_area);
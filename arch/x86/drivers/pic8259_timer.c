@@ -15,23 +15,39 @@
 #include <arch/asm.h>
 #include <arch/idt.h>
 #include <arch/task.h>
+#include <arch/irq.h>
+#include <arch/tsc.h>
 #include <arch/drivers/pic8259.h>
 #include <arch/drivers/pic8259_timer.h>
 #include <protura/ktimer.h>
+#include <protura/softirq.h>
+#include <protura/uinfo.h>
+#include <protura/kprof.h>
 
 static atomic32_t ticks;
 
+/* TSC value at the last tick, used to interpolate between ticks */
+static uint64_t tick_tsc;
+
 static void timer_callback(struct irq_frame *frame, void *param)
 {
+    if (tsc_is_usable())
+        tick_tsc = rdtsc();
+
     atomic32_inc(&ticks);
 
-    timer_handle_timers(atomic32_get(&ticks));
+    uinfo_time_update((uint64_t)atomic32_get(&ticks) * TIMER_NSEC_PER_TICK, tick_tsc, tsc_mult, TSC_SHIFT);
+
+    softirq_raise(SOFTIRQ_TIMER);
 
     if ((atomic32_get(&ticks) % (TIMER_TICKS_PER_SEC / CONFIG_TASKSWITCH_PER_SEC)) == 0)
         cpu_get_local()->reschedule = 1;
 
     if ((atomic32_get(&ticks) % TIMER_TICKS_PER_SEC) == 0)
         protura_uptime_inc();
+
+    if ((atomic32_get(&ticks) % (TIMER_TICKS_PER_SEC / KPROF_SAMPLE_HZ)) == 0)
+        kprof_sample(frame->eip, (void *)frame->ebp, (frame->cs & 0x03) == DPL_USER);
 }
 
 uint32_t timer_get_ticks(void)
@@ -44,6 +60,39 @@ uint32_t timer_get_ms(void)
     return timer_get_ticks() / (TIMER_TICKS_PER_SEC / 1000);
 }
 
+/*
+ * Nanoseconds since the timer was started. The tick count provides the
+ * coarse time, and the TSC is used to fill in the time since the last tick.
+ * The interpolated part is clamped to less then a tick, so that time never
+ * appears to go backwards when the next tick comes in.
+ */
+uint64_t timer_get_ns(void)
+{
+    irq_flags_t irq_flags;
+    uint32_t cur_ticks;
+    uint64_t last_tsc, now_tsc, offset = 0;
+
+    irq_flags = irq_save();
+    irq_disable();
+
+    cur_ticks = atomic32_get(&ticks);
+    last_tsc = tick_tsc;
+
+    irq_restore(irq_flags);
+
+    if (tsc_is_usable() && last_tsc) {
+        now_tsc = rdtsc();
+
+        if (now_tsc > last_tsc)
+            offset = tsc_cycles_to_ns(now_tsc - last_tsc);
+
+        if (offset >= TIMER_NSEC_PER_TICK)
+            offset = TIMER_NSEC_PER_TICK - 1;
+    }
+
+    return (uint64_t)cur_ticks * TIMER_NSEC_PER_TICK + offset;
+}
+
 uint32_t sys_clock(void)
 {
     return timer_get_ticks();
@@ -63,6 +112,8 @@ void pic8259_timer_init(void)
     outb(PIC8259_TIMER_IO,
             PIC8259_TIMER_DIV(TIMER_TICKS_PER_SEC) / 256);
 
+    ktimer_setup();
+
     int err = irq_register_handler(0, &timer_handler);
     if (err)
         panic("Timer: Timer interrupt already taken, unable to register timer!\n");
@@ -23,6 +23,11 @@
 #include <protura/users.h>
 #include <protura/utsname.h>
 #include <protura/reboot.h>
+#include <protura/time.h>
+#include <protura/sched.h>
+#include <protura/futex.h>
+#include <protura/resource.h>
+#include <protura/kstat.h>
 
 /* 
  * These simple functions serve as the glue between the underlying
@@ -494,6 +499,56 @@ static void sys_handler_usleep(struct irq_frame *frame)
     frame->eax = sys_usleep(frame->ebx);
 }
 
+static void sys_handler_clock_gettime(struct irq_frame *frame)
+{
+    frame->eax = sys_clock_gettime(frame->ebx, make_user_buffer(frame->ecx));
+}
+
+static void sys_handler_nice(struct irq_frame *frame)
+{
+    frame->eax = sys_nice(frame->ebx);
+}
+
+static void sys_handler_setpriority(struct irq_frame *frame)
+{
+    frame->eax = sys_setpriority(frame->ebx, frame->ecx, frame->edx);
+}
+
+static void sys_handler_getpriority(struct irq_frame *frame)
+{
+    frame->eax = sys_getpriority(frame->ebx, frame->ecx);
+}
+
+static void sys_handler_sched_setscheduler(struct irq_frame *frame)
+{
+    frame->eax = sys_sched_setscheduler(frame->ebx, frame->ecx, make_user_buffer(frame->edx));
+}
+
+static void sys_handler_sched_getscheduler(struct irq_frame *frame)
+{
+    frame->eax = sys_sched_getscheduler(frame->ebx);
+}
+
+static void sys_handler_clone(struct irq_frame *frame)
+{
+    frame->eax = sys_clone(frame->ebx, make_user_buffer(frame->ecx), make_user_buffer(frame->edx));
+}
+
+static void sys_handler_getrusage(struct irq_frame *frame)
+{
+    frame->eax = sys_getrusage(frame->ebx, make_user_buffer(frame->ecx));
+}
+
+static void sys_handler_times(struct irq_frame *frame)
+{
+    frame->eax = sys_times(make_user_buffer(frame->ebx));
+}
+
+static void sys_handler_futex(struct irq_frame *frame)
+{
+    frame->eax = sys_futex(make_user_buffer(frame->ebx), frame->ecx, frame->edx, frame->esi, make_user_buffer(frame->edi));
+}
+
 static void sys_handler_statvfs(struct irq_frame *frame)
 {
     frame->eax = sys_statvfs(make_user_buffer(frame->ebx), make_user_buffer(frame->ecx));
@@ -606,14 +661,31 @@ static struct syscall_handler {
     SYSCALL(USLEEP, sys_handler_usleep),
     SYSCALL(STATVFS, sys_handler_statvfs),
     SYSCALL(FSTATVFS, sys_handler_fstatvfs),
+    SYSCALL(CLOCK_GETTIME, sys_handler_clock_gettime),
+    SYSCALL(NICE, sys_handler_nice),
+    SYSCALL(SETPRIORITY, sys_handler_setpriority),
+    SYSCALL(GETPRIORITY, sys_handler_getpriority),
+    SYSCALL(SCHED_SETSCHEDULER, sys_handler_sched_setscheduler),
+    SYSCALL(SCHED_GETSCHEDULER, sys_handler_sched_getscheduler),
+    SYSCALL(FUTEX, sys_handler_futex),
+    SYSCALL(CLONE, sys_handler_clone),
+    SYSCALL(GETRUSAGE, sys_handler_getrusage),
+    SYSCALL(TIMES, sys_handler_times),
 };
 
-static void syscall_handler(struct irq_frame *frame, void *param)
+void syscall_dispatch(struct irq_frame *frame)
 {
+    kstat_syscall(frame->eax);
+
     if (frame->eax < ARRAY_SIZE(syscall_handlers) && syscall_handlers[frame->eax].handler)
         (syscall_handlers[frame->eax].handler) (frame);
 }
 
+static void syscall_handler(struct irq_frame *frame, void *param)
+{
+    syscall_dispatch(frame);
+}
+
 static struct irq_handler syscall_irq_handler
     = IRQ_HANDLER_INIT(syscall_irq_handler, "syscall", syscall_handler, NULL, IRQ_SYSCALL, 0);
 
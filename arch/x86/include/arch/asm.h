@@ -104,16 +104,6 @@ static __always_inline void hlt(void)
     asm volatile("hlt");
 }
 
-static __always_inline void cli(void)
-{
-    asm volatile("cli");
-}
-
-static __always_inline void sti(void)
-{
-    asm volatile("sti");
-}
-
 static __always_inline void ltr(uint16_t tss_seg)
 {
     asm volatile("ltr %0\n"
@@ -130,12 +120,47 @@ static __always_inline uint32_t eflags_read(void)
 
 #define EFLAGS_IF 0x00000200
 
+#ifdef CONFIG_IRQSOFF_TRACE
+/* See arch/x86/kernel/irqsoff.c, these record how long interrupts stay off */
+void irqsoff_start(void);
+void irqsoff_end(void);
+#endif
+
 static __always_inline void eflags_write(uint32_t flags)
 {
+#ifdef CONFIG_IRQSOFF_TRACE
+    if ((flags & EFLAGS_IF) && !(eflags_read() & EFLAGS_IF))
+        irqsoff_end();
+#endif
+
     asm volatile("pushl %0\n"
                  "popfl\n" : : "a" (flags));
 }
 
+static __always_inline void cli(void)
+{
+#ifdef CONFIG_IRQSOFF_TRACE
+    uint32_t was_enabled = eflags_read() & EFLAGS_IF;
+
+    asm volatile("cli");
+
+    if (was_enabled)
+        irqsoff_start();
+#else
+    asm volatile("cli");
+#endif
+}
+
+static __always_inline void sti(void)
+{
+#ifdef CONFIG_IRQSOFF_TRACE
+    if (!(eflags_read() & EFLAGS_IF))
+        irqsoff_end();
+#endif
+
+    asm volatile("sti");
+}
+
 static __always_inline uint32_t xchg(volatile void *addr, uint32_t val)
 {
     volatile uint32_t *ptr = addr;
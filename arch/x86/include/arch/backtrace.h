@@ -7,6 +7,10 @@
 void dump_stack(int log_level);
 void dump_stack_ptr(void *start, int log_level);
 
+/* Fills `addrs` with up to `max` return addresses by walking the kernel
+ * stackframes starting at `start`. Returns the number of addresses found */
+int backtrace_collect(void *start, uintptr_t *addrs, int max);
+
 struct stackframe {
     struct stackframe *caller_stackframe;
     uintptr_t return_addr;
@@ -18,6 +18,9 @@ struct cpu_info {
     struct arch_context scheduler;
     struct task *kidle;
 
+    /* The task whose state is currently loaded into the FPU, see arch/fpu.h */
+    struct task *fpu_owner;
+
     /* This is actually a self-referencial pointer that just points back to the
      * containing cpu_info. It's useful for implementing cpu local data,
      * because the GDT entry refers to the location of the address of the cpu_info object.
@@ -95,6 +95,9 @@ extern char cpuid_id[10];
 #define cpuid_has_pge() ((cpuid_edx) & CPUID_FEAT_EDX_PGE)
 #define cpuid_has_sse() (((cpuid_edx) & CPUID_FEAT_EDX_SSE) && ((cpuid_edx) & CPUID_FEAT_EDX_FXSR))
 #define cpuid_has_pat() ((cpuid_edx) & CPUID_FEAT_EDX_PAT)
+#define cpuid_has_tsc() ((cpuid_edx) & CPUID_FEAT_EDX_TSC)
+#define cpuid_has_sep() ((cpuid_edx) & CPUID_FEAT_EDX_SEP)
+#define cpuid_has_apic() ((cpuid_edx) & CPUID_FEAT_EDX_APIC)
 
 void cpuid_init(void);
 
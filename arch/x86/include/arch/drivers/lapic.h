@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef INCLUDE_ARCH_DRIVERS_LAPIC_H
+#define INCLUDE_ARCH_DRIVERS_LAPIC_H
+
+#include <protura/types.h>
+
+/*
+ * The Local APIC is only used for delivering MSIs, the 8259 PIC is still
+ * used for everything else. It keeps working through the LAPIC's LINT0 pin,
+ * which is set up as an ExtINT (virtual wire mode).
+ */
+#define MSR_IA32_APIC_BASE 0x1B
+#define APIC_BASE_ENABLE   (1 << 11)
+#define APIC_BASE_ADDR_MASK 0xFFFFF000
+
+#define LAPIC_REG_ID    0x020
+#define LAPIC_REG_TPR   0x080
+#define LAPIC_REG_EOI   0x0B0
+#define LAPIC_REG_SVR   0x0F0
+#define LAPIC_REG_LVT_TIMER 0x320
+#define LAPIC_REG_LVT_LINT0 0x350
+#define LAPIC_REG_LVT_LINT1 0x360
+#define LAPIC_REG_LVT_ERROR 0x370
+
+#define LAPIC_SVR_ENABLE (1 << 8)
+#define LAPIC_SPURIOUS_VECTOR 0xFF
+
+#define LAPIC_LVT_MASKED        (1 << 16)
+#define LAPIC_LVT_DELIVERY_NMI    (4 << 8)
+#define LAPIC_LVT_DELIVERY_EXTINT (7 << 8)
+
+/* MSIs are written to this address, with the destination APIC ID in bits
+ * 12 to 19. The data is just the vector, which gives a fixed, edge-triggered
+ * interrupt */
+#define LAPIC_MSI_ADDRESS 0xFEE00000
+#define LAPIC_MSI_DEST_SHIFT 12
+
+/* Returns zero if there's no usable LAPIC, in which case MSIs can't be used */
+int lapic_is_enabled(void);
+void lapic_eoi(void);
+
+uint32_t lapic_msi_address(void);
+uint32_t lapic_msi_data(int vector);
+
+#endif
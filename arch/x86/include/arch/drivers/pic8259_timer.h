@@ -16,11 +16,20 @@
 #define PIC8259_TIMER_FREQ    1193182
 #define PIC8259_TIMER_DIV(x)  ((PIC8259_TIMER_FREQ) / (x))
 
+#define PIC8259_TIMER_CH2     (PIC8259_TIMER_IO + 2)
 #define PIC8259_TIMER_MODE    (PIC8259_TIMER_IO + 3)
 #define PIC8259_TIMER_SEL0    0x00
+#define PIC8259_TIMER_SEL2    0x80
+#define PIC8259_TIMER_ONESHOT 0x00
 #define PIC8259_TIMER_RATEGEN 0x04
 #define PIC8259_TIMER_16BIT   0x30
 
+/* Channel 2 is gated through the keyboard controller's port B */
+#define PIC8259_TIMER_CH2_GATE_PORT 0x61
+#define PIC8259_TIMER_CH2_GATE      0x01
+#define PIC8259_TIMER_CH2_SPEAKER   0x02
+#define PIC8259_TIMER_CH2_OUT       0x20
+
 #define PIC8259_TIMER_IRQ     0x00 + 0x20
 
 #define PIC8259_TICKS_PER_SEC 2000
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef INCLUDE_ARCH_FPU_H
+#define INCLUDE_ARCH_FPU_H
+
+#include <protura/types.h>
+#include <arch/cpuid.h>
+
+struct task;
+struct irq_frame;
+
+/*
+ * The FPU/SSE state is switched lazily. On a task switch we set CR0.TS unless
+ * the new task already owns the FPU, and the first FPU instruction the task
+ * runs traps with #NM. The #NM handler then saves the state of the previous
+ * owner and loads the state of the current task.
+ *
+ * This is only done if the CPU has fxsave/fxrstor, without them the FPU state
+ * is not preserved.
+ */
+
+static inline void fpu_clts(void)
+{
+    asm volatile("clts");
+}
+
+static inline void fpu_stts(void)
+{
+    cpu_set_cr0(cpu_get_cr0() | CR0_TS);
+}
+
+/* Called with interrupts off when switching to `new` */
+void fpu_task_switch(struct task *new);
+
+/* Called when `t` is being free'd, so that it is no longer the owner */
+void fpu_task_release(struct task *t);
+
+void fpu_device_not_available_handler(struct irq_frame *frame, void *param);
+
+#endif
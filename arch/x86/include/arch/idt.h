@@ -81,9 +81,20 @@ static inline void irq_handler_init(struct irq_handler *hand)
     *hand = (struct irq_handler) { .entry = LIST_NODE_INIT(hand->entry) };
 }
 
+/* Vectors handed out to MSIs. Interrupts on these are acknowledged through
+ * the LAPIC rather than the 8259 PIC */
+#define IRQ_MSI_VECTOR_START 0x40
+#define IRQ_MSI_VECTOR_END   0x80
+
+struct pci_dev;
+
 /* Returns -1 if the registration fails */
 int irq_register_handler(uint8_t irqno, struct irq_handler *);
 int irq_register_callback(uint8_t irqno, void (*handler)(struct irq_frame *, void *param), const char *id, enum irq_type type, void *param, int flags);
+/* Allocates a vector and programs the device to send MSIs to it. Returns the
+ * vector, or a negative error if the device (or CPU) can't do MSIs, in which
+ * case the caller should fall back to its interrupt line */
+int irq_register_msi_callback(struct pci_dev *dev, void (*handler)(struct irq_frame *, void *param), const char *id, void *param);
 int cpu_exception_register_callback(uint8_t exception_no, struct irq_handler *hand);
 int x86_register_interrupt_handler(uint8_t irqno, struct irq_handler *hand);
 
@@ -93,6 +104,9 @@ void idt_init(void);
 
 void irq_global_handler(struct irq_frame *);
 
+/* Dumps the state and halts the kernel */
+void unhandled_cpu_exception(struct irq_frame *frame, void *param);
+
 extern const struct file_ops interrupts_file_ops;
 
 #endif
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef INCLUDE_ARCH_IRQSOFF_H
+#define INCLUDE_ARCH_IRQSOFF_H
+
+#include <protura/types.h>
+
+/*
+ * With CONFIG_IRQSOFF_TRACE enabled, cli(), sti(), and eflags_write() time
+ * every section of code that runs with interrupts off, and the longest ones
+ * are kept along with the functions that turned interrupts off and back on.
+ *
+ * Time spent in interrupt handlers themselves isn't included, that is covered
+ * by the per-vector duration histograms in /proc/interrupts.
+ */
+#define IRQSOFF_RECORDS 8
+
+struct irqsoff_record {
+    uint64_t cycles;
+    uintptr_t start_ip;
+    uintptr_t end_ip;
+};
+
+#ifdef CONFIG_IRQSOFF_TRACE
+
+/*
+ * Throws away the currently open section. Called on entry from a context that
+ * had interrupts on, as the `cli` done by the hardware or the `iret` back to
+ * it can't be seen.
+ */
+void irqsoff_reset(void);
+
+/* Copies the longest sections, longest first, and returns how many there are */
+int irqsoff_records_get(struct irqsoff_record *records);
+
+#else
+
+static inline void irqsoff_reset(void) { }
+
+static inline int irqsoff_records_get(struct irqsoff_record *records)
+{
+    return 0;
+}
+
+#endif
+
+#endif
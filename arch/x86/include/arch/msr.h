@@ -8,6 +8,10 @@
 #ifndef INCLUDE_ARCH_MSR_H
 #define INCLUDE_ARCH_MSR_H
 
+#define MSR_IA32_SYSENTER_CS  0x174
+#define MSR_IA32_SYSENTER_ESP 0x175
+#define MSR_IA32_SYSENTER_EIP 0x176
+
 static inline uint64_t x86_read_msr(uint32_t reg)
 {
     uint32_t edx, eax;
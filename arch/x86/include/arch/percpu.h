@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef INCLUDE_ARCH_PERCPU_H
+#define INCLUDE_ARCH_PERCPU_H
+
+#include <protura/compiler.h>
+#include <protura/types.h>
+
+/*
+ * Adds `val` to a 64-bit counter that only the local CPU writes to. Each half
+ * is updated by a single read-modify-write instruction, so an interrupt on
+ * this CPU can't lose an update and no lock prefix is needed. A reader on
+ * this CPU needs interrupts off to see both halves consistent.
+ */
+static __always_inline void arch_percpu_add64(uint64_t *counter, uint32_t val)
+{
+    uint32_t *half = (uint32_t *)counter;
+
+    asm volatile("addl %2, %0\n\t"
+                 "adcl $0, %1"
+                 : "+m" (half[0]), "+m" (half[1])
+                 : "ir" (val)
+                 : "cc");
+}
+
+#endif
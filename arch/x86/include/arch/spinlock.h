@@ -12,28 +12,80 @@
 #include <protura/debug.h>
 #include <protura/stddef.h>
 #include <arch/asm.h>
+#include <protura/lockstat.h>
 
 struct spinlock {
     unsigned int locked;
     unsigned int eflags;
+
+#ifdef CONFIG_LOCKSTAT
+    struct lock_class *class;
+    uint64_t acquire_tsc;
+#endif
 };
 
 typedef struct spinlock spinlock_t;
 
 #define SPINLOCK_INIT() { .locked = 0 }
 
+#ifdef CONFIG_LOCKSTAT
+# define SPINLOCK_INIT_CLASS(cls) { .locked = 0, .class = &(cls) }
+#else
+# define SPINLOCK_INIT_CLASS(cls) { .locked = 0 }
+#endif
+
 static inline void spinlock_init(spinlock_t *lock)
 {
     *lock = (spinlock_t)SPINLOCK_INIT();
 }
 
+#ifdef CONFIG_LOCKSTAT
+# define spinlock_set_class(lock, cls) ((lock)->class = &(cls))
+#else
+# define spinlock_set_class(lock, cls) do { } while (0)
+#endif
+
+#ifdef CONFIG_LOCKSTAT
+static inline struct lock_class *spinlock_class(spinlock_t *lock)
+{
+    return lock->class? lock->class: &lockstat_spinlock_class;
+}
+
+static inline void spinlock_stat_acquired(spinlock_t *lock, int contended, uint64_t start)
+{
+    lock->acquire_tsc = lockstat_now();
+    lockstat_acquired(spinlock_class(lock), contended, contended? lock->acquire_tsc - start: 0);
+}
+
+static inline void spinlock_stat_released(spinlock_t *lock)
+{
+    lockstat_released(spinlock_class(lock), lockstat_now() - lock->acquire_tsc);
+}
+#endif
+
 static inline void spinlock_acquire(spinlock_t *lock)
 {
     uint32_t tmp_flags = eflags_read();
 
     cli();
+
+#ifdef CONFIG_LOCKSTAT
+    uint64_t start = 0;
+    int contended = 0;
+
+    if (xchg(&lock->locked, 1) != 0) {
+        contended = 1;
+        start = lockstat_now();
+
+        while (xchg(&lock->locked, 1) != 0)
+            ;
+    }
+
+    spinlock_stat_acquired(lock, contended, start);
+#else
     while (xchg(&lock->locked, 1) != 0)
         ;
+#endif
 
     lock->eflags = tmp_flags;
 }
@@ -42,6 +94,10 @@ static inline void spinlock_release(spinlock_t *lock)
 {
     uint32_t tmp_flags = lock->eflags;
 
+#ifdef CONFIG_LOCKSTAT
+    spinlock_stat_released(lock);
+#endif
+
     xchg(&lock->locked, 0);
 
     eflags_write(tmp_flags);
@@ -67,10 +123,14 @@ static inline int spinlock_try_acquire(spinlock_t *lock)
 
     got_lock = xchg(&lock->locked, 1);
 
-    if (got_lock == 0)
+    if (got_lock == 0) {
+#ifdef CONFIG_LOCKSTAT
+        spinlock_stat_acquired(lock, 0, 0);
+#endif
         lock->eflags = eflags;
-    else
+    } else {
         eflags_write(eflags);
+    }
 
     return got_lock == 0;
 }
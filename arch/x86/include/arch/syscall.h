@@ -15,6 +15,13 @@
 
 void syscall_init(void);
 
+/* Runs the syscall handler for the syscall number in frame->eax */
+void syscall_dispatch(struct irq_frame *frame);
+
+/* Entry point for `sysenter`, and the C side of it */
+void sysenter_entry(void);
+int sysenter_handler(struct irq_frame *frame);
+
 #endif
 
 #endif
@@ -84,6 +84,9 @@ void arch_task_switch(context_t *old, struct task *new);
 
 void arch_task_init(struct task *t);
 
+/* Releases any arch state still referring to `t` */
+void arch_task_free(struct task *t);
+
 extern uintptr_t arch_task_user_entry_addr;
 
 #define task_switch(old, new) arch_task_switch(old, new)
@@ -13,8 +13,10 @@
 
 uint32_t timer_get_ms(void);
 uint32_t timer_get_ticks(void);
+uint64_t timer_get_ns(void);
 uint32_t sys_clock(void);
 
 #define TIMER_TICKS_PER_SEC PIC8259_TICKS_PER_SEC
+#define TIMER_NSEC_PER_TICK (1000000000 / TIMER_TICKS_PER_SEC)
 
 #endif
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef INCLUDE_ARCH_TSC_H
+#define INCLUDE_ARCH_TSC_H
+
+#include <protura/types.h>
+#include <arch/asm.h>
+
+/*
+ * The TSC is used to interpolate between timer ticks. Conversion to
+ * nanoseconds is done via `(cycles * tsc_mult) >> TSC_SHIFT`, which is only
+ * valid for relatively small cycle counts (a few ticks worth), which is all
+ * we ever use it for.
+ */
+#define TSC_SHIFT 22
+
+extern uint32_t tsc_khz;
+extern uint32_t tsc_mult;
+
+/* Zero if there is no TSC, or it could not be calibrated */
+static inline int tsc_is_usable(void)
+{
+    return tsc_khz != 0;
+}
+
+static inline uint64_t tsc_cycles_to_ns(uint64_t cycles)
+{
+    return (cycles * tsc_mult) >> TSC_SHIFT;
+}
+
+void tsc_init(void);
+
+#endif
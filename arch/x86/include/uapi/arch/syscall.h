@@ -10,6 +10,28 @@
 
 #define INT_SYSCALL 0x81
 
+/*
+ * If __kUINFO_FLAG_SYSENTER is set in the uinfo page, then syscalls can also
+ * be made via `sysenter`. The arguments are passed the same as `int 0x81`,
+ * except that %ecx, %edx, %ebp and the return address are passed on the user
+ * stack, and %ebp points to them:
+ *
+ *     pushl $1f
+ *     pushl %ecx
+ *     pushl %edx
+ *     pushl %ebp
+ *     movl %esp, %ebp
+ *     sysenter
+ * 1:  popl %ebp
+ *     popl %edx
+ *     popl %ecx
+ *     addl $4, %esp
+ *
+ * The return address must be the instruction directly after the `sysenter`,
+ * so that restarted syscalls work. The result is returned in %eax, and %ecx,
+ * %edx and %ebp are clobbered until they are popped.
+ */
+
 // #define SYSCALL_PUTCHAR      0x01
 #define SYSCALL_CLOCK        0x02
 #define SYSCALL_GETPID       0x03
@@ -108,5 +130,15 @@
 #define SYSCALL_USLEEP       0x60
 #define SYSCALL_STATVFS      0x61
 #define SYSCALL_FSTATVFS     0x62
+#define SYSCALL_CLOCK_GETTIME 0x63
+#define SYSCALL_NICE         0x64
+#define SYSCALL_SETPRIORITY  0x65
+#define SYSCALL_GETPRIORITY  0x66
+#define SYSCALL_SCHED_SETSCHEDULER 0x67
+#define SYSCALL_SCHED_GETSCHEDULER 0x68
+#define SYSCALL_FUTEX        0x69
+#define SYSCALL_CLONE        0x6A
+#define SYSCALL_GETRUSAGE    0x6B
+#define SYSCALL_TIMES        0x6C
 
 #endif
@@ -31,6 +31,7 @@
 #include <arch/idt.h>
 #include <arch/init.h>
 #include <arch/cpuid.h>
+#include <arch/tsc.h>
 #include <arch/drivers/pic8259.h>
 #include <arch/drivers/pic8259_timer.h>
 #include <arch/drivers/rtc.h>
@@ -249,6 +250,9 @@ void cmain(uint32_t magic, void *info)
     pic8259_init();
     pic8259_timer_init();
 
+    /* Calibrate the TSC against the PIT, used for sub-tick timekeeping */
+    tsc_init();
+
     kp(KP_NORMAL, "Reading RTC time\n");
     rtc_update_time();
 
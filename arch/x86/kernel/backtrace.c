@@ -38,6 +38,34 @@ void dump_stack_ptr(void *start, int log_level)
     }
 }
 
+int backtrace_collect(void *start, uintptr_t *addrs, int max)
+{
+    struct stackframe *stack = start;
+    int count = 0;
+
+    pa_t page_dir = get_current_page_directory();
+    pgd_t *pgd = p_to_v(page_dir);
+
+    /* This can be called from an interrupt, so be paranoid - only follow
+     * frames that are in kernel memory and that move up the stack */
+    while (count < max && stack) {
+        if ((uintptr_t)stack < KMEM_KBASE || !pgd_ptr_is_valid(pgd, stack))
+            break;
+
+        if (stack->return_addr < KMEM_LINK)
+            break;
+
+        addrs[count++] = stack->return_addr;
+
+        if (stack->caller_stackframe <= stack)
+            break;
+
+        stack = stack->caller_stackframe;
+    }
+
+    return count;
+}
+
 void dump_stack(int log_level)
 {
     dump_stack_ptr(read_ebp(), log_level);
@@ -13,12 +13,15 @@
 #include <protura/scheduler.h>
 #include <protura/mm/palloc.h>
 #include <protura/mm/kmalloc.h>
+#include <protura/uinfo.h>
 
 #include <arch/task.h>
 #include <arch/memlayout.h>
 #include <arch/asm.h>
 #include <arch/gdt.h>
 #include <arch/cpuid.h>
+#include <arch/msr.h>
+#include <arch/syscall.h>
 #include <arch/cpu.h>
 
 static struct cpu_info cpu;
@@ -41,6 +44,27 @@ void cpu_setup_fpu(struct cpu_info *c)
     }
 }
 
+/*
+ * SYSENTER requires the GDT to be laid out as kernel CS, kernel DS, user CS,
+ * user DS, which ours is. SYSENTER_ESP points at the TSS's esp0 entry, the
+ * entry code loads the actual stack from there.
+ */
+static void cpu_setup_sysenter(struct cpu_info *c)
+{
+    if (!cpuid_has_sep()) {
+        kp(KP_NORMAL, "CPU does not support SYSENTER.\n");
+        return;
+    }
+
+    x86_write_msr(MSR_IA32_SYSENTER_CS, _KERNEL_CS);
+    x86_write_msr(MSR_IA32_SYSENTER_ESP, (uintptr_t)&c->tss.esp0);
+    x86_write_msr(MSR_IA32_SYSENTER_EIP, (uintptr_t)sysenter_entry);
+
+    uinfo_set_flags(UINFO_FLAG_SYSENTER);
+
+    kp(KP_NORMAL, "SYSENTER enabled\n");
+}
+
 static void cpu_gdt(struct cpu_info *c)
 {
     c->gdt_entries[_GDT_NULL] = (struct gdt_entry){ 0 };
@@ -131,6 +155,10 @@ void cpu_start_scheduler(void)
 
 void cpu_init_early(void)
 {
+    /* Point the cpu-local pointer at ourselves right away, percpu_counters
+     * are bumped by palloc() and kmalloc() before cpu_info_init() runs */
+    cpu.cpu = &cpu;
+
     cpu_gdt(&cpu);
 }
 
@@ -138,6 +166,7 @@ void cpu_info_init(void)
 {
     cpu_tss(&cpu);
     cpu_setup_fpu(&cpu);
+    cpu_setup_sysenter(&cpu);
     cpu.cpu = &cpu;
     cpu.cpu_id = 0;
     cpu.intr_count = 1;
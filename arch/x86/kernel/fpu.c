@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/task.h>
+
+#include <arch/asm.h>
+#include <arch/irq.h>
+#include <arch/idt.h>
+#include <arch/cpu.h>
+#include <arch/cpuid.h>
+#include <arch/task.h>
+#include <arch/fpu.h>
+
+void fpu_task_switch(struct task *new)
+{
+    struct cpu_info *cpu = cpu_get_local();
+
+    if (!cpuid_has_sse())
+        return;
+
+    if (cpu->fpu_owner == new)
+        fpu_clts();
+    else
+        fpu_stts();
+}
+
+void fpu_task_release(struct task *t)
+{
+    struct cpu_info *cpu = cpu_get_local();
+    irq_flags_t irq_flags;
+
+    irq_flags = irq_save();
+    irq_disable();
+
+    if (cpu->fpu_owner == t)
+        cpu->fpu_owner = NULL;
+
+    irq_restore(irq_flags);
+}
+
+void fpu_device_not_available_handler(struct irq_frame *frame, void *param)
+{
+    struct cpu_info *cpu = cpu_get_local();
+    struct task *t = cpu->current;
+
+    /* The kernel itself never touches the FPU, so a #NM from kernel code is a
+     * bug */
+    if (!cpuid_has_sse() || !t || (frame->cs & 0x03) != DPL_USER)
+        unhandled_cpu_exception(frame, param);
+
+    fpu_clts();
+
+    if (cpu->fpu_owner == t)
+        return;
+
+    if (cpu->fpu_owner)
+        i387_fxsave(&cpu->fpu_owner->arch_info.fxsave);
+
+    i387_fxrstor(&t->arch_info.fxsave);
+    cpu->fpu_owner = t;
+}
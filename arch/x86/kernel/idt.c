@@ -15,6 +15,10 @@
 #include <protura/drivers/console.h>
 #include <protura/snprintf.h>
 #include <protura/fs/seq_file.h>
+#include <protura/symbols.h>
+#include <protura/softirq.h>
+#include <protura/kstat.h>
+#include <protura/drivers/pci.h>
 
 #include "irq_handler.h"
 #include <arch/asm.h>
@@ -25,17 +29,34 @@
 #include <arch/cpu.h>
 #include <arch/task.h>
 #include <arch/backtrace.h>
+#include <arch/fpu.h>
 #include <arch/idt.h>
+#include <arch/tsc.h>
+#include <arch/log2.h>
+#include <arch/irqsoff.h>
+#include <arch/drivers/lapic.h>
 
 static struct idt_ptr idt_ptr;
 static struct idt_entry idt_entries[256] = { {0} };
 
+/*
+ * Bucket zero counts handlers that ran for under 1us, bucket n counts those
+ * that ran for [2^(n-1), 2^n) us, and the last bucket counts everything
+ * longer than that.
+ */
+#define IRQ_DURATION_BUCKETS 12
+
 struct idt_identifier {
-    atomic32_t count;
+    struct percpu_counter count;
     enum irq_type type;
     flags_t flags;
 
     list_head_t list;
+
+    /* Only recorded for IRQ_INTERRUPT vectors, as syscalls and the page
+     * fault handler can sleep */
+    uint32_t duration_hist[IRQ_DURATION_BUCKETS];
+    uint32_t duration_max_ns;
 };
 
 static struct idt_identifier idt_ids[256];
@@ -110,6 +131,54 @@ int irq_register_callback(uint8_t irqno, void (*handler)(struct irq_frame *, voi
     return err;
 }
 
+/*
+ * Finds an unused vector in the MSI range, and registers `hand` on it. The
+ * check and the registration happen with interrupts off, so two callers can't
+ * end up with the same vector.
+ */
+static int irq_alloc_vector(struct irq_handler *hand)
+{
+    irq_flags_t flags = irq_save();
+    irq_disable();
+
+    int vec, ret = -ENOSPC;
+
+    for (vec = IRQ_MSI_VECTOR_START; vec < IRQ_MSI_VECTOR_END; vec++) {
+        if (list_empty(&idt_ids[vec].list)) {
+            x86_register_interrupt_handler(vec, hand);
+            ret = vec;
+            break;
+        }
+    }
+
+    irq_restore(flags);
+    return ret;
+}
+
+int irq_register_msi_callback(struct pci_dev *dev, void (*handler)(struct irq_frame *, void *param), const char *id, void *param)
+{
+    if (!lapic_is_enabled() || !pci_has_msi(dev))
+        return -ENODEV;
+
+    struct irq_handler *hand = kmalloc(sizeof(*hand), PAL_KERNEL);
+    irq_handler_init(hand);
+
+    hand->callback = handler;
+    hand->type = IRQ_INTERRUPT;
+    hand->id = id;
+    hand->param = param;
+    hand->flags = 0;
+
+    int vec = irq_alloc_vector(hand);
+    if (vec < 0) {
+        kfree(hand);
+        return vec;
+    }
+
+    pci_msi_enable(dev, lapic_msi_address(), lapic_msi_data(vec));
+    return vec;
+}
+
 static const char *cpu_exception_name[32] = {
     [0] = "Divide by zero",
     [1] = "Debug",
@@ -217,7 +286,7 @@ static struct irq_handler cpu_exceptions[] = {
     [4] = IRQ_HANDLER_INIT(cpu_exceptions[4], "Overflow", unhandled_cpu_exception, NULL, IRQ_INTERRUPT, 0),
     [5] = IRQ_HANDLER_INIT(cpu_exceptions[5], "Bound Range Exceeded", unhandled_cpu_exception, NULL, IRQ_INTERRUPT, 0),
     [6] = IRQ_HANDLER_INIT(cpu_exceptions[6], "Invalid OP", unhandled_cpu_exception, NULL, IRQ_INTERRUPT, 0),
-    [7] = IRQ_HANDLER_INIT(cpu_exceptions[7], "Device Not Available", unhandled_cpu_exception, NULL, IRQ_INTERRUPT, 0),
+    [7] = IRQ_HANDLER_INIT(cpu_exceptions[7], "Device Not Available", fpu_device_not_available_handler, NULL, IRQ_INTERRUPT, 0),
     [8] = IRQ_HANDLER_INIT(cpu_exceptions[8], "Double Fault", unhandled_cpu_exception, NULL, IRQ_INTERRUPT, 0),
     [10] = IRQ_HANDLER_INIT(cpu_exceptions[10], "Invalid TSS", unhandled_cpu_exception, NULL, IRQ_INTERRUPT, 0),
     [11] = IRQ_HANDLER_INIT(cpu_exceptions[11], "Segment Not Present", unhandled_cpu_exception, NULL, IRQ_INTERRUPT, 0),
@@ -253,6 +322,26 @@ void idt_init(void)
     idt_flush(((uintptr_t)&idt_ptr));
 }
 
+/* Called with interrupts off, so nothing else can touch the histogram */
+static void irq_record_duration(struct idt_identifier *ident, uint64_t cycles)
+{
+    uint64_t ns64 = tsc_cycles_to_ns(cycles);
+    uint32_t ns = (ns64 > 0xFFFFFFFF)? 0xFFFFFFFF: ns64;
+    uint32_t us = ns / 1000;
+    int bucket = 0;
+
+    if (us) {
+        bucket = log2(us) + 1;
+        if (bucket >= IRQ_DURATION_BUCKETS)
+            bucket = IRQ_DURATION_BUCKETS - 1;
+    }
+
+    ident->duration_hist[bucket]++;
+
+    if (ns > ident->duration_max_ns)
+        ident->duration_max_ns = ns;
+}
+
 void irq_global_handler(struct irq_frame *iframe)
 {
     struct idt_identifier *ident = idt_ids + iframe->intno;
@@ -260,25 +349,31 @@ void irq_global_handler(struct irq_frame *iframe)
     struct cpu_info *cpu = cpu_get_local();
     int frame_flag = 0;
     int pic8259_irq = -1;
+    uint64_t start_tsc = 0;
+
+    /* Whatever was running had interrupts on, so any section we think is open
+     * was really closed by the `iret` or `sysexit` back to it */
+    if (iframe->eflags & EFLAGS_IF)
+        irqsoff_reset();
 
-    atomic32_inc(&ident->count);
+    percpu_counter_inc(&ident->count);
 
     /* Only actual INTERRUPT types increment the intr_count */
-    if (ident->type == IRQ_INTERRUPT)
+    if (ident->type == IRQ_INTERRUPT) {
+        kstat_inc(KSTAT_INTERRUPTS);
         cpu->intr_count++;
+    }
 
     /* Check the DPL in the CS from where we came from. If it's the user's DPL,
      * then we just came from user-space */
     t = cpu->current;
     if ((iframe->cs & 0x03) == DPL_USER && t) {
         frame_flag = 1;
+        task_rusage_enter_kernel(t);
         t->context.prev_syscall = iframe->eax;
         t->context.frame = iframe;
     }
 
-    if (cpuid_has_sse() && t)
-        i387_fxsave(&t->arch_info.fxsave);
-
     /* When we get an IRQ from the 8259PIC, we disable the IRQ, send the EOI,
      * and then able it after we're done handling the IRQ */
     if (iframe->intno >= PIC8259_IRQ0 && iframe->intno <= PIC8259_IRQ0 + 16) {
@@ -286,15 +381,31 @@ void irq_global_handler(struct irq_frame *iframe)
 
         pic8259_disable_irq(pic8259_irq);
         pic8259_send_eoi(pic8259_irq);
+    } else if (iframe->intno >= IRQ_MSI_VECTOR_START && iframe->intno < IRQ_MSI_VECTOR_END) {
+        /* MSIs are edge-triggered and never shared, so there's nothing to
+         * mask. Any new MSI that comes in will wait until we turn interrupts
+         * back on */
+        lapic_eoi();
     }
 
+    if (ident->type == IRQ_INTERRUPT && tsc_is_usable())
+        start_tsc = rdtsc();
+
     struct irq_handler *hand;
     list_foreach_entry(&ident->list, hand, entry)
         (hand->callback) (iframe, hand->param);
 
+    if (start_tsc)
+        irq_record_duration(ident, rdtsc() - start_tsc);
+
     if (pic8259_irq >= 0)
         pic8259_enable_irq(pic8259_irq);
 
+    /* The rest of the work for this interrupt (and any that came in while it
+     * was being handled) happens in softirqs, with interrupts back on */
+    if (ident->type == IRQ_INTERRUPT && cpu->intr_count == 1)
+        softirq_run();
+
     if (frame_flag && t && t->sig_pending)
         signal_handle(t, iframe);
 
@@ -333,13 +444,19 @@ void irq_global_handler(struct irq_frame *iframe)
     if (flag_test(&t->flags, TASK_FLAG_KILLED))
         sys_exit(0);
 
-    if (cpuid_has_sse())
-        i387_fxrstor(&t->arch_info.fxsave);
+    if (frame_flag)
+        task_rusage_exit_kernel(t);
 }
 
+/*
+ * Offsets 0 to 255 are the vectors, and the one after that is the list of the
+ * longest interrupts-off sections.
+ */
+#define INTERRUPTS_SEQ_IRQSOFF 256
+
 static int interrupts_seq_start(struct seq_file *seq)
 {
-    if (seq->iter_offset == 256)
+    if (seq->iter_offset == INTERRUPTS_SEQ_IRQSOFF + 1)
         flag_set(&seq->flags, SEQ_FILE_DONE);
 
     return 0;
@@ -349,16 +466,92 @@ static void interrupts_seq_end(struct seq_file *seq)
 {
 }
 
+static void interrupts_render_symbol(struct seq_file *seq, uintptr_t addr)
+{
+    const struct symbol *sym = ksym_lookup(addr);
+
+    if (sym)
+        seq_printf(seq, "%s+0x%x", sym->name, addr - sym->addr);
+    else
+        seq_printf(seq, "0x%08x", addr);
+}
+
+static int interrupts_render_irqsoff(struct seq_file *seq)
+{
+    struct irqsoff_record records[IRQSOFF_RECORDS];
+    int i, count;
+
+    count = irqsoff_records_get(records);
+    if (!count)
+        return 0;
+
+    seq_printf(seq, "irqs-off:\n");
+
+    for (i = 0; i < count; i++) {
+        uint64_t ns = tsc_cycles_to_ns(records[i].cycles);
+
+        seq_printf(seq, "  %llu.%03llu us ", ns / 1000, ns % 1000);
+        interrupts_render_symbol(seq, records[i].start_ip);
+        seq_printf(seq, " -> ");
+        interrupts_render_symbol(seq, records[i].end_ip);
+        seq_printf(seq, "\n");
+    }
+
+    return 0;
+}
+
+static void interrupts_render_durations(struct seq_file *seq, struct idt_identifier *ident)
+{
+    uint32_t hist[IRQ_DURATION_BUCKETS];
+    uint32_t max_ns;
+    int i, last = -1;
+
+    irq_flags_t flags = irq_save();
+    irq_disable();
+
+    memcpy(hist, ident->duration_hist, sizeof(hist));
+    max_ns = ident->duration_max_ns;
+
+    irq_restore(flags);
+
+    for (i = 0; i < IRQ_DURATION_BUCKETS; i++)
+        if (hist[i])
+            last = i;
+
+    if (last == -1)
+        return;
+
+    seq_printf(seq, "    duration:");
+
+    for (i = 0; i <= last; i++) {
+        if (i == IRQ_DURATION_BUCKETS - 1)
+            seq_printf(seq, " >=%dus:%u", 1 << (i - 1), hist[i]);
+        else
+            seq_printf(seq, " <%dus:%u", 1 << i, hist[i]);
+    }
+
+    seq_printf(seq, " max:%u.%03uus\n", max_ns / 1000, max_ns % 1000);
+}
+
 static int interrupts_seq_render(struct seq_file *seq)
 {
+    struct idt_identifier *ident;
+
+    if (seq->iter_offset == INTERRUPTS_SEQ_IRQSOFF)
+        return interrupts_render_irqsoff(seq);
+
+    ident = idt_ids + seq->iter_offset;
+
     irq_flags_t flags = irq_save();
     irq_disable();
 
     struct irq_handler *hand;
-    list_foreach_entry(&idt_ids[seq->iter_offset].list, hand, entry)
-        seq_printf(seq, "%d: %d %s\n", seq->iter_offset, atomic32_get(&idt_ids[seq->iter_offset].count), hand->id);
+    list_foreach_entry(&ident->list, hand, entry)
+        seq_printf(seq, "%d: %llu %s\n", seq->iter_offset, percpu_counter_sum(&ident->count), hand->id);
 
     irq_restore(flags);
+
+    interrupts_render_durations(seq, ident);
     return 0;
 }
 
@@ -366,7 +559,7 @@ static int interrupts_seq_next(struct seq_file *seq)
 {
     seq->iter_offset++;
 
-    if (seq->iter_offset == 256)
+    if (seq->iter_offset == INTERRUPTS_SEQ_IRQSOFF + 1)
         flag_set(&seq->flags, SEQ_FILE_DONE);
 
     return 0;
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/string.h>
+#include <arch/asm.h>
+#include <arch/irq.h>
+#include <arch/tsc.h>
+#include <arch/irqsoff.h>
+
+/*
+ * These are called from cli(), sti(), and eflags_write(), so they can't turn
+ * interrupts on or off themselves. They're always called with interrupts
+ * off, which is enough to protect this state since we only run on one CPU.
+ */
+static struct irqsoff_state {
+    int open;
+    uint64_t start_tsc;
+    uintptr_t start_ip;
+
+    /* Sorted longest first, at most one entry per start_ip */
+    struct irqsoff_record records[IRQSOFF_RECORDS];
+} irqsoff_state;
+
+void irqsoff_start(void)
+{
+    if (!tsc_is_usable())
+        return;
+
+    irqsoff_state.open = 1;
+    irqsoff_state.start_ip = (uintptr_t)__builtin_return_address(0);
+    irqsoff_state.start_tsc = rdtsc();
+}
+
+static void irqsoff_record(uint64_t cycles, uintptr_t start_ip, uintptr_t end_ip)
+{
+    struct irqsoff_record *records = irqsoff_state.records;
+    int i, slot = IRQSOFF_RECORDS - 1;
+
+    /* Replace the existing entry for this call site, or the shortest one */
+    for (i = 0; i < IRQSOFF_RECORDS; i++) {
+        if (records[i].start_ip == start_ip) {
+            slot = i;
+            break;
+        }
+    }
+
+    if (cycles <= records[slot].cycles)
+        return;
+
+    for (; slot > 0 && records[slot - 1].cycles < cycles; slot--)
+        records[slot] = records[slot - 1];
+
+    records[slot].cycles = cycles;
+    records[slot].start_ip = start_ip;
+    records[slot].end_ip = end_ip;
+}
+
+void irqsoff_end(void)
+{
+    if (!irqsoff_state.open)
+        return;
+
+    irqsoff_state.open = 0;
+
+    uint64_t cycles = rdtsc() - irqsoff_state.start_tsc;
+
+    if (cycles > irqsoff_state.records[IRQSOFF_RECORDS - 1].cycles)
+        irqsoff_record(cycles, irqsoff_state.start_ip, (uintptr_t)__builtin_return_address(0));
+}
+
+void irqsoff_reset(void)
+{
+    irqsoff_state.open = 0;
+}
+
+int irqsoff_records_get(struct irqsoff_record *records)
+{
+    int count = 0;
+
+    irq_flags_t flags = irq_save();
+    irq_disable();
+
+    for (; count < IRQSOFF_RECORDS && irqsoff_state.records[count].cycles; count++)
+        records[count] = irqsoff_state.records[count];
+
+    irq_restore(flags);
+
+    return count;
+}
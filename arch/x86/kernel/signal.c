@@ -93,7 +93,7 @@ static void signal_setup_stack(struct task *current, struct sigaction *action, i
 
 static void signal_jump(struct task *current, int signum, struct irq_frame *iframe)
 {
-    struct sigaction *action = current->sig_actions + signum - 1;
+    struct sigaction *action = current->sighand->actions + signum - 1;
 
     if (current->context.prev_syscall) {
         switch (iframe->eax) {
@@ -159,7 +159,7 @@ int signal_handle(struct task *current, struct irq_frame *iframe)
 {
     while (current->sig_pending & (~current->sig_blocked)) {
         int signum = bit32_find_first_set((current->sig_pending & (~current->sig_blocked))) + 1;
-        struct sigaction *action = current->sig_actions + signum - 1;
+        struct sigaction *action = current->sighand->actions + signum - 1;
 
         kp(KP_TRACE, "signal: Handling %d on %d\n", signum, current->pid);
         kp(KP_TRACE, "signal: Handler: %p\n", action->sa_handler);
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/scheduler.h>
+#include <protura/signal.h>
+#include <protura/task.h>
+#include <protura/mm/user_check.h>
+
+#include <arch/asm.h>
+#include <arch/cpu.h>
+#include <arch/task.h>
+#include <arch/syscall.h>
+#include <arch/irqsoff.h>
+
+/* The registers userspace pushes before `sysenter`, %ebp points at these */
+struct sysenter_user_regs {
+    uint32_t ebp;
+    uint32_t edx;
+    uint32_t ecx;
+    uint32_t eip;
+};
+
+/*
+ * Called from sysenter_entry with a partially filled in irq_frame. This is a
+ * trimmed down version of irq_global_handler(), since we know this is always
+ * a syscall from userspace there's no interrupt bookkeeping to do.
+ *
+ * Returns non-zero if it is safe to return to userspace via sysexit.
+ */
+int sysenter_handler(struct irq_frame *frame)
+{
+    struct cpu_info *cpu = cpu_get_local();
+    struct task *t = cpu->current;
+    struct sysenter_user_regs regs;
+    uint32_t user_esp = frame->esp;
+    int fast_return = 0;
+
+    task_rusage_enter_kernel(t);
+
+    t->context.prev_syscall = frame->eax;
+    t->context.frame = frame;
+
+    /* `sysenter` turns interrupts off, but syscalls run with them on. The
+     * section they were off for started in userspace, so it isn't counted */
+    irqsoff_reset();
+    sti();
+
+    if (user_copy_to_kernel(&regs, make_user_buffer(user_esp))) {
+        /* There's no valid place to return to, so all we can do is kill it */
+        flag_set(&t->flags, TASK_FLAG_KILLED);
+        goto exit_syscall;
+    }
+
+    frame->ebp = regs.ebp;
+    frame->edx = regs.edx;
+    frame->ecx = regs.ecx;
+    frame->eip = regs.eip;
+
+    syscall_dispatch(frame);
+
+    /*
+     * If the frame still returns to the userspace stub, put %ebp back to
+     * pointing at the saved registers. This is necessary for restarted
+     * syscalls, since they re-execute the `sysenter`.
+     */
+    if (frame->eip == regs.eip && frame->esp == user_esp) {
+        frame->ebp = user_esp;
+        fast_return = 1;
+    }
+
+    if (t->sig_pending)
+        signal_handle(t, frame);
+
+  exit_syscall:
+    cli();
+
+    t->context.frame = NULL;
+
+    if (flag_test(&t->flags, TASK_FLAG_KILLED))
+        sys_exit(0);
+
+    if (cpu->intr_count == 0 && cpu->reschedule) {
+        scheduler_task_yield_preempt();
+        cpu->reschedule = 0;
+    }
+
+    if (flag_test(&t->flags, TASK_FLAG_KILLED))
+        sys_exit(0);
+
+    task_rusage_exit_kernel(t);
+
+    return fast_return && frame->eip == regs.eip && frame->esp == user_esp;
+}
@@ -38,10 +38,12 @@
 #include <arch/asm.h>
 #include <arch/cpu.h>
 #include <arch/task.h>
+#include <arch/fpu.h>
 
 void arch_task_switch(context_t *old, struct task *new)
 {
     cpu_set_kernel_stack(cpu_get_local(), new->kstack_top);
+    fpu_task_switch(new);
 
     if (flag_test(&new->flags, TASK_FLAG_KERNEL))
         set_current_page_directory(V2P(&kernel_dir));
@@ -134,11 +136,15 @@ void arch_task_change_address_space(struct address_space *addrspc)
     current->addrspc = addrspc;
     set_current_page_directory(V2P(addrspc->page_dir));
 
-    address_space_clear(old);
-    kfree(old);
+    address_space_put(old);
 }
 
 void arch_task_init(struct task *t)
 {
     arch_task_info_init(&t->arch_info);
 }
+
+void arch_task_free(struct task *t)
+{
+    fpu_task_release(t);
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+
+#include <arch/asm.h>
+#include <arch/irq.h>
+#include <arch/cpuid.h>
+#include <arch/drivers/pic8259_timer.h>
+#include <arch/tsc.h>
+
+uint32_t tsc_khz;
+uint32_t tsc_mult;
+
+#define TSC_CALIBRATE_MS 10
+#define TSC_CALIBRATE_LATCH (PIC8259_TIMER_FREQ / (1000 / TSC_CALIBRATE_MS))
+#define TSC_CALIBRATE_RUNS 3
+
+/*
+ * Counts the number of TSC cycles that pass while PIT channel 2 counts down
+ * TSC_CALIBRATE_MS milliseconds. Channel 2 is used because channel 0 is
+ * already programmed for the timer tick, and the output of channel 2 can be
+ * polled directly.
+ */
+static uint64_t tsc_calibrate_once(void)
+{
+    uint8_t gate = inb(PIC8259_TIMER_CH2_GATE_PORT);
+    uint64_t start, end;
+
+    /* Enable the gate, but keep the speaker disconnected */
+    outb(PIC8259_TIMER_CH2_GATE_PORT, (gate & ~PIC8259_TIMER_CH2_SPEAKER) | PIC8259_TIMER_CH2_GATE);
+
+    outb(PIC8259_TIMER_MODE,
+            PIC8259_TIMER_SEL2
+          | PIC8259_TIMER_ONESHOT
+          | PIC8259_TIMER_16BIT);
+    outb(PIC8259_TIMER_CH2, TSC_CALIBRATE_LATCH % 256);
+    outb(PIC8259_TIMER_CH2, TSC_CALIBRATE_LATCH / 256);
+
+    start = rdtsc();
+
+    while (!(inb(PIC8259_TIMER_CH2_GATE_PORT) & PIC8259_TIMER_CH2_OUT))
+        ;
+
+    end = rdtsc();
+
+    outb(PIC8259_TIMER_CH2_GATE_PORT, gate);
+
+    return end - start;
+}
+
+void tsc_init(void)
+{
+    uint64_t best = 0;
+    irq_flags_t irq_flags;
+    int i;
+
+    if (!cpuid_has_tsc()) {
+        kp(KP_NORMAL, "TSC: Not present, using tick resolution time\n");
+        return;
+    }
+
+    irq_flags = irq_save();
+    irq_disable();
+
+    /* The smallest result is the one least disturbed by SMIs and the like */
+    for (i = 0; i < TSC_CALIBRATE_RUNS; i++) {
+        uint64_t cycles = tsc_calibrate_once();
+
+        if (!best || cycles < best)
+            best = cycles;
+    }
+
+    irq_restore(irq_flags);
+
+    tsc_khz = best / TSC_CALIBRATE_MS;
+
+    /* Anything under 1MHz is bogus, and would overflow tsc_mult */
+    if (tsc_khz < 1000) {
+        tsc_khz = 0;
+        kp(KP_WARNING, "TSC: Calibration failed, using tick resolution time\n");
+        return;
+    }
+
+    tsc_mult = ((uint64_t)1000000 << TSC_SHIFT) / tsc_khz;
+
+    kp(KP_NORMAL, "TSC: %d.%03d MHz\n", tsc_khz / 1000, tsc_khz % 1000);
+}
@@ -21,6 +21,8 @@
 #include <protura/drivers/tty.h>
 #include <protura/symbols.h>
 #include <protura/mm/bootmem.h>
+#include <protura/trace.h>
+#include <protura/kstat.h>
 
 #include <arch/asm.h>
 #include <arch/cpu.h>
@@ -132,6 +134,8 @@ static void halt_and_dump_stack(struct irq_frame *frame, uintptr_t p)
     panic_notrace("KERNEL PAGE FAULT!\n");
 }
 
+DEFINE_TRACEPOINT(page_fault, "addr=0x%08x eip=0x%08x err=0x%x ret=%d");
+
 static void page_fault_handler(struct irq_frame *frame, void *param)
 {
     uintptr_t p;
@@ -148,9 +152,13 @@ static void page_fault_handler(struct irq_frame *frame, void *param)
         halt_and_dump_stack(frame, p);
 
     current->in_page_fault = 1;
+    kstat_inc(KSTAT_PAGE_FAULTS);
 
     /* Check if this page was a fault we can handle */
-    int ret = address_space_handle_pagefault(current->addrspc, (va_t)p);
+    int ret = address_space_handle_pagefault(current->addrspc, (va_t)p, pg_err_was_write(frame->err));
+
+    trace(page_fault, p, frame->eip, frame->err, ret);
+
     if (!ret)
         goto clear_in_page_fault;
 
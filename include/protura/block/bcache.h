@@ -12,6 +12,7 @@
 #include <protura/dev.h>
 
 struct block_device;
+struct block_batch;
 
 /*
  * Block state transitions:
@@ -37,8 +38,12 @@ struct block_device;
  * LOCKED: Block's data is currently being accessed (To read it, modify it,
  *         sync it, etc.), nobody else can access the data until it is unlocked.
  *
+ * REFERENCED: Block has been looked up since the block cache's CLOCK hand last
+ *             passed it, so it gets another trip around before being evicted.
+ *
  * Notes:
- *  * The state is protected by the flags_lock
+ *  * The state is protected by the flags_lock, except for REFERENCED which
+ *    is set and cleared atomically without it.
  *
  *  * When the block is LOCKED, refs > 0
  *
@@ -50,6 +55,7 @@ enum {
     BLOCK_DIRTY,
     BLOCK_VALID,
     BLOCK_LOCKED,
+    BLOCK_REFERENCED,
 };
 
 struct block {
@@ -76,9 +82,13 @@ struct block {
 
     list_node_t block_sync_node;
 
+    /* The batch this block was submitted with, if any. Only touched by
+     * whoever has the block locked */
+    struct block_batch *batch;
+
     list_node_t block_list_node;
     struct hlist_node cache;
-    list_node_t block_lru_node;
+    list_node_t block_clock_node;
 };
 
 static inline void block_mark_dirty(struct block *b)
@@ -106,15 +116,6 @@ static inline int block_waiting(struct block *b)
     return wait_queue_waiting(&b->flags_queue);
 }
 
-static inline void block_lock(struct block *b)
-{
-    using_spinlock(&b->flags_lock) {
-        wait_queue_event_spinlock(&b->flags_queue, !flag_test(&b->flags, BLOCK_LOCKED), &b->flags_lock);
-
-        flag_set(&b->flags, BLOCK_LOCKED);
-    }
-}
-
 static inline int block_try_lock(struct block *b)
 {
     using_spinlock(&b->flags_lock) {
@@ -127,6 +128,10 @@ static inline int block_try_lock(struct block *b)
     return 1;
 }
 
+/* Flushes the current task's block_plug before sleeping, since whoever has
+ * the block locked may be waiting on a block held back in it */
+void block_lock(struct block *b);
+
 static inline void block_unlock(struct block *b)
 {
     using_spinlock(&b->flags_lock) {
@@ -135,6 +140,62 @@ static inline void block_unlock(struct block *b)
     }
 }
 
+/*
+ * A block_batch tracks a group of locked blocks submitted together with
+ * block_batch_submit(), so that they can all be in flight at once. Once
+ * everything is submitted, either:
+ *
+ *  - block_batch_wait() is called, which returns when every block of the
+ *    batch is done, or
+ *  - the batch was made with a callback, and block_batch_finish() is called.
+ *    The callback is run once every block is done, possibly right away from
+ *    block_batch_finish(). It may be run from a tasklet, so it can't sleep.
+ *    The batch isn't touched after the callback, so it can free it.
+ *
+ * The batch starts out holding one extra count, dropped by finish/wait, so it
+ * can't complete while blocks are still being added.
+ */
+struct block_batch {
+    atomic_t pending;
+
+    spinlock_t lock;
+    int done;
+    struct wait_queue wait;
+
+    void (*callback) (struct block_batch *);
+};
+
+#define BLOCK_BATCH_INIT(batch, cb) \
+    { \
+        .pending = ATOMIC_INIT(1), \
+        .lock = SPINLOCK_INIT(), \
+        .wait = WAIT_QUEUE_INIT((batch).wait), \
+        .callback = (cb), \
+    }
+
+static inline void block_batch_init(struct block_batch *batch, void (*callback) (struct block_batch *))
+{
+    *batch = (struct block_batch)BLOCK_BATCH_INIT(*batch, callback);
+}
+
+/* Submits the locked block as part of the batch */
+void block_batch_submit(struct block_batch *, struct block *);
+
+/* Starts reading in the block if it isn't already valid or being read. The
+ * read is part of the batch if one is given */
+void block_batch_read(struct block_batch *, struct block_device *, sector_t);
+
+void block_batch_finish(struct block_batch *);
+void block_batch_wait(struct block_batch *);
+
+/* Called by drivers once the I/O for a submitted block is done. Marks it
+ * synced, unlocks it, completes its part of any batch, and drops the
+ * driver's reference */
+void block_io_done(struct block *);
+
+/* Unlocks a submitted block without doing any I/O on it */
+void block_io_unlock(struct block *);
+
 struct block *block_get(struct block_device *bdev, sector_t);
 struct block *block_get_nosync(struct block_device *bdev, sector_t sector);
 void block_put(struct block *);
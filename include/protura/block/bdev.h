@@ -48,6 +48,10 @@ struct block_device {
     spinlock_t block_size_lock;
     size_t block_size;
 
+    /* The most blocks that file reads will read ahead, zero turns it off.
+     * Set with the BLKRASET ioctl */
+    int readahead_max;
+
     /* 'whole' points back to the block_device representing the whole disk if
      * this is a partition */
     struct block_device *whole;
@@ -104,6 +108,31 @@ void block_dev_sync(struct block_device *, int wait);
 void block_sync_all(int wait);
 void block_submit(struct block *);
 
+/* Starts reading in the block if it isn't already valid or being read,
+ * without waiting for it to finish */
+void block_readahead(struct block_device *, sector_t);
+
+/*
+ * While a task has a plug, the blocks it submits are held back and handed to
+ * the drivers all at once when the plug is finished. That gives the elevator
+ * the whole batch to sort and merge, instead of the driver starting on the
+ * first block before the rest show up.
+ *
+ * Plugs nest, only the outermost one does anything. Waiting on a block or
+ * batch flushes the plug first, so a task can't wait on I/O it's holding
+ * back.
+ */
+struct block_plug {
+    list_head_t blocks;
+    int nested;
+};
+
+void block_plug_start(struct block_plug *);
+void block_plug_finish(struct block_plug *);
+
+/* Submits any blocks held back by the current task's plug */
+void block_plug_flush(void);
+
 dev_t block_dev_anon_get(void);
 void block_dev_anon_put(dev_t dev);
 
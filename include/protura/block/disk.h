@@ -13,6 +13,7 @@ struct disk;
 struct file_ops;
 struct block;
 struct block_device;
+struct block_queue;
 
 struct disk_part {
     sector_t first_sector;
@@ -21,7 +22,11 @@ struct disk_part {
 };
 
 struct disk_ops {
+    /* Disks without a block_queue get their blocks handed straight to
+     * sync_block(). Disks with one get them queued, and then run_queue() is
+     * called to let the driver pick up requests if it's idle */
     void (*sync_block) (struct disk *, struct block *);
+    void (*run_queue) (struct disk *);
 
     /* Called when the last reference to this disk is dropped */
     void (*put) (struct disk *);
@@ -54,6 +59,9 @@ struct disk {
 
     const struct disk_ops *ops;
 
+    /* Optional, free'd along with the disk */
+    struct block_queue *queue;
+
     void *priv;
 
     hlist_node_t hash_entry;
@@ -114,5 +122,6 @@ int disk_open(struct disk *);
 void disk_close(struct disk *);
 
 extern const struct file_ops disk_file_ops;
+extern const struct file_ops disk_elevator_file_ops;
 
 #endif
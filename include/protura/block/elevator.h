@@ -0,0 +1,119 @@
+#ifndef INCLUDE_PROTURA_BLOCK_ELEVATOR_H
+#define INCLUDE_PROTURA_BLOCK_ELEVATOR_H
+
+#include <protura/types.h>
+#include <protura/list.h>
+#include <arch/spinlock.h>
+#include <uapi/protura/block/elevator.h>
+
+struct block;
+struct block_queue;
+struct seq_file;
+
+/*
+ * A request is a run of blocks that are next to each other on the disk and
+ * are all going in the same direction. block_submit() merges each block into
+ * an existing request if it can, and otherwise starts a new one.
+ *
+ * `blocks` is in sector order, linked through `block->block_list_node`.
+ */
+struct block_request {
+    /* Used by the elevator, to keep the request in dispatch order */
+    list_node_t queue_entry;
+
+    /* Used by the elevator, to keep the request in submission order */
+    list_node_t fifo_entry;
+
+    /* Entry in the block_queue's list of requests that can be merged into */
+    list_node_t merge_entry;
+
+    sector_t sector;
+    sector_t sector_count;
+    int is_write;
+    int block_count;
+
+    /* When this request was submitted, in timer ms */
+    uint32_t submit_ms;
+
+    list_head_t blocks;
+};
+
+/*
+ * An elevator decides the order queued requests are given to the driver in.
+ * Merging is handled by the block_queue, so an elevator only ever sees whole
+ * requests. All of the callbacks except `alloc` and `free` are called with
+ * the block_queue's lock held, so they can't sleep.
+ */
+struct elevator {
+    const struct elevator_ops *ops;
+};
+
+struct elevator_ops {
+    const char *name;
+
+    struct elevator *(*alloc) (void);
+    void (*free) (struct elevator *);
+
+    void (*add) (struct elevator *, struct block_queue *, struct block_request *);
+
+    /* Removes and returns the next request to dispatch, NULL if empty */
+    struct block_request *(*next) (struct elevator *, struct block_queue *);
+};
+
+extern const struct elevator_ops elevator_noop_ops;
+extern const struct elevator_ops elevator_deadline_ops;
+extern const struct elevator_ops elevator_cloop_ops;
+
+/*
+ * The queue of pending requests for a disk. Drivers that want their requests
+ * sorted and merged give their disk a block_queue, and then take requests off
+ * of it with block_queue_next() when they're ready for more.
+ */
+struct block_queue {
+    spinlock_t lock;
+
+    struct elevator *elevator;
+
+    /* Requests that haven't been dispatched yet */
+    list_head_t requests;
+    struct block_request *last_merge;
+
+    /* The sector just past the end of the last dispatched request */
+    sector_t head_sector;
+
+    /* Disk sectors are (1 << sector_shift) bytes */
+    int sector_shift;
+
+    /* Limits on how big merged requests can get, zero means no limit */
+    sector_t max_sectors;
+    int max_blocks;
+
+    int queued;
+
+    uint64_t total_requests;
+    uint64_t total_merges;
+    uint64_t total_dispatched;
+};
+
+struct block_queue *block_queue_alloc(int sector_shift, sector_t max_sectors, int max_blocks);
+void block_queue_free(struct block_queue *);
+
+/*
+ * Queues the locked block, merging it into an existing request if possible.
+ * block_submit() has already taken the reference the driver releases when it
+ * is done with the block.
+ */
+void block_queue_submit(struct block_queue *, struct block *);
+
+/* Called by the driver to take the next request to process, with whatever
+ * locks the driver needs held. Returns NULL if there are none */
+struct block_request *block_queue_next(struct block_queue *);
+
+/* Calls block_io_done() on every block in the request, and frees it.
+ * Drivers call this from a tasklet rather than their interrupt handler */
+void block_request_complete(struct block_request *);
+
+int block_queue_set_elevator(struct block_queue *, const char *name);
+int block_queue_render(struct seq_file *, struct block_queue *);
+
+#endif
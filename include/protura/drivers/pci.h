@@ -48,6 +48,31 @@ void pci_config_write_uint8(struct pci_dev *dev, uint8_t regno, uint8_t value);
 #define PCI_REG_PRIMARY_BUS 0x18
 #define PCI_REG_SECONDARY_BUS 0x19
 
+#define PCI_REG_CAP_PTR     0x34
+
+#define PCI_STATUS_CAP_LIST (1 << 4)
+
+/*
+ * Capabilities are a linked list in config space, starting from
+ * PCI_REG_CAP_PTR. Each entry starts with its ID and the offset of the next.
+ */
+#define PCI_CAP_ID_MSI      0x05
+
+#define PCI_CAP_REG_ID      0x00
+#define PCI_CAP_REG_NEXT    0x01
+
+/* Offsets of the MSI registers, from the start of the capability. The data
+ * register moves if the device supports 64-bit addresses */
+#define PCI_MSI_REG_CONTROL    0x02
+#define PCI_MSI_REG_ADDR_LOW   0x04
+#define PCI_MSI_REG_ADDR_HIGH  0x08
+#define PCI_MSI_REG_DATA_32    0x08
+#define PCI_MSI_REG_DATA_64    0x0C
+
+#define PCI_MSI_CONTROL_ENABLE      (1 << 0)
+#define PCI_MSI_CONTROL_MME_MASK    (7 << 4) /* Multiple Message Enable */
+#define PCI_MSI_CONTROL_64BIT       (1 << 7)
+
 /*
  * Bits for the PCI_COMMAND config register
  * Bits 7, and 11 to 15 are reserved.
@@ -61,7 +86,7 @@ void pci_config_write_uint8(struct pci_dev *dev, uint8_t regno, uint8_t value);
 #define PCI_COMMAND_PERR_RESPONSE   (1 << 6) /* Parity Error Response */
 #define PCI_COMMAND_SERR_ENABLE     (1 << 8) /* SERR Driver Enable */
 #define PCI_COMMAND_FAST_B2B_ENABLE (1 << 9) /* Fast Back-to-Back Enable */
-#define PCI_COMMAND_INT_DISABLE     (1 << 10 /* Interrupt Disable */
+#define PCI_COMMAND_INT_DISABLE     (1 << 10) /* Interrupt Disable */
 
 #define PCI_HEADER_IS_MULTIFUNCTION 0x80
 #define PCI_HEADER_IS_BRIDGE        0x01
@@ -71,6 +96,18 @@ void pci_config_write_uint8(struct pci_dev *dev, uint8_t regno, uint8_t value);
 size_t pci_bar_size(struct pci_dev *dev, uint8_t bar_reg);
 int pci_has_interrupt_line(struct pci_dev *dev);
 
+/* Returns the config space offset of the capability, or zero if the device
+ * doesn't have it */
+uint8_t pci_find_capability(struct pci_dev *dev, uint8_t cap_id);
+
+/* Returns zero if the device has no MSI capability, or MSIs were turned off
+ * with the `pci.msi` kernel parameter */
+int pci_has_msi(struct pci_dev *dev);
+
+/* Programs the device to send a single MSI with the provided address and data,
+ * and turns off its INTx interrupt */
+int pci_msi_enable(struct pci_dev *dev, uint32_t address, uint16_t data);
+
 extern const struct file_ops pci_file_ops;
 
 #endif
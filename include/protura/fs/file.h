@@ -24,6 +24,21 @@ struct file_readdir_handler {
     int (*readdir) (struct file_readdir_handler *, ino_t, mode_t, const char *name, size_t len);
 };
 
+/*
+ * Read-ahead state for fs_file_generic_pread(), in file blocks. Reads that
+ * start where the last one stopped grow the window, anything else collapses
+ * it back to zero. It's only a hint, so it isn't locked.
+ */
+struct file_readahead {
+    /* The block the next sequential read would start in */
+    sector_t next;
+
+    /* Blocks before this have already been submitted */
+    sector_t end;
+
+    int window;
+};
+
 struct file {
     struct inode *inode;
     atomic_t ref;
@@ -32,6 +47,8 @@ struct file {
 
     off_t offset;
 
+    struct file_readahead readahead;
+
     const struct file_ops *ops;
 
     void *priv_data;
@@ -0,0 +1,22 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef INCLUDE_PROTURA_FUTEX_H
+#define INCLUDE_PROTURA_FUTEX_H
+
+#include <protura/types.h>
+#include <uapi/protura/futex.h>
+
+#define FUTEX_WAIT    __kFUTEX_WAIT
+#define FUTEX_WAKE    __kFUTEX_WAKE
+#define FUTEX_REQUEUE __kFUTEX_REQUEUE
+
+/* `arg` is a `struct timespec` pointer for FUTEX_WAIT, and the number of
+ * waiters to requeue for FUTEX_REQUEUE */
+int sys_futex(struct user_buffer uaddr, int op, uint32_t val, uintptr_t arg, struct user_buffer uaddr2);
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef INCLUDE_INITCALL_H
 #define INCLUDE_INITCALL_H
 
+#include <protura/types.h>
+
 /* Used to forward declare an initcall in a header
  * This is used to expose the initcall for taking a dependency on it */
 #define extern_initcall(name) \
@@ -36,8 +38,35 @@
     initcall(name, fn); \
     initcall_dependency(name, device)
 
-/* The NULL terminated list of initcalls to run on boot */
-extern void (*initcalls[]) (void);
+struct initcall {
+    const char *name;
+    void (*fn) (void);
+
+    /* Indexes into initcalls[] of the initcalls this one directly depends on,
+     * terminated by -1. They always come before this one in the array */
+    const int *deps;
+
+    /* Filled in by initcalls_run() */
+    int deps_left;
+    int started;
+    uint64_t start_ns;
+    uint64_t end_ns;
+};
+
+/* The list of initcalls to run on boot, generated by
+ * scripts/sort_initcalls.sh in dependency order and terminated by an entry
+ * with a NULL fn */
+extern struct initcall initcalls[];
+
+/* Runs every initcall, running the ones that don't depend on each other
+ * concurrently in separate kernel threads. Returns once all have finished. */
+void initcalls_run(void);
+
+/* Records the time at which the kernel finished booting, for /proc/boot_timing */
+void initcalls_boot_done(void);
+
+struct file_ops;
+extern const struct file_ops boot_timing_file_ops;
 
 /* These are defined hooks during the boot sequence you can take a depedency or
  * be a 'part-of', to ensure you run with certain facilities setup */
@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef INCLUDE_PROTURA_KPROF_H
+#define INCLUDE_PROTURA_KPROF_H
+
+#include <protura/types.h>
+#include <uapi/protura/kprof.h>
+
+/* The rate the timer interrupt takes samples at while the profiler is running */
+#define KPROF_SAMPLE_HZ 250
+
+extern int kprof_running;
+
+void __kprof_sample(uintptr_t pc, void *frame_ptr, int user);
+
+/* Called from the timer interrupt with the interrupted instruction pointer and
+ * frame pointer. `user` indicates the interrupt came from userspace, in which
+ * case no backtrace is taken. */
+static inline void kprof_sample(uintptr_t pc, void *frame_ptr, int user)
+{
+    if (kprof_running)
+        __kprof_sample(pc, frame_ptr, user);
+}
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef INCLUDE_PROTURA_KSTAT_H
+#define INCLUDE_PROTURA_KSTAT_H
+
+#include <protura/types.h>
+#include <protura/percpu_counter.h>
+
+struct file_ops;
+
+/*
+ * System-wide event counters, reported in /proc/stat. These are bumped on hot
+ * paths, so they're all percpu_counters.
+ */
+enum kstat_counter {
+    KSTAT_CONTEXT_SWITCHES,
+    KSTAT_INTERRUPTS,
+    KSTAT_SYSCALLS,
+    KSTAT_PAGE_FAULTS,
+    KSTAT_PAGE_ALLOCS,
+    KSTAT_PAGE_FREES,
+    KSTAT_KMALLOCS,
+    KSTAT_KFREES,
+    KSTAT_BLOCK_READS,
+    KSTAT_BLOCK_WRITES,
+    KSTAT_BLOCK_READ_BYTES,
+    KSTAT_BLOCK_WRITE_BYTES,
+    KSTAT_COUNT,
+};
+
+/* Syscalls are also counted individually, up to this number */
+#define KSTAT_SYSCALL_MAX 128
+
+extern struct percpu_counter kstat_counters[KSTAT_COUNT];
+extern struct percpu_counter kstat_syscall_counters[KSTAT_SYSCALL_MAX];
+
+static inline void kstat_add(enum kstat_counter counter, uint32_t val)
+{
+    percpu_counter_add(kstat_counters + counter, val);
+}
+
+static inline void kstat_inc(enum kstat_counter counter)
+{
+    percpu_counter_inc(kstat_counters + counter);
+}
+
+static inline void kstat_syscall(uint32_t sys)
+{
+    kstat_inc(KSTAT_SYSCALLS);
+
+    if (sys < KSTAT_SYSCALL_MAX)
+        percpu_counter_inc(kstat_syscall_counters + sys);
+}
+
+extern const struct file_ops kstat_file_ops;
+
+#endif
@@ -8,8 +8,13 @@
 /*
  * ktimer - Kernel timers
  *
- * Timers that can be set to trigger a callback (in an interrupt context) after
- * a certain number of milliseconds have gone by.
+ * Timers that can be set to trigger a callback (from the timer softirq) after
+ * a certain number of milliseconds (or nanoseconds) have gone by. Timers
+ * still fire on a timer tick, the deadline is rounded up to the first tick at
+ * or after it.
+ *
+ * Timers are kept in a hierarchical timing wheel, so adding and removing a
+ * timer is O(1) regardless of how many timers are pending.
  */
 
 struct ktimer {
@@ -36,8 +41,9 @@ static inline void ktimer_init(struct ktimer *timer)
     *timer = (struct ktimer)KTIMER_INIT(*timer);
 }
 
-void timer_handle_timers(uint64_t tick);
+void ktimer_setup(void);
 int timer_add(struct ktimer *timer, uint64_t ms);
+int timer_add_ns(struct ktimer *timer, uint64_t ns);
 
 /* Returns 0 if the timer was deleted, -1 if the timer was already scheduled */
 int timer_del(struct ktimer *timer);
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef INCLUDE_PROTURA_LOCKSTAT_H
+#define INCLUDE_PROTURA_LOCKSTAT_H
+
+#include <protura/types.h>
+#include <protura/compiler.h>
+#include <arch/asm.h>
+
+struct file_ops;
+
+/*
+ * lockstat - Lock contention and hold-time statistics
+ *
+ * When CONFIG_LOCKSTAT is enabled, every spinlock_t, mutex_t, and rwlock_t
+ * acquisition is recorded against a `struct lock_class`, and the results are
+ * reported in /proc/lockstat. All times are in TSC cycles.
+ *
+ * Locks that are interesting enough to look at on their own get their own
+ * class via DEFINE_LOCK_CLASS() and the *_INIT_CLASS() initializers, the rest
+ * are lumped together into one class per lock type.
+ *
+ * Lock classes live in the `.lockstat` section, so /proc/lockstat can walk
+ * them without any registration or locking.
+ *
+ * With CONFIG_LOCKSTAT disabled, all of this compiles out and the locks don't
+ * change size.
+ */
+#ifdef CONFIG_LOCKSTAT
+
+struct lock_class {
+    const char *name;
+
+    uint64_t acquisitions;
+    uint64_t contentions;
+
+    /* Time spent spinning or sleeping to get the lock */
+    uint64_t wait_total;
+    uint64_t wait_max;
+
+    /* Time between acquiring and releasing the lock. Not recorded for
+     * rwlock readers, as multiple readers can hold it at once */
+    uint64_t hold_total;
+    uint64_t hold_max;
+} __align(32);
+
+#define __lockstat __used __section(".lockstat")
+
+#define LOCK_CLASS_INIT(nam) { .name = (nam) }
+
+#define DEFINE_LOCK_CLASS(var, name) \
+    struct lock_class __lockstat var = LOCK_CLASS_INIT(name)
+
+/* The classes that locks without one are recorded against */
+extern struct lock_class lockstat_spinlock_class;
+extern struct lock_class lockstat_mutex_class;
+extern struct lock_class lockstat_rwlock_class;
+
+static inline uint64_t lockstat_now(void)
+{
+    return rdtsc();
+}
+
+void lockstat_acquired(struct lock_class *, int contended, uint64_t wait);
+void lockstat_released(struct lock_class *, uint64_t hold);
+
+#else
+
+#define DEFINE_LOCK_CLASS(var, name) \
+    extern struct lock_class var
+
+#endif
+
+extern const struct file_ops lockstat_file_ops;
+
+#endif
@@ -22,4 +22,16 @@
     KEEP(*(.kparam)); \
     __kparam_end = .;
 
+#define LOCKSTAT_SECTION \
+    . = ALIGN(32); \
+    __lockstat_start = .; \
+    KEEP(*(.lockstat)); \
+    __lockstat_end = .;
+
+#define TRACEPOINT_SECTION \
+    . = ALIGN(32); \
+    __tracepoint_start = .; \
+    KEEP(*(.tracepoint)); \
+    __tracepoint_end = .;
+
 #endif
@@ -11,6 +11,8 @@
 #include <protura/types.h>
 #include <protura/list.h>
 #include <protura/bits.h>
+#include <protura/atomic.h>
+#include <protura/mutex.h>
 #include <protura/mm/ptable.h>
 #include <arch/task.h>
 
@@ -30,16 +32,25 @@ struct vm_region {
 
 /* A task's mapped address space
  *
- * Note there is no locking, it is presumed that it is only ever owned by one
- * task, and the owner is the only one who modifies it. This may not be true in
- * the future. */
+ * Tasks created with CLONE_VM share an address_space, `refs` counts the tasks
+ * using it. `lock` must be held when modifying `vm_maps` or `brk` on an
+ * address_space that may be shared, and is held while handling page faults.
+ *
+ * `vm_maps` is kept sorted by starting address. */
 struct address_space {
+    atomic_t refs;
+    mutex_t lock;
+
     list_head_t vm_maps;
 
     pgd_t *page_dir;
 
     struct vm_map *code, *data, *bss, *stack;
     va_t brk;
+
+    /* Backing page for the uinfo_task page. It describes the task that the
+     * address_space was made for, and is shared by every task using it */
+    struct page *uinfo_page;
 };
 
 struct vm_map_ops {
@@ -91,6 +102,8 @@ enum vm_map_flags {
 
 #define ADDRESS_SPACE_INIT(addrspc) \
     { \
+        .refs = ATOMIC_INIT(1), \
+        .lock = MUTEX_INIT((addrspc).lock), \
         .vm_maps = LIST_HEAD_INIT((addrspc).vm_maps), \
         .code = NULL, \
         .data = NULL, \
@@ -122,11 +135,27 @@ void vm_map_resize(struct vm_map *map, struct vm_region new_size);
 
 void address_space_change(struct address_space *new);
 void address_space_clear(struct address_space *addrspc);
+
+static inline struct address_space *address_space_dup(struct address_space *addrspc)
+{
+    atomic_inc(&addrspc->refs);
+    return addrspc;
+}
+
+/* Drops a reference, and clears and frees the address_space when the last
+ * one is gone */
+void address_space_put(struct address_space *addrspc);
 void address_space_copy(struct address_space *new, struct address_space *old);
 void address_space_vm_map_add(struct address_space *, struct vm_map *);
 void address_space_vm_map_remove(struct address_space *, struct vm_map *);
-int address_space_handle_pagefault(struct address_space *, va_t address);
 
+/* Removes the map from its address_space, and frees it along with its pages */
+void address_space_vm_map_free(struct address_space *, struct vm_map *);
+/* `is_write` is set if the fault was caused by a write */
+int address_space_handle_pagefault(struct address_space *, va_t address, int is_write);
+
+/* Finds an unmapped region of at least `size` bytes above the program's data,
+ * or returns -ENOMEM */
 int address_space_find_region(struct address_space *, size_t size, struct vm_region *region);
 
 extern const struct vm_map_ops mmap_file_ops;
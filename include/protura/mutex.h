@@ -10,28 +10,75 @@
 
 #include <protura/debug.h>
 #include <protura/semaphore.h>
+#include <protura/lockstat.h>
 
 typedef struct semaphore mutex_t;
 
 #define MUTEX_INIT(sem) SEM_INIT(sem, 1)
 
+#ifdef CONFIG_LOCKSTAT
+# define MUTEX_INIT_CLASS(sem, cls) \
+    { .lock = SPINLOCK_INIT(), \
+      .count = 1, \
+      .queue = LIST_HEAD_INIT((sem).queue), \
+      .class = &(cls) }
+
+# define mutex_set_class(mut, cls) ((mut)->class = &(cls))
+#else
+# define MUTEX_INIT_CLASS(sem, cls) MUTEX_INIT(sem)
+# define mutex_set_class(mut, cls) do { } while (0)
+#endif
+
 static inline void mutex_init(mutex_t *mut)
 {
     sem_init(mut, 1);
 }
 
+#ifdef CONFIG_LOCKSTAT
+static inline struct lock_class *mutex_class(mutex_t *mut)
+{
+    return mut->class? mut->class: &lockstat_mutex_class;
+}
+#endif
+
 static inline void mutex_lock(mutex_t *mut)
 {
+#ifdef CONFIG_LOCKSTAT
+    uint64_t start = lockstat_now();
+    int contended = 0;
+
+    if (!sem_try_down(mut)) {
+        contended = 1;
+        sem_down(mut);
+    }
+
+    mut->acquire_tsc = lockstat_now();
+    lockstat_acquired(mutex_class(mut), contended, contended? mut->acquire_tsc - start: 0);
+#else
     sem_down(mut);
+#endif
 }
 
 static inline int mutex_try_lock(mutex_t *mut)
 {
-    return sem_try_down(mut);
+    int ret = sem_try_down(mut);
+
+#ifdef CONFIG_LOCKSTAT
+    if (ret) {
+        mut->acquire_tsc = lockstat_now();
+        lockstat_acquired(mutex_class(mut), 0, 0);
+    }
+#endif
+
+    return ret;
 }
 
 static inline void mutex_unlock(mutex_t *mut)
 {
+#ifdef CONFIG_LOCKSTAT
+    lockstat_released(mutex_class(mut), lockstat_now() - mut->acquire_tsc);
+#endif
+
     sem_up(mut);
 }
 
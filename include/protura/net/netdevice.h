@@ -6,6 +6,7 @@
 #include <protura/bits.h>
 #include <protura/rwlock.h>
 #include <protura/string.h>
+#include <protura/percpu_counter.h>
 #include <protura/net/ipv4/ipv4.h>
 #include <protura/net/if.h>
 
@@ -23,7 +24,9 @@ struct net_interface {
     atomic_t refs;
     mutex_t lock;
 
-    struct ifmetrics metrics;
+    /* Bumped for every packet, so these don't take the netdev lock */
+    struct percpu_counter rx_packets, tx_packets;
+    struct percpu_counter rx_bytes, tx_bytes;
 
     const char *name;
     char netdev_name[IFNAMSIZ];
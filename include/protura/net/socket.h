@@ -3,6 +3,7 @@
 
 #include <protura/fs/inode.h>
 #include <protura/hlist.h>
+#include <protura/mutex.h>
 #include <protura/net/sockaddr.h>
 #include <protura/net/ipv4/ipv4.h>
 #include <protura/net/ipv4/udp.h>
@@ -74,6 +75,11 @@ struct socket {
 };
 
 
+/* All sockets share the same lock classes for lockstat */
+extern struct lock_class socket_private_lock_class;
+extern struct lock_class socket_recv_lock_class;
+extern struct lock_class socket_send_lock_class;
+
 #define SOCKET_INIT(sock) \
     { \
         .refs = ATOMIC_INIT(0), \
@@ -83,12 +89,12 @@ struct socket {
         .proto_entry = LIST_NODE_INIT((sock).proto_entry), \
         .socket_entry = LIST_NODE_INIT((sock).socket_entry), \
         .socket_hash_entry = HLIST_NODE_INIT(), \
-        .private_lock = MUTEX_INIT((sock).private_lock), \
-        .recv_lock = MUTEX_INIT((sock).recv_lock), \
+        .private_lock = MUTEX_INIT_CLASS((sock).private_lock, socket_private_lock_class), \
+        .recv_lock = MUTEX_INIT_CLASS((sock).recv_lock, socket_recv_lock_class), \
         .recv_wait_queue = WAIT_QUEUE_INIT((sock).recv_wait_queue), \
         .recv_queue = LIST_HEAD_INIT((sock).recv_queue), \
         .out_of_order_queue = LIST_HEAD_INIT((sock).out_of_order_queue), \
-        .send_lock = MUTEX_INIT((sock).send_lock), \
+        .send_lock = MUTEX_INIT_CLASS((sock).send_lock, socket_send_lock_class), \
         .send_wait_queue = WAIT_QUEUE_INIT((sock).send_wait_queue), \
         .send_queue = LIST_HEAD_INIT((sock).send_queue), \
     }
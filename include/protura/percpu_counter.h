@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef INCLUDE_PROTURA_PERCPU_COUNTER_H
+#define INCLUDE_PROTURA_PERCPU_COUNTER_H
+
+#include <protura/types.h>
+#include <arch/cpu.h>
+#include <arch/irq.h>
+#include <arch/percpu.h>
+
+/* Protura only runs on one CPU at the moment */
+#define PERCPU_CPUS 1
+
+/*
+ * A statistics counter with one slot per CPU. Incrementing only touches the
+ * local CPU's slot, without a lock or atomic operation, and the slots are
+ * summed when the counter is read. These only count up, they're not meant
+ * for values that need to be exact at any given moment.
+ */
+struct percpu_counter {
+    uint64_t count[PERCPU_CPUS];
+};
+
+#define PERCPU_COUNTER_INIT() { .count = { 0 } }
+
+static inline void percpu_counter_add(struct percpu_counter *counter, uint32_t val)
+{
+    arch_percpu_add64(counter->count + cpu_get_local()->cpu_id, val);
+}
+
+static inline void percpu_counter_inc(struct percpu_counter *counter)
+{
+    percpu_counter_add(counter, 1);
+}
+
+static inline uint64_t percpu_counter_sum(struct percpu_counter *counter)
+{
+    uint64_t sum = 0;
+    int i;
+
+    irq_flags_t flags = irq_save();
+    irq_disable();
+
+    for (i = 0; i < PERCPU_CPUS; i++)
+        sum += counter->count[i];
+
+    irq_restore(flags);
+
+    return sum;
+}
+
+#endif
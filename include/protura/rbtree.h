@@ -0,0 +1,64 @@
+#ifndef INCLUDE_PROTURA_RBTREE_H
+#define INCLUDE_PROTURA_RBTREE_H
+
+#include <protura/stddef.h>
+#include <protura/container_of.h>
+
+/*
+ * Intrusive red-black tree
+ *
+ * The tree doesn't know anything about keys, the caller supplies a 'less'
+ * function when inserting and the tree keeps the nodes in that order. Nodes
+ * that compare equal are inserted after the existing ones, so walking the
+ * tree with rb_first()/rb_next() gives them back in insertion order.
+ *
+ * There's no locking, that is up to the user of the tree.
+ */
+struct rb_node {
+    struct rb_node *parent, *left, *right;
+    int color;
+};
+
+struct rb_root {
+    struct rb_node *node;
+};
+
+typedef struct rb_node rb_node_t;
+typedef struct rb_root rb_root_t;
+
+#define RB_ROOT_INIT { .node = NULL }
+
+static inline void rb_root_init(rb_root_t *root)
+{
+    root->node = NULL;
+}
+
+static inline int rb_empty(const rb_root_t *root)
+{
+    return !root->node;
+}
+
+#define rb_entry(node, type, member) \
+    container_of(node, type, member)
+
+/* Necessary because container_of will modify the 'node' pointer, with the
+ * result being that if it starts out as NULL, it won't end as NULL */
+#define rb_entry_or_null(node, type, member) \
+    ({ \
+        typeof(node) __rb_tmp = (node); \
+        ((__rb_tmp)? rb_entry(__rb_tmp, type, member): NULL); \
+    })
+
+void rb_insert(rb_root_t *, rb_node_t *, int (*less) (const rb_node_t *, const rb_node_t *));
+void rb_erase(rb_root_t *, rb_node_t *);
+
+/* Return NULL when there are no more nodes */
+rb_node_t *rb_first(const rb_root_t *);
+rb_node_t *rb_next(const rb_node_t *);
+
+#define rb_foreach_entry(root, pos, member) \
+    for (pos = rb_entry_or_null(rb_first(root), typeof(*(pos)), member); \
+         pos; \
+         pos = rb_entry_or_null(rb_next(&(pos)->member), typeof(*(pos)), member))
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef INCLUDE_PROTURA_RESOURCE_H
+#define INCLUDE_PROTURA_RESOURCE_H
+
+#include <protura/types.h>
+#include <uapi/protura/resource.h>
+
+#define RUSAGE_SELF     __kRUSAGE_SELF
+#define RUSAGE_CHILDREN __kRUSAGE_CHILDREN
+
+struct task;
+
+/*
+ * Per-task resource usage, see sched/rusage.c
+ *
+ * Time is split at the user/kernel boundary: every entry into the kernel from
+ * userspace charges the time since the last boundary as user time, and every
+ * return charges it as system time. A task is always in the kernel when it is
+ * switched out, so the time between being switched in and out is system time.
+ */
+struct task_rusage {
+    uint64_t utime_ns;
+    uint64_t stime_ns;
+
+    uint32_t minflt;
+    uint32_t majflt;
+    uint32_t nvcsw;
+    uint32_t nivcsw;
+
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+};
+
+/* Called with interrupts off by the interrupt and syscall entry code */
+void task_rusage_enter_kernel(struct task *);
+void task_rusage_exit_kernel(struct task *);
+
+/* Called by the scheduler around task_switch() */
+void task_rusage_switch_in(struct task *);
+void task_rusage_switch_out(struct task *, int preempted);
+
+void task_rusage_fault(struct task *, int major);
+void task_rusage_io(struct task *, uint64_t read_bytes, uint64_t write_bytes);
+
+/* Adds the usage of a reaped child, and all of its reaped children, to
+ * `parent`'s child usage */
+void task_rusage_reap(struct task *parent, struct task *child);
+
+/* Takes a consistent copy of the usage of `t`, including the time it has been
+ * running since the last boundary */
+void task_rusage_get(struct task *t, struct task_rusage *usage, struct task_rusage *child_usage);
+
+void task_rusage_to_user(const struct task_rusage *, struct __krusage *);
+
+int sys_getrusage(int who, struct user_buffer usage);
+int sys_times(struct user_buffer buf);
+
+#endif
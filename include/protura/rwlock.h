@@ -14,6 +14,7 @@
 #include <protura/spinlock.h>
 #include <protura/scheduler.h>
 #include <protura/wait.h>
+#include <protura/lockstat.h>
 
 /* If count is '-1', that indicates a writer currently holds the lock.  A
  * postiive count is the current number of readers */
@@ -23,6 +24,11 @@ struct rwlock {
     int count;
     struct wait_queue readers;
     struct wait_queue writers;
+
+#ifdef CONFIG_LOCKSTAT
+    struct lock_class *class;
+    uint64_t write_tsc;
+#endif
 };
 
 typedef struct rwlock rwlock_t;
@@ -33,6 +39,17 @@ typedef struct rwlock rwlock_t;
       .readers = WAIT_QUEUE_INIT((rwlock).readers), \
       .writers = WAIT_QUEUE_INIT((rwlock).writers) }
 
+#ifdef CONFIG_LOCKSTAT
+# define rwlock_set_class(rwlock, cls) ((rwlock)->class = &(cls))
+
+static inline struct lock_class *rwlock_class(rwlock_t *rwlock)
+{
+    return rwlock->class? rwlock->class: &lockstat_rwlock_class;
+}
+#else
+# define rwlock_set_class(rwlock, cls) do { } while (0)
+#endif
+
 static inline void rwlock_init(rwlock_t *rwlock)
 {
     memset(rwlock, 0, sizeof(*rwlock));
@@ -45,8 +62,17 @@ static inline void rwlock_init(rwlock_t *rwlock)
 
 static inline void __rwlock_rlock(rwlock_t *rwlock)
 {
+#ifdef CONFIG_LOCKSTAT
+    uint64_t start = lockstat_now();
+    int contended = rwlock->count < 0;
+#endif
+
     wait_queue_event_spinlock(&rwlock->readers, rwlock->count >= 0, &rwlock->lock);
     rwlock->count++;
+
+#ifdef CONFIG_LOCKSTAT
+    lockstat_acquired(rwlock_class(rwlock), contended, contended? lockstat_now() - start: 0);
+#endif
 }
 
 static inline void rwlock_rlock(rwlock_t *rwlock)
@@ -76,8 +102,18 @@ static inline void rwlock_runlock(rwlock_t *rwlock)
 
 static inline void __rwlock_wlock(rwlock_t *rwlock)
 {
+#ifdef CONFIG_LOCKSTAT
+    uint64_t start = lockstat_now();
+    int contended = rwlock->count != 0;
+#endif
+
     wait_queue_event_spinlock(&rwlock->writers, rwlock->count == 0, &rwlock->lock);
     rwlock->count--;
+
+#ifdef CONFIG_LOCKSTAT
+    rwlock->write_tsc = lockstat_now();
+    lockstat_acquired(rwlock_class(rwlock), contended, contended? rwlock->write_tsc - start: 0);
+#endif
 }
 
 static inline void rwlock_wlock(rwlock_t *rwlock)
@@ -88,6 +124,10 @@ static inline void rwlock_wlock(rwlock_t *rwlock)
 
 static inline void __rwlock_wunlock(rwlock_t *rwlock)
 {
+#ifdef CONFIG_LOCKSTAT
+    lockstat_released(rwlock_class(rwlock), lockstat_now() - rwlock->write_tsc);
+#endif
+
     rwlock->count = 0;
 
     /* Since we just did a write, we're better off waking any writers if we
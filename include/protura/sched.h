@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef INCLUDE_PROTURA_SCHED_H
+#define INCLUDE_PROTURA_SCHED_H
+
+#include <protura/types.h>
+#include <uapi/protura/sched.h>
+
+#define PRIO_PROCESS __kPRIO_PROCESS
+#define PRIO_PGRP    __kPRIO_PGRP
+#define PRIO_USER    __kPRIO_USER
+
+#define SCHED_OTHER __kSCHED_OTHER
+#define SCHED_FIFO  __kSCHED_FIFO
+
+#define SCHED_PRIO_MIN __kSCHED_PRIO_MIN
+#define SCHED_PRIO_MAX __kSCHED_PRIO_MAX
+
+#define CLONE_VM      __kCLONE_VM
+#define CLONE_FS      __kCLONE_FS
+#define CLONE_FILES   __kCLONE_FILES
+#define CLONE_SIGHAND __kCLONE_SIGHAND
+
+#define NICE_MIN __kNICE_MIN
+#define NICE_MAX __kNICE_MAX
+
+/* The weight of a nice 0 task, every other nice level is scaled relative to this */
+#define SCHED_NICE_0_WEIGHT 1024
+
+/* Matches the layout of newlib's `struct sched_param` */
+struct sched_param {
+    int sched_priority;
+};
+
+struct task;
+
+uint32_t sched_nice_to_weight(int nice);
+
+/*
+ * Changes the scheduling class of a task. SCHED_FIFO tasks always run before
+ * SCHED_OTHER tasks, and run until they sleep, yield, or a higher priority
+ * SCHED_FIFO task becomes runnable.
+ */
+int sched_task_set_policy(struct task *t, int policy, int priority);
+
+int sys_nice(int inc);
+int sys_setpriority(int which, int who, int prio);
+int sys_getpriority(int which, int who);
+int sys_sched_setscheduler(pid_t pid, int policy, struct user_buffer param);
+int sys_sched_getscheduler(pid_t pid);
+
+#endif
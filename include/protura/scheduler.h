@@ -5,8 +5,10 @@
 #include <protura/task.h>
 #include <protura/list.h>
 #include <protura/queue.h>
+#include <protura/sched.h>
 #include <arch/timer.h>
 #include <arch/cpu.h>
+#include <protura/trace.h>
 
 struct tty;
 
@@ -30,6 +32,7 @@ void scheduler_task_clear_sid_tty(struct tty *tty, pid_t sid);
 struct file_ops;
 
 extern struct file_ops task_file_ops;
+extern struct file_ops task_usage_file_ops;
 extern struct procfs_entry_ops tasks_ops;
 extern struct procfs_entry_ops task_api_ops;
 
@@ -67,16 +70,38 @@ static inline void scheduler_set_state(enum task_state state)
 #define scheduler_set_running()  scheduler_set_state(TASK_RUNNING)
 #define scheduler_set_intr_sleeping() scheduler_set_state(TASK_INTR_SLEEPING)
 
+DECLARE_TRACEPOINT(sched_wake);
+
+/* Puts a task that was taken off the runqueue while asleep back on it. This
+ * doesn't take the ktasks lock, so it can be called with it held or from an
+ * interrupt */
+void scheduler_task_queue_woken(struct task *);
+
+/* Waking a real-time task requests a reschedule, so that it preempts the
+ * current task as soon as possible instead of waiting for the next timeslice */
+static inline void __scheduler_task_woken(struct task *t)
+{
+    trace(sched_wake, t->pid);
+    scheduler_task_queue_woken(t);
+
+    if (t->sched_policy == SCHED_FIFO)
+        cpu_get_local()->reschedule = 1;
+}
+
 static inline void scheduler_task_wake(struct task *t)
 {
-    if (t->state == TASK_SLEEPING || t->state == TASK_INTR_SLEEPING)
+    if (t->state == TASK_SLEEPING || t->state == TASK_INTR_SLEEPING) {
         t->state = TASK_RUNNING;
+        __scheduler_task_woken(t);
+    }
 }
 
 static inline void scheduler_task_intr_wake(struct task *t)
 {
-    if (t->state == TASK_INTR_SLEEPING)
+    if (t->state == TASK_INTR_SLEEPING) {
         t->state = TASK_RUNNING;
+        __scheduler_task_woken(t);
+    }
 }
 
 static inline uint32_t scheduler_calculate_wakeup(uint32_t mseconds)
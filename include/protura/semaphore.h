@@ -18,6 +18,12 @@ struct semaphore {
 
     int count;
     list_head_t queue;
+
+#ifdef CONFIG_LOCKSTAT
+    /* Only used when the semaphore is used as a mutex_t */
+    struct lock_class *class;
+    uint64_t acquire_tsc;
+#endif
 };
 
 struct semaphore_wait_entry {
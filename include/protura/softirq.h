@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef INCLUDE_PROTURA_SOFTIRQ_H
+#define INCLUDE_PROTURA_SOFTIRQ_H
+
+#include <protura/types.h>
+#include <protura/list.h>
+#include <protura/bits.h>
+
+struct file_ops;
+
+/*
+ * softirq - Deferred interrupt work
+ *
+ * Hard interrupt handlers run with interrupts off and their PIC line masked,
+ * so they should only talk to the hardware and then raise a softirq for the
+ * rest. Pending softirqs are run at the end of the outermost interrupt, after
+ * the PIC line is unmasked and with interrupts turned back on. Softirqs are
+ * never run in parallel with themselves, and the task that was interrupted
+ * can't be rescheduled until they're done, so they can't sleep.
+ *
+ * If softirqs keep getting raised while they're running, we give up after
+ * SOFTIRQ_MAX_RESTART passes and leave the rest for the end of the next
+ * interrupt, so that a flood of packets can't lock out everything else.
+ */
+enum softirq_type {
+    SOFTIRQ_TIMER,
+    SOFTIRQ_TASKLET,
+    SOFTIRQ_COUNT,
+};
+
+#define SOFTIRQ_MAX_RESTART 10
+
+void softirq_register(enum softirq_type, void (*handler) (void));
+void softirq_raise(enum softirq_type);
+
+/* Called by the interrupt handler with interrupts off, returns with them off */
+void softirq_run(void);
+
+/*
+ * Tasklets are the driver-facing side of softirqs. Scheduling a tasklet that
+ * is already scheduled does nothing, so a driver can schedule its tasklet on
+ * every interrupt and the tasklet will handle everything that happened since
+ * the last time it ran.
+ *
+ * A tasklet is unscheduled right before its callback is run, so it can be
+ * scheduled again while it is running.
+ */
+struct tasklet {
+    list_node_t entry;
+    flags_t flags;
+    void (*callback) (struct tasklet *);
+};
+
+enum {
+    TASKLET_SCHEDULED,
+};
+
+#define TASKLET_INIT(tasklet, cb) \
+    { \
+        .entry = LIST_NODE_INIT((tasklet).entry), \
+        .callback = (cb), \
+    }
+
+static inline void tasklet_init(struct tasklet *tasklet, void (*callback) (struct tasklet *))
+{
+    *tasklet = (struct tasklet)TASKLET_INIT(*tasklet, callback);
+}
+
+void tasklet_schedule(struct tasklet *);
+
+extern const struct file_ops softirq_file_ops;
+
+#endif
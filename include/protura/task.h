@@ -4,14 +4,17 @@
 #include <protura/types.h>
 #include <protura/errors.h>
 #include <protura/list.h>
+#include <protura/rbtree.h>
 #include <protura/stddef.h>
 #include <protura/compiler.h>
+#include <protura/atomic.h>
 #include <protura/wait.h>
 #include <protura/work.h>
 #include <protura/mm/vm.h>
 #include <protura/signal.h>
 #include <protura/fs/fdset.h>
 #include <protura/users.h>
+#include <protura/resource.h>
 #include <arch/context.h>
 #include <arch/paging.h>
 #include <arch/cpu.h>
@@ -20,6 +23,7 @@
 struct file;
 struct inode;
 struct tty;
+struct block_plug;
 
 /* Indicates the current state of a task. It should be noted that these states
  * are separate from preemption. Tasks can be preempted and restarted at any
@@ -49,6 +53,35 @@ enum {
     TASK_FLAG_KILLED,
     TASK_FLAG_SESSION_LEADER,
     TASK_FLAG_RW_USER,
+    TASK_FLAG_QUEUED,
+};
+
+/* The file descriptor table. Shared between tasks created with CLONE_FILES.
+ *
+ * Entries in `fds` are only ever changed atomically, see task_fd.c */
+struct task_files {
+    atomic_t refs;
+
+    struct file *fds[NOFILE];
+    fd_set close_on_exec;
+};
+
+/* The current directory and umask. Shared between tasks created with
+ * CLONE_FS. `lock` protects changing `cwd`. */
+struct task_fs {
+    atomic_t refs;
+    spinlock_t lock;
+
+    struct inode *cwd;
+    mode_t umask;
+};
+
+/* Signal handlers. Shared between tasks created with CLONE_SIGHAND. The
+ * pending and blocked signals are always per-task. */
+struct task_sighand {
+    atomic_t refs;
+
+    struct sigaction actions[NSIG];
 };
 
 struct task {
@@ -58,6 +91,18 @@ struct task {
 
     enum task_state state;
 
+    /* Scheduling information, see sched/fair.c and sched/rt.c */
+    int sched_policy;
+    int rt_priority;
+    int nice;
+    uint64_t vruntime;
+
+    /* Where this task sits in the runqueue while TASK_FLAG_QUEUED is set, or
+     * on the woken list until the scheduler gets to it */
+    rb_node_t sched_fair_node;
+    list_node_t sched_rt_node;
+    list_node_t sched_woken_node;
+
     struct tty *tty;
 
     flags_t flags;
@@ -75,6 +120,11 @@ struct task {
 
     struct address_space *addrspc;
 
+    /* The user stack allocated for this task by clone(), if it has one. It
+     * is removed from addrspc when the task exits, and forgotten on exec()
+     * since it stays with the old address_space. */
+    struct vm_map *user_stack;
+
     struct task *parent;
 
     list_node_t task_sibling_list;
@@ -86,20 +136,25 @@ struct task {
     void *kstack_bot, *kstack_top;
     int in_page_fault;
 
-    struct file *files[NOFILE];
-    struct inode *cwd;
-
-    fd_set close_on_exec;
-
-    mode_t umask;
+    struct task_files *files;
+    struct task_fs *fs;
 
     /* When modifying the sets, this lock must be taken */
     sigset_t sig_pending, sig_blocked;
 
-    struct sigaction sig_actions[NSIG];
+    struct task_sighand *sighand;
 
     struct credentials creds;
 
+    /* Resource usage of this task, and of its children that have been
+     * waited on. `usage_mark` is the time of the last user/kernel boundary,
+     * see sched/rusage.c */
+    struct task_rusage usage, child_usage;
+    uint64_t usage_mark;
+
+    /* Blocks submitted while this is set are held back, see block/bdev.h */
+    struct block_plug *block_plug;
+
     struct arch_task_info arch_info;
 
     /* The address to jump too if a user fault happens while reading/writing
@@ -119,6 +174,7 @@ extern struct task *task_pid1;
  * scheduler list using scheduler_task_add(). */
 struct task *__must_check task_new(void);
 struct task *__must_check task_fork(struct task *);
+struct task *__must_check task_clone(struct task *, flags_t clone_flags, va_t entry, va_t arg);
 struct task *__must_check task_user_new_exec(const char *exe);
 struct task *__must_check task_user_new(void);
 
@@ -128,6 +184,7 @@ void task_init(struct task *);
 pid_t __fork(struct task *current, pid_t pgrp);
 pid_t sys_fork(void);
 pid_t sys_fork_pgrp(pid_t pgrp); /* Fork and set pgrp - Protura exclusive */
+pid_t sys_clone(flags_t clone_flags, struct user_buffer entry, struct user_buffer arg);
 pid_t sys_getpid(void);
 pid_t sys_getppid(void);
 pid_t sys_setsid(void);
@@ -149,6 +206,21 @@ void task_kernel_init(struct task *t, const char *name, int (*kernel_task)(void
 void task_print(char *buf, size_t size, struct task *);
 void task_switch(context_t *old, struct task *new);
 
+struct task_files *task_files_dup(struct task_files *);
+void task_files_put(struct task_files *);
+struct task_fs *task_fs_dup(struct task_fs *);
+void task_fs_put(struct task_fs *);
+struct task_sighand *task_sighand_dup(struct task_sighand *);
+void task_sighand_put(struct task_sighand *);
+
+/* Gives the current task a private copy of its signal handlers, if it is
+ * sharing them with other tasks */
+int task_sighand_unshare(struct task *);
+
+/* Gives the current task a private copy of its file table, if it is sharing
+ * it with other tasks */
+int task_files_unshare(struct task *);
+
 /* Turns the provided task into a 'zombie' - Closes all files, releases held
  * inode's, free's the address-space, etc... Free's everything except it's own
  * kernel stack. Then, it sets the tasks state to TASK_ZOMBIE. Zombie's are set
@@ -161,9 +233,9 @@ int task_fd_assign_empty(struct task *t, struct file *filp);
 int task_fd_get_empty(struct task *t);
 void task_fd_release(struct task *t, int fd);
 #define task_fd_assign(t, fd, filp) \
-    ((t)->files[(fd)] = (filp))
+    ((t)->files->fds[(fd)] = (filp))
 #define task_fd_get(t, fd) \
-    (((intptr_t)(t)->files[(fd)] == -1)? NULL: (t)->files[(fd)])
+    (((intptr_t)(t)->files->fds[(fd)] == -1)? NULL: (t)->files->fds[(fd)])
 
 static inline int task_fd_get_checked(struct task *t, int fd, struct file **filp)
 {
@@ -9,12 +9,25 @@
 #define INCLUDE_PROTURA_TIME_H
 
 #include <protura/types.h>
+#include <uapi/protura/time.h>
+
+#define CLOCK_REALTIME  __kCLOCK_REALTIME
+#define CLOCK_MONOTONIC __kCLOCK_MONOTONIC
+
+#define NSEC_PER_SEC  1000000000ULL
+#define NSEC_PER_MSEC 1000000ULL
+#define NSEC_PER_USEC 1000ULL
 
 struct timeval {
     time_t tv_sec;
     suseconds_t tv_usec;
 };
 
+struct timespec {
+    time_t tv_sec;
+    long tv_nsec;
+};
+
 struct timezone {
     int tz_minuteswest;
     int tz_dsttime;
@@ -38,12 +51,25 @@ void protura_boot_time_set(time_t t);
 
 time_t protura_current_time_get(void);
 
+/* Nanoseconds since boot, never goes backwards */
+uint64_t protura_monotonic_ns(void);
+
+/* Nanoseconds since the Unix Epoch */
+uint64_t protura_realtime_ns(void);
+
+static inline void protura_ns_to_timespec(uint64_t ns, struct timespec *ts)
+{
+    ts->tv_sec = ns / NSEC_PER_SEC;
+    ts->tv_nsec = ns % NSEC_PER_SEC;
+}
+
 extern struct procfs_entry_ops uptime_ops;
 extern struct procfs_entry_ops boot_time_ops;
 extern struct procfs_entry_ops current_time_ops;
 
 int sys_time(struct user_buffer t);
 int sys_gettimeofday(struct user_buffer tv, struct user_buffer tz);
+int sys_clock_gettime(int clock_id, struct user_buffer ts);
 int sys_usleep(useconds_t useconds);
 
 #endif
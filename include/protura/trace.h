@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef INCLUDE_PROTURA_TRACE_H
+#define INCLUDE_PROTURA_TRACE_H
+
+#include <protura/types.h>
+#include <protura/compiler.h>
+#include <protura/kparam.h>
+#include <arch/asm.h>
+#include <uapi/protura/trace.h>
+
+/*
+ * Static tracepoints
+ *
+ * A tracepoint records a fixed-size binary event - timestamp, CPU, PID, and up
+ * to TRACE_MAX_ARGS 32-bit arguments - into a per-CPU ring buffer. The
+ * tracepoint's format string is only applied when the events are read from
+ * /proc/trace/buffer, so a trace() call costs about the same as a few stores.
+ *
+ * Tracepoints start disabled, and are enabled individually either with the
+ * `trace.<name>` kernel parameter, or at runtime via /proc/trace/events. A
+ * disabled tracepoint is a single load and branch.
+ *
+ * Usage:
+ *
+ *   DEFINE_TRACEPOINT(block_submit, "dev=%d:%d sector=%u write=%d");
+ *
+ *   trace(block_submit, DEV_MAJOR(dev), DEV_MINOR(dev), b->sector, write);
+ *
+ * The format string must only use 32-bit conversions (%d, %u, %x, ...), as
+ * every argument is stored as a uint32_t.
+ */
+
+#define TRACE_MAX_ARGS 10
+
+struct tracepoint {
+    const char *name;
+    const char *fmt;
+
+    int enabled;
+    uint32_t hits;
+} __align(16);
+
+#define __tracepoint __used __section(".tracepoint")
+
+#define DEFINE_TRACEPOINT(nam, format) \
+    struct tracepoint __tracepoint __tracepoint_##nam = { \
+        .name = #nam, \
+        .fmt = (format), \
+    }; \
+    KPARAM("trace." #nam, &__tracepoint_##nam.enabled, KPARAM_BOOL)
+
+#define DECLARE_TRACEPOINT(nam) \
+    extern struct tracepoint __tracepoint_##nam
+
+void __trace_event(struct tracepoint *, const uint32_t *args);
+
+#define trace(nam, ...) \
+    do { \
+        if (unlikely(READ_ONCE(__tracepoint_##nam.enabled))) \
+            __trace_event(&__tracepoint_##nam, (const uint32_t[TRACE_MAX_ARGS]) { __VA_ARGS__ }); \
+    } while (0)
+
+#endif
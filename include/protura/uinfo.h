@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef INCLUDE_PROTURA_UINFO_H
+#define INCLUDE_PROTURA_UINFO_H
+
+#include <protura/types.h>
+#include <uapi/protura/uinfo.h>
+
+struct task;
+struct address_space;
+
+#define UINFO_TIME_ADDR ((va_t)__kUINFO_TIME_ADDR)
+#define UINFO_TASK_ADDR ((va_t)__kUINFO_TASK_ADDR)
+
+/* Called on every timer tick with the new tick time. tsc_mult is zero if
+ * there is no usable TSC */
+void uinfo_time_update(uint64_t tick_ns, uint64_t tick_tsc, uint32_t tsc_mult, uint32_t tsc_shift);
+void uinfo_time_set_realtime_offset(int64_t offset_ns);
+
+#define UINFO_FLAG_SYSENTER __kUINFO_FLAG_SYSENTER
+
+void uinfo_set_flags(uint32_t flags);
+
+/* Maps the uinfo pages into the provided address_space, which is going to
+ * belong to the task `t`. Called on both fork and exec. The task page is
+ * owned by the address_space, and freed along with it. */
+void uinfo_map(struct address_space *addrspc, struct task *t);
+
+/* Called when the parent of `t` changes */
+void uinfo_task_update_ppid(struct task *t);
+
+#endif
@@ -21,6 +21,17 @@
  * Thus, the general way to use this is via a register/check/sleep loop, which is
  * conviently wrapped up into the 'wait_event' macros below.
  *
+ * Waiters can also register as 'exclusive', for when only one of them can
+ * make progress on an event (Ex. a pipe with a single page of data and ten
+ * readers). wait_queue_wake_nr() wakes every normal waiter, but only `nr` of
+ * the exclusive ones. Exclusive waiters are kept at the end of the queue, so
+ * that normal waiters (poll(), etc.) are never skipped.
+ *
+ * An exclusive waiter that gets woken but then doesn't act on it (it was
+ * interrupted by a signal) passes the wake-up on to the next exclusive waiter.
+ * It's up to the user of the queue to wake the next waiter if there's still
+ * something left to do after it's done, as only it knows that.
+ *
  * When modifying the queue, 'lock' has to be held. */
 struct wait_queue {
     list_head_t queue;
@@ -32,6 +43,8 @@ struct wait_queue_node {
     struct wait_queue *queue;
 
     struct work on_complete;
+
+    unsigned int exclusive :1;
 };
 
 #define WAIT_QUEUE_INIT(q) \
@@ -41,7 +54,8 @@ struct wait_queue_node {
 #define WAIT_QUEUE_NODE_INIT(q) \
     { .node = LIST_NODE_INIT((q).node), \
       .on_complete = WORK_INIT((q).on_complete), \
-      .queue = NULL }
+      .queue = NULL, \
+      .exclusive = 0 }
 
 void wait_queue_init(struct wait_queue *);
 void wait_queue_node_init(struct wait_queue_node *);
@@ -50,6 +64,12 @@ void wait_queue_node_init(struct wait_queue_node *);
 void wait_queue_register(struct wait_queue *, struct wait_queue_node *);
 void wait_queue_unregister(struct wait_queue_node *);
 
+void wait_queue_register_exclusive(struct wait_queue *, struct wait_queue_node *);
+
+/* `aborted` indicates the waiter is giving up rather than acting on the
+ * event, so any wake-up it received is passed on */
+void wait_queue_unregister_exclusive(struct wait_queue *, struct wait_queue_node *, int aborted);
+
 static inline int wait_queue_waiting(struct wait_queue *queue)
 {
     using_spinlock(&queue->lock)
@@ -57,9 +77,17 @@ static inline int wait_queue_waiting(struct wait_queue *queue)
 }
 
 /* Called by the task that is done with whatever the tasks waiting in the queue
- * are waiting for. */
+ * are waiting for. Wakes every waiter, including the exclusive ones. */
 int wait_queue_wake(struct wait_queue *);
 
+/* Wakes all of the normal waiters, and at most `nr` exclusive waiters */
+int wait_queue_wake_nr(struct wait_queue *, int nr);
+
+static inline int wait_queue_wake_one(struct wait_queue *queue)
+{
+    return wait_queue_wake_nr(queue, 1);
+}
+
 pid_t sys_waitpid(pid_t pid, struct user_buffer wstatus, int options);
 
 pid_t sys_wait(struct user_buffer ret);
@@ -84,11 +112,14 @@ pid_t sys_wait(struct user_buffer ret);
 #define WSIGNALED_MAKE(sig) (sig)
 #define WSTOPPED_MAKE(sig) (((sig) << 8) | 0x7F)
 
-#define __wait_queue_event_generic(queue, condition, is_intr, cmd1, cmd2) \
+#define __wait_queue_event_generic(queue, condition, is_intr, is_excl, cmd1, cmd2) \
     ({ \
         int ____ret = 0; \
         while (1) { \
-            wait_queue_register(queue, &cpu_get_local()->current->wait); \
+            if (is_excl) \
+                wait_queue_register_exclusive(queue, &cpu_get_local()->current->wait); \
+            else \
+                wait_queue_register(queue, &cpu_get_local()->current->wait); \
             \
             if (is_intr) \
                 scheduler_set_intr_sleeping(); \
@@ -110,16 +141,19 @@ pid_t sys_wait(struct user_buffer ret);
             \
             cmd2; \
         } \
-        wait_queue_unregister(&cpu_get_local()->current->wait); \
+        if (is_excl) \
+            wait_queue_unregister_exclusive(queue, &cpu_get_local()->current->wait, ____ret); \
+        else \
+            wait_queue_unregister(&cpu_get_local()->current->wait); \
         scheduler_set_running(); \
         ____ret; \
     })
 
-#define wait_queue_event_generic(queue, condition, is_intr, cmd1, cmd2) \
+#define wait_queue_event_generic(queue, condition, is_intr, is_excl, cmd1, cmd2) \
     ({ \
         int __ret = 0; \
         if (!(condition)) \
-            __ret = __wait_queue_event_generic(queue, condition, is_intr, cmd1, cmd2); \
+            __ret = __wait_queue_event_generic(queue, condition, is_intr, is_excl, cmd1, cmd2); \
         __ret; \
     })
 
@@ -127,24 +161,33 @@ pid_t sys_wait(struct user_buffer ret);
  * Wrappers around wait-queue functionality.
  */
 #define wait_queue_event(queue, condition) \
-    wait_queue_event_generic(queue, condition, 0, do { ; } while (0), do { ; } while (0))
+    wait_queue_event_generic(queue, condition, 0, 0, do { ; } while (0), do { ; } while (0))
 
 #define wait_queue_event_intr(queue, condition) \
-    wait_queue_event_generic(queue, condition, 1, do { ; } while (0), do { ; } while (0))
+    wait_queue_event_generic(queue, condition, 1, 0, do { ; } while (0), do { ; } while (0))
 
 #define wait_queue_event_intr_cmd(queue, condition, cmd1, cmd2) \
-    wait_queue_event_generic(queue, condition, 1, cmd1, cmd2)
+    wait_queue_event_generic(queue, condition, 1, 0, cmd1, cmd2)
 
 #define wait_queue_event_spinlock(queue, condition, lock) \
-    wait_queue_event_generic(queue, condition, 0, spinlock_release(lock), spinlock_acquire(lock))
+    wait_queue_event_generic(queue, condition, 0, 0, spinlock_release(lock), spinlock_acquire(lock))
 
 #define wait_queue_event_intr_spinlock(queue, condition, lock) \
-    wait_queue_event_generic(queue, condition, 1, spinlock_release(lock), spinlock_acquire(lock))
+    wait_queue_event_generic(queue, condition, 1, 0, spinlock_release(lock), spinlock_acquire(lock))
 
 #define wait_queue_event_mutex(queue, condition, lock) \
-    wait_queue_event_generic(queue, condition, 0, mutex_unlock(lock), mutex_lock(lock))
+    wait_queue_event_generic(queue, condition, 0, 0, mutex_unlock(lock), mutex_lock(lock))
 
 #define wait_queue_event_intr_mutex(queue, condition, lock) \
-    wait_queue_event_generic(queue, condition, 1, mutex_unlock(lock), mutex_lock(lock))
+    wait_queue_event_generic(queue, condition, 1, 0, mutex_unlock(lock), mutex_lock(lock))
+
+/*
+ * Exclusive versions of the above
+ */
+#define wait_queue_event_spinlock_exclusive(queue, condition, lock) \
+    wait_queue_event_generic(queue, condition, 0, 1, spinlock_release(lock), spinlock_acquire(lock))
+
+#define wait_queue_event_intr_mutex_exclusive(queue, condition, lock) \
+    wait_queue_event_generic(queue, condition, 1, 1, mutex_unlock(lock), mutex_lock(lock))
 
 #endif
@@ -16,19 +16,57 @@
 #include <protura/spinlock.h>
 
 struct task;
+struct file_ops;
 
-#define WORKQUEUE_MAX_THREADS 5
+#define WORKQUEUE_NAME_LEN 32
+
+struct workqueue_stats {
+    /* Number of entries currently in `work_list`, and the most it has been */
+    int depth;
+    int max_depth;
+
+    /* How long work sat in `work_list` before a worker picked it up */
+    uint64_t run_count;
+    uint64_t total_latency_ns;
+    uint64_t max_latency_ns;
+
+    uint32_t workers_spawned;
+    uint32_t workers_retired;
+};
 
 /*
- * Holds one or more threads that `struct work` entries will be scheduled on.
+ * Holds a pool of worker threads that `struct work` entries will be
+ * scheduled on.
+ *
+ * The pool starts with `min_threads` workers. If work gets queued while none
+ * of the workers are idle (they're all running work, or blocked inside of
+ * it), the workqueue manager thread spawns another worker, up to
+ * `max_threads`. Workers beyond `min_threads` exit after sitting idle for
+ * WORKQUEUE_IDLE_TIMEOUT_MS.
  */
 struct workqueue {
     list_head_t work_list;
     list_head_t work_running_list;
     spinlock_t lock;
-    struct task *work_threads[WORKQUEUE_MAX_THREADS];
-    int thread_count;
-    int wake_next_thread;
+
+    list_head_t idle_workers;
+    int idle_count;
+    int worker_count;
+    int min_threads;
+    int max_threads;
+    int next_worker_id;
+
+    /* Set while this queue is waiting on the manager to spawn a worker */
+    int spawn_pending;
+    list_node_t manager_entry;
+
+    /* If non-zero, the threads are run as SCHED_FIFO with this priority */
+    int rt_priority;
+
+    char name[WORKQUEUE_NAME_LEN];
+    list_node_t workqueue_entry;
+
+    struct workqueue_stats stats;
 };
 
 /*
@@ -87,6 +125,9 @@ struct work {
     void (*callback) (struct work *);
     struct task *task;
     struct workqueue *queue;
+
+    /* When this work was last put on a workqueue's `work_list` */
+    uint64_t queued_ns;
 };
 
 struct delay_work {
@@ -99,6 +140,20 @@ struct delay_work {
         .work_list = LIST_HEAD_INIT((queue).work_list), \
         .work_running_list = LIST_HEAD_INIT((queue).work_running_list), \
         .lock = SPINLOCK_INIT(), \
+        .idle_workers = LIST_HEAD_INIT((queue).idle_workers), \
+        .manager_entry = LIST_NODE_INIT((queue).manager_entry), \
+        .workqueue_entry = LIST_NODE_INIT((queue).workqueue_entry), \
+    }
+
+#define WORKQUEUE_INIT_RT(queue, prio) \
+    { \
+        .work_list = LIST_HEAD_INIT((queue).work_list), \
+        .work_running_list = LIST_HEAD_INIT((queue).work_running_list), \
+        .lock = SPINLOCK_INIT(), \
+        .idle_workers = LIST_HEAD_INIT((queue).idle_workers), \
+        .manager_entry = LIST_NODE_INIT((queue).manager_entry), \
+        .workqueue_entry = LIST_NODE_INIT((queue).workqueue_entry), \
+        .rt_priority = (prio), \
     }
 
 #define WORK_INIT(work) \
@@ -193,9 +248,15 @@ static inline void delay_work_init_kwork(struct delay_work *work, void (*callbac
     *work = (struct delay_work)DELAY_WORK_INIT_KWORK(*work, callback);
 }
 
+/* Starts a fixed number of worker threads */
 void workqueue_start(struct workqueue *, const char *thread_name);
 void workqueue_start_multiple(struct workqueue *, const char *thread_name, int thread_count);
 
+/* Starts `min_threads` workers, and allows the pool to grow to `max_threads`
+ * when the workers get blocked. Work on these queues can run in parallel, so
+ * don't use this if the work depends on being run in order. */
+void workqueue_start_pool(struct workqueue *, const char *thread_name, int min_threads, int max_threads);
+
 void workqueue_add_work(struct workqueue *, struct work *);
 
 void work_schedule(struct work *);
@@ -223,6 +284,8 @@ static inline void kwork_delay_schedule_callback(struct delay_work *work, int de
     kwork_delay_schedule(work, delay_ms);
 }
 
+extern const struct file_ops workqueue_file_ops;
+
 extern_initcall(kwork);
 
 #endif
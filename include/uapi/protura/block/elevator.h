@@ -0,0 +1,22 @@
+#ifndef __INCLUDE_UAPI_PROTURA_BLOCK_ELEVATOR_H__
+#define __INCLUDE_UAPI_PROTURA_BLOCK_ELEVATOR_H__
+
+/*
+ * /proc/elevator lists the I/O scheduler used by each disk, along with the
+ * ones that are available. The scheduler of a disk is changed with the
+ * ELEVATORIO_SET ioctl on that file:
+ *
+ * ELEVATORIO_SET - Argument is a `struct elevator_select`, naming the disk
+ *                  (Ex. "hda") and the elevator to switch it to.
+ */
+#define ELEVATORIO_SET 50
+
+#define ELEVATOR_DISK_NAME_MAX 28
+#define ELEVATOR_NAME_MAX 16
+
+struct elevator_select {
+    char disk[ELEVATOR_DISK_NAME_MAX];
+    char elevator[ELEVATOR_NAME_MAX];
+};
+
+#endif
@@ -15,4 +15,8 @@
 #define FIBMAP 0x0001
 #define FIGETBSZ 0x0002
 
+/* The max read-ahead of a block device, in blocks. Argument is an int */
+#define BLKRASET 0x1262
+#define BLKRAGET 0x1263
+
 #endif
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef __INCLUDE_UAPI_PROTURA_FUTEX_H__
+#define __INCLUDE_UAPI_PROTURA_FUTEX_H__
+
+/*
+ * Operations for the futex() syscall:
+ *
+ * futex(uaddr, FUTEX_WAIT, val, timeout, NULL)
+ *   Sleeps as long as *uaddr == val. `timeout` is an optional pointer to a
+ *   relative `struct timespec`. Returns -EAGAIN if *uaddr != val on entry.
+ *
+ * futex(uaddr, FUTEX_WAKE, nr_wake, 0, NULL)
+ *   Wakes up to nr_wake waiters on uaddr, returns the number woken.
+ *
+ * futex(uaddr, FUTEX_REQUEUE, nr_wake, nr_requeue, uaddr2)
+ *   Wakes up to nr_wake waiters on uaddr, and moves up to nr_requeue of the
+ *   remaining waiters over to wait on uaddr2. Returns the number woken.
+ */
+#define __kFUTEX_WAIT    0
+#define __kFUTEX_WAKE    1
+#define __kFUTEX_REQUEUE 2
+
+#endif
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef __INCLUDE_UAPI_PROTURA_KPROF_H__
+#define __INCLUDE_UAPI_PROTURA_KPROF_H__
+
+#include <protura/types.h>
+
+/*
+ * The kernel profiler is controlled via ioctls on /proc/kprof/flat or
+ * /proc/kprof/folded:
+ *
+ * KPROFIO_START - Argument is a pointer to an `int` holding the number of
+ *                 return addresses to record per sample, up to
+ *                 KPROF_MAX_DEPTH. Zero records only the interrupted address.
+ * KPROFIO_STOP  - Stops taking samples, the recorded ones are kept.
+ * KPROFIO_RESET - Throws away all the recorded samples.
+ * KPROFIO_STATUS - Argument is a pointer to a `struct kprof_status`.
+ */
+#define KPROFIO_START 30
+#define KPROFIO_STOP 31
+#define KPROFIO_RESET 32
+#define KPROFIO_STATUS 33
+
+#define KPROF_MAX_DEPTH 8
+
+struct kprof_status {
+    int running;
+    int depth;
+    int sample_hz;
+
+    /* Samples currently in the buffers, and samples that were overwritten
+     * because the buffers were full */
+    __kuint32_t samples;
+    __kuint32_t overwritten;
+};
+
+#endif
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef __INCLUDE_UAPI_PROTURA_RESOURCE_H__
+#define __INCLUDE_UAPI_PROTURA_RESOURCE_H__
+
+#include <protura/types.h>
+
+/* `who` values for getrusage() */
+#define __kRUSAGE_SELF     0
+#define __kRUSAGE_CHILDREN (-1)
+
+struct __krusage_timeval {
+    __ktime_t tv_sec;
+    __ksuseconds_t tv_usec;
+};
+
+/*
+ * The times come first so that this starts with the same layout as newlib's
+ * `struct rusage`, the rest are Protura's own counters.
+ */
+struct __krusage {
+    struct __krusage_timeval ru_utime;
+    struct __krusage_timeval ru_stime;
+
+    /* Page faults that did and didn't need I/O */
+    long ru_minflt;
+    long ru_majflt;
+
+    /* Voluntary (blocking) and involuntary (preempted) context switches */
+    long ru_nvcsw;
+    long ru_nivcsw;
+
+    __kuint64_t ru_read_bytes;
+    __kuint64_t ru_write_bytes;
+};
+
+/* Returned by times(), in clock ticks */
+struct __ktms {
+    __kuint32_t tms_utime;
+    __kuint32_t tms_stime;
+    __kuint32_t tms_cutime;
+    __kuint32_t tms_cstime;
+};
+
+#endif
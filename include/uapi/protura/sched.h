@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef __INCLUDE_UAPI_PROTURA_SCHED_H__
+#define __INCLUDE_UAPI_PROTURA_SCHED_H__
+
+/* Scheduling policies for sched_setscheduler() */
+#define __kSCHED_OTHER 0
+#define __kSCHED_FIFO  1
+
+/*
+ * Valid sched_priority range for SCHED_FIFO, higher values run first.
+ * SCHED_OTHER tasks always use a sched_priority of zero.
+ */
+#define __kSCHED_PRIO_MIN 1
+#define __kSCHED_PRIO_MAX 99
+
+/*
+ * Flags for clone(), selecting what the new task shares with its parent.
+ * CLONE_SIGHAND requires CLONE_VM, since handlers are userspace addresses.
+ */
+#define __kCLONE_VM      0x01
+#define __kCLONE_FS      0x02
+#define __kCLONE_FILES   0x04
+#define __kCLONE_SIGHAND 0x08
+
+/* 'which' values for setpriority() and getpriority() */
+#define __kPRIO_PROCESS 0
+#define __kPRIO_PGRP    1
+#define __kPRIO_USER    2
+
+/* Nice values are clamped to this range, lower values get more CPU time */
+#define __kNICE_MIN (-20)
+#define __kNICE_MAX 19
+
+/*
+ * The getpriority() syscall returns `__kNICE_TO_PRIO(nice)` rather than the
+ * nice value directly, so that successful results are never negative and
+ * can't be confused with errors.
+ */
+#define __kNICE_TO_PRIO(nice) (20 - (nice))
+
+#endif
@@ -12,6 +12,7 @@
 
 #include <protura/signal.h>
 #include <protura/fs/fdset.h>
+#include <protura/resource.h>
 
 enum task_api_state {
     TASK_API_NONE,
@@ -39,6 +40,9 @@ struct task_api_info {
 
     __kdev_t tty_devno;
     char name[128];
+
+    /* Same as getrusage(RUSAGE_SELF) would return for this task */
+    struct __krusage usage;
 };
 
 #define TASKIO_MEM_INFO 20
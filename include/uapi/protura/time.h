@@ -0,0 +1,15 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef __INCLUDE_UAPI_PROTURA_TIME_H__
+#define __INCLUDE_UAPI_PROTURA_TIME_H__
+
+/* These match the values used by newlib */
+#define __kCLOCK_REALTIME  1
+#define __kCLOCK_MONOTONIC 4
+
+#endif
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef __INCLUDE_UAPI_PROTURA_TRACE_H__
+#define __INCLUDE_UAPI_PROTURA_TRACE_H__
+
+/*
+ * Tracepoints are controlled via ioctls on /proc/trace/events:
+ *
+ * TRACEIO_ENABLE  - Argument is a `struct trace_name` naming the tracepoint
+ *                   to enable. The name "all" enables every tracepoint.
+ * TRACEIO_DISABLE - Same as TRACEIO_ENABLE, but disables the tracepoint.
+ * TRACEIO_CLEAR   - Throws away all the recorded events.
+ */
+#define TRACEIO_ENABLE 40
+#define TRACEIO_DISABLE 41
+#define TRACEIO_CLEAR 42
+
+#define TRACE_NAME_MAX 32
+
+struct trace_name {
+    char name[TRACE_NAME_MAX];
+};
+
+#endif
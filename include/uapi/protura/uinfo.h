@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+#ifndef __INCLUDE_UAPI_PROTURA_UINFO_H__
+#define __INCLUDE_UAPI_PROTURA_UINFO_H__
+
+#include <protura/types.h>
+
+/*
+ * The uinfo pages are two read-only pages mapped into every user process at a
+ * fixed address, directly below the stack. They let userspace answer simple
+ * questions (The time, the current pid, etc.) without making a syscall.
+ *
+ * The time page is shared by every process and updated by the kernel on every
+ * timer tick. Readers must use the `seq` field to get a consistent snapshot:
+ *
+ *   1. Read `seq`, if it is odd then an update is in progress, retry.
+ *   2. Read the fields you want.
+ *   3. Read `seq` again, if it changed then retry.
+ *
+ * The monotonic time is then:
+ *
+ *   tick_ns + min(((rdtsc() - tick_tsc) * tsc_mult) >> tsc_shift, nsec_per_tick - 1)
+ *
+ * Where the TSC part is skipped if `tsc_mult` is zero. The realtime is the
+ * monotonic time plus `realtime_offset_ns`.
+ *
+ * The task page is private to each address space, and holds values that only
+ * change when the kernel knows about it (Ex. being reparented to init). It
+ * describes the task the address space was created for, so tasks made with
+ * CLONE_VM see that task's pid and ppid there rather than their own, and
+ * have to use getpid() and getppid() for those.
+ */
+#define __kUINFO_TIME_ADDR 0xBF7FE000
+#define __kUINFO_TASK_ADDR 0xBF7FF000
+
+struct uinfo_time {
+    volatile __kuint32_t seq;
+
+    /* Zero if the TSC is not usable for interpolation */
+    __kuint32_t tsc_mult;
+    __kuint32_t tsc_shift;
+    __kuint32_t nsec_per_tick;
+
+    /* Monotonic time and TSC value at the last tick */
+    __kuint64_t tick_ns;
+    __kuint64_t tick_tsc;
+
+    __kint64_t realtime_offset_ns;
+
+    /* System-wide flags, these are set once at boot */
+    __kuint32_t flags;
+};
+
+/* `sysenter` can be used to make syscalls, see <arch/syscall.h> */
+#define __kUINFO_FLAG_SYSENTER 0x01
+
+struct uinfo_task {
+    __kpid_t pid;
+    volatile __kpid_t ppid;
+};
+
+#endif
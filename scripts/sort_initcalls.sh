@@ -12,7 +12,8 @@ ERR_FILE=$(mktemp)
 # The pairs are then sorted into an order that satisfies the required dependences
 # via `tsort`, which does a topological sort of the dependency tree.
 #
-initcalls=$(objdump --section=.discard.initcall.deps --full-contents $PROTURA_OBJ | grep '^ *[0-9a-f]'  | xxd -r | tr '\0' '\n' | tsort 2>$ERR_FILE)
+dependencies=$(objdump --section=.discard.initcall.deps --full-contents $PROTURA_OBJ | grep '^ *[0-9a-f]'  | xxd -r | tr '\0' '\n')
+initcalls=$(echo "$dependencies" | tsort 2>$ERR_FILE)
 
 ERR=$(cat $ERR_FILE)
 rm $ERR_FILE
@@ -36,14 +37,36 @@ do
     echo "extern void __init_$i(void);"
 done
 
+# The initcalls are run in parallel, so along with the sorted order we record
+# the index of every initcall each one directly depends on. Because of the
+# sort, those indexes are always earlier in the array.
+declare -A index
+
+idx=0
+for i in $initcalls
+do
+    index[$i]=$idx
+    idx=$((idx + 1))
+done
+
+declare -A deps
+
+while read dep init
+do
+    if [ -n "$dep" ]
+    then
+        deps[$init]="${deps[$init]}${index[$dep]}, "
+    fi
+done <<< "$dependencies"
+
 echo
-echo "void (*initcalls[]) (void) = {"
+echo "struct initcall initcalls[] = {"
 
 for i in $initcalls
 do
-    echo "    __init_$i,"
+    echo "    { .name = \"$i\", .fn = __init_$i, .deps = (const int []) { ${deps[$i]}-1 } },"
 done
 
-echo "    NULL"
+echo "    { .name = NULL, .fn = NULL }"
 echo "};"
 
@@ -8,6 +8,8 @@ print "\n";
 print "#include <protura/symbols.h>\n";
 print "\n";
 
+my $count = 0;
+
 print "const struct symbol kernel_symbols[] = {\n";
 foreach my $line (<STDIN>) {
     chomp($line);
@@ -29,12 +31,15 @@ foreach my $line (<STDIN>) {
 
     # Don't output a symbol for the table, it will only appear in the second
     # pass which makes the ending kernel_symbols's table one entry bigger than
-    # the second
-    if ($sym_name eq "kernel_symbols") {
+    # the second. The same goes for the count.
+    if ($sym_name eq "kernel_symbols" || $sym_name eq "kernel_symbols_count") {
         next;
     }
 
+    $count++;
     print "    { .addr = 0x$sym_addr, .size = 0x$sym_len, .name = \"$sym_name\" },\n";
 }
 print "    { .addr = 0, .size = 0, .name = NULL }\n";
 print "};\n";
+print "\n";
+print "const size_t kernel_symbols_count = $count;\n";
@@ -1,3 +1,3 @@
 #!/bin/bash
 
-nm $1 -S --defined-only | sort | ./scripts/symbol_table.pl
+nm $1 -S --defined-only | LC_ALL=C sort | ./scripts/symbol_table.pl
@@ -21,51 +21,172 @@
 #include <protura/block/bdev.h>
 #include <protura/block/bcache.h>
 
-#define BLOCK_HASH_TABLE_SIZE CONFIG_BLOCK_HASH_TABLE_SIZE
+/*
+ * The hash table is split into shards, each with its own lock, so lookups of
+ * different blocks don't all fight over one lock. A block's shard comes from
+ * the low bits of its hash, and its bucket in that shard from the bits above
+ * them. Each shard's table starts at an equal part of
+ * CONFIG_BLOCK_HASH_TABLE_SIZE and doubles when the shard gets to
+ * BLOCK_SHARD_LOAD blocks per bucket.
+ */
+#define BLOCK_CACHE_SHARD_BITS 4
+#define BLOCK_CACHE_SHARDS (1 << BLOCK_CACHE_SHARD_BITS)
+
+#define BLOCK_SHARD_INITIAL_SIZE (CONFIG_BLOCK_HASH_TABLE_SIZE / BLOCK_CACHE_SHARDS)
+#define BLOCK_SHARD_MAX_SIZE 8192
+#define BLOCK_SHARD_LOAD 2
+
+STATIC_ASSERT(BLOCK_SHARD_INITIAL_SIZE > 0 && (BLOCK_SHARD_INITIAL_SIZE & (BLOCK_SHARD_INITIAL_SIZE - 1)) == 0);
+
+DEFINE_LOCK_CLASS(block_cache_lock_class, "block_cache.lock");
+DEFINE_LOCK_CLASS(block_shard_lock_class, "block_shard.lock");
+
+struct block_shard {
+    spinlock_t lock;
+
+    /* NULL until the shard is first resized, `initial_table` is used until
+     * then. `table_size` is always a power of two */
+    struct hlist_head *table;
+    size_t table_size;
+    size_t count;
+
+    struct hlist_head initial_table[BLOCK_SHARD_INITIAL_SIZE];
+};
 
+/*
+ * Ordering:
+ *   block_cache.lock
+ *     shard->lock
+ *       b->flags_lock
+ *
+ * block_cache.lock protects the CLOCK list, every bdev's `blocks` list, and
+ * the size of the cache. Lookups only take their shard's lock, and mark the
+ * block REFERENCED rather than moving it on the CLOCK list.
+ */
 static struct {
     spinlock_t lock;
 
-    /* List of cached blocks ready to be checked-out.
+    size_t cache_size;
+    size_t block_count;
+
+    /* Every cached block, in CLOCK order. The hand is the front of the list,
+     * and new blocks are added right behind it at the back.
      *
      * Note: Some of the cached blocks may be currently locked by another
      * process. */
-    size_t cache_size;
-    struct hlist_head cache[BLOCK_HASH_TABLE_SIZE];
-    list_head_t lru;
+    list_head_t clock;
+
+    struct block_shard shards[BLOCK_CACHE_SHARDS];
 } block_cache = {
-    .lock = SPINLOCK_INIT(),
+    .lock = SPINLOCK_INIT_CLASS(block_cache_lock_class),
     .cache_size = 0,
-    .cache = { { NULL }, },
-    .lru = LIST_HEAD_INIT(block_cache.lru),
+    .clock = LIST_HEAD_INIT(block_cache.clock),
+    .shards = {
+        [0 ... BLOCK_CACHE_SHARDS - 1] = {
+            .lock = SPINLOCK_INIT_CLASS(block_shard_lock_class),
+            .table_size = BLOCK_SHARD_INITIAL_SIZE,
+        },
+    },
 };
 
-static inline int block_hash(dev_t device, sector_t sector)
+/* Sequential sectors need to end up spread over every shard and bucket, so
+ * the device and sector are mixed with the MurmurHash3 finalizer */
+static inline uint32_t block_hash(dev_t device, sector_t sector)
 {
-    int hash;
-    hash = ((DEV_MAJOR(device) + DEV_MINOR(device)) ^ (sector)) % BLOCK_HASH_TABLE_SIZE;
+    uint32_t hash = (uint32_t)sector ^ ((uint32_t)device * 0x9E3779B9);
+
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6B;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35;
+    hash ^= hash >> 16;
+
     return hash;
 }
 
-static void __block_uncache(struct block *b)
+static inline struct block_shard *block_shard_get(uint32_t hash)
+{
+    return block_cache.shards + (hash & (BLOCK_CACHE_SHARDS - 1));
+}
+
+static inline struct hlist_head *block_bucket(struct hlist_head *table, size_t table_size, uint32_t hash)
+{
+    return table + ((hash >> BLOCK_CACHE_SHARD_BITS) & (table_size - 1));
+}
+
+static inline struct hlist_head *__block_shard_bucket(struct block_shard *shard, uint32_t hash)
+{
+    struct hlist_head *table = shard->table? shard->table: shard->initial_table;
+
+    return block_bucket(table, shard->table_size, hash);
+}
+
+/* Called with block_cache.lock and the block's shard lock held */
+static void __block_uncache(struct block_shard *shard, struct block *b)
 {
     block_cache.cache_size -= b->block_size;
+    block_cache.block_count--;
+
     /* Remove this block from the cache */
     hlist_del(&b->cache);
-    list_del(&b->block_lru_node);
-    list_del(&b->bdev_blocks_entry);
+    shard->count--;
 
+    list_del(&b->block_clock_node);
+    list_del(&b->bdev_blocks_entry);
 }
 
+/* Called with block_cache.lock held, once the block is already in its shard */
 static void __block_cache(struct block *b)
 {
-    int hash = block_hash(b->bdev->dev, b->sector);
-    hlist_add(block_cache.cache + hash, &b->cache);
     block_cache.cache_size += b->block_size;
+    block_cache.block_count++;
 
+    list_add_tail(&block_cache.clock, &b->block_clock_node);
     list_add(&b->bdev->blocks, &b->bdev_blocks_entry);
 }
 
+/* Doubles the size of the shard's table. The new table is allocated without
+ * the lock held, so somebody else may have already done it by the time we
+ * have the lock back, in which case ours is thrown away. */
+static void block_shard_grow(struct block_shard *shard)
+{
+    struct hlist_head *new, *old, *table;
+    size_t new_size, i;
+    struct block *b;
+
+    using_spinlock(&shard->lock)
+        new_size = shard->table_size * 2;
+
+    new = kzalloc(sizeof(*new) * new_size, PAL_KERNEL);
+    if (!new)
+        return;
+
+    using_spinlock(&shard->lock) {
+        if (shard->table_size * 2 != new_size) {
+            old = new;
+            break;
+        }
+
+        table = shard->table? shard->table: shard->initial_table;
+
+        for (i = 0; i < shard->table_size; i++) {
+            while (!hlist_empty(table + i)) {
+                b = hlist_entry(table[i].first, struct block, cache);
+
+                hlist_del(&b->cache);
+                hlist_add(block_bucket(new, new_size, block_hash(b->bdev->dev, b->sector)), &b->cache);
+            }
+        }
+
+        old = shard->table;
+        shard->table = new;
+        shard->table_size = new_size;
+    }
+
+    if (old)
+        kfree(old);
+}
+
 static void block_delete(struct block *b)
 {
     if (b->block_size == PG_SIZE)
@@ -84,7 +205,7 @@ static struct block *block_new(void)
     wait_queue_init(&b->flags_queue);
 
     list_node_init(&b->block_list_node);
-    list_node_init(&b->block_lru_node);
+    list_node_init(&b->block_clock_node);
     list_node_init(&b->bdev_blocks_entry);
     list_node_init(&b->block_sync_node);
 
@@ -93,55 +214,85 @@ static struct block *block_new(void)
     return b;
 }
 
-static void __block_cache_shrink(void)
+/* Called with block_cache.lock held. Returns 1 if the block was removed from
+ * the cache, after which it just needs to be deleted */
+static int __block_try_evict(struct block *b)
 {
-    size_t freed_space = 0;
-    int already_synced = 0;
-    struct block *b, *next;
+    struct block_shard *shard = block_shard_get(block_hash(b->bdev->dev, b->sector));
 
-    kp(KP_NORMAL, "Shrinking block cache...\n");
+    /* Lookups take their reference with the shard lock held, so once we've
+     * seen no references under it nobody else can get one */
+    using_spinlock(&shard->lock) {
+        if (atomic_get(&b->refs) != 0)
+            return 0;
 
-  again:
-    list_foreach_entry_safe(&block_cache.lru, b, next, block_lru_node) {
         if (block_try_lock(b) != SUCCESS)
-            continue;
+            return 0;
 
-        if (atomic_get(&b->refs) != 0) {
+        /* Don't need the flags_lock, there's no existing references */
+        if (flag_test(&b->flags, BLOCK_DIRTY)) {
             block_unlock(b);
-            continue;
+            return 0;
         }
 
-        /* Don't need the spinlock, there's no existing references */
-        if (flag_test(&b->flags, BLOCK_DIRTY)) {
-            block_unlock(b);
+        __block_uncache(shard, b);
+    }
+
+    return 1;
+}
+
+/*
+ * Runs the CLOCK hand over the cache until `target` bytes have been freed.
+ * Blocks that have been looked up since the hand last passed them have their
+ * REFERENCED bit cleared and are skipped, everything else is evicted if it
+ * isn't in use or dirty. Two trips around is enough to get back to any
+ * block that was skipped the first time.
+ */
+static size_t __block_cache_evict(size_t target)
+{
+    size_t freed_space = 0;
+    size_t scan = block_cache.block_count * 2;
+    struct block *b;
+
+    while (scan-- && freed_space < target && !list_empty(&block_cache.clock)) {
+        b = list_first_entry(&block_cache.clock, struct block, block_clock_node);
+        list_rotate_left(&block_cache.clock);
+
+        if (flag_test(&b->flags, BLOCK_REFERENCED)) {
+            flag_clear(&b->flags, BLOCK_REFERENCED);
             continue;
         }
 
-        freed_space += b->block_size;
+        if (__block_try_evict(b)) {
+            freed_space += b->block_size;
+            block_delete(b);
+        }
+    }
+
+    return freed_space;
+}
 
-        /* Remove this block from the cache */
-        __block_uncache(b);
+static void __block_cache_shrink(void)
+{
+    size_t freed_space;
 
-        block_delete(b);
+    kp(KP_NORMAL, "Shrinking block cache...\n");
 
-        if (freed_space >= CONFIG_BLOCK_CACHE_SHRINK_SIZE)
-            break;
-    }
+    freed_space = __block_cache_evict(CONFIG_BLOCK_CACHE_SHRINK_SIZE);
 
     /* We could be stuck due to too many dirty blocks, sync them and try one more time */
-    if (!already_synced && freed_space < CONFIG_BLOCK_CACHE_SHRINK_SIZE) {
+    if (freed_space < CONFIG_BLOCK_CACHE_SHRINK_SIZE) {
         spinlock_release(&block_cache.lock);
 
-        /* We could potentially be more optimal and only sync the LRU blocks.
-         * The only potential problem with that approach is that if someone
-         * grabs a reference during the sync they may no longer be in the LRU
-         * after the sync() and we'll still have no blocks to free. */
+        /* We could potentially be more optimal and only sync the blocks
+         * near the CLOCK hand. The only potential problem with that approach
+         * is that if someone grabs a reference during the sync they'll be
+         * skipped and we'll still have no blocks to free. */
         block_sync_all(1);
 
         spinlock_acquire(&block_cache.lock);
 
-        already_synced = 1;
-        goto again;
+        freed_space += __block_cache_evict(CONFIG_BLOCK_CACHE_SHRINK_SIZE - freed_space);
     }
 
     kp(KP_NORMAL, "Block cache shrunk, free'd bytes: %d\n", freed_space);
@@ -153,18 +304,34 @@ void bcache_oom(void)
         __block_cache_shrink();
 }
 
+void block_lock(struct block *b)
+{
+    if (block_try_lock(b) == SUCCESS)
+        return;
+
+    block_plug_flush();
+
+    using_spinlock(&b->flags_lock) {
+        wait_queue_event_spinlock(&b->flags_queue, !flag_test(&b->flags, BLOCK_LOCKED), &b->flags_lock);
+
+        flag_set(&b->flags, BLOCK_LOCKED);
+    }
+}
+
 void block_wait_for_sync(struct block *b)
 {
+    block_plug_flush();
+
     using_spinlock(&b->flags_lock)
         wait_queue_event_spinlock(&b->flags_queue, !flag_test(&b->flags, BLOCK_LOCKED), &b->flags_lock);
 }
 
-static struct block *__find_block(dev_t device, sector_t sector)
+/* Called with the shard lock held */
+static struct block *__find_block(struct block_shard *shard, uint32_t hash, dev_t device, sector_t sector)
 {
     struct block *b;
-    int hash = block_hash(device, sector);
 
-    hlist_foreach_entry(block_cache.cache + hash, b, cache)
+    hlist_foreach_entry(__block_shard_bucket(shard, hash), b, cache)
         if (b->bdev->dev == device && b->sector == sector)
             return b;
 
@@ -176,22 +343,32 @@ static struct block *__find_block(dev_t device, sector_t sector)
  * off the disk. */
 struct block *block_get_nosync(struct block_device *bdev, sector_t sector)
 {
-    struct block *b = NULL, *new = NULL;
-    size_t block_size = block_dev_block_size_get(bdev);
-
-    spinlock_acquire(&block_cache.lock);
+    uint32_t hash = block_hash(bdev->dev, sector);
+    struct block_shard *shard = block_shard_get(hash);
+    struct block *b, *new;
+    size_t block_size;
+    int grow = 0;
+
+    using_spinlock(&shard->lock) {
+        b = __find_block(shard, hash, bdev->dev, sector);
+        if (b)
+            atomic_inc(&b->refs);
+    }
 
-    b = __find_block(bdev->dev, sector);
     if (b)
-        goto inc_and_return;
+        goto referenced;
 
     /* We do the shrink *before* we allocate a new block if it is necessary.
      * This is to ensure the shrink can't remove the block we're about to add
      * from the cache. */
-    if (block_cache.cache_size >= CONFIG_BLOCK_CACHE_MAX_SIZE)
-        __block_cache_shrink();
+    if (READ_ONCE(block_cache.cache_size) >= CONFIG_BLOCK_CACHE_MAX_SIZE) {
+        using_spinlock(&block_cache.lock) {
+            if (block_cache.cache_size >= CONFIG_BLOCK_CACHE_MAX_SIZE)
+                __block_cache_shrink();
+        }
+    }
 
-    spinlock_release(&block_cache.lock);
+    block_size = block_dev_block_size_get(bdev);
 
     new = block_new();
     new->block_size = block_size;
@@ -204,33 +381,46 @@ struct block *block_get_nosync(struct block_device *bdev, sector_t sector)
     new->sector = sector;
     new->bdev = bdev;
 
-    spinlock_acquire(&block_cache.lock);
-
     /* We had to drop the lock because allocating the memory may sleep. If
      * there is a race and a second allocation happens for the same block then
      * the block we just made might already be in the hash list.  In that
      * situation we simply delete the one we just made and return the existing
      * one. */
-    b = __find_block(bdev->dev, sector);
+    using_spinlock(&shard->lock) {
+        b = __find_block(shard, hash, bdev->dev, sector);
 
-    if (b) {
-        block_delete(new);
-        goto inc_and_return;
-    }
+        if (!b) {
+            hlist_add(__block_shard_bucket(shard, hash), &new->cache);
+            shard->count++;
+
+            grow = shard->count > shard->table_size * BLOCK_SHARD_LOAD
+                   && shard->table_size < BLOCK_SHARD_MAX_SIZE;
+
+            b = new;
+            new = NULL;
+        }
 
-    /* Insert our new block into the cache */
-    __block_cache(new);
-    b = new;
+        atomic_inc(&b->refs);
+    }
 
-  inc_and_return:
-    atomic_inc(&b->refs);
+    if (new) {
+        block_delete(new);
+    } else {
+        /* Lookups can find the block before it's on the CLOCK list, which is
+         * fine since nothing but our reference could be holding it yet */
+        using_spinlock(&block_cache.lock)
+            __block_cache(b);
+
+        if (grow)
+            block_shard_grow(shard);
+    }
 
-    /* Refresh the LRU entry for this block */
-    if (list_node_is_in_list(&b->block_lru_node))
-        list_del(&b->block_lru_node);
-    list_add_tail(&block_cache.lru, &b->block_lru_node);
+  referenced:
+    /* Most lookups are for blocks that are already referenced, so skip the
+     * locked write when we can */
+    if (!flag_test(&b->flags, BLOCK_REFERENCED))
+        flag_set(&b->flags, BLOCK_REFERENCED);
 
-    spinlock_release(&block_cache.lock);
     return b;
 }
 
@@ -276,6 +466,90 @@ void block_put(struct block *b)
     atomic_dec(&b->refs);
 }
 
+static void block_batch_complete(struct block_batch *batch)
+{
+    if (batch->callback) {
+        (batch->callback) (batch);
+        return;
+    }
+
+    using_spinlock(&batch->lock) {
+        batch->done = 1;
+        wait_queue_wake(&batch->wait);
+    }
+}
+
+static void block_batch_put(struct block_batch *batch)
+{
+    if (atomic_dec_and_test(&batch->pending))
+        block_batch_complete(batch);
+}
+
+void block_batch_submit(struct block_batch *batch, struct block *b)
+{
+    atomic_inc(&batch->pending);
+    b->batch = batch;
+
+    block_submit(b);
+}
+
+void block_batch_finish(struct block_batch *batch)
+{
+    block_batch_put(batch);
+}
+
+void block_batch_wait(struct block_batch *batch)
+{
+    kassert(!batch->callback, "block_batch_wait() called on a batch with a callback!\n");
+
+    block_plug_flush();
+    block_batch_finish(batch);
+
+    using_spinlock(&batch->lock)
+        wait_queue_event_spinlock(&batch->wait, batch->done, &batch->lock);
+}
+
+void block_io_unlock(struct block *b)
+{
+    struct block_batch *batch = b->batch;
+
+    b->batch = NULL;
+    block_unlock(b);
+
+    if (batch)
+        block_batch_put(batch);
+}
+
+void block_io_done(struct block *b)
+{
+    block_mark_synced(b);
+    block_io_unlock(b);
+    block_put(b);
+}
+
+void block_batch_read(struct block_batch *batch, struct block_device *bdev, sector_t sector)
+{
+    struct block *b = block_get_nosync(bdev, sector);
+
+    /* If we can't get the lock then somebody else is already reading it, or
+     * using it */
+    if (!flag_test(&b->flags, BLOCK_VALID) && block_try_lock(b) == SUCCESS) {
+        if (flag_test(&b->flags, BLOCK_VALID))
+            block_unlock(b);
+        else if (batch)
+            block_batch_submit(batch, b);
+        else
+            block_submit(b);
+    }
+
+    block_put(b);
+}
+
+void block_readahead(struct block_device *bdev, sector_t sector)
+{
+    block_batch_read(NULL, bdev, sector);
+}
+
 /* Protects the 'b->block_sync_node' entries.
  * Ordering:
  *   sync_lock
@@ -283,6 +557,28 @@ void block_put(struct block *b)
  */
 static mutex_t sync_lock = MUTEX_INIT(sync_lock);
 
+/* Called with block_cache.lock held */
+static void __block_dev_clear_block(struct block *b)
+{
+    struct block_shard *shard = block_shard_get(block_hash(b->bdev->dev, b->sector));
+
+    using_spinlock(&shard->lock) {
+        if (block_try_lock(b) != SUCCESS || atomic_get(&b->refs) != 0) {
+            kp(KP_WARNING, "BLOCK: Reference to Block %d:%d held when block_dev_clear was called!!!!\n", b->bdev->dev, b->sector);
+            return;
+        }
+
+        if (flag_test(&b->flags, BLOCK_DIRTY)) {
+            kp(KP_WARNING, "BLOCK: Block %d:%d was still dirty when block_dev_clear was called!!!!\n", b->bdev->dev, b->sector);
+            return;
+        }
+
+        __block_uncache(shard, b);
+    }
+
+    block_delete(b);
+}
+
 void block_dev_clear(struct block_device *bdev)
 {
     struct block *b;
@@ -294,18 +590,7 @@ void block_dev_clear(struct block_device *bdev)
             if (b->bdev != bdev)
                 continue;
 
-            if (block_try_lock(b) != SUCCESS || atomic_get(&b->refs) != 0) {
-                kp(KP_WARNING, "BLOCK: Reference to Block %d:%d held when block_dev_clear was called!!!!\n", b->bdev->dev, b->sector);
-                continue;
-            }
-
-            if (flag_test(&b->flags, BLOCK_DIRTY)) {
-                kp(KP_WARNING, "BLOCK: Block %d:%d was still dirty when block_dev_clear was called!!!!\n", b->bdev->dev, b->sector);
-                continue;
-            }
-
-            __block_uncache(b);
-            block_delete(b);
+            __block_dev_clear_block(b);
         }
     }
 }
@@ -313,7 +598,9 @@ void block_dev_clear(struct block_device *bdev)
 void block_dev_sync(struct block_device *bdev, int wait)
 {
     list_head_t sync_list = LIST_HEAD_INIT(sync_list);
-    struct block *b, *next;
+    struct block_batch batch = BLOCK_BATCH_INIT(batch, NULL);
+    struct block_plug plug;
+    struct block *b;
 
     using_mutex(&sync_lock) {
         using_spinlock(&block_cache.lock) {
@@ -333,55 +620,52 @@ void block_dev_sync(struct block_device *bdev, int wait)
         /* It's better to to simply hold the block_cache.lock spinlock the
          * whole time and then submit all the blocks down here.
          *
-         * Safe is used because if we're not waiting we need to drop the reference here too. */
-        list_foreach_entry_safe(&sync_list, b, next, block_sync_node) {
+         * They're submitted under a plug so the elevator gets all of them at
+         * once, and the driver holds its own reference while syncing, so we
+         * can drop ours right away. */
+        block_plug_start(&plug);
+
+        list_foreach_take_entry(&sync_list, b, block_sync_node) {
             block_lock(b);
-            block_submit(b);
 
-            if (!wait)
-                block_put(b);
-        }
+            if (wait)
+                block_batch_submit(&batch, b);
+            else
+                block_submit(b);
 
-        if (!wait)
-            return;
+            block_put(b);
+        }
 
-        while (!list_empty(&sync_list)) {
-            b = list_take_first(&sync_list, struct block, block_sync_node);
+        block_plug_finish(&plug);
 
-            /* Wait for block to be synced, and then drop reference */
-            block_wait_for_sync(b);
-            atomic_dec(&b->refs);
-        }
+        if (wait)
+            block_batch_wait(&batch);
     }
 }
 
 void block_sync_all(int wait)
 {
     list_head_t sync_list = LIST_HEAD_INIT(sync_list);
-    struct block *b, *next;
+    struct block_batch batch = BLOCK_BATCH_INIT(batch, NULL);
+    struct block_plug plug;
+    struct block *b;
 
     using_mutex(&sync_lock) {
         using_spinlock(&block_cache.lock) {
-            int hash;
-
-            for (hash = 0; hash < BLOCK_HASH_TABLE_SIZE; hash++) {
-                hlist_foreach_entry(block_cache.cache + hash, b, cache) {
-
-                    using_spinlock(&b->flags_lock) {
-                        if (flag_test(&b->flags, BLOCK_VALID) && flag_test(&b->flags, BLOCK_DIRTY)) {
-                            atomic_inc(&b->refs);
-                            list_add_tail(&sync_list, &b->block_sync_node);
-                        }
+            list_foreach_entry(&block_cache.clock, b, block_clock_node) {
+                using_spinlock(&b->flags_lock) {
+                    if (flag_test(&b->flags, BLOCK_VALID) && flag_test(&b->flags, BLOCK_DIRTY)) {
+                        atomic_inc(&b->refs);
+                        list_add_tail(&sync_list, &b->block_sync_node);
                     }
                 }
             }
         }
 
-        /* It's better to to simply hold the block_cache.lock spinlock the
-         * whole time and then submit all the blocks down here.
-         *
-         * Safe is used because if we're not waiting we need to drop the reference here too. */
-        list_foreach_entry_safe(&sync_list, b, next, block_sync_node) {
+        /* Same as block_dev_sync() */
+        block_plug_start(&plug);
+
+        list_foreach_take_entry(&sync_list, b, block_sync_node) {
             block_lock(b);
 
             if (!flag_test(&b->flags, BLOCK_VALID) || !flag_test(&b->flags, BLOCK_DIRTY)) {
@@ -389,21 +673,21 @@ void block_sync_all(int wait)
                 continue;
             }
 
-            block_submit(b);
+            if (wait)
+                block_batch_submit(&batch, b);
+            else
+                block_submit(b);
 
-            if (!wait)
-                block_put(b);
+            block_put(b);
         }
 
-        if (!wait)
-            return;
+        block_plug_finish(&plug);
 
-        while (!list_empty(&sync_list)) {
-            b = list_take_first(&sync_list, struct block, block_sync_node);
-
-            /* Wait for block to be synced, and then drop reference */
-            block_wait_for_sync(b);
-            block_put(b);
-        }
+        if (wait)
+            block_batch_wait(&batch);
     }
 }
+
+#ifdef CONFIG_KERNEL_TESTS
+# include "bcache_test.c"
+#endif
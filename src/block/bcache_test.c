@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+/*
+ * Tests for bcache.c - included directly at the end of bcache.c
+ */
+
+#include <protura/types.h>
+#include <protura/mm/kmalloc.h>
+#include <protura/block/bdev.h>
+#include <protura/block/bcache.h>
+#include <protura/ktest.h>
+
+/* Nothing real uses this major, so none of these blocks are ever submitted */
+#define TEST_BDEV_DEV DEV_MAKE(0xFFE, 0)
+#define TEST_BLOCK_SIZE 1024
+
+static struct block_device *test_bdev_new(void)
+{
+    struct block_device *bdev = kzalloc(sizeof(*bdev), PAL_KERNEL);
+
+    list_head_init(&bdev->blocks);
+    mutex_init(&bdev->lock);
+    spinlock_init(&bdev->block_size_lock);
+
+    bdev->dev = TEST_BDEV_DEV;
+    bdev->block_size = TEST_BLOCK_SIZE;
+
+    return bdev;
+}
+
+static void test_bdev_free(struct block_device *bdev)
+{
+    block_dev_clear(bdev);
+    kfree(bdev);
+}
+
+static struct block *test_find_block(dev_t dev, sector_t sector)
+{
+    uint32_t hash = block_hash(dev, sector);
+    struct block_shard *shard = block_shard_get(hash);
+
+    using_spinlock(&shard->lock)
+        return __find_block(shard, hash, dev, sector);
+}
+
+static void bcache_lookup_hammer_test(struct ktest *kt)
+{
+    int count = KT_ARG(kt, 0, int);
+    int rounds = KT_ARG(kt, 1, int);
+    struct block_device *bdev = test_bdev_new();
+    struct block **blocks = kzalloc(sizeof(*blocks) * count, PAL_KERNEL);
+    int i, k;
+
+    for (i = 0; i < count; i++) {
+        blocks[i] = block_get_nosync(bdev, i);
+
+        ktest_assert_notequal(kt, NULL, blocks[i]);
+        ktest_assert_equal(kt, i, blocks[i]->sector);
+        ktest_assert_equal(kt, 1, atomic_get(&blocks[i]->refs));
+    }
+
+    /* The tables were resized along the way, everything has to still be
+     * there and still be the same block */
+    for (k = 0; k < rounds; k++) {
+        for (i = 0; i < count; i++) {
+            struct block *b = block_get_nosync(bdev, i);
+
+            ktest_assert_equal(kt, blocks[i], b);
+            ktest_assert_equal(kt, 2, atomic_get(&b->refs));
+
+            block_put(b);
+        }
+    }
+
+    for (i = 0; i < count; i++)
+        block_put(blocks[i]);
+
+    test_bdev_free(bdev);
+
+    for (i = 0; i < count; i++)
+        ktest_assert_equal(kt, NULL, test_find_block(TEST_BDEV_DEV, i));
+
+    kfree(blocks);
+}
+
+static void bcache_shard_grow_test(struct ktest *kt)
+{
+    int count = KT_ARG(kt, 0, int);
+    struct block_device *bdev = test_bdev_new();
+    struct block_shard *shard = block_shard_get(block_hash(TEST_BDEV_DEV, 0));
+    size_t end_size, shard_count;
+    int i;
+
+    /* Enough blocks that every shard goes well past the load of its initial
+     * table. Tables never shrink, so an earlier test may have already grown
+     * it, but either way it can't be carrying more than its load */
+    for (i = 0; i < count; i++)
+        block_put(block_get_nosync(bdev, i));
+
+    using_spinlock(&shard->lock) {
+        end_size = shard->table_size;
+        shard_count = shard->count;
+    }
+
+    ktest_assert_equal(kt, 1, end_size > BLOCK_SHARD_INITIAL_SIZE);
+    ktest_assert_equal(kt, 1, shard_count <= end_size * BLOCK_SHARD_LOAD || end_size == BLOCK_SHARD_MAX_SIZE);
+
+    test_bdev_free(bdev);
+}
+
+static void bcache_hash_spread_test(struct ktest *kt)
+{
+    int counts[BLOCK_CACHE_SHARDS] = { 0 };
+    int per_shard = 16;
+    int i;
+
+    for (i = 0; i < BLOCK_CACHE_SHARDS * per_shard; i++)
+        counts[block_hash(TEST_BDEV_DEV, i) & (BLOCK_CACHE_SHARDS - 1)]++;
+
+    /* Sequential sectors shouldn't pile up on a few shards */
+    for (i = 0; i < BLOCK_CACHE_SHARDS; i++) {
+        ktest_assert_equal(kt, 1, counts[i] >= per_shard / 4);
+        ktest_assert_equal(kt, 1, counts[i] <= per_shard * 2);
+    }
+}
+
+static void bcache_referenced_test(struct ktest *kt)
+{
+    struct block_device *bdev = test_bdev_new();
+    struct block *b = block_get_nosync(bdev, 0);
+    list_node_t *next;
+
+    ktest_assert_equal(kt, 1, flag_test(&b->flags, BLOCK_REFERENCED));
+
+    flag_clear(&b->flags, BLOCK_REFERENCED);
+    block_put(b);
+
+    /* A hit only marks the block, it doesn't move it. It can't take
+     * block_cache.lock either, or this would never get past the lookup */
+    using_spinlock(&block_cache.lock) {
+        next = b->block_clock_node.next;
+
+        struct block *b2 = block_get_nosync(bdev, 0);
+
+        ktest_assert_equal(kt, b, b2);
+        ktest_assert_equal(kt, 1, flag_test(&b2->flags, BLOCK_REFERENCED));
+        ktest_assert_equal(kt, next, b2->block_clock_node.next);
+
+        block_put(b2);
+    }
+
+    test_bdev_free(bdev);
+}
+
+static const struct ktest_unit bcache_test_units[] = {
+    KTEST_UNIT("bcache-lookup-hammer", bcache_lookup_hammer_test,
+            (KT_INT(16), KT_INT(1)),
+            (KT_INT(1024), KT_INT(8)),
+            (KT_INT(8192), KT_INT(4))),
+    KTEST_UNIT("bcache-shard-grow", bcache_shard_grow_test,
+            (KT_INT(BLOCK_SHARD_INITIAL_SIZE * BLOCK_SHARD_LOAD * BLOCK_CACHE_SHARDS * 4))),
+    KTEST_UNIT("bcache-hash-spread", bcache_hash_spread_test),
+    KTEST_UNIT("bcache-referenced", bcache_referenced_test),
+};
+
+KTEST_MODULE_DEFINE("bcache", bcache_test_units);
@@ -13,12 +13,24 @@
 #include <protura/mm/kmalloc.h>
 #include <protura/mm/user_check.h>
 #include <protura/dev.h>
+#include <protura/trace.h>
+#include <protura/kstat.h>
+#include <protura/kparam.h>
 #include <protura/fs/inode.h>
 #include <protura/fs/file.h>
 #include <protura/fs/pipe.h>
 #include <protura/block/bcache.h>
 #include <protura/block/disk.h>
 #include <protura/block/bdev.h>
+#include <protura/block/elevator.h>
+#include <protura/task.h>
+#include <arch/cpu.h>
+
+DEFINE_TRACEPOINT(block_submit, "dev=%d:%d sector=%u disk_sector=%u size=%u write=%d");
+
+static int block_readahead_default = 32;
+
+KPARAM("block.readahead", &block_readahead_default, KPARAM_INT);
 
 #define BDEV_HASH_TABLE_SIZE 256
 static spinlock_t bdev_cache_lock = SPINLOCK_INIT();
@@ -35,6 +47,7 @@ static struct block_device *bdev_alloc(void)
     list_head_init(&bdev->blocks);
     mutex_init(&bdev->lock);
     spinlock_init(&bdev->block_size_lock);
+    bdev->readahead_max = block_readahead_default;
 
     return bdev;
 }
@@ -264,6 +277,14 @@ uint64_t block_dev_capacity_get(struct block_device *bdev)
     }
 }
 
+static void block_dispatch(struct disk *disk, struct block *b)
+{
+    if (disk->queue)
+        block_queue_submit(disk->queue, b);
+    else
+        disk->ops->sync_block(disk, b);
+}
+
 void block_submit(struct block *b)
 {
     /* 
@@ -272,6 +293,19 @@ void block_submit(struct block *b)
      */
     struct disk *disk = b->bdev->disk;
     struct disk_part *part = b->bdev->part;
+    struct task *current = cpu_get_local()->current;
+
+    /* Shouldn't really happen, since the block is locked and they can check
+     * this before calling, but check it anyway */
+    if (flag_test(&b->flags, BLOCK_VALID) && !flag_test(&b->flags, BLOCK_DIRTY)) {
+        block_io_unlock(b);
+        return;
+    }
+
+    /* The driver's reference, dropped by block_io_done(). It's taken here so
+     * that blocks sitting in a plug are referenced too, since the submitter
+     * is free to drop its own reference right after this returns */
+    block_dup(b);
 
     /* We convert the block number that's in 'block-sized' increments into a
      * real sector offset for the disk that is in disk->min_block_size_shift
@@ -281,7 +315,78 @@ void block_submit(struct block *b)
     if (part)
         b->real_sector += part->first_sector;
 
-    disk->ops->sync_block(disk, b);
+    trace(block_submit, DEV_MAJOR(b->bdev->dev), DEV_MINOR(b->bdev->dev), b->sector, b->real_sector,
+          b->block_size, flag_test(&b->flags, BLOCK_DIRTY));
+
+    if (flag_test(&b->flags, BLOCK_DIRTY)) {
+        kstat_inc(KSTAT_BLOCK_WRITES);
+        kstat_add(KSTAT_BLOCK_WRITE_BYTES, b->block_size);
+    } else {
+        kstat_inc(KSTAT_BLOCK_READS);
+        kstat_add(KSTAT_BLOCK_READ_BYTES, b->block_size);
+    }
+
+    if (current && current->block_plug) {
+        list_add_tail(&current->block_plug->blocks, &b->block_list_node);
+        return;
+    }
+
+    block_dispatch(disk, b);
+
+    if (disk->queue)
+        disk->ops->run_queue(disk);
+}
+
+void block_plug_start(struct block_plug *plug)
+{
+    struct task *current = cpu_get_local()->current;
+
+    list_head_init(&plug->blocks);
+    plug->nested = !!current->block_plug;
+
+    if (!plug->nested)
+        current->block_plug = plug;
+}
+
+static void __block_plug_flush(struct block_plug *plug)
+{
+    struct disk *last = NULL;
+    struct block *b;
+
+    /* Blocks from the same disk are usually next to each other, so we only
+     * kick a disk's queue once we've moved on from it. Once a block is handed
+     * to the driver we can't touch its list node anymore */
+    list_foreach_take_entry(&plug->blocks, b, block_list_node) {
+        struct disk *disk = b->bdev->disk;
+
+        if (last && last != disk && last->queue)
+            last->ops->run_queue(last);
+
+        block_dispatch(disk, b);
+        last = disk;
+    }
+
+    if (last && last->queue)
+        last->ops->run_queue(last);
+}
+
+void block_plug_finish(struct block_plug *plug)
+{
+    struct task *current = cpu_get_local()->current;
+
+    if (plug->nested)
+        return;
+
+    current->block_plug = NULL;
+    __block_plug_flush(plug);
+}
+
+void block_plug_flush(void)
+{
+    struct task *current = cpu_get_local()->current;
+
+    if (current && current->block_plug)
+        __block_plug_flush(current->block_plug);
 }
 
 static spinlock_t anon_dev_bitmap_lock = SPINLOCK_INIT();
@@ -19,6 +19,8 @@
 #include <protura/block/bcache.h>
 #include <protura/block/bdev.h>
 #include <protura/block/disk.h>
+#include <protura/block/elevator.h>
+#include <arch/cpu.h>
 
 #define DISK_HASH_TABLE_SIZE 256
 static spinlock_t disk_hash_lock = SPINLOCK_INIT();
@@ -66,6 +68,10 @@ static void disk_free(struct disk *disk)
 {
     disk_free_parts(disk);
     kfree(disk->parts);
+
+    if (disk->queue)
+        block_queue_free(disk->queue);
+
     kfree(disk);
 }
 
@@ -347,3 +353,91 @@ const struct file_ops disk_file_ops = {
     .read = seq_read,
     .release = seq_release,
 };
+
+/*
+ * /proc/elevator only lists the disks that have a block_queue, other disks
+ * don't have an elevator to pick.
+ */
+static int disk_elevator_seq_render(struct seq_file *seq)
+{
+    struct disk *disk = seq_list_get_entry(seq, struct disk, disk_entry);
+    int ret;
+
+    if (!disk->queue)
+        return 0;
+
+    ret = seq_printf(seq, "%s ", disk->name);
+    if (ret < 0)
+        return ret;
+
+    return block_queue_render(seq, disk->queue);
+}
+
+const static struct seq_file_ops disk_elevator_seq_file_ops = {
+    .start = disk_seq_start,
+    .end = disk_seq_end,
+    .render = disk_elevator_seq_render,
+    .next = disk_seq_next,
+};
+
+static struct disk *disk_find_name(const char *name)
+{
+    struct disk *disk;
+
+    using_spinlock(&disk_hash_lock) {
+        list_foreach_entry(&disk_list, disk, disk_entry) {
+            if (strcmp(disk->name, name) == 0 && flag_test(&disk->flags, DISK_UP)) {
+                disk->refs++;
+                return disk;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static int disk_elevator_ioctl(struct file *filp, int cmd, struct user_buffer ptr)
+{
+    struct task *current = cpu_get_local()->current;
+    struct elevator_select select;
+    struct disk *disk;
+    int ret;
+
+    if (current->creds.euid != 0)
+        return -EPERM;
+
+    if (cmd != ELEVATORIO_SET)
+        return -EINVAL;
+
+    ret = user_copy_to_kernel(&select, ptr);
+    if (ret)
+        return ret;
+
+    select.disk[ELEVATOR_DISK_NAME_MAX - 1] = '\0';
+    select.elevator[ELEVATOR_NAME_MAX - 1] = '\0';
+
+    disk = disk_find_name(select.disk);
+    if (!disk)
+        return -ENODEV;
+
+    if (disk->queue)
+        ret = block_queue_set_elevator(disk->queue, select.elevator);
+    else
+        ret = -ENOTSUP;
+
+    disk_put(disk);
+    return ret;
+}
+
+static int disk_elevator_file_seq_open(struct inode *inode, struct file *filp)
+{
+    return seq_open(filp, &disk_elevator_seq_file_ops);
+}
+
+const struct file_ops disk_elevator_file_ops = {
+    .open = disk_elevator_file_seq_open,
+    .lseek = seq_lseek,
+    .read = seq_read,
+    .ioctl = disk_elevator_ioctl,
+    .release = seq_release,
+};
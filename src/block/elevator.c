@@ -0,0 +1,356 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/string.h>
+#include <protura/list.h>
+#include <protura/kparam.h>
+#include <protura/trace.h>
+#include <protura/task.h>
+#include <protura/mm/kmalloc.h>
+#include <protura/fs/seq_file.h>
+#include <protura/block/bcache.h>
+#include <protura/block/elevator.h>
+#include <arch/spinlock.h>
+#include <arch/timer.h>
+
+DEFINE_TRACEPOINT(block_merge, "disk_sector=%u request_sector=%u request_count=%u write=%d");
+
+#define BLOCK_REQUEST_ALLOC_RETRY_MS 10
+
+static const char *elevator_default = "deadline";
+
+KPARAM("block.elevator", &elevator_default, KPARAM_STRING);
+
+static const struct elevator_ops *elevator_list[] = {
+    &elevator_noop_ops,
+    &elevator_deadline_ops,
+    &elevator_cloop_ops,
+};
+
+static const struct elevator_ops *elevator_find(const char *name)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(elevator_list); i++)
+        if (strcmp(elevator_list[i]->name, name) == 0)
+            return elevator_list[i];
+
+    return NULL;
+}
+
+struct block_queue *block_queue_alloc(int sector_shift, sector_t max_sectors, int max_blocks)
+{
+    const struct elevator_ops *ops = elevator_find(elevator_default);
+
+    if (!ops) {
+        kp(KP_WARNING, "block: Unknown elevator \"%s\", using deadline\n", elevator_default);
+        ops = &elevator_deadline_ops;
+    }
+
+    struct block_queue *queue = kzalloc(sizeof(*queue), PAL_KERNEL);
+    if (!queue)
+        return NULL;
+
+    queue->elevator = (ops->alloc) ();
+    if (!queue->elevator) {
+        kfree(queue);
+        return NULL;
+    }
+
+    spinlock_init(&queue->lock);
+    list_head_init(&queue->requests);
+    queue->sector_shift = sector_shift;
+    queue->max_sectors = max_sectors;
+    queue->max_blocks = max_blocks;
+
+    return queue;
+}
+
+void block_queue_free(struct block_queue *queue)
+{
+    kassert(queue->queued == 0, "block_queue freed with %d requests queued!\n", queue->queued);
+
+    (queue->elevator->ops->free) (queue->elevator);
+    kfree(queue);
+}
+
+static int block_request_can_grow(struct block_queue *queue, struct block_request *req, sector_t sectors)
+{
+    if (queue->max_sectors && req->sector_count + sectors > queue->max_sectors)
+        return 0;
+
+    if (queue->max_blocks && req->block_count + 1 > queue->max_blocks)
+        return 0;
+
+    return 1;
+}
+
+/* Returns 1 if the block was added to the request */
+static int __block_request_try_merge(struct block_queue *queue, struct block_request *req, struct block *b, sector_t sectors, int is_write)
+{
+    if (req->is_write != is_write)
+        return 0;
+
+    if (!block_request_can_grow(queue, req, sectors))
+        return 0;
+
+    if (req->sector + req->sector_count == b->real_sector) {
+        list_add_tail(&req->blocks, &b->block_list_node);
+    } else if (b->real_sector + sectors == req->sector) {
+        list_add(&req->blocks, &b->block_list_node);
+        req->sector = b->real_sector;
+    } else {
+        return 0;
+    }
+
+    req->sector_count += sectors;
+    req->block_count++;
+
+    trace(block_merge, b->real_sector, req->sector, req->sector_count, is_write);
+    return 1;
+}
+
+static int __block_queue_merge(struct block_queue *queue, struct block *b, sector_t sectors, int is_write)
+{
+    struct block_request *req;
+
+    /* Sequential I/O almost always merges into the same request as the last
+     * block did, so check that one before looking through the rest */
+    if (queue->last_merge && __block_request_try_merge(queue, queue->last_merge, b, sectors, is_write))
+        return 1;
+
+    list_foreach_entry(&queue->requests, req, merge_entry) {
+        if (req == queue->last_merge)
+            continue;
+
+        if (__block_request_try_merge(queue, req, b, sectors, is_write)) {
+            queue->last_merge = req;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Returns 1 if the block was merged into an existing request */
+static int block_queue_merge(struct block_queue *queue, struct block *b, sector_t sectors, int is_write)
+{
+    using_spinlock(&queue->lock) {
+        if (__block_queue_merge(queue, b, sectors, is_write)) {
+            queue->total_merges++;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* If we're out of memory the block may still merge into a request that's
+ * already queued. Otherwise we wait for memory to show up, since the block
+ * has nowhere else to go */
+static struct block_request *block_request_alloc(struct block_queue *queue, struct block *b, sector_t sectors, int is_write)
+{
+    struct block_request *new;
+
+    while (!(new = kmalloc(sizeof(*new), PAL_KERNEL))) {
+        if (block_queue_merge(queue, b, sectors, is_write))
+            return NULL;
+
+        kp(KP_WARNING, "block: No memory for block request, waiting...\n");
+        task_sleep_ms(BLOCK_REQUEST_ALLOC_RETRY_MS);
+    }
+
+    return new;
+}
+
+void block_queue_submit(struct block_queue *queue, struct block *b)
+{
+    sector_t sectors = b->block_size >> queue->sector_shift;
+    int is_write = flag_test(&b->flags, BLOCK_DIRTY);
+
+    /* Allocated up front since we can't sleep under the queue lock. It's
+     * thrown away if the block gets merged */
+    struct block_request *new = block_request_alloc(queue, b, sectors, is_write);
+    if (!new)
+        return;
+
+    using_spinlock(&queue->lock) {
+        if (__block_queue_merge(queue, b, sectors, is_write)) {
+            queue->total_merges++;
+            break;
+        }
+
+        list_node_init(&new->queue_entry);
+        list_node_init(&new->fifo_entry);
+        list_node_init(&new->merge_entry);
+        list_head_init(&new->blocks);
+
+        new->sector = b->real_sector;
+        new->sector_count = sectors;
+        new->is_write = is_write;
+        new->block_count = 1;
+        new->submit_ms = timer_get_ms();
+
+        list_add_tail(&new->blocks, &b->block_list_node);
+        list_add_tail(&queue->requests, &new->merge_entry);
+
+        (queue->elevator->ops->add) (queue->elevator, queue, new);
+
+        queue->last_merge = new;
+        queue->queued++;
+        queue->total_requests++;
+        new = NULL;
+    }
+
+    if (new)
+        kfree(new);
+}
+
+struct block_request *block_queue_next(struct block_queue *queue)
+{
+    struct block_request *req;
+
+    using_spinlock(&queue->lock) {
+        req = (queue->elevator->ops->next) (queue->elevator, queue);
+        if (!req)
+            return NULL;
+
+        /* Once the driver has it, nothing else can be merged into it */
+        list_del(&req->merge_entry);
+        if (queue->last_merge == req)
+            queue->last_merge = NULL;
+
+        queue->head_sector = req->sector + req->sector_count;
+        queue->queued--;
+        queue->total_dispatched++;
+    }
+
+    return req;
+}
+
+void block_request_complete(struct block_request *req)
+{
+    struct block *b;
+
+    list_foreach_take_entry(&req->blocks, b, block_list_node)
+        block_io_done(b);
+
+    kfree(req);
+}
+
+int block_queue_set_elevator(struct block_queue *queue, const char *name)
+{
+    const struct elevator_ops *ops = elevator_find(name);
+    struct elevator *new, *old;
+    struct block_request *req;
+
+    if (!ops)
+        return -EINVAL;
+
+    new = (ops->alloc) ();
+    if (!new)
+        return -ENOMEM;
+
+    /* Requests waiting in the old elevator are handed over in the order it
+     * would have dispatched them. They stay on the merge list the whole time */
+    using_spinlock(&queue->lock) {
+        old = queue->elevator;
+
+        while ((req = (old->ops->next) (old, queue)))
+            (new->ops->add) (new, queue, req);
+
+        queue->elevator = new;
+    }
+
+    (old->ops->free) (old);
+    return 0;
+}
+
+int block_queue_render(struct seq_file *seq, struct block_queue *queue)
+{
+    const struct elevator_ops *current;
+    uint64_t requests, merges, dispatched;
+    int queued;
+    size_t i;
+    int ret;
+
+    using_spinlock(&queue->lock) {
+        current = queue->elevator->ops;
+        queued = queue->queued;
+        requests = queue->total_requests;
+        merges = queue->total_merges;
+        dispatched = queue->total_dispatched;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(elevator_list); i++) {
+        if (elevator_list[i] == current)
+            ret = seq_printf(seq, "[%s] ", elevator_list[i]->name);
+        else
+            ret = seq_printf(seq, "%s ", elevator_list[i]->name);
+
+        if (ret < 0)
+            return ret;
+    }
+
+    return seq_printf(seq, "queued=%d requests=%llu merges=%llu dispatched=%llu\n",
+                      queued, requests, merges, dispatched);
+}
+
+/*
+ * The noop elevator dispatches requests in the order they were submitted,
+ * which is what the drivers did before there were elevators. Merging still
+ * happens, since that's done by the block_queue.
+ */
+struct elevator_noop {
+    struct elevator elevator;
+    list_head_t fifo;
+};
+
+static struct elevator *noop_alloc(void)
+{
+    struct elevator_noop *noop = kzalloc(sizeof(*noop), PAL_KERNEL);
+    if (!noop)
+        return NULL;
+
+    noop->elevator.ops = &elevator_noop_ops;
+    list_head_init(&noop->fifo);
+
+    return &noop->elevator;
+}
+
+static void noop_free(struct elevator *elevator)
+{
+    kfree(container_of(elevator, struct elevator_noop, elevator));
+}
+
+static void noop_add(struct elevator *elevator, struct block_queue *queue, struct block_request *req)
+{
+    struct elevator_noop *noop = container_of(elevator, struct elevator_noop, elevator);
+
+    list_add_tail(&noop->fifo, &req->queue_entry);
+}
+
+static struct block_request *noop_next(struct elevator *elevator, struct block_queue *queue)
+{
+    struct elevator_noop *noop = container_of(elevator, struct elevator_noop, elevator);
+
+    if (list_empty(&noop->fifo))
+        return NULL;
+
+    return list_take_first(&noop->fifo, struct block_request, queue_entry);
+}
+
+const struct elevator_ops elevator_noop_ops = {
+    .name = "noop",
+    .alloc = noop_alloc,
+    .free = noop_free,
+    .add = noop_add,
+    .next = noop_next,
+};
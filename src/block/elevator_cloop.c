@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/list.h>
+#include <protura/mm/kmalloc.h>
+#include <protura/block/elevator.h>
+
+/*
+ * C-LOOK keeps every request in one list sorted by sector, and always
+ * dispatches the next request at or past the head. When there's nothing left
+ * past the head it jumps back to the lowest request and starts going up
+ * again, so the head only ever sweeps in one direction.
+ *
+ * Reads and writes are treated the same, and nothing stops a steady stream
+ * of requests near the head from starving the rest of the disk. Use deadline
+ * if that matters.
+ */
+struct elevator_cloop {
+    struct elevator elevator;
+    list_head_t sorted;
+};
+
+static struct elevator *cloop_alloc(void)
+{
+    struct elevator_cloop *cloop = kzalloc(sizeof(*cloop), PAL_KERNEL);
+    if (!cloop)
+        return NULL;
+
+    cloop->elevator.ops = &elevator_cloop_ops;
+    list_head_init(&cloop->sorted);
+
+    return &cloop->elevator;
+}
+
+static void cloop_free(struct elevator *elevator)
+{
+    kfree(container_of(elevator, struct elevator_cloop, elevator));
+}
+
+static void cloop_add(struct elevator *elevator, struct block_queue *queue, struct block_request *req)
+{
+    struct elevator_cloop *cloop = container_of(elevator, struct elevator_cloop, elevator);
+    struct block_request *pos;
+
+    list_foreach_entry_reverse(&cloop->sorted, pos, queue_entry)
+        if (pos->sector < req->sector)
+            break;
+
+    list_add(&pos->queue_entry, &req->queue_entry);
+}
+
+static struct block_request *cloop_next(struct elevator *elevator, struct block_queue *queue)
+{
+    struct elevator_cloop *cloop = container_of(elevator, struct elevator_cloop, elevator);
+    struct block_request *req;
+
+    if (list_empty(&cloop->sorted))
+        return NULL;
+
+    list_foreach_entry(&cloop->sorted, req, queue_entry)
+        if (req->sector >= queue->head_sector)
+            goto found;
+
+    req = list_first_entry(&cloop->sorted, struct block_request, queue_entry);
+
+  found:
+    list_del(&req->queue_entry);
+    return req;
+}
+
+const struct elevator_ops elevator_cloop_ops = {
+    .name = "cloop",
+    .alloc = cloop_alloc,
+    .free = cloop_free,
+    .add = cloop_add,
+    .next = cloop_next,
+};
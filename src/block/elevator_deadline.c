@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/list.h>
+#include <protura/mm/kmalloc.h>
+#include <protura/block/elevator.h>
+#include <arch/timer.h>
+
+/*
+ * The deadline elevator keeps reads and writes separate, each both sorted by
+ * sector and in submission order. Requests are normally dispatched in batches
+ * going up the disk from wherever the head last was, but if the oldest
+ * request in a direction has waited longer than its deadline it is serviced
+ * next instead.
+ *
+ * Reads are preferred, since something is almost always waiting on them,
+ * but writes only get passed over DEADLINE_WRITES_STARVED times in a row.
+ */
+#define DEADLINE_READ_EXPIRE_MS 500
+#define DEADLINE_WRITE_EXPIRE_MS 5000
+#define DEADLINE_FIFO_BATCH 16
+#define DEADLINE_WRITES_STARVED 2
+
+enum {
+    DEADLINE_READ,
+    DEADLINE_WRITE,
+};
+
+struct elevator_deadline {
+    struct elevator elevator;
+
+    list_head_t sorted[2];
+    list_head_t fifo[2];
+
+    int batch_dir;
+    int batch_left;
+    int writes_starved;
+};
+
+static const uint32_t deadline_expire_ms[2] = {
+    [DEADLINE_READ] = DEADLINE_READ_EXPIRE_MS,
+    [DEADLINE_WRITE] = DEADLINE_WRITE_EXPIRE_MS,
+};
+
+static struct elevator *deadline_alloc(void)
+{
+    struct elevator_deadline *dl = kzalloc(sizeof(*dl), PAL_KERNEL);
+    if (!dl)
+        return NULL;
+
+    dl->elevator.ops = &elevator_deadline_ops;
+    list_head_init(&dl->sorted[DEADLINE_READ]);
+    list_head_init(&dl->sorted[DEADLINE_WRITE]);
+    list_head_init(&dl->fifo[DEADLINE_READ]);
+    list_head_init(&dl->fifo[DEADLINE_WRITE]);
+
+    return &dl->elevator;
+}
+
+static void deadline_free(struct elevator *elevator)
+{
+    kfree(container_of(elevator, struct elevator_deadline, elevator));
+}
+
+static void deadline_add(struct elevator *elevator, struct block_queue *queue, struct block_request *req)
+{
+    struct elevator_deadline *dl = container_of(elevator, struct elevator_deadline, elevator);
+    int dir = req->is_write? DEADLINE_WRITE: DEADLINE_READ;
+    struct block_request *pos;
+
+    /* New requests usually go at the end, so search from the back */
+    list_foreach_entry_reverse(&dl->sorted[dir], pos, queue_entry)
+        if (pos->sector < req->sector)
+            break;
+
+    list_add(&pos->queue_entry, &req->queue_entry);
+    list_add_tail(&dl->fifo[dir], &req->fifo_entry);
+}
+
+/* The first request at or past `sector`, or NULL if there isn't one */
+static struct block_request *deadline_find_after(list_head_t *sorted, sector_t sector)
+{
+    struct block_request *req;
+
+    list_foreach_entry(sorted, req, queue_entry)
+        if (req->sector >= sector)
+            return req;
+
+    return NULL;
+}
+
+static int deadline_expired(struct elevator_deadline *dl, int dir)
+{
+    struct block_request *oldest = list_first_entry(&dl->fifo[dir], struct block_request, fifo_entry);
+
+    return timer_get_ms() - oldest->submit_ms >= deadline_expire_ms[dir];
+}
+
+static int deadline_expired_any(struct elevator_deadline *dl)
+{
+    return (!list_empty(&dl->fifo[DEADLINE_READ]) && deadline_expired(dl, DEADLINE_READ))
+        || (!list_empty(&dl->fifo[DEADLINE_WRITE]) && deadline_expired(dl, DEADLINE_WRITE));
+}
+
+static struct block_request *deadline_next(struct elevator *elevator, struct block_queue *queue)
+{
+    struct elevator_deadline *dl = container_of(elevator, struct elevator_deadline, elevator);
+    struct block_request *req = NULL;
+    int have_reads, have_writes;
+    int dir;
+
+    /* Keep going up the disk in the same direction until the batch is used up */
+    if (dl->batch_left > 0 && !deadline_expired_any(dl)) {
+        req = deadline_find_after(&dl->sorted[dl->batch_dir], queue->head_sector);
+        if (req) {
+            dl->batch_left--;
+            goto dispatch;
+        }
+    }
+
+    have_reads = !list_empty(&dl->sorted[DEADLINE_READ]);
+    have_writes = !list_empty(&dl->sorted[DEADLINE_WRITE]);
+
+    if (!have_reads && !have_writes)
+        return NULL;
+
+    if (have_reads && (!have_writes || dl->writes_starved < DEADLINE_WRITES_STARVED)) {
+        dir = DEADLINE_READ;
+        if (have_writes)
+            dl->writes_starved++;
+    } else {
+        dir = DEADLINE_WRITE;
+        dl->writes_starved = 0;
+    }
+
+    /* Start the new batch at the oldest request if it has expired, and
+     * otherwise wherever the head is, wrapping back to the start of the disk */
+    if (deadline_expired(dl, dir))
+        req = list_first_entry(&dl->fifo[dir], struct block_request, fifo_entry);
+    else
+        req = deadline_find_after(&dl->sorted[dir], queue->head_sector);
+
+    if (!req)
+        req = list_first_entry(&dl->sorted[dir], struct block_request, queue_entry);
+
+    dl->batch_dir = dir;
+    dl->batch_left = DEADLINE_FIFO_BATCH - 1;
+
+  dispatch:
+    list_del(&req->queue_entry);
+    list_del(&req->fifo_entry);
+    return req;
+}
+
+const struct elevator_ops elevator_deadline_ops = {
+    .name = "deadline",
+    .alloc = deadline_alloc,
+    .free = deadline_free,
+    .add = deadline_add,
+    .next = deadline_next,
+};
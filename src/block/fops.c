@@ -12,13 +12,17 @@
 #include <protura/snprintf.h>
 #include <protura/mm/kmalloc.h>
 #include <protura/mm/user_check.h>
+#include <protura/task.h>
 #include <protura/dev.h>
 #include <protura/fs/inode.h>
 #include <protura/fs/file.h>
 #include <protura/fs/pipe.h>
+#include <protura/fs/ioctl.h>
 #include <protura/block/bcache.h>
 #include <protura/block/disk.h>
 #include <protura/block/bdev.h>
+#include <arch/cpu.h>
+#include <arch/asm.h>
 
 static int block_dev_pread_generic(struct file *filp, struct user_buffer buf, size_t len, off_t off)
 {
@@ -137,6 +141,35 @@ static int block_dev_fops_close(struct file *filp)
     return 0;
 }
 
+static int block_dev_ioctl_generic(struct file *filp, int cmd, struct user_buffer ptr)
+{
+    struct block_device *bdev = filp->inode->bdev;
+    struct task *current = cpu_get_local()->current;
+    int readahead;
+    int ret;
+
+    switch (cmd) {
+    case BLKRAGET:
+        return user_copy_from_kernel(ptr, bdev->readahead_max);
+
+    case BLKRASET:
+        if (current->creds.euid != 0)
+            return -EPERM;
+
+        ret = user_copy_to_kernel(&readahead, ptr);
+        if (ret)
+            return ret;
+
+        if (readahead < 0)
+            return -EINVAL;
+
+        WRITE_ONCE(bdev->readahead_max, readahead);
+        return 0;
+    }
+
+    return -EINVAL;
+}
+
 struct file_ops block_dev_file_ops = {
     .open = block_dev_fops_open,
     .release = block_dev_fops_close,
@@ -144,4 +177,5 @@ struct file_ops block_dev_file_ops = {
     .read = block_dev_read_generic,
     .write = block_dev_write_generic,
     .lseek = fs_file_generic_lseek,
+    .ioctl = block_dev_ioctl_generic,
 };
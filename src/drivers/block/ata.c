@@ -17,6 +17,8 @@
 #include <protura/wait.h>
 #include <protura/ida.h>
 #include <protura/kparam.h>
+#include <protura/trace.h>
+#include <protura/softirq.h>
 
 #include <arch/spinlock.h>
 #include <arch/idt.h>
@@ -31,12 +33,16 @@
 #include "ata.h"
 
 static int ata_max_log_level = CONFIG_ATA_LOG_LEVEL;
+
 KPARAM("ata.loglevel", &ata_max_log_level, KPARAM_LOGLEVEL);
 
+DEFINE_TRACEPOINT(ata_request, "disk_sector=%u count=%d slave=%d dma=%d write=%d");
+DEFINE_TRACEPOINT(ata_intr, "status=0x%02x");
+DEFINE_TRACEPOINT(ata_complete, "disk_sector=%u count=%u");
+
 #define kp_ata_check_level(lvl, str, ...) \
     kp_check_level((lvl), ata_max_log_level, "ATA: " str, ## __VA_ARGS__)
 
-#define kp_ata_trace(str, ...)   kp_ata_check_level(KP_TRACE, str, ## __VA_ARGS__)
 #define kp_ata_debug(str, ...)   kp_ata_check_level(KP_DEBUG, str, ## __VA_ARGS__)
 #define kp_ata(str, ...)         kp_ata_check_level(KP_NORMAL, str, ## __VA_ARGS__)
 #define kp_ata_warning(str, ...) kp_ata_check_level(KP_WARNING, str, ## __VA_ARGS__)
@@ -95,30 +101,36 @@ static void ata_pio_write(struct ata_drive *drive, const char *buf)
     outsw(ata_reg(drive, ATA_PORT_DATA), buf, ATA_SECTOR_SIZE / sizeof(uint16_t));
 }
 
-static void ata_pio_write_next_sector(struct ata_drive *drive)
+/* Moves to the next sector of the request, which may be in the next block */
+static void ata_pio_advance(struct ata_drive *drive)
 {
-    ata_pio_write(drive, drive->current->data + drive->current_sector_offset);
-
     drive->sectors_left--;
     drive->current_sector_offset += ATA_SECTOR_SIZE;
+
+    if (drive->sectors_left && drive->current_sector_offset == drive->current->block_size) {
+        drive->current = list_next_entry(drive->current, block_list_node);
+        drive->current_sector_offset = 0;
+    }
+}
+
+static void ata_pio_write_next_sector(struct ata_drive *drive)
+{
+    ata_pio_write(drive, drive->current->data + drive->current_sector_offset);
+    ata_pio_advance(drive);
 }
 
 static void ata_pio_read_next_sector(struct ata_drive *drive)
 {
     ata_pio_read(drive, drive->current->data + drive->current_sector_offset);
-
-    drive->sectors_left--;
-    drive->current_sector_offset += ATA_SECTOR_SIZE;
+    ata_pio_advance(drive);
 }
 
-static void start_pio_request(struct ata_drive *drive, struct block *b)
+static void start_pio_request(struct ata_drive *drive, struct block_request *req, int lba48)
 {
-    if (!flag_test(&b->flags, BLOCK_DIRTY)) {
-        kp_ata_trace("Start PIO read: %d\n", b->sector);
-        outb(ata_reg(drive, ATA_PORT_COMMAND_STATUS), ATA_COMMAND_PIO_LBA28_READ);
+    if (!req->is_write) {
+        outb(ata_reg(drive, ATA_PORT_COMMAND_STATUS), lba48? ATA_COMMAND_PIO_LBA48_READ: ATA_COMMAND_PIO_LBA28_READ);
     } else {
-        kp_ata_trace("Start PIO write: %d\n", b->sector);
-        outb(ata_reg(drive, ATA_PORT_COMMAND_STATUS), ATA_COMMAND_PIO_LBA28_WRITE);
+        outb(ata_reg(drive, ATA_PORT_COMMAND_STATUS), lba48? ATA_COMMAND_PIO_LBA48_WRITE: ATA_COMMAND_PIO_LBA28_WRITE);
 
         int status = ata_wait_for_drq(drive);
 
@@ -129,76 +141,121 @@ static void start_pio_request(struct ata_drive *drive, struct block *b)
     }
 }
 
-static void start_dma_request(struct ata_drive *drive, struct block *b)
+/* Every block of the request gets its own PRD entry, the blocks are one
+ * after the other on the disk but can be anywhere in memory */
+static void ata_dma_fill_prdt(struct ata_drive *drive, struct block_request *req)
 {
-    drive->prdt[0].addr = V2P(b->data);
-    drive->prdt[0].bcnt = b->block_size | 0x80000000;
+    struct block *b;
+    int i = 0;
 
-    outl(drive->dma_base + ATA_DMA_IO_PRDT, V2P(drive->prdt));
+    list_foreach_entry(&req->blocks, b, block_list_node) {
+        drive->prdt[i].addr = V2P(b->data);
+        drive->prdt[i].bcnt = b->block_size;
+        i++;
+    }
+
+    drive->prdt[i - 1].bcnt |= 0x80000000;
+}
+
+static void start_dma_request(struct ata_drive *drive, struct block_request *req, int lba48)
+{
+    ata_dma_fill_prdt(drive, req);
 
-    if (!flag_test(&b->flags, BLOCK_DIRTY)) {
-        kp_ata_trace("Start DMA read: %d\n", b->sector);
+    outl(drive->dma_base + ATA_DMA_IO_PRDT, V2P(drive->prdt));
 
+    if (!req->is_write) {
         outb(drive->dma_base + ATA_DMA_IO_CMD, ATA_DMA_CMD_RWCON);
         outb(drive->dma_base + ATA_DMA_IO_STAT, inb(drive->dma_base + ATA_DMA_IO_STAT)); /* Per Linux, clear the status register */
         outb(drive->dma_base + ATA_DMA_IO_CMD, ATA_DMA_CMD_RWCON | ATA_DMA_CMD_SSBM);
-        outb(ata_reg(drive, ATA_PORT_COMMAND_STATUS), ATA_COMMAND_DMA_LBA28_READ);
+        outb(ata_reg(drive, ATA_PORT_COMMAND_STATUS), lba48? ATA_COMMAND_DMA_LBA48_READ: ATA_COMMAND_DMA_LBA28_READ);
     } else {
-        kp_ata_trace("Start DMA write: %d\n", b->sector);
-
         outb(drive->dma_base + ATA_DMA_IO_CMD, 0);
         outb(drive->dma_base + ATA_DMA_IO_STAT, inb(drive->dma_base + ATA_DMA_IO_STAT)); /* Per Linux, clear the status register */
         outb(drive->dma_base + ATA_DMA_IO_CMD, ATA_DMA_CMD_SSBM);
-        outb(ata_reg(drive, ATA_PORT_COMMAND_STATUS), ATA_COMMAND_DMA_LBA28_WRITE);
+        outb(ata_reg(drive, ATA_PORT_COMMAND_STATUS), lba48? ATA_COMMAND_DMA_LBA48_WRITE: ATA_COMMAND_DMA_LBA28_WRITE);
     }
 }
 
+static void ata_setup_lba28(struct ata_drive *drive, sector_t sector, int count, int is_slave)
+{
+    /* A count of 256 is written as zero */
+    outb(ata_reg(drive, ATA_PORT_SECTOR_CNT), count & 0xFF);
+    outb(ata_reg(drive, ATA_PORT_LBA_LOW_8), sector & 0xFF);
+    outb(ata_reg(drive, ATA_PORT_LBA_MID_8), (sector >> 8) & 0xFF);
+    outb(ata_reg(drive, ATA_PORT_LBA_HIGH_8), (sector >> 16) & 0xFF);
+
+    outb(ata_reg(drive, ATA_PORT_DRIVE_HEAD), ATA_DH_SHOULD_BE_SET
+                                            | ATA_DH_LBA
+                                            | ((sector >> 24) & 0x0F)
+                                            | (is_slave? ATA_DH_SLAVE: 0)
+                                            );
+}
+
+/* For LBA48 the registers are FIFOs two bytes deep, the high bytes are
+ * written first and then the low bytes. sector_t is only 32 bits, so the top
+ * two bytes of the LBA are always zero */
+static void ata_setup_lba48(struct ata_drive *drive, sector_t sector, int count, int is_slave)
+{
+    outb(ata_reg(drive, ATA_PORT_DRIVE_HEAD), ATA_DH_SHOULD_BE_SET
+                                            | ATA_DH_LBA
+                                            | (is_slave? ATA_DH_SLAVE: 0)
+                                            );
+
+    outb(ata_reg(drive, ATA_PORT_SECTOR_CNT), (count >> 8) & 0xFF);
+    outb(ata_reg(drive, ATA_PORT_LBA_LOW_8), (sector >> 24) & 0xFF);
+    outb(ata_reg(drive, ATA_PORT_LBA_MID_8), 0);
+    outb(ata_reg(drive, ATA_PORT_LBA_HIGH_8), 0);
+
+    outb(ata_reg(drive, ATA_PORT_SECTOR_CNT), count & 0xFF);
+    outb(ata_reg(drive, ATA_PORT_LBA_LOW_8), sector & 0xFF);
+    outb(ata_reg(drive, ATA_PORT_LBA_MID_8), (sector >> 8) & 0xFF);
+    outb(ata_reg(drive, ATA_PORT_LBA_HIGH_8), (sector >> 16) & 0xFF);
+}
+
 static void __ata_start_request(struct ata_drive *drive)
 {
-    int is_slave;
+    struct block_request *req = NULL;
+    int is_slave = 0, lba48;
 
-    if (drive->current)
+    if (drive->current_request)
         return;
 
-    /* Attempt to find the next block, or exit if there are none */
-    if (!list_empty(&drive->block_queue_master)) {
-        drive->current = list_take_first(&drive->block_queue_master, struct block, block_list_node);
-        is_slave = 0;
-    } else if (!list_empty(&drive->block_queue_slave)) {
-        drive->current = list_take_first(&drive->block_queue_slave, struct block, block_list_node);
+    /* Attempt to find the next request, or exit if there are none */
+    if (drive->queue_master)
+        req = block_queue_next(drive->queue_master);
+
+    if (!req && drive->queue_slave) {
+        req = block_queue_next(drive->queue_slave);
         is_slave = 1;
-    } else {
-        return;
     }
 
-    struct block *b = drive->current;
-    int sector_count = b->block_size / ATA_SECTOR_SIZE;
+    if (!req)
+        return;
 
-    kp_ata_trace("Request B: %d, sector: %d, count: %d, slave: %d\n", b->sector, b->real_sector, sector_count, is_slave);
+    lba48 = is_slave? drive->slave_lba48: drive->master_lba48;
 
-    drive->current_sector_offset = 0;
-    drive->sectors_left = sector_count;
+    trace(ata_request, req->sector, req->sector_count, is_slave, drive->use_dma, req->is_write);
 
-    outb(ata_reg(drive, ATA_PORT_SECTOR_CNT), sector_count);
-    outb(ata_reg(drive, ATA_PORT_LBA_LOW_8), b->real_sector & 0xFF);
-    outb(ata_reg(drive, ATA_PORT_LBA_MID_8), (b->real_sector >> 8) & 0xFF);
-    outb(ata_reg(drive, ATA_PORT_LBA_HIGH_8), (b->real_sector >> 16) & 0xFF);
+    drive->current_request = req;
+    drive->current = list_first_entry(&req->blocks, struct block, block_list_node);
+    drive->current_sector_offset = 0;
+    drive->sectors_left = req->sector_count;
 
-    outb(ata_reg(drive, ATA_PORT_DRIVE_HEAD), ATA_DH_SHOULD_BE_SET
-                                            | ATA_DH_LBA
-                                            | ((b->real_sector >> 24) & 0x0F)
-                                            | (is_slave? ATA_DH_SLAVE: 0)
-                                            );
+    if (lba48)
+        ata_setup_lba48(drive, req->sector, req->sector_count, is_slave);
+    else
+        ata_setup_lba28(drive, req->sector, req->sector_count, is_slave);
 
     if (drive->use_dma)
-        start_dma_request(drive, b);
+        start_dma_request(drive, req, lba48);
     else
-        start_pio_request(drive, b);
+        start_pio_request(drive, req, lba48);
 }
 
-static int __ata_handle_intr_pio(struct ata_drive *drive, struct block *b)
+/* PIO gives us an interrupt for every sector */
+static int __ata_handle_intr_pio(struct ata_drive *drive, struct block_request *req)
 {
-    if (!flag_test(&b->flags, BLOCK_DIRTY)) {
+    if (!req->is_write) {
         ata_pio_read_next_sector(drive);
 
         if (!drive->sectors_left)
@@ -215,17 +272,18 @@ static int __ata_handle_intr_pio(struct ata_drive *drive, struct block *b)
 
 static void __ata_handle_intr(struct ata_drive *drive)
 {
-    struct block *b = drive->current;
+    struct block_request *req = drive->current_request;
     int status = ata_read_status(drive);
 
-    kp_ata_trace("INTR, Status: 0x%02x\n", status);
+    trace(ata_intr, status);
 
-    /* If the interrupt is shared, the request may not be finished yet */
-    if (status & ATA_STATUS_BUSY)
+    /* If the interrupt is shared, we may not have a request at all, or it may
+     * not be finished yet */
+    if (!req || (status & ATA_STATUS_BUSY))
         return;
 
     kassert(status & (ATA_STATUS_DATA_REQUEST | ATA_STATUS_READY), "Drive not busy but DRQ not set! Status: 0x%02x\n", status);
-    kassert(!(status & ATA_STATUS_ERROR), "Drive reported error reading block %d! Status: 0x%02x\n", b->sector, status);
+    kassert(!(status & ATA_STATUS_ERROR), "Drive reported error on request at sector %d! Status: 0x%02x\n", req->sector, status);
 
     int request_done;
 
@@ -233,13 +291,14 @@ static void __ata_handle_intr(struct ata_drive *drive)
         inb(drive->dma_base + ATA_DMA_IO_STAT);
         request_done = 1;
     } else {
-        request_done = __ata_handle_intr_pio(drive, b);
+        request_done = __ata_handle_intr_pio(drive, req);
     }
 
     if (request_done) {
-        block_mark_synced(b);
-        block_unlockput(b);
+        list_add_tail(&drive->completed, &req->queue_entry);
+        tasklet_schedule(&drive->complete_tasklet);
 
+        drive->current_request = NULL;
         drive->current = NULL;
 
         /* Start the next request if we have one */
@@ -247,44 +306,44 @@ static void __ata_handle_intr(struct ata_drive *drive)
     }
 }
 
-static void ata_handle_intr(struct irq_frame *frame, void *param)
+/*
+ * The bcache side of completing a request (Marking the block synced and
+ * waking up anybody waiting on it) is done from a tasklet rather than in the
+ * interrupt handler. The interrupt handler starts the next request right
+ * away, so the drive doesn't sit idle while this runs.
+ */
+static void ata_complete_tasklet(struct tasklet *tasklet)
 {
-    struct ata_drive *drive = param;
+    struct ata_drive *drive = container_of(tasklet, struct ata_drive, complete_tasklet);
+    list_head_t done = LIST_HEAD_INIT(done);
+    struct block_request *req;
 
     using_spinlock(&drive->lock)
-        __ata_handle_intr(drive);
-}
+        list_splice_init(&done, &drive->completed);
 
-static void ata_sync_block(struct ata_drive *drive, struct block *b, int master_or_slave)
-{
-    /* Shouldn't really happen, since the block is locked and they can check
-     * this before calling, but check it anyway */
-    if (flag_test(&b->flags, BLOCK_VALID) && !flag_test(&b->flags, BLOCK_DIRTY)) {
-        block_unlock(b);
-        return ;
-    }
+    list_foreach_take_entry(&done, req, queue_entry) {
+        trace(ata_complete, req->sector, req->sector_count);
 
-    b = block_dup(b);
-
-    /* The block will be unlocked once syncing is done */
-    using_spinlock(&drive->lock) {
-        if (master_or_slave == 0)
-            list_add_tail(&drive->block_queue_master, &b->block_list_node);
-        else
-            list_add_tail(&drive->block_queue_slave, &b->block_list_node);
-
-        __ata_start_request(drive);
+        block_request_complete(req);
     }
 }
 
-static void ata_sync_block_master(struct disk *disk, struct block *b)
+static void ata_handle_intr(struct irq_frame *frame, void *param)
 {
-    return ata_sync_block(disk->priv, b, 0);
+    struct ata_drive *drive = param;
+
+    using_spinlock(&drive->lock)
+        __ata_handle_intr(drive);
 }
 
-static void ata_sync_block_slave(struct disk *disk, struct block *b)
+/* The block_queue already has the new blocks, we just have to start on them
+ * if the drive isn't busy */
+static void ata_run_queue(struct disk *disk)
 {
-    return ata_sync_block(disk->priv, b, 1);
+    struct ata_drive *drive = disk->priv;
+
+    using_spinlock(&drive->lock)
+        __ata_start_request(drive);
 }
 
 static void ata_identity_fix_string(uint8_t *s, size_t len)
@@ -309,7 +368,10 @@ static void ata_identity_fix_string(uint8_t *s, size_t len)
 
 /* NOTE: This function *requires* interrupts to be on for the timer to
  * function. This is only used during startup and polling for the identify
- * command */
+ * command.
+ *
+ * Between polls we yield, so the initcalls running alongside the disk probe
+ * aren't stuck behind it. */
 static int ata_wait_for_status(struct ata_drive *drive, int status, uint32_t ms)
 {
     int ret;
@@ -321,7 +383,7 @@ static int ata_wait_for_status(struct ata_drive *drive, int status, uint32_t ms)
 
         uint32_t cur;
         while (cur = timer_get_ms(), cur == last)
-            ;
+            scheduler_task_yield();
 
         last = cur;
 
@@ -332,7 +394,7 @@ static int ata_wait_for_status(struct ata_drive *drive, int status, uint32_t ms)
     return ret;
 }
 
-static int ata_identify(struct ata_drive *drive, uint32_t *size)
+static int ata_identify(struct ata_drive *drive, sector_t *size, int *lba48)
 {
     int ret = 0;
     struct page *page = palloc(0, PAL_KERNEL);
@@ -357,9 +419,15 @@ static int ata_identify(struct ata_drive *drive, uint32_t *size)
     struct ata_identify_format *id = page->virt;
     ata_identity_fix_string(id->model, sizeof(id->model));
 
-    kp(KP_NORMAL, "IDENTIFY Model: %s, capacity: %dMB\n", id->model, id->lba_capacity * ATA_SECTOR_SIZE / 1024 / 1024);
+    *lba48 = !!(id->command_set_2 & ATA_COMMAND_SET_2_LBA48);
+
+    /* sector_t is 32 bits, so anything past that can't be used */
+    if (*lba48)
+        *size = (id->lba_capacity_2 > 0xFFFFFFFF)? 0xFFFFFFFF: id->lba_capacity_2;
+    else
+        *size = id->lba_capacity;
 
-    *size = id->lba_capacity;
+    kp(KP_NORMAL, "IDENTIFY Model: %s, capacity: %lluMB, LBA48: %d\n", id->model, (uint64_t)*size * ATA_SECTOR_SIZE / 1024 / 1024, *lba48);
 
     drive->use_dma = drive->dma_base && (id->capability & ATA_CAPABILITY_DMA);
     if (drive->use_dma)
@@ -372,22 +440,26 @@ static int ata_identify(struct ata_drive *drive, uint32_t *size)
 
 static int ata_identify_master(struct ata_drive *drive)
 {
-    uint32_t capacity = 0;
+    sector_t capacity = 0;
+    int lba48 = 0;
     outb(ata_reg(drive, ATA_PORT_DRIVE_HEAD), ATA_DH_SHOULD_BE_SET);
 
-    int ret = ata_identify(drive, &capacity);
+    int ret = ata_identify(drive, &capacity, &lba48);
     drive->master_sectors = capacity;
+    drive->master_lba48 = lba48;
 
     return ret;
 }
 
 static int ata_identify_slave(struct ata_drive *drive)
 {
-    uint32_t capacity = 0;
+    sector_t capacity = 0;
+    int lba48 = 0;
     outb(ata_reg(drive, ATA_PORT_DRIVE_HEAD), ATA_DH_SHOULD_BE_SET | ATA_DH_SLAVE);
 
-    int ret = ata_identify(drive, &capacity);
+    int ret = ata_identify(drive, &capacity, &lba48);
     drive->slave_sectors = capacity;
+    drive->slave_lba48 = lba48;
 
     return ret;
 }
@@ -430,6 +502,14 @@ static int ata_drive_init(struct ata_drive *drive)
 static uint32_t ata_ids[ATA_MAX_DISKS / 32];
 static struct ida ata_ida = IDA_INIT(ata_ids, ATA_MAX_DISKS);
 
+static void ata_drive_free(struct ata_drive *drive)
+{
+    if (drive->prdt)
+        pfree_va(drive->prdt, 0);
+
+    kfree(drive);
+}
+
 static void ata_disk_put(struct disk *disk)
 {
     struct ata_drive *drive = disk->priv;
@@ -438,26 +518,26 @@ static void ata_disk_put(struct disk *disk)
     ida_putid(&ata_ida, disk->first_minor >> ATA_MINOR_SHIFT);
 
     using_spinlock(&drive->lock) {
+        if (drive->queue_master == disk->queue)
+            drive->queue_master = NULL;
+        else if (drive->queue_slave == disk->queue)
+            drive->queue_slave = NULL;
+
         drive->refs--;
         if (!drive->refs)
             drop_drive = 1;
     }
 
     if (drop_drive)
-        kfree(drive);
+        ata_drive_free(drive);
 }
 
-static struct disk_ops ata_master_disk_ops = {
-    .sync_block = ata_sync_block_master,
+static struct disk_ops ata_disk_ops = {
+    .run_queue = ata_run_queue,
     .put = ata_disk_put,
 };
 
-static struct disk_ops ata_slave_disk_ops = {
-    .sync_block = ata_sync_block_slave,
-    .put = ata_disk_put,
-};
-
-static void make_disk(struct ata_drive *ata, const struct disk_ops *ops, uint32_t capacity)
+static void make_disk(struct ata_drive *ata, int is_slave, sector_t capacity)
 {
     int index = ida_getid(&ata_ida);
     if (index == -1) {
@@ -465,21 +545,35 @@ static void make_disk(struct ata_drive *ata, const struct disk_ops *ops, uint32_
         return;
     }
 
+    struct block_queue *queue = block_queue_alloc(log2(ATA_SECTOR_SIZE), ATA_MAX_REQUEST_SECTORS, PRD_MAX);
+    if (!queue) {
+        kp(KP_WARNING, "Unable to allocate request queue for ATA disk at 0x%04x!\n", ata->io_base);
+        ida_putid(&ata_ida, index);
+        return;
+    }
+
     struct disk *disk = disk_alloc();
 
     snprintf(disk->name, sizeof(disk->name), "hd%c", 'a' + index);
 
-    disk->ops = ops;
+    disk->ops = &ata_disk_ops;
 
     disk->major = BLOCK_DEV_ATA;
     disk->first_minor = index << ATA_MINOR_SHIFT;
     disk->minor_count = 1 << ATA_MINOR_SHIFT;
 
     disk->min_block_size_shift = log2(ATA_SECTOR_SIZE);
+    disk->queue = queue;
 
-    using_spinlock(&ata->lock)
+    using_spinlock(&ata->lock) {
         ata->refs++;
 
+        if (is_slave)
+            ata->queue_slave = disk->queue;
+        else
+            ata->queue_master = disk->queue;
+    }
+
     disk->priv = ata;
 
     disk_capacity_set(disk, capacity);
@@ -491,8 +585,8 @@ static void ata_create_disk(io_t io_base, io_t ctrl_io_base, io_t dma_base, int
 {
     struct ata_drive *ata = kzalloc(sizeof(*ata), PAL_KERNEL);
     spinlock_init(&ata->lock);
-    list_head_init(&ata->block_queue_master);
-    list_head_init(&ata->block_queue_slave);
+    list_head_init(&ata->completed);
+    tasklet_init(&ata->complete_tasklet, ata_complete_tasklet);
 
     ata->io_base = io_base;
     ata->ctrl_io_base = ctrl_io_base;
@@ -505,18 +599,26 @@ static void ata_create_disk(io_t io_base, io_t ctrl_io_base, io_t dma_base, int
         return;
     }
 
+    if (ata->use_dma) {
+        ata->prdt = palloc_va(0, PAL_KERNEL);
+        if (!ata->prdt) {
+            kp(KP_WARNING, "ATA: Unable to allocate PRD table, falling back to PIO\n");
+            ata->use_dma = 0;
+        }
+    }
+
     int err = irq_register_callback(ata->drive_irq, ata_handle_intr, "ATA", IRQ_INTERRUPT, ata, F(IRQF_SHARED));
     if (err) {
         kp(KP_WARNING, "ATA: Interrupt %d is already in use! Check log, drive cannot be used.\n", ata->drive_irq);
-        kfree(ata);
+        ata_drive_free(ata);
         return;
     }
 
     if (ata->has_master)
-        make_disk(ata, &ata_master_disk_ops, ata->master_sectors);
+        make_disk(ata, 0, ata->master_sectors);
 
     if (ata->has_slave)
-        make_disk(ata, &ata_slave_disk_ops, ata->slave_sectors);
+        make_disk(ata, 1, ata->slave_sectors);
 }
 
 void ata_pci_init(struct pci_dev *dev)
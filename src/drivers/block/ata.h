@@ -4,6 +4,7 @@
 #include <protura/types.h>
 #include <protura/list.h>
 #include <protura/block/bcache.h>
+#include <protura/block/elevator.h>
 #include <arch/spinlock.h>
 #include <protura/drivers/pci.h>
 
@@ -55,11 +56,41 @@ struct ata_identify_format {
     uint16_t eide_pio_iordy; /* min cycle time (ns), with IORDY */
     uint16_t reserved69; /* reserved (word 69) */
     uint16_t reserved70; /* reserved (word 70) */
+    uint16_t words71_74[4]; /* reserved words 71-74 */
+    uint16_t queue_depth; /* */
+    uint16_t words76_79[4]; /* reserved words 76-79 */
+    uint16_t major_rev_num; /* */
+    uint16_t minor_rev_num; /* */
+    uint16_t command_set_1; /* bits 0:Smart 1:Security 2:Removable 3:PM */
+    uint16_t command_set_2; /* bits 14:Smart Enabled 13:0 zero 10:48-bit */
+    uint16_t cfsse; /* command set-feature supported extensions */
+    uint16_t cfs_enable_1; /* command set-feature enabled */
+    uint16_t cfs_enable_2; /* command set-feature enabled */
+    uint16_t csf_default; /* command set-feature default */
+    uint16_t dma_ultra; /* */
+    uint16_t trseuc; /* time required for security erase */
+    uint16_t trsEuc; /* time required for enhanced erase */
+    uint16_t CurAPMvalues; /* current APM values */
+    uint16_t mprc; /* master password revision code */
+    uint16_t hw_config; /* hardware config */
+    uint16_t acoustic; /* acoustic management */
+    uint16_t msrqs; /* min stream request size */
+    uint16_t sxfert; /* stream transfer time */
+    uint16_t sal; /* stream access latency */
+    uint32_t spg; /* stream performance granularity */
+    uint64_t lba_capacity_2; /* 48-bit total number of sectors */
 } __packed;
 
 #define ATA_CAPABILITY_DMA 0x01
+#define ATA_COMMAND_SET_2_LBA48 (1 << 10)
 
-#define PRD_MAX 10
+/*
+ * A whole request is done with a single command, so it's limited by the
+ * largest transfer we allow (128KiB) and the number of PRD entries. Each block
+ * gets its own PRD entry, and blocks are never smaller than a sector.
+ */
+#define ATA_MAX_REQUEST_SECTORS 256
+#define PRD_MAX ATA_MAX_REQUEST_SECTORS
 
 struct ata_dma_prd {
     uint32_t addr;
@@ -101,6 +132,12 @@ enum {
     ATA_COMMAND_DMA_LBA28_READ = 0xC8,
     ATA_COMMAND_DMA_LBA28_WRITE = 0xCA,
 
+    ATA_COMMAND_PIO_LBA48_READ = 0x24,
+    ATA_COMMAND_PIO_LBA48_WRITE = 0x34,
+
+    ATA_COMMAND_DMA_LBA48_READ = 0x25,
+    ATA_COMMAND_DMA_LBA48_WRITE = 0x35,
+
     ATA_COMMAND_CACHE_FLUSH = 0xE7,
     ATA_COMMAND_IDENTIFY = 0xEC,
 
@@ -117,14 +154,24 @@ enum {
 struct ata_drive {
     spinlock_t lock;
 
+    /* The request being processed. For PIO, `current` is the block of the
+     * request that the next sector goes in or comes from */
+    struct block_request *current_request;
     struct block *current;
     size_t current_sector_offset;
     int sectors_left;
 
-    list_head_t block_queue_master;
-    list_head_t block_queue_slave;
+    /* These belong to the disks, and are cleared when the disks go away */
+    struct block_queue *queue_master;
+    struct block_queue *queue_slave;
+
+    /* Finished requests, waiting for ata_complete_tasklet() */
+    list_head_t completed;
+    struct tasklet complete_tasklet;
 
-    struct ata_dma_prd prdt[PRD_MAX];
+    /* A page, only allocated if the drive does DMA. Being in one page keeps
+     * it from crossing a 64KiB boundary */
+    struct ata_dma_prd *prdt;
 
     io_t io_base;
     io_t ctrl_io_base;
@@ -134,9 +181,11 @@ struct ata_drive {
     uint8_t has_master :1;
     uint8_t has_slave  :1;
     uint8_t use_dma    :1;
+    uint8_t master_lba48 :1;
+    uint8_t slave_lba48  :1;
 
-    uint32_t master_sectors;
-    uint32_t slave_sectors;
+    sector_t master_sectors;
+    sector_t slave_sectors;
 
     int refs;
 };
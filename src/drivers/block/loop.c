@@ -115,23 +115,17 @@ static void loop_block_sync_callback(struct work *work)
         }
     }
 
-    block_mark_synced(b);
-    block_unlockput(b);
+    block_io_done(b);
 
     kfree(loop_block);
 }
 
 static void loop_sync_block(struct disk *disk, struct block *b)
 {
-    if (flag_test(&b->flags, BLOCK_VALID) && !flag_test(&b->flags, BLOCK_DIRTY)) {
-        block_unlock(b);
-        return;
-    }
-
     struct loop_drive *drive = disk->priv;
     struct loop_block_work *work = kzalloc(sizeof(*work), PAL_KERNEL);
 
-    work->block = block_dup(b);
+    work->block = b;
     work->drive = drive;
 
     work_init_workqueue(&work->work, loop_block_sync_callback, &loop_block_queue);
@@ -330,7 +324,7 @@ struct file_ops loop_control_ops = {
 
 static void loop_init(void)
 {
-    workqueue_start_multiple(&loop_block_queue, "loop", 4);
+    workqueue_start_pool(&loop_block_queue, "loop", 1, 4);
 }
 initcall_subsys(block_loop, loop_init);
 
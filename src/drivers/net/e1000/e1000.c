@@ -209,6 +209,25 @@ static void e1000_process_tx_queue(struct net_interface *net)
     }
 }
 
+/*
+ * The interrupt handler just acknowledges the interrupt, copying the packets
+ * out and refilling the TX ring is done from a tasklet. Both of those only
+ * look at the descriptors the hardware has marked as done, so the tasklet
+ * doesn't need to know which interrupts came in.
+ */
+static void e1000_tasklet(struct tasklet *tasklet)
+{
+    struct net_interface_e1000 *e1000 = container_of(tasklet, struct net_interface_e1000, tasklet);
+
+    using_spinlock(&e1000->rx_lock)
+        __e1000_rx_interrupt(e1000);
+
+    using_spinlock(&e1000->net.tx_lock) {
+        __e1000_clear_tx_descs(e1000);
+        __e1000_flush_packet_queue(e1000);
+    }
+}
+
 static void e1000_interrupt(struct irq_frame *frame, void *param)
 {
     struct net_interface_e1000 *e1000 = param;
@@ -216,17 +235,19 @@ static void e1000_interrupt(struct irq_frame *frame, void *param)
     uint32_t icr = e1000_command_read32(e1000, REG_ICR);
     e1000_command_write32(e1000, REG_ICR, icr);
 
-    if (icr & (ICR_RXT0 | ICR_LSC)) {
-        using_spinlock(&e1000->rx_lock)
-            __e1000_rx_interrupt(e1000);
-    }
+    /* The line is shared, this might not have been for us */
+    if (icr)
+        tasklet_schedule(&e1000->tasklet);
+}
 
-    /* We turn on the TXDW interrupt, but we check and try to queue packets
-     * even if it isn't a TXDW */
-    using_spinlock(&e1000->net.tx_lock) {
-        __e1000_clear_tx_descs(e1000);
-        __e1000_flush_packet_queue(e1000);
-    }
+/* Our MSI vector isn't shared, so it's always for us. Reading ICR is still
+ * required, as that's what clears the interrupt causes */
+static void e1000_msi_interrupt(struct irq_frame *frame, void *param)
+{
+    struct net_interface_e1000 *e1000 = param;
+
+    e1000_command_read32(e1000, REG_ICR);
+    tasklet_schedule(&e1000->tasklet);
 }
 
 static void e1000_setup_rx(struct net_interface_e1000 *e1000)
@@ -283,6 +304,7 @@ void e1000_device_init(struct pci_dev *dev)
 
     net_interface_init(&e1000->net);
     spinlock_init(&e1000->rx_lock);
+    tasklet_init(&e1000->tasklet, e1000_tasklet);
 
     kp(KP_NORMAL, "Found Intel E1000 NIC: "PRpci_dev"\n", Ppci_dev(dev));
 
@@ -314,16 +336,21 @@ void e1000_device_init(struct pci_dev *dev)
 
     kp(KP_NORMAL, "  E1000 MAC: "PRmac"\n", Pmac(e1000->net.mac));
 
-    int int_line = pci_config_read_uint8(dev, PCI_REG_INTERRUPT_LINE);
-    kp(KP_NORMAL, "  Interrupt: %d\n", int_line);
-
     e1000_setup_rx(e1000);
     e1000_setup_tx(e1000);
 
-    int err = irq_register_callback(int_line, e1000_interrupt, "E1000", IRQ_INTERRUPT, e1000, F(IRQF_SHARED));
-    if (err) {
-        kp(KP_WARNING, "e1000: Interrupt %d already taken and not shared!\n", PIC8259_IRQ0 + int_line);
-        return;
+    int vec = irq_register_msi_callback(dev, e1000_msi_interrupt, "E1000 MSI", e1000);
+    if (vec >= 0) {
+        kp(KP_NORMAL, "  Interrupt: MSI, vector %d\n", vec);
+    } else {
+        int int_line = pci_config_read_uint8(dev, PCI_REG_INTERRUPT_LINE);
+        kp(KP_NORMAL, "  Interrupt: %d\n", int_line);
+
+        int err = irq_register_callback(int_line, e1000_interrupt, "E1000", IRQ_INTERRUPT, e1000, F(IRQF_SHARED));
+        if (err) {
+            kp(KP_WARNING, "e1000: Interrupt %d already taken and not shared!\n", PIC8259_IRQ0 + int_line);
+            return;
+        }
     }
 
     e1000_command_write32(e1000, REG_IMS, IMS_RXT0
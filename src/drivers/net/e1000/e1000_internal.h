@@ -4,6 +4,7 @@
 #include <protura/compiler.h>
 #include <protura/drivers/pci.h>
 #include <protura/net.h>
+#include <protura/softirq.h>
 
 #define REG_CTRL     0x0000
 #define REG_STATUS   0x0008
@@ -186,6 +187,8 @@ struct net_interface_e1000 {
 
     uint8_t has_eeprom :1;
 
+    struct tasklet tasklet;
+
     spinlock_t rx_lock;
     struct e1000_rx_desc *rx_descs;
     int cur_rx; /* RDT = cur_rx - 1 */
@@ -4,6 +4,7 @@
 #include <protura/drivers/pci.h>
 #include <protura/net.h>
 #include <protura/spinlock.h>
+#include <protura/softirq.h>
 
 /* MAC Address */
 #define REG_MAC0  0x00
@@ -176,6 +177,8 @@ struct net_interface_rtl {
     struct page *tx_buffer[4];
     int tx_cur_buffer;
 
+    struct tasklet tasklet;
+
     struct pci_dev dev;
 };
 
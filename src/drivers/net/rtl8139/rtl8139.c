@@ -112,19 +112,26 @@ static void rtl_process_tx_queue(struct net_interface *iface)
     }
 }
 
+/* Checking the RX buffer and TX queue is cheap when there's nothing to do, so
+ * the tasklet always does both rather than tracking which interrupts came in */
+static void rtl_tasklet(struct tasklet *tasklet)
+{
+    struct net_interface_rtl *rtl = container_of(tasklet, struct net_interface_rtl, tasklet);
+
+    rtl_handle_rx(rtl);
+    rtl_process_tx_queue(&rtl->net);
+}
+
 static void rtl_rx_interrupt(struct irq_frame *frame, void *param)
 {
     struct net_interface_rtl *rtl = param;
     uint16_t isr = rtl_inw(rtl, REG_ISR);
 
-    if (isr & REG_ISR_ROK)
-        rtl_handle_rx(rtl);
-
-    if (isr & REG_ISR_TOK)
-        rtl_process_tx_queue(&rtl->net);
-
     /* ACK Interrupt */
     rtl_outw(rtl, REG_ISR, isr);
+
+    if (isr & (REG_ISR_ROK | REG_ISR_TOK))
+        tasklet_schedule(&rtl->tasklet);
 }
 
 void rtl_device_init_rx(struct net_interface_rtl *rtl)
@@ -156,6 +163,7 @@ void rtl_device_init(struct pci_dev *dev)
     int int_line;
 
     net_interface_init(&rtl->net);
+    tasklet_init(&rtl->tasklet, rtl_tasklet);
 
     rtl->net.process_tx_queue = rtl_process_tx_queue;
     rtl->net.linklayer_tx = arp_tx;
@@ -34,6 +34,7 @@
 #include <protura/fs/vfs.h>
 #include <protura/fs/binfmt.h>
 #include <protura/fs/elf.h>
+#include <protura/uinfo.h>
 
 static int elf_max_log_level = CONFIG_ELF_LOG_LEVEL;
 KPARAM("elf.loglevel", &elf_max_log_level, KPARAM_LOGLEVEL);
@@ -239,6 +240,8 @@ static int load_bin_elf(struct exe_params *params, struct irq_frame *frame)
 
     current = cpu_get_local()->current;
 
+    uinfo_map(new_addrspc, current);
+
     address_space_change(new_addrspc);
 
     irq_frame_initalize(current->context.frame);
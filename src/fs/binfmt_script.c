@@ -62,7 +62,7 @@ static int load_script(struct exe_params *params, struct irq_frame *frame)
 
     kp(KP_TRACE, "Script interpreter: %s\n", exe);
 
-    ret = namex(exe, current->cwd, &script_ino);
+    ret = namex(exe, current->fs->cwd, &script_ino);
     if (ret)
         return -ENOEXEC;
 
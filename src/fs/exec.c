@@ -123,6 +123,16 @@ static int execve(struct inode *inode, const char *file, struct user_buffer argv
     if (ret)
         return ret;
 
+    /* The new program gets its own signal handlers and file table, even if
+     * we were sharing them with other tasks */
+    ret = task_sighand_unshare(current);
+    if (ret)
+        goto close_fd;
+
+    ret = task_files_unshare(current);
+    if (ret)
+        goto close_fd;
+
     params.exe = filp;
     ret = binary_load(&params, frame);
 
@@ -134,6 +144,10 @@ static int execve(struct inode *inode, const char *file, struct user_buffer argv
     /* At this point, the pointers we were passed are now completely invalid
      * (besides frame and inode, which reside in the kernel). */
 
+    /* A clone()'d stack belongs to the address_space we just dropped, which
+     * frees it along with the rest of its vm_maps. It isn't in our new one. */
+    current->user_stack = NULL;
+
     user_stack_end = cpu_get_local()->current->addrspc->stack->addr.end;
     sp = params_copy_to_userspace(&params, user_stack_end);
 
@@ -141,15 +155,15 @@ static int execve(struct inode *inode, const char *file, struct user_buffer argv
 
     int i;
     for (i = 0; i < NSIG; i++) {
-        if (current->sig_actions[i].sa_handler != SIG_IGN)
-            current->sig_actions[i].sa_handler = SIG_DFL;
+        if (current->sighand->actions[i].sa_handler != SIG_IGN)
+            current->sighand->actions[i].sa_handler = SIG_DFL;
 
-        current->sig_actions[i].sa_mask = 0;
-        current->sig_actions[i].sa_flags = 0;
+        current->sighand->actions[i].sa_mask = 0;
+        current->sighand->actions[i].sa_flags = 0;
     }
 
     for (i = 0; i < NOFILE; i++) {
-        if (FD_ISSET(i, &current->close_on_exec)) {
+        if (FD_ISSET(i, &current->files->close_on_exec)) {
             kp(KP_TRACE, "Close-on-exec: %d\n", i);
             sys_close(i);
         }
@@ -178,7 +192,7 @@ int sys_execve(struct user_buffer file_buf, struct user_buffer argv_buf, struct
 
     kp(KP_TRACE, "Executing: %s\n", tmp_file);
 
-    ret = namex(tmp_file, current->cwd, &exe);
+    ret = namex(tmp_file, current->fs->cwd, &exe);
     if (ret) {
         irq_frame_set_syscall_ret(frame, ret);
         return ret;
@@ -21,6 +21,7 @@
 
 #include <arch/spinlock.h>
 #include <protura/block/bcache.h>
+#include <protura/block/bdev.h>
 #include <protura/fs/char.h>
 #include <protura/fs/stat.h>
 #include <protura/fs/file.h>
@@ -62,6 +63,32 @@ static uint8_t ext2_dir_type(mode_t mode)
     return ext2_dt_to_dir_type[MODE_TO_DT(mode)];
 }
 
+/* Directory scans go through every block, so we submit all of them as one
+ * batch up front and wait for the whole thing, rather than reading and
+ * waiting on one block at a time. Blocks already in the cache are skipped. */
+static void __ext2_dir_read_blocks(struct inode *dir)
+{
+    struct ext2_super_block *sb = container_of(dir->sb, struct ext2_super_block, sb);
+    struct block_batch batch = BLOCK_BATCH_INIT(batch, NULL);
+    struct block_plug plug;
+    int block_size = sb->block_size;
+    off_t cur_off;
+
+    block_plug_start(&plug);
+
+    for (cur_off = 0; cur_off < dir->size; cur_off += block_size) {
+        sector_t sec = vfs_bmap(dir, cur_off / block_size);
+
+        if (sec == SECTOR_INVALID)
+            break;
+
+        block_batch_read(&batch, dir->sb->bdev, sec);
+    }
+
+    block_plug_finish(&plug);
+    block_batch_wait(&batch);
+}
+
 /* Finds the entry coresponding to 'name', and returns the on-disk entry in
  * '*result'. The block that *result resides in is returned by the function.
  * This block should be passed to block_unlockput() when you're done messing with
@@ -73,6 +100,8 @@ __must_check struct block *__ext2_lookup_entry(struct inode *dir, const char *na
     int block_size = sb->block_size;
     off_t cur_off;
 
+    __ext2_dir_read_blocks(dir);
+
     for (cur_off = 0; cur_off < dir->size; cur_off += block_size) {
         int offset = 0;
         struct ext2_disk_directory_entry *entry;
@@ -113,6 +142,8 @@ __must_check struct block *__ext2_add_entry(struct inode *dir, const char *name,
 
     kp_ext2_trace(dir->sb, "add entry: %s\n", name);
 
+    __ext2_dir_read_blocks(dir);
+
     for (cur_off = 0; cur_off < dir->size; cur_off += block_size) {
         int offset = 0;
 
@@ -302,6 +333,8 @@ int __ext2_dir_empty(struct inode *dir)
 
     blocks = ALIGN_2(dir->size, block_size) / block_size;
 
+    __ext2_dir_read_blocks(dir);
+
     for (cur_block = 0; cur_block < blocks && !ret; cur_block++) {
         sector_t sec;
         struct block *b;
@@ -401,6 +434,9 @@ int __ext2_dir_readdir(struct file *filp, struct file_readdir_handler *handler)
     int ret = 0;
     int offset = 0;
 
+    if (filp->offset == 0)
+        __ext2_dir_read_blocks(dir);
+
     for (; filp->offset < dir->size && !ret; filp->offset += offset) {
         sector_t sec = vfs_bmap(dir, filp->offset / block_size);
 
@@ -439,6 +475,10 @@ int __ext2_dir_read_dent(struct file *filp, struct user_buffer dent, size_t size
     if (filp->offset == dir->size)
         return 0;
 
+    /* Starting a new listing, get the whole directory on its way */
+    if (filp->offset == 0)
+        __ext2_dir_read_blocks(dir);
+
     sector_t sec = vfs_bmap(dir, filp->offset / block_size);
     int block_off = filp->offset % block_size;
 
@@ -18,12 +18,58 @@
 #include <protura/mm/user_check.h>
 
 #include <protura/block/bcache.h>
+#include <protura/block/bdev.h>
 #include <protura/fs/super.h>
 #include <protura/fs/inode.h>
 #include <protura/fs/file.h>
 #include <protura/fs/ioctl.h>
 #include <protura/fs/vfs.h>
 
+#define FILE_READAHEAD_INITIAL 4
+
+/*
+ * Every block of the read that isn't cached yet is submitted up front along
+ * with the read-ahead window past it, before we wait on any of them. That way
+ * they all reach the elevator together and get merged into a few large
+ * requests, and the window is already on its way by the time the next
+ * sequential read comes in.
+ */
+static void fs_file_readahead(struct file *filp, struct block_device *bdev, sector_t first, sector_t last, off_t block_size)
+{
+    struct file_readahead *ra = &filp->readahead;
+    int max = READ_ONCE(bdev->readahead_max);
+    sector_t file_blocks = (filp->inode->size + block_size - 1) / block_size;
+    struct block_plug plug;
+    sector_t sec, end;
+
+    if (max && first == ra->next) {
+        ra->window = ra->window? ra->window * 2: FILE_READAHEAD_INITIAL;
+        if (ra->window > max)
+            ra->window = max;
+    } else {
+        ra->window = 0;
+        ra->end = 0;
+    }
+
+    end = last + 1 + ra->window;
+    if (end > file_blocks)
+        end = file_blocks;
+
+    block_plug_start(&plug);
+
+    for (sec = (ra->end > first)? ra->end: first; sec < end; sec++) {
+        sector_t on_dev = vfs_bmap(filp->inode, sec);
+
+        if (on_dev != SECTOR_INVALID)
+            block_readahead(bdev, on_dev);
+    }
+
+    block_plug_finish(&plug);
+
+    if (end > ra->end)
+        ra->end = end;
+}
+
 /* Generic read implemented using bmap */
 int fs_file_generic_pread(struct file *filp, struct user_buffer buf, size_t sizet_len, off_t off)
 {
@@ -53,6 +99,9 @@ int fs_file_generic_pread(struct file *filp, struct user_buffer buf, size_t size
     off_t sec_off = off - sec * block_size;
 
     using_inode_lock_read(filp->inode) {
+        if (len > 0)
+            fs_file_readahead(filp, bdev, sec, (off + len - 1) / block_size, block_size);
+
         while (have_read < len) {
             struct block *b;
             sector_t on_dev = vfs_bmap(filp->inode, sec);
@@ -83,6 +132,8 @@ int fs_file_generic_pread(struct file *filp, struct user_buffer buf, size_t size
             sec_off = 0;
             sec++;
         }
+
+        filp->readahead.next = (off + have_read) / block_size;
     }
 
     filp->inode->atime = protura_current_time_get();
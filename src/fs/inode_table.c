@@ -31,7 +31,8 @@
  *
  * inode->flags_lock nests inside of this lock
  */
-static spinlock_t inode_hashes_lock;
+DEFINE_LOCK_CLASS(inode_hashes_lock_class, "inode_hashes_lock");
+static spinlock_t inode_hashes_lock = SPINLOCK_INIT_CLASS(inode_hashes_lock_class);
 static hlist_head_t inode_hashes[INODE_HASH_SIZE];
 
 /* This queue is used when an inode is in INO_FREEING.
@@ -213,23 +213,28 @@ static int pipe_read(struct file *filp, struct user_buffer data, size_t size)
                 /* If we freed a page by reading data, then wake-up any writers
                  * that may have been waiting. */
                 if (wake_writers)
-                    wait_queue_wake(&pinfo->write_queue);
+                    wait_queue_wake_one(&pinfo->write_queue);
 
                 wake_writers = 0;
 
-                /* Sleep until more data */
-                ret = wait_queue_event_intr_mutex(&pinfo->read_queue, !list_empty(&pinfo->bufs), &pinfo->pipe_buf_lock);
+                /* Sleep until more data. Only one reader is woken per
+                 * write, that reader passes the wake-up along below if it
+                 * leaves data behind. */
+                ret = wait_queue_event_intr_mutex_exclusive(&pinfo->read_queue, !list_empty(&pinfo->bufs) || pinfo->writers == 0, &pinfo->pipe_buf_lock);
                 if (ret)
                     return ret;
             }
         }
 
-        /* If the buffer isn't empty, then wake next reader */
-        if (!list_empty(&pinfo->bufs) || pinfo->writers == 0)
+        /* If the buffer isn't empty, then wake next reader. If there are no
+         * writers left then every reader needs to see the EOF */
+        if (pinfo->writers == 0)
             wait_queue_wake(&pinfo->read_queue);
+        else if (!list_empty(&pinfo->bufs))
+            wait_queue_wake_one(&pinfo->read_queue);
 
         if (wake_writers)
-            wait_queue_wake(&pinfo->write_queue);
+            wait_queue_wake_one(&pinfo->write_queue);
     }
 
     if (!ret)
@@ -306,21 +311,23 @@ static int pipe_write(struct file *filp, struct user_buffer data, size_t size)
              * ourselves and exit with -EPIPE */
             if (size) {
                 if (wake_readers)
-                    wait_queue_wake(&pinfo->read_queue);
+                    wait_queue_wake_one(&pinfo->read_queue);
 
                 wake_readers = 0;
 
-                ret = wait_queue_event_intr_mutex(&pinfo->write_queue, !list_empty(&pinfo->free_pages), &pinfo->pipe_buf_lock);
+                ret = wait_queue_event_intr_mutex_exclusive(&pinfo->write_queue, !list_empty(&pinfo->free_pages) || pinfo->readers == 0, &pinfo->pipe_buf_lock);
                 if (ret)
                     return ret;
             }
         }
 
-        if (!list_empty(&pinfo->free_pages) || pinfo->readers == 0)
+        if (pinfo->readers == 0)
             wait_queue_wake(&pinfo->write_queue);
+        else if (!list_empty(&pinfo->free_pages))
+            wait_queue_wake_one(&pinfo->write_queue);
 
         if (wake_readers)
-            wait_queue_wake(&pinfo->read_queue);
+            wait_queue_wake_one(&pinfo->read_queue);
     }
 
     if (!ret)
@@ -512,8 +519,8 @@ int sys_pipe(struct user_buffer fds)
         goto release_fd_0;
     }
 
-    FD_CLR(fd_local[P_READ], &current->close_on_exec);
-    FD_CLR(fd_local[P_WRITE], &current->close_on_exec);
+    FD_CLR(fd_local[P_READ], &current->files->close_on_exec);
+    FD_CLR(fd_local[P_WRITE], &current->files->close_on_exec);
 
     ret = user_memcpy_from_kernel(fds, fd_local, sizeof(fd_local));
     if (ret)
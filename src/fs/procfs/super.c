@@ -24,6 +24,11 @@
 #include <protura/drivers/pci.h>
 #include <protura/block/disk.h>
 #include <protura/event/device.h>
+#include <protura/work.h>
+#include <protura/lockstat.h>
+#include <protura/softirq.h>
+#include <protura/kstat.h>
+#include <protura/initcall.h>
 
 #include <arch/spinlock.h>
 #include <protura/block/bcache.h>
@@ -128,14 +133,23 @@ static void procfs_init(void)
     procfs_hash_add_node(&procfs_root.node);
 
     procfs_register_entry(&procfs_root, "interrupts", &interrupts_file_ops);
+    procfs_register_entry(&procfs_root, "softirqs", &softirq_file_ops);
+    procfs_register_entry(&procfs_root, "stat", &kstat_file_ops);
     procfs_register_entry(&procfs_root, "tasks", &task_file_ops);
+    procfs_register_entry(&procfs_root, "task_usage", &task_usage_file_ops);
     procfs_register_entry(&procfs_root, "filesystems", &file_system_file_ops);
     procfs_register_entry(&procfs_root, "mounts", &mount_file_ops);
     procfs_register_entry(&procfs_root, "binfmts", &binfmt_file_ops);
     procfs_register_entry(&procfs_root, "klog", &klog_file_ops);
     procfs_register_entry(&procfs_root, "pci_devices", &pci_file_ops);
     procfs_register_entry(&procfs_root, "disks", &disk_file_ops);
+    procfs_register_entry(&procfs_root, "elevator", &disk_elevator_file_ops);
     procfs_register_entry(&procfs_root, "devices", &device_event_file_ops);
+    procfs_register_entry(&procfs_root, "workqueues", &workqueue_file_ops);
+    procfs_register_entry(&procfs_root, "boot_timing", &boot_timing_file_ops);
+#ifdef CONFIG_LOCKSTAT
+    procfs_register_entry(&procfs_root, "lockstat", &lockstat_file_ops);
+#endif
 
     procfs_register_entry_ops(&procfs_root, "uptime", &uptime_ops);
     procfs_register_entry_ops(&procfs_root, "boottime", &boot_time_ops);
@@ -76,7 +76,7 @@ int sys_open(struct user_buffer path, int flags, mode_t mode)
     struct task *current = cpu_get_local()->current;
     struct nameidata name;
 
-    mode = (mode & 0777) & ~current->umask;
+    mode = (mode & 0777) & ~current->fs->umask;
 
     __cleanup_user_string char *tmp_path = NULL;
     ret = user_alloc_string(path, &tmp_path);
@@ -104,7 +104,7 @@ int sys_open(struct user_buffer path, int flags, mode_t mode)
 
     memset(&name, 0, sizeof(name));
     name.path = tmp_path;
-    name.cwd = current->cwd;
+    name.cwd = current->fs->cwd;
 
     ret = namei_full(&name, F(NAMEI_GET_INODE) | F(NAMEI_GET_PARENT) | F(NAMEI_ALLOW_TRAILING_SLASH));
 
@@ -129,7 +129,7 @@ int sys_open(struct user_buffer path, int flags, mode_t mode)
         goto cleanup_namei;
 
     if (flags & O_CLOEXEC)
-        FD_SET(ret, &current->close_on_exec);
+        FD_SET(ret, &current->files->close_on_exec);
 
     if (flags & O_TRUNC)
         vfs_truncate(filp->inode, 0);
@@ -172,7 +172,11 @@ int sys_read(int fd, struct user_buffer buf, size_t len)
     if (ret)
         return ret;
 
-    return vfs_read(filp, buf, len);
+    ret = vfs_read(filp, buf, len);
+    if (ret > 0)
+        task_rusage_io(cpu_get_local()->current, ret, 0);
+
+    return ret;
 }
 
 int sys_read_dent(int fd, struct user_buffer dent, size_t size)
@@ -206,7 +210,11 @@ int sys_write(int fd, struct user_buffer buf, size_t len)
     if (ret)
         return ret;
 
-    return vfs_write(filp, buf, len);
+    ret = vfs_write(filp, buf, len);
+    if (ret > 0)
+        task_rusage_io(cpu_get_local()->current, 0, ret);
+
+    return ret;
 }
 
 off_t sys_lseek(int fd, off_t off, int whence)
@@ -233,7 +241,7 @@ int sys_truncate(struct user_buffer path, off_t length)
     if (ret)
         return ret;
 
-    ret = namex(tmp_path, current->cwd, &i);
+    ret = namex(tmp_path, current->fs->cwd, &i);
     if (ret)
         return ret;
 
@@ -263,7 +271,7 @@ int sys_mkdir(struct user_buffer name, mode_t mode)
     struct nameidata dirname;
     int ret;
 
-    mode = (mode & 0777) & ~current->umask;
+    mode = (mode & 0777) & ~current->fs->umask;
 
     __cleanup_user_string char *tmp_path = NULL;
     ret = user_alloc_string(name, &tmp_path);
@@ -272,7 +280,7 @@ int sys_mkdir(struct user_buffer name, mode_t mode)
 
     memset(&dirname, 0, sizeof(dirname));
     dirname.path = tmp_path;
-    dirname.cwd = current->cwd;
+    dirname.cwd = current->fs->cwd;
 
     ret = namei_full(&dirname, F(NAMEI_GET_INODE) | F(NAMEI_GET_PARENT) | F(NAMEI_ALLOW_TRAILING_SLASH));
     if (!dirname.parent)
@@ -314,7 +322,7 @@ int sys_rmdir(struct user_buffer name)
     memset(&dirname, 0, sizeof(dirname));
 
     dirname.path = tmp_path;
-    dirname.cwd = current->cwd;
+    dirname.cwd = current->fs->cwd;
 
     ret = namei_full(&dirname, F(NAMEI_GET_INODE) | F(NAMEI_GET_PARENT) | F(NAMEI_ALLOW_TRAILING_SLASH));
     if (!dirname.parent)
@@ -360,7 +368,7 @@ int sys_link(struct user_buffer old, struct user_buffer new)
 
     memset(&oldname, 0, sizeof(oldname));
     oldname.path = tmp_old_path;
-    oldname.cwd = current->cwd;
+    oldname.cwd = current->fs->cwd;
 
     ret = namei_full(&oldname, F(NAMEI_GET_INODE) | F(NAMEI_ALLOW_TRAILING_SLASH));
     if (!oldname.found)
@@ -369,7 +377,7 @@ int sys_link(struct user_buffer old, struct user_buffer new)
     memset(&newname, 0, sizeof(newname));
 
     newname.path = tmp_new_path;
-    newname.cwd = current->cwd;
+    newname.cwd = current->fs->cwd;
 
     ret = namei_full(&newname, F(NAMEI_GET_INODE) | F(NAMEI_GET_PARENT) | F(NAMEI_ALLOW_TRAILING_SLASH));
     if (!newname.parent)
@@ -416,7 +424,7 @@ int sys_mknod(struct user_buffer node, mode_t mode, dev_t dev)
     if (format != S_IFREG && format != S_IFCHR && format != S_IFBLK && format != S_IFIFO)
         return -EINVAL;
 
-    mode = (mode & 0777) & ~current->umask;
+    mode = (mode & 0777) & ~current->fs->umask;
     mode |= format;
 
     __cleanup_user_string char *tmp_file = NULL;
@@ -426,7 +434,7 @@ int sys_mknod(struct user_buffer node, mode_t mode, dev_t dev)
 
     memset(&name, 0, sizeof(name));
     name.path = tmp_file;
-    name.cwd = current->cwd;
+    name.cwd = current->fs->cwd;
 
     ret = namei_full(&name, F(NAMEI_GET_INODE) | F(NAMEI_GET_PARENT));
     if (!name.parent)
@@ -467,7 +475,7 @@ int sys_unlink(struct user_buffer file)
 
     memset(&name, 0, sizeof(name));
     name.path = tmp_file;
-    name.cwd = current->cwd;
+    name.cwd = current->fs->cwd;
 
     ret = namei_full(&name, F(NAMEI_GET_INODE) | F(NAMEI_GET_PARENT));
     if (!name.parent)
@@ -506,7 +514,7 @@ int sys_rename(struct user_buffer old, struct user_buffer new)
 
     memset(&old_name, 0, sizeof(old_name));
     old_name.path = tmp_old_path;
-    old_name.cwd = current->cwd;
+    old_name.cwd = current->fs->cwd;
 
     ret = namei_full(&old_name, F(NAMEI_GET_PARENT));
     if (!old_name.parent)
@@ -519,7 +527,7 @@ int sys_rename(struct user_buffer old, struct user_buffer new)
 
     memset(&new_name, 0, sizeof(new_name));
     new_name.path = tmp_new_path;
-    new_name.cwd = current->cwd;
+    new_name.cwd = current->fs->cwd;
 
     ret = namei_full(&new_name, F(NAMEI_GET_PARENT));
     if (!new_name.parent)
@@ -569,7 +577,7 @@ int sys_access(struct user_buffer path_buf, int mode)
 
     memset(&name, 0, sizeof(name));
     name.path = tmp_path;
-    name.cwd = current->cwd;
+    name.cwd = current->fs->cwd;
 
     ret = namei_full(&name, F(NAMEI_GET_INODE) | F(NAMEI_ALLOW_TRAILING_SLASH));
     if (!name.found)
@@ -613,7 +621,7 @@ int sys_stat(struct user_buffer path_buf, struct user_buffer stat_buf)
 
     memset(&name, 0, sizeof(name));
     name.path = tmp_path;
-    name.cwd = current->cwd;
+    name.cwd = current->fs->cwd;
 
     ret = namei_full(&name, F(NAMEI_GET_INODE) | F(NAMEI_ALLOW_TRAILING_SLASH));
     if (!name.found)
@@ -666,7 +674,7 @@ int sys_lstat(struct user_buffer path_buf, struct user_buffer stat_buf)
 
     memset(&name, 0, sizeof(name));
     name.path = tmp_path;
-    name.cwd = current->cwd;
+    name.cwd = current->fs->cwd;
 
     ret = namei_full(&name, F(NAMEI_GET_INODE) | F(NAMEI_ALLOW_TRAILING_SLASH) | F(NAMEI_DONT_FOLLOW_LINK));
     if (!name.found)
@@ -695,7 +703,7 @@ int sys_readlink(struct user_buffer path_buf, struct user_buffer buf, size_t buf
 
     memset(&name, 0, sizeof(name));
     name.path = tmp_path;
-    name.cwd = current->cwd;
+    name.cwd = current->fs->cwd;
 
     ret = namei_full(&name, F(NAMEI_GET_INODE) | F(NAMEI_DONT_FOLLOW_LINK));
     if (!name.found)
@@ -726,7 +734,7 @@ int sys_symlink(struct user_buffer target_buf, struct user_buffer link_buf)
 
     memset(&name, 0, sizeof(name));
     name.path = tmp_link;
-    name.cwd = current->cwd;
+    name.cwd = current->fs->cwd;
 
     ret = namei_full(&name, F(NAMEI_GET_INODE) | F(NAMEI_GET_PARENT));
     if (!name.parent)
@@ -778,7 +786,7 @@ int sys_mount(struct user_buffer source_buf, struct user_buffer target_buf, stru
             return ret;
 
         source_name.path = tmp_source;
-        source_name.cwd = current->cwd;
+        source_name.cwd = current->fs->cwd;
 
         ret = namei_full(&source_name, F(NAMEI_GET_INODE));
         if (!source_name.found) {
@@ -795,7 +803,7 @@ int sys_mount(struct user_buffer source_buf, struct user_buffer target_buf, stru
 
     memset(&target_name, 0, sizeof(target_name));
     target_name.path = tmp_target;
-    target_name.cwd = current->cwd;
+    target_name.cwd = current->fs->cwd;
 
     ret = namei_full(&target_name, F(NAMEI_GET_INODE));
     if (!target_name.found)
@@ -839,7 +847,7 @@ int sys_umount(struct user_buffer target_buf)
 
     memset(&target_name, 0, sizeof(target_name));
     target_name.path = tmp_target;
-    target_name.cwd = current->cwd;
+    target_name.cwd = current->fs->cwd;
 
     ret = namei_full(&target_name, F(NAMEI_GET_INODE));
     if (!target_name.found)
@@ -885,13 +893,13 @@ int sys_fcntl(int fd, int cmd, uintptr_t arg)
         return sys_dup(fd);
 
     case F_GETFD:
-        return FD_ISSET(fd,&current->close_on_exec);
+        return FD_ISSET(fd,&current->files->close_on_exec);
 
     case F_SETFD:
         if (arg & 1)
-            FD_SET(fd, &current->close_on_exec);
+            FD_SET(fd, &current->files->close_on_exec);
         else
-            FD_CLR(fd, &current->close_on_exec);
+            FD_CLR(fd, &current->files->close_on_exec);
         return 0;
 
     case F_GETFL:
@@ -943,11 +951,11 @@ int sys_ioctl(int fd, int cmd, struct user_buffer arg)
 
     switch (cmd) {
     case FIOCLEX:
-        FD_SET(fd, &current->close_on_exec);
+        FD_SET(fd, &current->files->close_on_exec);
         return 0;
 
     case FIONCLEX:
-        FD_CLR(fd, &current->close_on_exec);
+        FD_CLR(fd, &current->files->close_on_exec);
         return 0;
     }
 
@@ -969,7 +977,7 @@ static int sys_chown_global(struct user_buffer path_buf, uid_t uid, gid_t gid, f
 
     memset(&path_name, 0, sizeof(path_name));
     path_name.path = tmp_path;
-    path_name.cwd = current->cwd;
+    path_name.cwd = current->fs->cwd;
 
     ret = namei_full(&path_name, F(NAMEI_GET_INODE) | namei_flags);
     if (!path_name.found)
@@ -1019,7 +1027,7 @@ int sys_chmod(struct user_buffer path_buf, mode_t mode)
 
     memset(&path_name, 0, sizeof(path_name));
     path_name.path = tmp_path;
-    path_name.cwd = current->cwd;
+    path_name.cwd = current->fs->cwd;
 
     ret = namei_full(&path_name, F(NAMEI_GET_INODE));
     if (!path_name.found)
@@ -1050,9 +1058,9 @@ int sys_fchmod(int fd, mode_t mode)
 mode_t sys_umask(mode_t mode)
 {
     struct task *current = cpu_get_local()->current;
-    mode_t old = current->umask;
+    mode_t old = current->fs->umask;
 
-    current->umask = mode & 0777;
+    current->fs->umask = mode & 0777;
 
     return old;
 }
@@ -1069,7 +1077,7 @@ int sys_utimes(struct user_buffer path_buf, struct user_buffer timeval_buf)
 
     memset(&path_name, 0, sizeof(path_name));
     path_name.path = tmp_path;
-    path_name.cwd = current->cwd;
+    path_name.cwd = current->fs->cwd;
 
     ret = namei_full(&path_name, F(NAMEI_GET_INODE));
     if (!path_name.found)
@@ -1114,7 +1122,7 @@ int sys_statvfs(struct user_buffer path_buf, struct user_buffer user_statvfs)
 
     memset(&path_name, 0, sizeof(path_name));
     path_name.path = tmp_path;
-    path_name.cwd = current->cwd;
+    path_name.cwd = current->fs->cwd;
 
     ret = namei_full(&path_name, F(NAMEI_GET_INODE));
     if (!path_name.found)
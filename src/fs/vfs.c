@@ -294,7 +294,7 @@ int vfs_chdir(const char *path)
     memset(&name, 0, sizeof(name));
 
     name.path = path;
-    name.cwd = current->cwd;
+    name.cwd = current->fs->cwd;
 
     ret = namei_full(&name, F(NAMEI_GET_INODE) | F(NAMEI_ALLOW_TRAILING_SLASH));
     if (!name.found)
@@ -305,8 +305,14 @@ int vfs_chdir(const char *path)
         return -ENOTDIR;
     }
 
-    inode_put(current->cwd);
-    current->cwd = name.found;
+    struct inode *old_cwd;
+
+    using_spinlock(&current->fs->lock) {
+        old_cwd = current->fs->cwd;
+        current->fs->cwd = name.found;
+    }
+
+    inode_put(old_cwd);
 
     return 0;
 }
@@ -42,10 +42,7 @@ KPARAM("reboot_on_panic", &reboot_on_panic, KPARAM_BOOL);
 
 static int start_user_init(void *unused)
 {
-    void (**ic) (void);
-
-    for (ic = initcalls; *ic; ic++)
-        (*ic) ();
+    initcalls_run();
 
     kp(KP_NORMAL, "Mounting root device %d:%d, fs type \"%s\"\n", root_major, root_minor, root_fstype);
 
@@ -58,6 +55,8 @@ static int start_user_init(void *unused)
     ktest_init();
 #endif
 
+    initcalls_boot_done();
+
     kp(KP_NORMAL, "Kernel is done booting!\n");
     kp(KP_NORMAL, "Starting \"%s\"...\n", init_prog);
 
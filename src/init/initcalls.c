@@ -2,6 +2,13 @@
 #include <protura/types.h>
 #include <protura/debug.h>
 #include <protura/initcall.h>
+#include <protura/kparam.h>
+#include <protura/mutex.h>
+#include <protura/wait.h>
+#include <protura/task.h>
+#include <protura/scheduler.h>
+#include <protura/fs/seq_file.h>
+#include <arch/timer.h>
 
 static void core_init(void)
 {
@@ -24,3 +31,197 @@ initcall(device, device_init);
 initcall_dependency(subsys, core);
 initcall_dependency(device, subsys);
 
+
+/*
+ * Initcalls are run by a small pool of kernel threads, the "Kernel init" task
+ * being one of them. A thread takes the first initcall whose dependencies
+ * have all finished, so the slow ones (Like probing the disks) don't hold up
+ * the ones that don't depend on them.
+ *
+ * `initcall.threads=1` runs them one at a time in order instead, in case some
+ * initcall is missing a dependency it needs.
+ */
+static int initcall_threads = 4;
+KPARAM("initcall.threads", &initcall_threads, KPARAM_INT);
+
+static mutex_t initcall_lock = MUTEX_INIT(initcall_lock);
+static struct wait_queue initcall_queue = WAIT_QUEUE_INIT(initcall_queue);
+static int initcalls_left;
+
+static uint64_t initcalls_start_ns, initcalls_end_ns, boot_done_ns;
+
+static void initcall_run(struct initcall *ic)
+{
+    ic->start_ns = timer_get_ns();
+    (ic->fn) ();
+    ic->end_ns = timer_get_ns();
+}
+
+/* Called with initcall_lock held */
+static struct initcall *initcall_next_ready(void)
+{
+    struct initcall *ic;
+
+    for (ic = initcalls; ic->fn; ic++)
+        if (!ic->started && !ic->deps_left)
+            return ic;
+
+    return NULL;
+}
+
+/* Called with initcall_lock held */
+static void initcall_finished(struct initcall *done)
+{
+    int done_idx = done - initcalls;
+    struct initcall *ic;
+    const int *dep;
+
+    for (ic = done + 1; ic->fn; ic++)
+        for (dep = ic->deps; *dep != -1; dep++)
+            if (*dep == done_idx)
+                ic->deps_left--;
+
+    initcalls_left--;
+    wait_queue_wake(&initcall_queue);
+}
+
+static int initcall_worker(void *unused)
+{
+    struct initcall *ic;
+
+    mutex_lock(&initcall_lock);
+
+    while (1) {
+        ic = NULL;
+
+        wait_queue_event_mutex(&initcall_queue, (ic = initcall_next_ready()) || !initcalls_left, &initcall_lock);
+
+        if (!ic)
+            break;
+
+        ic->started = 1;
+
+        mutex_unlock(&initcall_lock);
+        initcall_run(ic);
+        mutex_lock(&initcall_lock);
+
+        initcall_finished(ic);
+    }
+
+    mutex_unlock(&initcall_lock);
+    return 0;
+}
+
+void initcalls_run(void)
+{
+    struct initcall *ic;
+    const int *dep;
+    int i;
+
+    initcalls_start_ns = timer_get_ns();
+
+    if (initcall_threads <= 1) {
+        for (ic = initcalls; ic->fn; ic++)
+            initcall_run(ic);
+
+        initcalls_end_ns = timer_get_ns();
+        return;
+    }
+
+    for (ic = initcalls; ic->fn; ic++) {
+        for (dep = ic->deps; *dep != -1; dep++)
+            ic->deps_left++;
+
+        initcalls_left++;
+    }
+
+    for (i = 1; i < initcall_threads; i++) {
+        struct task *t = task_kernel_new("initcall", initcall_worker, NULL);
+        if (!t) {
+            kp(KP_WARNING, "init: Unable to create initcall thread %d\n", i);
+            break;
+        }
+
+        scheduler_task_add(t);
+    }
+
+    /* We return once every initcall has finished, not just started */
+    initcall_worker(NULL);
+
+    initcalls_end_ns = timer_get_ns();
+}
+
+void initcalls_boot_done(void)
+{
+    boot_done_ns = timer_get_ns();
+}
+
+static int initcalls_count(void)
+{
+    struct initcall *ic;
+
+    for (ic = initcalls; ic->fn; ic++)
+        ;
+
+    return ic - initcalls;
+}
+
+/* Offset zero is the header, the initcalls come after it, and the totals are last */
+static int boot_timing_seq_start(struct seq_file *seq)
+{
+    if (seq->iter_offset == initcalls_count() + 2)
+        flag_set(&seq->flags, SEQ_FILE_DONE);
+
+    return 0;
+}
+
+static int boot_timing_seq_render(struct seq_file *seq)
+{
+    int count = initcalls_count();
+
+    if (seq->iter_offset == 0)
+        return seq_printf(seq, "initcall\tstart_us\tduration_us\n");
+
+    if (seq->iter_offset == count + 1)
+        return seq_printf(seq, "initcalls_us\t%llu\nboot_to_init_us\t%llu\n",
+                (initcalls_end_ns - initcalls_start_ns) / 1000,
+                boot_done_ns / 1000);
+
+    struct initcall *ic = initcalls + seq->iter_offset - 1;
+
+    return seq_printf(seq, "%s\t%llu\t%llu\n", ic->name, ic->start_ns / 1000, (ic->end_ns - ic->start_ns) / 1000);
+}
+
+static int boot_timing_seq_next(struct seq_file *seq)
+{
+    seq->iter_offset++;
+
+    if (seq->iter_offset == initcalls_count() + 2)
+        flag_set(&seq->flags, SEQ_FILE_DONE);
+
+    return 0;
+}
+
+static void boot_timing_seq_end(struct seq_file *seq)
+{
+
+}
+
+const static struct seq_file_ops boot_timing_seq_file_ops = {
+    .start = boot_timing_seq_start,
+    .next = boot_timing_seq_next,
+    .render = boot_timing_seq_render,
+    .end = boot_timing_seq_end,
+};
+
+static int boot_timing_file_seq_open(struct inode *inode, struct file *filp)
+{
+    return seq_open(filp, &boot_timing_seq_file_ops);
+}
+
+const struct file_ops boot_timing_file_ops = {
+    .open = boot_timing_file_seq_open,
+    .lseek = seq_lseek,
+    .read = seq_read,
+    .release = seq_release,
+};
@@ -0,0 +1,530 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/string.h>
+#include <protura/initcall.h>
+#include <protura/mutex.h>
+#include <protura/symbols.h>
+#include <protura/backtrace.h>
+#include <protura/task.h>
+#include <protura/kprof.h>
+#include <protura/mm/palloc.h>
+#include <protura/mm/kmalloc.h>
+#include <protura/mm/user_check.h>
+#include <protura/fs/seq_file.h>
+#include <protura/fs/procfs.h>
+#include <arch/cpu.h>
+#include <arch/irq.h>
+
+/*
+ * Sampling kernel profiler
+ *
+ * While running, the timer interrupt calls kprof_sample() KPROF_SAMPLE_HZ
+ * times a second with the interrupted instruction pointer. Each sample, along
+ * with an optional backtrace, goes into the ring buffer for the current CPU.
+ * When the ring is full the oldest samples are overwritten, so the buffers
+ * always hold the most recent samples.
+ *
+ * The samples are only turned into symbols when /proc/kprof/flat or
+ * /proc/kprof/folded is opened. While that happens sampling on that CPU is
+ * paused, so the ring doesn't change under us.
+ *
+ * The ring buffers are only ever written from the timer interrupt, everything
+ * else touches them with interrupts disabled or while the CPU is paused.
+ */
+
+#define KPROF_BUFFER_ORDER CONFIG_KPROF_BUFFER_ORDER
+
+/* Protura only runs on one CPU at the moment */
+#define KPROF_CPUS 1
+
+struct kprof_sample {
+    uint16_t depth;
+    uint16_t user;
+
+    /* addrs[0] is the interrupted address, the return addresses follow it */
+    uintptr_t addrs[KPROF_MAX_DEPTH + 1];
+};
+
+struct kprof_cpu {
+    struct kprof_sample *samples;
+    int capacity;
+
+    /* The next sample is written at `head`, the oldest is `count` before it */
+    int head;
+    int count;
+    uint32_t overwritten;
+
+    int paused;
+};
+
+int kprof_running;
+static int kprof_depth;
+
+static mutex_t kprof_lock = MUTEX_INIT(kprof_lock);
+static struct kprof_cpu kprof_cpus[KPROF_CPUS];
+
+void __kprof_sample(uintptr_t pc, void *frame_ptr, int user)
+{
+    struct kprof_cpu *cpu = kprof_cpus + cpu_get_local()->cpu_id;
+    struct kprof_sample *sample;
+
+    if (cpu->paused || !cpu->samples)
+        return;
+
+    sample = cpu->samples + cpu->head;
+
+    sample->addrs[0] = pc;
+    sample->user = user;
+
+    if (!user && kprof_depth)
+        sample->depth = backtrace_collect(frame_ptr, sample->addrs + 1, kprof_depth);
+    else
+        sample->depth = 0;
+
+    cpu->head = (cpu->head + 1) % cpu->capacity;
+
+    if (cpu->count < cpu->capacity)
+        cpu->count++;
+    else
+        cpu->overwritten++;
+}
+
+static void kprof_cpu_pause(struct kprof_cpu *cpu, int paused)
+{
+    irq_flags_t flags = irq_save();
+    irq_disable();
+
+    cpu->paused = paused;
+
+    irq_restore(flags);
+}
+
+static void kprof_cpu_reset(struct kprof_cpu *cpu)
+{
+    irq_flags_t flags = irq_save();
+    irq_disable();
+
+    cpu->head = 0;
+    cpu->count = 0;
+    cpu->overwritten = 0;
+
+    irq_restore(flags);
+}
+
+/* kprof_lock must be held */
+static int kprof_start(int depth)
+{
+    int i;
+
+    if (depth < 0 || depth > KPROF_MAX_DEPTH)
+        return -EINVAL;
+
+    for (i = 0; i < KPROF_CPUS; i++) {
+        struct kprof_cpu *cpu = kprof_cpus + i;
+
+        if (cpu->samples)
+            continue;
+
+        /* The buffers stick around once allocated, the profiler is generally
+         * going to be started again */
+        struct kprof_sample *samples = palloc_va(KPROF_BUFFER_ORDER, PAL_KERNEL);
+        if (!samples)
+            return -ENOMEM;
+
+        irq_flags_t flags = irq_save();
+        irq_disable();
+
+        cpu->samples = samples;
+        cpu->capacity = (PG_SIZE << KPROF_BUFFER_ORDER) / sizeof(*samples);
+        cpu->head = 0;
+        cpu->count = 0;
+        cpu->overwritten = 0;
+
+        irq_restore(flags);
+    }
+
+    kprof_depth = depth;
+    kprof_running = 1;
+
+    return 0;
+}
+
+static void kprof_status_get(struct kprof_status *status)
+{
+    int i;
+
+    memset(status, 0, sizeof(*status));
+
+    status->running = kprof_running;
+    status->depth = kprof_depth;
+    status->sample_hz = KPROF_SAMPLE_HZ;
+
+    for (i = 0; i < KPROF_CPUS; i++) {
+        irq_flags_t flags = irq_save();
+        irq_disable();
+
+        status->samples += kprof_cpus[i].count;
+        status->overwritten += kprof_cpus[i].overwritten;
+
+        irq_restore(flags);
+    }
+}
+
+static int kprof_ioctl(struct file *filp, int cmd, struct user_buffer ptr)
+{
+    struct task *current = cpu_get_local()->current;
+    struct kprof_status status;
+    int depth, ret, i;
+
+    if (cmd != KPROFIO_STATUS && current->creds.euid != 0)
+        return -EPERM;
+
+    switch (cmd) {
+    case KPROFIO_START:
+        ret = user_copy_to_kernel(&depth, ptr);
+        if (ret)
+            return ret;
+
+        using_mutex(&kprof_lock)
+            ret = kprof_start(depth);
+
+        return ret;
+
+    case KPROFIO_STOP:
+        using_mutex(&kprof_lock)
+            kprof_running = 0;
+
+        return 0;
+
+    case KPROFIO_RESET:
+        using_mutex(&kprof_lock)
+            for (i = 0; i < KPROF_CPUS; i++)
+                kprof_cpu_reset(kprof_cpus + i);
+
+        return 0;
+
+    case KPROFIO_STATUS:
+        using_mutex(&kprof_lock)
+            kprof_status_get(&status);
+
+        return user_copy_from_kernel(ptr, status);
+    }
+
+    return -EINVAL;
+}
+
+/*
+ * The samples are aggregated into unique entries when the file is first read.
+ * For the flat profile the entries are keyed on just the symbol of the
+ * interrupted address, for the folded profile they're keyed on the whole
+ * backtrace.
+ */
+struct kprof_entry {
+    uint32_t count;
+    uint16_t depth;
+    uint16_t user;
+
+    /* NULL if the address isn't in the symbol table */
+    const struct symbol *syms[KPROF_MAX_DEPTH + 1];
+};
+
+struct kprof_result {
+    int entry_count;
+    uint32_t total;
+    struct kprof_entry entries[];
+};
+
+static uint32_t kprof_entry_hash(struct kprof_entry *ent)
+{
+    uint32_t hash = ent->user;
+    int i;
+
+    for (i = 0; i <= ent->depth; i++)
+        hash = hash * 31 + ((uintptr_t)ent->syms[i] >> 2);
+
+    return hash;
+}
+
+static int kprof_entry_equal(struct kprof_entry *a, struct kprof_entry *b)
+{
+    int i;
+
+    if (a->user != b->user || a->depth != b->depth)
+        return 0;
+
+    for (i = 0; i <= a->depth; i++)
+        if (a->syms[i] != b->syms[i])
+            return 0;
+
+    return 1;
+}
+
+static void kprof_result_sort(struct kprof_result *result)
+{
+    int i, j;
+
+    /* Insertion sort, descending by count. The number of unique
+     * entries is usually pretty small */
+    for (i = 1; i < result->entry_count; i++) {
+        struct kprof_entry tmp = result->entries[i];
+
+        for (j = i; j > 0 && result->entries[j - 1].count < tmp.count; j--)
+            result->entries[j] = result->entries[j - 1];
+
+        result->entries[j] = tmp;
+    }
+}
+
+/* kprof_lock must be held and the CPU paused */
+static void kprof_aggregate_cpu(struct kprof_cpu *cpu, struct kprof_result *result, int *table, int table_size, int folded)
+{
+    int i, k;
+
+    for (i = 0; i < cpu->count; i++) {
+        struct kprof_sample *sample = cpu->samples + (cpu->head - cpu->count + i + cpu->capacity) % cpu->capacity;
+        struct kprof_entry ent = { .count = 1, .user = sample->user };
+
+        ent.depth = folded? sample->depth: 0;
+
+        if (!ent.user)
+            for (k = 0; k <= ent.depth; k++)
+                ent.syms[k] = ksym_lookup(sample->addrs[k]);
+
+        uint32_t slot = kprof_entry_hash(&ent) & (table_size - 1);
+
+        for (; table[slot] != -1; slot = (slot + 1) & (table_size - 1))
+            if (kprof_entry_equal(result->entries + table[slot], &ent))
+                break;
+
+        if (table[slot] == -1) {
+            table[slot] = result->entry_count;
+            result->entries[result->entry_count++] = ent;
+        } else {
+            result->entries[table[slot]].count++;
+        }
+
+        result->total++;
+    }
+}
+
+static struct kprof_result *kprof_aggregate(int folded)
+{
+    struct kprof_result *result = NULL;
+    int *table = NULL;
+    int table_size = 16;
+    int samples = 0;
+    int i;
+
+    using_mutex(&kprof_lock) {
+        for (i = 0; i < KPROF_CPUS; i++)
+            kprof_cpu_pause(kprof_cpus + i, 1);
+
+        for (i = 0; i < KPROF_CPUS; i++)
+            samples += kprof_cpus[i].count;
+
+        /* Keep the table at most half full */
+        while (table_size < samples * 2)
+            table_size <<= 1;
+
+        result = kmalloc(sizeof(*result) + sizeof(*result->entries) * samples, PAL_KERNEL);
+        table = kmalloc(sizeof(*table) * table_size, PAL_KERNEL);
+
+        if (result && table) {
+            memset(table, 0xFF, sizeof(*table) * table_size);
+
+            result->entry_count = 0;
+            result->total = 0;
+
+            for (i = 0; i < KPROF_CPUS; i++)
+                kprof_aggregate_cpu(kprof_cpus + i, result, table, table_size, folded);
+        }
+
+        for (i = 0; i < KPROF_CPUS; i++)
+            kprof_cpu_pause(kprof_cpus + i, 0);
+    }
+
+    if (table)
+        kfree(table);
+
+    if (!table && result) {
+        kfree(result);
+        result = NULL;
+    }
+
+    if (result)
+        kprof_result_sort(result);
+
+    return result;
+}
+
+static const char *kprof_entry_name(struct kprof_entry *ent, int idx)
+{
+    if (ent->user)
+        return "[user]";
+
+    if (!ent->syms[idx])
+        return "[unknown]";
+
+    return ent->syms[idx]->name;
+}
+
+/* Entry zero is the header for the flat profile */
+static int kprof_flat_seq_start(struct seq_file *seq)
+{
+    if (!seq->priv) {
+        seq->priv = kprof_aggregate(0);
+        if (!seq->priv)
+            return -ENOMEM;
+    }
+
+    struct kprof_result *result = seq->priv;
+
+    if (seq->iter_offset == result->entry_count + 1)
+        flag_set(&seq->flags, SEQ_FILE_DONE);
+
+    return 0;
+}
+
+static int kprof_flat_seq_render(struct seq_file *seq)
+{
+    struct kprof_result *result = seq->priv;
+
+    if (seq->iter_offset == 0)
+        return seq_printf(seq, "samples\tpercent\tsymbol\n");
+
+    struct kprof_entry *ent = result->entries + seq->iter_offset - 1;
+    uint32_t percent = (uint64_t)ent->count * 10000 / result->total;
+
+    return seq_printf(seq, "%u\t%u.%02u%%\t%s\n", ent->count, percent / 100, percent % 100, kprof_entry_name(ent, 0));
+}
+
+static int kprof_flat_seq_next(struct seq_file *seq)
+{
+    struct kprof_result *result = seq->priv;
+
+    seq->iter_offset++;
+
+    if (seq->iter_offset == result->entry_count + 1)
+        flag_set(&seq->flags, SEQ_FILE_DONE);
+
+    return 0;
+}
+
+/* Folded stacks, in the format used by flamegraph.pl:
+ *
+ *   outer_func;inner_func;interrupted_func count
+ */
+static int kprof_folded_seq_start(struct seq_file *seq)
+{
+    if (!seq->priv) {
+        seq->priv = kprof_aggregate(1);
+        if (!seq->priv)
+            return -ENOMEM;
+    }
+
+    struct kprof_result *result = seq->priv;
+
+    if (seq->iter_offset == result->entry_count)
+        flag_set(&seq->flags, SEQ_FILE_DONE);
+
+    return 0;
+}
+
+static int kprof_folded_seq_render(struct seq_file *seq)
+{
+    struct kprof_result *result = seq->priv;
+    struct kprof_entry *ent = result->entries + seq->iter_offset;
+    int i, ret;
+
+    for (i = ent->depth; i > 0; i--) {
+        ret = seq_printf(seq, "%s;", kprof_entry_name(ent, i));
+        if (ret < 0)
+            return ret;
+    }
+
+    return seq_printf(seq, "%s %u\n", kprof_entry_name(ent, 0), ent->count);
+}
+
+static int kprof_folded_seq_next(struct seq_file *seq)
+{
+    struct kprof_result *result = seq->priv;
+
+    seq->iter_offset++;
+
+    if (seq->iter_offset == result->entry_count)
+        flag_set(&seq->flags, SEQ_FILE_DONE);
+
+    return 0;
+}
+
+static void kprof_seq_end(struct seq_file *seq)
+{
+
+}
+
+const static struct seq_file_ops kprof_flat_seq_file_ops = {
+    .start = kprof_flat_seq_start,
+    .next = kprof_flat_seq_next,
+    .render = kprof_flat_seq_render,
+    .end = kprof_seq_end,
+};
+
+const static struct seq_file_ops kprof_folded_seq_file_ops = {
+    .start = kprof_folded_seq_start,
+    .next = kprof_folded_seq_next,
+    .render = kprof_folded_seq_render,
+    .end = kprof_seq_end,
+};
+
+static int kprof_flat_file_seq_open(struct inode *inode, struct file *filp)
+{
+    return seq_open(filp, &kprof_flat_seq_file_ops);
+}
+
+static int kprof_folded_file_seq_open(struct inode *inode, struct file *filp)
+{
+    return seq_open(filp, &kprof_folded_seq_file_ops);
+}
+
+static int kprof_file_release(struct file *filp)
+{
+    struct seq_file *seq = filp->priv_data;
+
+    if (seq->priv)
+        kfree(seq->priv);
+
+    return seq_release(filp);
+}
+
+static const struct file_ops kprof_flat_file_ops = {
+    .open = kprof_flat_file_seq_open,
+    .lseek = seq_lseek,
+    .read = seq_read,
+    .ioctl = kprof_ioctl,
+    .release = kprof_file_release,
+};
+
+static const struct file_ops kprof_folded_file_ops = {
+    .open = kprof_folded_file_seq_open,
+    .lseek = seq_lseek,
+    .read = seq_read,
+    .ioctl = kprof_ioctl,
+    .release = kprof_file_release,
+};
+
+static void kprof_init(void)
+{
+    struct procfs_dir *kprof_dir = procfs_register_dir(&procfs_root, "kprof");
+
+    procfs_register_entry(kprof_dir, "flat", &kprof_flat_file_ops);
+    procfs_register_entry(kprof_dir, "folded", &kprof_folded_file_ops);
+}
+initcall_device(kprof, kprof_init);
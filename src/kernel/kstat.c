@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/kstat.h>
+#include <protura/fs/seq_file.h>
+
+struct percpu_counter kstat_counters[KSTAT_COUNT];
+struct percpu_counter kstat_syscall_counters[KSTAT_SYSCALL_MAX];
+
+static const char *kstat_names[KSTAT_COUNT] = {
+    [KSTAT_CONTEXT_SWITCHES] = "ctxt",
+    [KSTAT_INTERRUPTS] = "intr",
+    [KSTAT_SYSCALLS] = "syscalls",
+    [KSTAT_PAGE_FAULTS] = "page_faults",
+    [KSTAT_PAGE_ALLOCS] = "page_allocs",
+    [KSTAT_PAGE_FREES] = "page_frees",
+    [KSTAT_KMALLOCS] = "kmallocs",
+    [KSTAT_KFREES] = "kfrees",
+    [KSTAT_BLOCK_READS] = "block_reads",
+    [KSTAT_BLOCK_WRITES] = "block_writes",
+    [KSTAT_BLOCK_READ_BYTES] = "block_read_bytes",
+    [KSTAT_BLOCK_WRITE_BYTES] = "block_write_bytes",
+};
+
+static int kstat_seq_start(struct seq_file *seq)
+{
+    if (seq->iter_offset == KSTAT_COUNT + 1)
+        flag_set(&seq->flags, SEQ_FILE_DONE);
+
+    return 0;
+}
+
+/* The counters come first, followed by one line per syscall that has been
+ * called at least once */
+static int kstat_seq_render(struct seq_file *seq)
+{
+    uint64_t count;
+    int i;
+
+    if (seq->iter_offset < KSTAT_COUNT)
+        return seq_printf(seq, "%s %llu\n", kstat_names[seq->iter_offset],
+                          percpu_counter_sum(kstat_counters + seq->iter_offset));
+
+    for (i = 0; i < KSTAT_SYSCALL_MAX; i++) {
+        count = percpu_counter_sum(kstat_syscall_counters + i);
+        if (!count)
+            continue;
+
+        int ret = seq_printf(seq, "syscall %d %llu\n", i, count);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int kstat_seq_next(struct seq_file *seq)
+{
+    seq->iter_offset++;
+
+    if (seq->iter_offset == KSTAT_COUNT + 1)
+        flag_set(&seq->flags, SEQ_FILE_DONE);
+
+    return 0;
+}
+
+static void kstat_seq_end(struct seq_file *seq)
+{
+
+}
+
+const static struct seq_file_ops kstat_seq_file_ops = {
+    .start = kstat_seq_start,
+    .next = kstat_seq_next,
+    .render = kstat_seq_render,
+    .end = kstat_seq_end,
+};
+
+static int kstat_file_seq_open(struct inode *inode, struct file *filp)
+{
+    return seq_open(filp, &kstat_seq_file_ops);
+}
+
+const struct file_ops kstat_file_ops = {
+    .open = kstat_file_seq_open,
+    .lseek = seq_lseek,
+    .read = seq_read,
+    .release = seq_release,
+};
@@ -13,14 +13,37 @@
  * linking attempt when kernel_symbols does not exist, but also allows the real
  * definition to take over when we link the actual symbol table */
 extern const struct symbol kernel_symbols[] __weak;
+extern const size_t kernel_symbols_count __weak;
 
+/* Symbols with no size (Typically from assembly) only match their exact
+ * address, so the closest symbol might not be the one containing `addr`. We
+ * check a few of the ones before it before giving up. */
+#define KSYM_LOOKUP_BACKTRACK 8
+
+static inline int ksym_contains(const struct symbol *sym, uintptr_t addr)
+{
+    return sym->addr <= addr && (sym->addr + sym->size) >= addr;
+}
+
+/* kernel_symbols is sorted by address, see scripts/symbol_table.sh */
 const struct symbol *ksym_lookup(uintptr_t addr)
 {
-    const struct symbol *sym;
+    size_t low = 0, high = kernel_symbols_count;
+    int i;
 
-    for (sym = kernel_symbols; sym->name; sym++)
-        if (sym->addr <= addr && (sym->addr + sym->size) >= addr)
-            return sym;
+    /* Find the first symbol starting after addr */
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+
+        if (kernel_symbols[mid].addr <= addr)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    for (i = 0; i < KSYM_LOOKUP_BACKTRACK && low > 0; i++, low--)
+        if (ksym_contains(kernel_symbols + low - 1, addr))
+            return kernel_symbols + low - 1;
 
     return NULL;
 }
@@ -35,3 +58,7 @@ const struct symbol *ksym_lookup_name(const char *symbol_name)
 
     return NULL;
 }
+
+#ifdef CONFIG_KERNEL_TESTS
+# include "ksym_test.c"
+#endif
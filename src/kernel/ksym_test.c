@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+/*
+ * Tests for ksym.c - included directly at the end of ksym.c
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/symbols.h>
+#include <protura/ktest.h>
+
+static void ksym_sorted_test(struct ktest *kt)
+{
+    size_t i;
+    int unsorted = 0;
+
+    for (i = 1; i < kernel_symbols_count; i++)
+        if (kernel_symbols[i - 1].addr > kernel_symbols[i].addr)
+            unsorted++;
+
+    ktest_assert_equal(kt, 0, unsorted);
+}
+
+static void ksym_lookup_test(struct ktest *kt)
+{
+    const struct symbol *sym;
+
+    sym = ksym_lookup((uintptr_t)ksym_lookup);
+    ktest_assert_notequal(kt, NULL, sym);
+    if (sym)
+        ktest_assert_equal_str(kt, "ksym_lookup", sym->name);
+
+    /* Addresses in the middle of a function should resolve to that function */
+    sym = ksym_lookup((uintptr_t)ksym_lookup_name + 4);
+    ktest_assert_notequal(kt, NULL, sym);
+    if (sym)
+        ktest_assert_equal_str(kt, "ksym_lookup_name", sym->name);
+
+    ktest_assert_equal(kt, NULL, ksym_lookup(0));
+}
+
+static void ksym_lookup_all_test(struct ktest *kt)
+{
+    size_t i;
+
+    /* Every sized symbol should be found by its own address */
+    for (i = 0; i < kernel_symbols_count; i++) {
+        const struct symbol *sym = kernel_symbols + i;
+
+        if (!sym->size)
+            continue;
+
+        const struct symbol *found = ksym_lookup(sym->addr + sym->size / 2);
+
+        if (!found || !ksym_contains(found, sym->addr + sym->size / 2))
+            ktest_assert_equal_str(kt, sym->name, found? found->name: "(null)");
+    }
+}
+
+static const struct ktest_unit ksym_test_units[] = {
+    KTEST_UNIT("ksym-sorted-test", ksym_sorted_test),
+    KTEST_UNIT("ksym-lookup-test", ksym_lookup_test),
+    KTEST_UNIT("ksym-lookup-all-test", ksym_lookup_all_test),
+};
+
+KTEST_MODULE_DEFINE("ksym", ksym_test_units);
@@ -15,96 +15,192 @@
 #include <protura/time.h>
 #include <arch/drivers/pic8259_timer.h>
 #include <protura/ktimer.h>
+#include <protura/softirq.h>
 
 /*
  * ktimer - Kernel timers
  *
- * Implemented as a sorted list of lists. The main list holds a sorted list of
- * timers, where the one soonest to go off is first.
+ * Implemented as a hierarchical timing wheel. The first level has a slot for
+ * each of the next TVR_SIZE ticks, and each level after that has TVN_SIZE
+ * slots, with each slot covering the entire range of the level below it.
  *
- * Each timer in that list holds its own list of timers who share the same
- * wake-up tick (if there are any).
+ * Adding or removing a timer is O(1), it just gets put in the list of the
+ * correct slot. When the first level wraps around, the next slot of the
+ * second level is 'cascaded', the timers in it are redistributed into the
+ * first level (and so on for the higher levels, when the second level wraps
+ * around). Each timer is cascaded at most once per level.
  *
- * The above setup allows for very fast handling of timers each tick. Only the
- * first timer has to ever be checked, even if there are multiple timers
- * registered for that tick.
+ * On each tick, the entire slot for that tick is taken off of the wheel at
+ * once, and then the callbacks are run one at a time with the lock dropped.
  */
 
-static spinlock_t timers_lock;
-static list_head_t timer_list = LIST_HEAD_INIT(timer_list);
+#define TVR_BITS 8
+#define TVN_BITS 6
+#define TVR_SIZE (1 << TVR_BITS)
+#define TVN_SIZE (1 << TVN_BITS)
+#define TVR_MASK (TVR_SIZE - 1)
+#define TVN_MASK (TVN_SIZE - 1)
+#define TVN_LEVELS 4
 
-/* FIXME: This should be per-CPU, since they can all trigger ktimers.
- *
- * NOTE: This *CANNOT* be used to read the state of the current timer, once we
- * drop the lock in timer_handle_timers() this thing could be free'd at any time.
- *
- * What we can do, however, is do a direct pointer comparison against a
- * pointer provided to us in `timer_cancel()`. If they're equal, the timer is
- * potentially still running, and we need to wait until they don't equal. */
-static struct ktimer *currently_running_timer;
+/* Timers further out then this are clamped to it */
+#define TIMER_WHEEL_MAX_DELTA ((1ULL << (TVR_BITS + TVN_LEVELS * TVN_BITS)) - 1)
+
+#define TVN_SHIFT(level) (TVR_BITS + (level) * TVN_BITS)
+#define TVN_INDEX(tick, level) (((tick) >> TVN_SHIFT(level)) & TVN_MASK)
+
+struct ktimer_wheel {
+    spinlock_t lock;
+
+    /* The next tick that has not yet been processed */
+    uint64_t tick;
+
+    /*
+     * NOTE: This *CANNOT* be used to read the state of the current timer, once
+     * we drop the lock in timer_wheel_run() this thing could be free'd at any
+     * time.
+     *
+     * What we can do, however, is do a direct pointer comparison against a
+     * pointer provided to us in `timer_cancel()`. If they're equal, the timer
+     * is potentially still running, and we need to wait until they don't
+     * equal.
+     */
+    struct ktimer *running;
+
+    list_head_t tvr[TVR_SIZE];
+    list_head_t tvn[TVN_LEVELS][TVN_SIZE];
+};
+
+/* FIXME: This should be per-CPU, since they can all trigger ktimers. */
+static struct ktimer_wheel timer_wheel;
+
+static void timer_wheel_init(struct ktimer_wheel *wheel, uint64_t tick)
+{
+    int i, level;
+
+    spinlock_init(&wheel->lock);
+    wheel->tick = tick;
+    wheel->running = NULL;
+
+    for (i = 0; i < TVR_SIZE; i++)
+        list_head_init(wheel->tvr + i);
+
+    for (level = 0; level < TVN_LEVELS; level++)
+        for (i = 0; i < TVN_SIZE; i++)
+            list_head_init(&wheel->tvn[level][i]);
+}
+
+/* Must be called with the wheel lock held */
+static void __timer_wheel_add(struct ktimer_wheel *wheel, struct ktimer *timer)
+{
+    uint64_t expires = timer->wake_up_tick;
+    uint64_t delta;
+    list_head_t *slot;
+    int level;
+
+    /* Timers in the past fire on the next tick we process */
+    if (expires < wheel->tick)
+        expires = wheel->tick;
+
+    delta = expires - wheel->tick;
+
+    if (delta > TIMER_WHEEL_MAX_DELTA) {
+        delta = TIMER_WHEEL_MAX_DELTA;
+        expires = wheel->tick + delta;
+    }
+
+    if (delta < TVR_SIZE) {
+        slot = wheel->tvr + (expires & TVR_MASK);
+    } else {
+        for (level = 0; level < TVN_LEVELS - 1; level++)
+            if (delta < (1ULL << TVN_SHIFT(level + 1)))
+                break;
+
+        slot = &wheel->tvn[level][TVN_INDEX(expires, level)];
+    }
+
+    list_add_tail(slot, &timer->timer_entry);
+}
 
-void timer_handle_timers(uint64_t tick)
+/* Redistribute a slot of a higher level into the levels below it */
+static int timer_wheel_cascade(struct ktimer_wheel *wheel, int level, int index)
 {
+    list_head_t list = LIST_HEAD_INIT(list);
     struct ktimer *timer;
-    void (*callback) (struct ktimer *);
 
-    while (1) {
-        using_spinlock(&timers_lock) {
-            currently_running_timer = NULL;
+    list_splice_init(&list, &wheel->tvn[level][index]);
 
-            if (list_empty(&timer_list))
-                return;
+    list_foreach_take_entry(&list, timer, timer_entry)
+        __timer_wheel_add(wheel, timer);
 
-            timer = list_first_entry(&timer_list, struct ktimer, timer_entry);
+    return index;
+}
+
+/*
+ * Moves the timers for the next unprocessed tick onto `expired`, and
+ * advances the wheel by one tick. Must be called with the lock held.
+ */
+static void __timer_wheel_advance(struct ktimer_wheel *wheel, list_head_t *expired)
+{
+    int index = wheel->tick & TVR_MASK;
+    int level;
 
-            if (timer->wake_up_tick > tick)
+    if (!index)
+        for (level = 0; level < TVN_LEVELS; level++)
+            if (timer_wheel_cascade(wheel, level, TVN_INDEX(wheel->tick, level)))
+                break;
+
+    list_splice_tail_init(expired, wheel->tvr + index);
+    wheel->tick++;
+}
+
+static void timer_wheel_run(struct ktimer_wheel *wheel, uint64_t tick)
+{
+    list_head_t expired = LIST_HEAD_INIT(expired);
+    struct ktimer *timer;
+    void (*callback) (struct ktimer *);
+
+    using_spinlock(&wheel->lock)
+        while (wheel->tick <= tick)
+            __timer_wheel_advance(wheel, &expired);
+
+    while (1) {
+        using_spinlock(&wheel->lock) {
+            wheel->running = NULL;
+
+            /* The expired timers are still 'in a list', so they can still be
+             * removed by timer_del() while we're running the others */
+            if (list_empty(&expired))
                 return;
 
-            list_del(&timer->timer_entry);
+            timer = list_take_first(&expired, struct ktimer, timer_entry);
 
             /* Store callback because timer might be modified once we release the lock */
             callback = timer->callback;
 
-            currently_running_timer = timer;
+            wheel->running = timer;
         }
 
         (callback) (timer);
     }
 }
 
-int timer_was_fired(struct ktimer *timer)
-{
-    using_spinlock(&timers_lock)
-        return !list_node_is_in_list(&timer->timer_entry);
-}
-
-int timer_add(struct ktimer *timer, uint64_t ms)
+static int timer_wheel_add(struct ktimer_wheel *wheel, struct ktimer *timer, uint64_t wake_up_tick)
 {
-    struct ktimer *t;
-    timer->wake_up_tick = timer_get_ticks() + ms * (TIMER_TICKS_PER_SEC / 1000);
-
-    using_spinlock(&timers_lock) {
+    using_spinlock(&wheel->lock) {
         /* We're already scheduled, don't do anything */
         if (list_node_is_in_list(&timer->timer_entry))
             return -1;
 
-        list_foreach_entry(&timer_list, t, timer_entry) {
-            if (t->wake_up_tick >= timer->wake_up_tick) {
-                list_add_before(&t->timer_entry, &timer->timer_entry);
-                break;
-            }
-        }
-
-        if (!list_node_is_in_list(&timer->timer_entry))
-            list_add_tail(&timer_list, &timer->timer_entry);
-
-        return 0;
+        timer->wake_up_tick = wake_up_tick;
+        __timer_wheel_add(wheel, timer);
     }
+
+    return 0;
 }
 
-int timer_del(struct ktimer *timer)
+static int timer_wheel_del(struct ktimer_wheel *wheel, struct ktimer *timer)
 {
-    using_spinlock(&timers_lock) {
+    using_spinlock(&wheel->lock) {
         if (!list_node_is_in_list(&timer->timer_entry))
             return -1;
 
@@ -114,23 +210,73 @@ int timer_del(struct ktimer *timer)
     return 0;
 }
 
-void timer_cancel(struct ktimer *timer)
+static void timer_wheel_cancel(struct ktimer_wheel *wheel, struct ktimer *timer)
 {
-    int ret = timer_del(timer);
+    int ret = timer_wheel_del(wheel, timer);
 
     /* The easy case, timer wasn't yet run, just return */
     if (!ret)
         return;
 
     /* Annoying case, timer might currently be running, keep checking
-     * `currently_running_timer and yielding. Timers are *supposed* to finish
-     * quickly, so this shouldn't last that long. */
+     * `running` and yielding. Timers are *supposed* to finish quickly, so this
+     * shouldn't last that long. */
     while (1) {
-        using_spinlock(&timers_lock) {
-            if (currently_running_timer != timer)
+        using_spinlock(&wheel->lock) {
+            if (wheel->running != timer)
                 return;
         }
 
         scheduler_task_yield();
     }
 }
+
+static int timer_was_fired_wheel(struct ktimer_wheel *wheel, struct ktimer *timer)
+{
+    using_spinlock(&wheel->lock)
+        return !list_node_is_in_list(&timer->timer_entry);
+}
+
+/* Raised by the timer interrupt on every tick */
+static void timer_softirq(void)
+{
+    timer_wheel_run(&timer_wheel, timer_get_ticks());
+}
+
+void ktimer_setup(void)
+{
+    timer_wheel_init(&timer_wheel, timer_get_ticks());
+    softirq_register(SOFTIRQ_TIMER, timer_softirq);
+}
+
+int timer_was_fired(struct ktimer *timer)
+{
+    return timer_was_fired_wheel(&timer_wheel, timer);
+}
+
+int timer_add_ns(struct ktimer *timer, uint64_t ns)
+{
+    uint64_t deadline = timer_get_ns() + ns;
+
+    /* Round up, the timer can never fire before the deadline */
+    return timer_wheel_add(&timer_wheel, timer, (deadline + TIMER_NSEC_PER_TICK - 1) / TIMER_NSEC_PER_TICK);
+}
+
+int timer_add(struct ktimer *timer, uint64_t ms)
+{
+    return timer_add_ns(timer, ms * NSEC_PER_MSEC);
+}
+
+int timer_del(struct ktimer *timer)
+{
+    return timer_wheel_del(&timer_wheel, timer);
+}
+
+void timer_cancel(struct ktimer *timer)
+{
+    timer_wheel_cancel(&timer_wheel, timer);
+}
+
+#ifdef CONFIG_KERNEL_TESTS
+# include "ktimer_test.c"
+#endif
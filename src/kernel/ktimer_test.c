@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+/*
+ * Tests for ktimer.c - included directly at the end of ktimer.c
+ */
+
+#include <protura/types.h>
+#include <protura/mm/palloc.h>
+#include <protura/ktimer.h>
+#include <protura/ktest.h>
+
+/* The wheel is bigger than a single page */
+#define TEST_WHEEL_ORDER 1
+
+STATIC_ASSERT(sizeof(struct ktimer_wheel) <= (PG_SIZE << TEST_WHEEL_ORDER));
+
+struct test_timer {
+    struct ktimer timer;
+    struct ktimer_wheel *wheel;
+
+    int fired;
+    int order;
+
+    /* Used by the callbacks that act on other timers */
+    struct test_timer *other;
+    int *next_order;
+};
+
+static void test_timer_callback(struct ktimer *timer)
+{
+    struct test_timer *t = container_of(timer, struct test_timer, timer);
+
+    t->fired++;
+    if (t->next_order)
+        t->order = (*t->next_order)++;
+}
+
+static void test_timer_init(struct test_timer *t, struct ktimer_wheel *wheel, void (*callback) (struct ktimer *))
+{
+    memset(t, 0, sizeof(*t));
+    ktimer_init(&t->timer);
+    t->timer.callback = callback;
+    t->wheel = wheel;
+}
+
+static struct ktimer_wheel *test_wheel_new(uint64_t tick)
+{
+    struct ktimer_wheel *wheel = palloc_va(TEST_WHEEL_ORDER, PAL_KERNEL);
+    timer_wheel_init(wheel, tick);
+    return wheel;
+}
+
+static void test_wheel_free(struct ktimer_wheel *wheel)
+{
+    pfree_va(wheel, TEST_WHEEL_ORDER);
+}
+
+static void ktimer_wheel_expire_test(struct ktest *kt, uint64_t start, uint64_t delta)
+{
+    struct ktimer_wheel *wheel = test_wheel_new(start);
+    struct test_timer t;
+
+    test_timer_init(&t, wheel, test_timer_callback);
+    ktest_assert_equal(kt, 0, timer_wheel_add(wheel, &t.timer, start + delta));
+
+    /* Adding an already scheduled timer does nothing */
+    ktest_assert_equal(kt, -1, timer_wheel_add(wheel, &t.timer, start));
+
+    if (delta) {
+        timer_wheel_run(wheel, start + delta - 1);
+        ktest_assert_equal(kt, 0, t.fired);
+    }
+
+    timer_wheel_run(wheel, start + delta);
+    ktest_assert_equal(kt, 1, t.fired);
+    ktest_assert_equal(kt, 1, timer_was_fired_wheel(wheel, &t.timer));
+
+    test_wheel_free(wheel);
+}
+
+static void ktimer_wheel_expire_zero_test(struct ktest *kt)
+{
+    ktimer_wheel_expire_test(kt, 0, KT_ARG(kt, 0, int));
+}
+
+static void ktimer_wheel_expire_offset_test(struct ktest *kt)
+{
+    /* Start somewhere that isn't aligned to any level */
+    ktimer_wheel_expire_test(kt, 12345, KT_ARG(kt, 0, int));
+}
+
+static void ktimer_wheel_order_test(struct ktest *kt)
+{
+    static const int deltas[] = { 300, 1, 70000, 256, 255, 20000, 1, 0, 16384, 257 };
+    static const int expected_order[] = { 6, 1, 9, 4, 3, 8, 2, 0, 7, 5 };
+    struct test_timer timers[ARRAY_SIZE(deltas)];
+    struct ktimer_wheel *wheel = test_wheel_new(100);
+    int next_order = 0;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(deltas); i++) {
+        test_timer_init(timers + i, wheel, test_timer_callback);
+        timers[i].next_order = &next_order;
+        timer_wheel_add(wheel, &timers[i].timer, 100 + deltas[i]);
+    }
+
+    /* All of the timers expire in a single batch */
+    timer_wheel_run(wheel, 100 + 70000);
+
+    for (i = 0; i < ARRAY_SIZE(deltas); i++) {
+        ktest_assert_equal(kt, 1, timers[i].fired);
+        ktest_assert_equal(kt, expected_order[i], timers[i].order);
+    }
+
+    test_wheel_free(wheel);
+}
+
+static void test_timer_del_other_callback(struct ktimer *timer)
+{
+    struct test_timer *t = container_of(timer, struct test_timer, timer);
+
+    t->fired++;
+    t->order = timer_wheel_del(t->wheel, &t->other->timer);
+}
+
+static void ktimer_wheel_del_from_callback_test(struct ktest *kt)
+{
+    struct ktimer_wheel *wheel = test_wheel_new(0);
+    struct test_timer first, second;
+
+    test_timer_init(&first, wheel, test_timer_del_other_callback);
+    test_timer_init(&second, wheel, test_timer_callback);
+    first.other = &second;
+
+    /* Both expire on the same tick, so they're in the same batch */
+    timer_wheel_add(wheel, &first.timer, 500);
+    timer_wheel_add(wheel, &second.timer, 500);
+
+    timer_wheel_run(wheel, 500);
+
+    ktest_assert_equal(kt, 1, first.fired);
+    ktest_assert_equal(kt, 0, first.order);
+    ktest_assert_equal(kt, 0, second.fired);
+
+    test_wheel_free(wheel);
+}
+
+static void test_timer_rearm_callback(struct ktimer *timer)
+{
+    struct test_timer *t = container_of(timer, struct test_timer, timer);
+
+    t->fired++;
+
+    /* A deadline in the past still can't fire in the current batch */
+    if (t->fired == 1)
+        timer_wheel_add(t->wheel, timer, 0);
+}
+
+static void ktimer_wheel_rearm_test(struct ktest *kt)
+{
+    struct ktimer_wheel *wheel = test_wheel_new(1000);
+    struct test_timer t;
+
+    test_timer_init(&t, wheel, test_timer_rearm_callback);
+    timer_wheel_add(wheel, &t.timer, 1010);
+
+    timer_wheel_run(wheel, 1010);
+    ktest_assert_equal(kt, 1, t.fired);
+    ktest_assert_equal(kt, 0, timer_was_fired_wheel(wheel, &t.timer));
+
+    timer_wheel_run(wheel, 1011);
+    ktest_assert_equal(kt, 2, t.fired);
+    ktest_assert_equal(kt, 1, timer_was_fired_wheel(wheel, &t.timer));
+
+    test_wheel_free(wheel);
+}
+
+static void ktimer_wheel_del_test(struct ktest *kt)
+{
+    struct ktimer_wheel *wheel = test_wheel_new(0);
+    struct test_timer t;
+    int delta = KT_ARG(kt, 0, int);
+
+    test_timer_init(&t, wheel, test_timer_callback);
+    timer_wheel_add(wheel, &t.timer, delta);
+
+    ktest_assert_equal(kt, 0, timer_wheel_del(wheel, &t.timer));
+    ktest_assert_equal(kt, -1, timer_wheel_del(wheel, &t.timer));
+
+    timer_wheel_run(wheel, delta + 1);
+    ktest_assert_equal(kt, 0, t.fired);
+
+    test_wheel_free(wheel);
+}
+
+static const struct ktest_unit ktimer_test_units[] = {
+    KTEST_UNIT("ktimer-wheel-expire-zero-test", ktimer_wheel_expire_zero_test,
+            (KT_INT(0)),
+            (KT_INT(1)),
+            (KT_INT(255)),
+            (KT_INT(256)),
+            (KT_INT(257)),
+            (KT_INT(300)),
+            (KT_INT(16383)),
+            (KT_INT(16384)),
+            (KT_INT(16385)),
+            (KT_INT(1 << 20)),
+            (KT_INT((1 << 20) + 1)),
+            (KT_INT((1 << 26) + 3))),
+
+    KTEST_UNIT("ktimer-wheel-expire-offset-test", ktimer_wheel_expire_offset_test,
+            (KT_INT(0)),
+            (KT_INT(1)),
+            (KT_INT(255)),
+            (KT_INT(256)),
+            (KT_INT(300)),
+            (KT_INT(16383)),
+            (KT_INT(16384)),
+            (KT_INT(100000)),
+            (KT_INT((1 << 20) + 7))),
+
+    KTEST_UNIT("ktimer-wheel-order-test", ktimer_wheel_order_test),
+    KTEST_UNIT("ktimer-wheel-del-from-callback-test", ktimer_wheel_del_from_callback_test),
+    KTEST_UNIT("ktimer-wheel-rearm-test", ktimer_wheel_rearm_test),
+
+    KTEST_UNIT("ktimer-wheel-del-test", ktimer_wheel_del_test,
+            (KT_INT(1)),
+            (KT_INT(256)),
+            (KT_INT(20000))),
+};
+
+KTEST_MODULE_DEFINE("ktimer", ktimer_test_units);
@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/rbtree.h>
+
+/*
+ * The standard red-black rules:
+ *
+ *   1. The root is black.
+ *   2. A red node never has a red child.
+ *   3. Every path from a node down to a NULL leaf has the same number of
+ *      black nodes.
+ *
+ * NULL leaves count as black, which is why most of the color checks below
+ * also check for NULL.
+ */
+enum {
+    RB_RED,
+    RB_BLACK,
+};
+
+static inline int rb_is_black(const rb_node_t *node)
+{
+    return !node || node->color == RB_BLACK;
+}
+
+/* Puts 'new' in the place of 'old' in old's parent */
+static void rb_replace_child(rb_root_t *root, rb_node_t *old, rb_node_t *new)
+{
+    if (!old->parent)
+        root->node = new;
+    else if (old == old->parent->left)
+        old->parent->left = new;
+    else
+        old->parent->right = new;
+
+    if (new)
+        new->parent = old->parent;
+}
+
+static void rb_rotate_left(rb_root_t *root, rb_node_t *node)
+{
+    rb_node_t *right = node->right;
+
+    node->right = right->left;
+    if (right->left)
+        right->left->parent = node;
+
+    rb_replace_child(root, node, right);
+
+    right->left = node;
+    node->parent = right;
+}
+
+static void rb_rotate_right(rb_root_t *root, rb_node_t *node)
+{
+    rb_node_t *left = node->left;
+
+    node->left = left->right;
+    if (left->right)
+        left->right->parent = node;
+
+    rb_replace_child(root, node, left);
+
+    left->right = node;
+    node->parent = left;
+}
+
+void rb_insert(rb_root_t *root, rb_node_t *node, int (*less) (const rb_node_t *, const rb_node_t *))
+{
+    rb_node_t **link = &root->node;
+    rb_node_t *parent = NULL;
+
+    while (*link) {
+        parent = *link;
+
+        if (less(node, parent))
+            link = &parent->left;
+        else
+            link = &parent->right;
+    }
+
+    node->parent = parent;
+    node->left = NULL;
+    node->right = NULL;
+    node->color = RB_RED;
+    *link = node;
+
+    /* 'node' is red, so the only rule that can be broken is a red parent */
+    while ((parent = node->parent) && parent->color == RB_RED) {
+        /* The parent is red, so it isn't the root and 'gparent' exists */
+        rb_node_t *gparent = parent->parent;
+
+        if (parent == gparent->left) {
+            rb_node_t *uncle = gparent->right;
+
+            if (!rb_is_black(uncle)) {
+                parent->color = RB_BLACK;
+                uncle->color = RB_BLACK;
+                gparent->color = RB_RED;
+                node = gparent;
+                continue;
+            }
+
+            if (node == parent->right) {
+                rb_rotate_left(root, parent);
+                node = parent;
+                parent = node->parent;
+            }
+
+            parent->color = RB_BLACK;
+            gparent->color = RB_RED;
+            rb_rotate_right(root, gparent);
+        } else {
+            rb_node_t *uncle = gparent->left;
+
+            if (!rb_is_black(uncle)) {
+                parent->color = RB_BLACK;
+                uncle->color = RB_BLACK;
+                gparent->color = RB_RED;
+                node = gparent;
+                continue;
+            }
+
+            if (node == parent->left) {
+                rb_rotate_right(root, parent);
+                node = parent;
+                parent = node->parent;
+            }
+
+            parent->color = RB_BLACK;
+            gparent->color = RB_RED;
+            rb_rotate_left(root, gparent);
+        }
+    }
+
+    root->node->color = RB_BLACK;
+}
+
+/* 'node' took the place of a black node that was removed, so every path
+ * through it is missing a black node. 'node' may be NULL, which is why its
+ * parent is passed separately. */
+static void rb_erase_fixup(rb_root_t *root, rb_node_t *node, rb_node_t *parent)
+{
+    while (node != root->node && rb_is_black(node)) {
+        /* The paths through the sibling have one more black node than the
+         * paths through 'node', so the sibling can't be NULL */
+        if (node == parent->left) {
+            rb_node_t *sibling = parent->right;
+
+            if (!rb_is_black(sibling)) {
+                sibling->color = RB_BLACK;
+                parent->color = RB_RED;
+                rb_rotate_left(root, parent);
+                sibling = parent->right;
+            }
+
+            if (rb_is_black(sibling->left) && rb_is_black(sibling->right)) {
+                sibling->color = RB_RED;
+                node = parent;
+                parent = node->parent;
+                continue;
+            }
+
+            if (rb_is_black(sibling->right)) {
+                sibling->left->color = RB_BLACK;
+                sibling->color = RB_RED;
+                rb_rotate_right(root, sibling);
+                sibling = parent->right;
+            }
+
+            sibling->color = parent->color;
+            parent->color = RB_BLACK;
+            sibling->right->color = RB_BLACK;
+            rb_rotate_left(root, parent);
+        } else {
+            rb_node_t *sibling = parent->left;
+
+            if (!rb_is_black(sibling)) {
+                sibling->color = RB_BLACK;
+                parent->color = RB_RED;
+                rb_rotate_right(root, parent);
+                sibling = parent->left;
+            }
+
+            if (rb_is_black(sibling->left) && rb_is_black(sibling->right)) {
+                sibling->color = RB_RED;
+                node = parent;
+                parent = node->parent;
+                continue;
+            }
+
+            if (rb_is_black(sibling->left)) {
+                sibling->right->color = RB_BLACK;
+                sibling->color = RB_RED;
+                rb_rotate_left(root, sibling);
+                sibling = parent->left;
+            }
+
+            sibling->color = parent->color;
+            parent->color = RB_BLACK;
+            sibling->left->color = RB_BLACK;
+            rb_rotate_right(root, parent);
+        }
+
+        node = root->node;
+        break;
+    }
+
+    if (node)
+        node->color = RB_BLACK;
+}
+
+void rb_erase(rb_root_t *root, rb_node_t *node)
+{
+    rb_node_t *child, *parent;
+    int color;
+
+    if (!node->left || !node->right) {
+        child = node->left? node->left: node->right;
+        parent = node->parent;
+        color = node->color;
+
+        rb_replace_child(root, node, child);
+    } else {
+        /* 'node' has two children, so its successor takes its place. The
+         * successor has no left child, so it's easy to remove from where it
+         * currently is */
+        rb_node_t *next = node->right;
+
+        while (next->left)
+            next = next->left;
+
+        child = next->right;
+        color = next->color;
+
+        if (next->parent == node) {
+            parent = next;
+        } else {
+            parent = next->parent;
+            rb_replace_child(root, next, child);
+
+            next->right = node->right;
+            next->right->parent = next;
+        }
+
+        rb_replace_child(root, node, next);
+
+        next->left = node->left;
+        next->left->parent = next;
+        next->color = node->color;
+    }
+
+    if (color == RB_BLACK)
+        rb_erase_fixup(root, child, parent);
+
+    node->parent = NULL;
+    node->left = NULL;
+    node->right = NULL;
+}
+
+rb_node_t *rb_first(const rb_root_t *root)
+{
+    rb_node_t *node = root->node;
+
+    if (!node)
+        return NULL;
+
+    while (node->left)
+        node = node->left;
+
+    return node;
+}
+
+rb_node_t *rb_next(const rb_node_t *node)
+{
+    if (node->right) {
+        node = node->right;
+
+        while (node->left)
+            node = node->left;
+
+        return (rb_node_t *)node;
+    }
+
+    while (node->parent && node == node->parent->right)
+        node = node->parent;
+
+    return node->parent;
+}
+
+#ifdef CONFIG_KERNEL_TESTS
+# include "rbtree_test.c"
+#endif
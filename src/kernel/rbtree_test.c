@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+/*
+ * Tests for rbtree.c - included directly at the end of rbtree.c
+ */
+
+#include <protura/types.h>
+#include <protura/mm/kmalloc.h>
+#include <protura/rbtree.h>
+#include <protura/ktest.h>
+
+struct rbtree_test_node {
+    rb_node_t node;
+    int key;
+    int order;
+};
+
+static int rbtree_test_less(const rb_node_t *n1, const rb_node_t *n2)
+{
+    return rb_entry(n1, struct rbtree_test_node, node)->key < rb_entry(n2, struct rbtree_test_node, node)->key;
+}
+
+/* Returns the black height of 'node', or -1 if any of the rules are broken */
+static int rbtree_test_check_node(const rb_node_t *node)
+{
+    int left, right;
+
+    if (!node)
+        return 1;
+
+    if (node->left && node->left->parent != node)
+        return -1;
+
+    if (node->right && node->right->parent != node)
+        return -1;
+
+    if (!rb_is_black(node) && (!rb_is_black(node->left) || !rb_is_black(node->right)))
+        return -1;
+
+    left = rbtree_test_check_node(node->left);
+    right = rbtree_test_check_node(node->right);
+
+    if (left == -1 || left != right)
+        return -1;
+
+    return left + rb_is_black(node);
+}
+
+/* Checks the tree is valid, and that it holds 'count' nodes in order */
+static void rbtree_test_check(struct ktest *kt, rb_root_t *root, int count)
+{
+    struct rbtree_test_node *n, *prev = NULL;
+    int found = 0;
+
+    ktest_assert_equal(kt, 1, rb_is_black(root->node));
+    ktest_assert_notequal(kt, -1, rbtree_test_check_node(root->node));
+
+    rb_foreach_entry(root, n, node) {
+        if (prev) {
+            ktest_assert_equal(kt, 1, prev->key <= n->key);
+
+            if (prev->key == n->key)
+                ktest_assert_equal(kt, 1, prev->order < n->order);
+        }
+
+        prev = n;
+        found++;
+    }
+
+    ktest_assert_equal(kt, count, found);
+}
+
+static void rbtree_insert_erase_test(struct ktest *kt)
+{
+    int count = KT_ARG(kt, 0, int);
+    int key_range = KT_ARG(kt, 1, int);
+    struct rbtree_test_node *nodes = kzalloc(sizeof(*nodes) * count, PAL_KERNEL);
+    rb_root_t root = RB_ROOT_INIT;
+    uint32_t seed = 12345;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+
+        nodes[i].key = (seed >> 8) % key_range;
+        nodes[i].order = i;
+
+        rb_insert(&root, &nodes[i].node, rbtree_test_less);
+    }
+
+    rbtree_test_check(kt, &root, count);
+
+    /* Remove every other node, and then the rest */
+    for (i = 0; i < count; i += 2)
+        rb_erase(&root, &nodes[i].node);
+
+    rbtree_test_check(kt, &root, count / 2);
+
+    for (i = 1; i < count; i += 2)
+        rb_erase(&root, &nodes[i].node);
+
+    ktest_assert_equal(kt, 1, rb_empty(&root));
+
+    kfree(nodes);
+}
+
+static void rbtree_first_test(struct ktest *kt)
+{
+    struct rbtree_test_node nodes[32];
+    rb_root_t root = RB_ROOT_INIT;
+    int i;
+
+    ktest_assert_equal(kt, NULL, rb_first(&root));
+
+    for (i = 0; i < 32; i++) {
+        nodes[i].key = 31 - i;
+        nodes[i].order = i;
+        rb_insert(&root, &nodes[i].node, rbtree_test_less);
+    }
+
+    /* Taking the first node each time gives them back in order */
+    for (i = 0; i < 32; i++) {
+        rb_node_t *first = rb_first(&root);
+
+        ktest_assert_equal(kt, &nodes[31 - i].node, first);
+
+        rb_erase(&root, first);
+        rbtree_test_check(kt, &root, 31 - i);
+    }
+}
+
+static const struct ktest_unit rbtree_test_units[] = {
+    KTEST_UNIT("rbtree-insert-erase", rbtree_insert_erase_test,
+            (KT_INT(1), KT_INT(10)),
+            (KT_INT(16), KT_INT(4)),
+            (KT_INT(100), KT_INT(1000)),
+            (KT_INT(1000), KT_INT(50)),
+            (KT_INT(4096), KT_INT(100000))),
+    KTEST_UNIT("rbtree-first", rbtree_first_test),
+};
+
+KTEST_MODULE_DEFINE("rbtree", rbtree_test_units);
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/list.h>
+#include <protura/rbtree.h>
+#include <protura/time.h>
+#include <protura/task.h>
+#include <protura/sched.h>
+#include "scheduler_internal.h"
+
+/*
+ * Weighted fair scheduling
+ *
+ * Every task keeps a 'vruntime', which is the amount of time it has run for,
+ * scaled by the inverse of its weight. A nice 0 task's vruntime advances at
+ * the same speed as real time, higher weight tasks advance slower and lower
+ * weight tasks advance faster.
+ *
+ * ktasks.fair_queue is a red-black tree ordered by vruntime, and the
+ * scheduler always picks the leftmost task in it, so the task that has
+ * received the least weighted CPU time runs next. Over time every runnable
+ * task ends up with a share of the CPU proportional to its weight.
+ *
+ * Tasks that sleep don't accumulate vruntime, so when they wake they would
+ * get to run until they caught up with everybody else. To prevent that they
+ * are limited to being SCHED_SLEEPER_CREDIT_NS behind min_vruntime when they
+ * go back on the queue, which still gives woken (interactive) tasks a small
+ * boost.
+ */
+
+#define SCHED_SLEEPER_CREDIT_NS (20 * NSEC_PER_MSEC)
+
+/* The amount of time a task runs before it is preempted */
+#define SCHED_SLICE_NS (NSEC_PER_SEC / CONFIG_TASKSWITCH_PER_SEC)
+
+/*
+ * Each nice level is worth roughly 10% of CPU time compared to the next one,
+ * which works out to a ~1.25x difference in weight.
+ */
+static const uint32_t sched_nice_weights[NICE_MAX - NICE_MIN + 1] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */  9548,  7620,  6100,  4904,  3906,
+    /*  -5 */  3121,  2501,  1991,  1586,  1277,
+    /*   0 */  1024,   820,   655,   526,   423,
+    /*   5 */   335,   272,   215,   172,   137,
+    /*  10 */   110,    87,    70,    56,    45,
+    /*  15 */    36,    29,    23,    18,    15,
+};
+
+uint32_t sched_nice_to_weight(int nice)
+{
+    if (nice < NICE_MIN)
+        nice = NICE_MIN;
+
+    if (nice > NICE_MAX)
+        nice = NICE_MAX;
+
+    return sched_nice_weights[nice - NICE_MIN];
+}
+
+static int __sched_fair_less(const rb_node_t *n1, const rb_node_t *n2)
+{
+    return rb_entry(n1, struct task, sched_fair_node)->vruntime
+         < rb_entry(n2, struct task, sched_fair_node)->vruntime;
+}
+
+/* Inserts after any tasks with an equal vruntime, so equal tasks round-robin */
+void __sched_fair_enqueue(struct sched_task_list *list, struct task *task)
+{
+    rb_insert(&list->fair_queue, &task->sched_fair_node, __sched_fair_less);
+}
+
+void __sched_fair_dequeue(struct sched_task_list *list, struct task *task)
+{
+    rb_erase(&list->fair_queue, &task->sched_fair_node);
+}
+
+/*
+ * New tasks start a slice after min_vruntime, so they are put after the
+ * tasks that are currently waiting to run.
+ *
+ * This prevents an interesting issue that can arise from a very-quickly
+ * forking process preventing other processes from running.
+ */
+void __sched_fair_task_add(struct sched_task_list *list, struct task *task)
+{
+    if (task->vruntime < list->min_vruntime + SCHED_SLICE_NS)
+        task->vruntime = list->min_vruntime + SCHED_SLICE_NS;
+
+    __sched_task_enqueue(list, task, 0);
+}
+
+/* Waking up after a long sleep doesn't entitle a task to all of the time it
+ * missed. This has to happen before it goes back on the queue, since its
+ * vruntime is its place in the queue. */
+void __sched_fair_task_wake(struct sched_task_list *list, struct task *task)
+{
+    if (!sched_task_is_rt(task) && task->vruntime + SCHED_SLEEPER_CREDIT_NS < list->min_vruntime)
+        task->vruntime = list->min_vruntime - SCHED_SLEEPER_CREDIT_NS;
+
+    __sched_task_enqueue(list, task, 0);
+}
+
+void __sched_fair_task_pick(struct sched_task_list *list, struct task *task)
+{
+    if (sched_task_is_rt(task))
+        return;
+
+    if (task->vruntime > list->min_vruntime)
+        list->min_vruntime = task->vruntime;
+}
+
+void __sched_fair_task_account(struct sched_task_list *list, struct task *task, uint64_t runtime_ns, int preempted)
+{
+    __sched_task_dequeue(list, task);
+
+    if (!sched_task_is_rt(task))
+        task->vruntime += runtime_ns * SCHED_NICE_0_WEIGHT / sched_nice_to_weight(task->nice);
+
+    /* A task that went to sleep stays off the runqueue until it is woken, see
+     * __sched_task_woken(). A preempted task has to run again regardless of
+     * its state. */
+    if (!preempted && task->state != TASK_RUNNING)
+        return;
+
+    /* A preempted SCHED_FIFO task stays at the front of its priority, it
+     * only goes to the back when it gives up the CPU */
+    __sched_task_enqueue(list, task, preempted);
+}
+
+#ifdef CONFIG_KERNEL_TESTS
+# include "fair_test.c"
+#endif
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+/*
+ * Tests for fair.c - included directly at the end of fair.c
+ */
+
+#include <protura/types.h>
+#include <protura/mm/kmalloc.h>
+#include <protura/task.h>
+#include <protura/ktest.h>
+
+#define FAIR_TEST_LIST_INIT(name) \
+    { \
+        .list = LIST_HEAD_INIT((name).list), \
+        .rt_queue = LIST_HEAD_INIT((name).rt_queue), \
+        .fair_queue = RB_ROOT_INIT, \
+        .woken = LIST_HEAD_INIT((name).woken), \
+        .dead = LIST_HEAD_INIT((name).dead), \
+    }
+
+/*
+ * Runs the same selection the scheduler does against a private list of fake
+ * tasks, charging each picked task a single slice.
+ */
+static struct task *fair_test_run_slice(struct sched_task_list *list)
+{
+    struct task *t = __sched_task_pick(list);
+
+    if (!t)
+        return NULL;
+
+    __sched_fair_task_account(list, t, SCHED_SLICE_NS, 1);
+
+    return t;
+}
+
+static struct task *fair_test_task_new(struct sched_task_list *list, int nice)
+{
+    struct task *t = kzalloc(sizeof(*t), PAL_KERNEL);
+
+    list_node_init(&t->task_list_node);
+    list_node_init(&t->sched_rt_node);
+    list_node_init(&t->sched_woken_node);
+    t->state = TASK_RUNNING;
+    t->nice = nice;
+
+    list_add_tail(&list->list, &t->task_list_node);
+    __sched_fair_task_add(list, t);
+
+    return t;
+}
+
+static void fair_test_list_clear(struct sched_task_list *list)
+{
+    struct task *t;
+
+    list_foreach_take_entry(&list->list, t, task_list_node) {
+        __sched_task_dequeue(list, t);
+        kfree(t);
+    }
+}
+
+static void fair_share_test(struct ktest *kt)
+{
+    struct sched_task_list list = FAIR_TEST_LIST_INIT(list);
+    int nice1 = KT_ARG(kt, 0, int);
+    int nice2 = KT_ARG(kt, 1, int);
+    uint32_t weight1 = sched_nice_to_weight(nice1);
+    uint32_t weight2 = sched_nice_to_weight(nice2);
+    int total = 20000;
+    int count1 = 0, count2 = 0;
+    int i;
+
+    struct task *t1 = fair_test_task_new(&list, nice1);
+    struct task *t2 = fair_test_task_new(&list, nice2);
+
+    for (i = 0; i < total; i++) {
+        struct task *t = fair_test_run_slice(&list);
+
+        if (t == t1)
+            count1++;
+        else if (t == t2)
+            count2++;
+    }
+
+    ktest_assert_equal(kt, total, count1 + count2);
+
+    /* Each task should get its share of the slices, give or take one slice
+     * for rounding */
+    int expected1 = (uint64_t)total * weight1 / (weight1 + weight2);
+    int diff = count1 - expected1;
+
+    ktest_assert_equal(kt, 1, diff >= -1 && diff <= 1);
+
+    fair_test_list_clear(&list);
+}
+
+static void fair_sleeper_credit_test(struct ktest *kt)
+{
+    struct sched_task_list list = FAIR_TEST_LIST_INIT(list);
+    int max_in_a_row = SCHED_SLEEPER_CREDIT_NS / SCHED_SLICE_NS + 1;
+    int in_a_row = 0;
+    int i;
+
+    struct task *sleeper = fair_test_task_new(&list, 0);
+    fair_test_task_new(&list, 0);
+
+    sleeper->state = TASK_SLEEPING;
+
+    for (i = 0; i < 1000; i++)
+        ktest_assert_notequal(kt, sleeper, fair_test_run_slice(&list));
+
+    /* It isn't left on the runqueue while it sleeps */
+    ktest_assert_equal(kt, 0, flag_test(&sleeper->flags, TASK_FLAG_QUEUED));
+
+    /* After waking, the sleeper gets a small boost, but doesn't get to run
+     * for the entire time it was asleep */
+    sleeper->state = TASK_RUNNING;
+    __sched_task_woken(&list, sleeper);
+
+    while (fair_test_run_slice(&list) == sleeper)
+        in_a_row++;
+
+    ktest_assert_equal(kt, 1, in_a_row > 0 && in_a_row <= max_in_a_row);
+
+    fair_test_list_clear(&list);
+}
+
+static void fair_new_task_test(struct ktest *kt)
+{
+    struct sched_task_list list = FAIR_TEST_LIST_INIT(list);
+    int i;
+
+    struct task *t1 = fair_test_task_new(&list, 0);
+    struct task *t2 = fair_test_task_new(&list, 0);
+
+    for (i = 0; i < 100; i++)
+        fair_test_run_slice(&list);
+
+    /* A new task doesn't get to run ahead of the existing tasks */
+    struct task *t3 = fair_test_task_new(&list, 0);
+
+    ktest_assert_equal(kt, list.min_vruntime + SCHED_SLICE_NS, t3->vruntime);
+
+    ktest_assert_equal(kt, t1, fair_test_run_slice(&list));
+    ktest_assert_equal(kt, t2, fair_test_run_slice(&list));
+    ktest_assert_equal(kt, t3, fair_test_run_slice(&list));
+
+    fair_test_list_clear(&list);
+}
+
+static const struct ktest_unit fair_test_units[] = {
+    KTEST_UNIT("fair-share-test", fair_share_test,
+            (KT_INT(0), KT_INT(0)),
+            (KT_INT(0), KT_INT(1)),
+            (KT_INT(0), KT_INT(5)),
+            (KT_INT(0), KT_INT(19)),
+            (KT_INT(-20), KT_INT(19)),
+            (KT_INT(-5), KT_INT(0)),
+            (KT_INT(10), KT_INT(-10))),
+
+    KTEST_UNIT("fair-sleeper-credit-test", fair_sleeper_credit_test),
+    KTEST_UNIT("fair-new-task-test", fair_new_task_test),
+};
+
+KTEST_MODULE_DEFINE("sched-fair", fair_test_units);
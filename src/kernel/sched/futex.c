@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/list.h>
+#include <protura/initcall.h>
+#include <protura/mutex.h>
+#include <protura/wait.h>
+#include <protura/ktimer.h>
+#include <protura/time.h>
+#include <protura/signal.h>
+#include <protura/scheduler.h>
+#include <protura/task.h>
+#include <protura/futex.h>
+#include <protura/mm/vm.h>
+#include <protura/mm/user_check.h>
+
+/*
+ * Futexes are keyed on the address space and the virtual address of the
+ * futex word. Every waiter sits in one of the futex_buckets, picked by
+ * hashing that key. The bucket's `lock` protects the `waiters` list and each
+ * waiter's `bucket`, `key`, and `woken` fields.
+ *
+ * Waiters sleep on the bucket's wait_queue with `woken` as their condition.
+ * Waking a futex sets `woken` on the matching waiters and then wakes the
+ * bucket's wait_queue, anybody else in the bucket simply goes back to sleep.
+ *
+ * The bucket lock is a mutex rather than a spinlock because we have to read
+ * the futex word from userspace while holding it, which can page fault.
+ */
+#define FUTEX_HASH_SIZE 128
+
+struct futex_key {
+    struct address_space *addrspc;
+    va_t addr;
+};
+
+struct futex_bucket {
+    mutex_t lock;
+    list_head_t waiters;
+    struct wait_queue queue;
+};
+
+struct futex_waiter {
+    list_node_t entry;
+    struct futex_key key;
+    struct futex_bucket *bucket;
+    struct task *task;
+
+    struct ktimer timer;
+
+    unsigned int woken :1;
+    unsigned int timed_out :1;
+};
+
+static struct futex_bucket futex_buckets[FUTEX_HASH_SIZE];
+
+static inline int futex_key_equal(struct futex_key *a, struct futex_key *b)
+{
+    return a->addrspc == b->addrspc && a->addr == b->addr;
+}
+
+static struct futex_bucket *futex_bucket_get(struct futex_key *key)
+{
+    /* Futex words are 4-byte aligned, so the bottom bits are useless. XOR in
+     * the top of the address space pointer to mix a bit before the mod */
+    uintptr_t as = (uintptr_t)key->addrspc;
+    uintptr_t hash = ((uintptr_t)key->addr >> 2) ^ as ^ (as >> 16);
+
+    return futex_buckets + (hash % FUTEX_HASH_SIZE);
+}
+
+static int futex_key_get(struct user_buffer uaddr, struct futex_key *key)
+{
+    if (((uintptr_t)uaddr.ptr & (sizeof(uint32_t) - 1)) != 0)
+        return -EINVAL;
+
+    int ret = user_check_access(uaddr, sizeof(uint32_t));
+    if (ret)
+        return ret;
+
+    key->addrspc = cpu_get_local()->current->addrspc;
+    key->addr = uaddr.ptr;
+    return 0;
+}
+
+/* A requeue can move the waiter to a different bucket while it is not holding
+ * the lock, so we have to verify the bucket after acquiring its lock */
+static void futex_waiter_lock(struct futex_waiter *waiter)
+{
+    while (1) {
+        struct futex_bucket *bucket = waiter->bucket;
+
+        mutex_lock(&bucket->lock);
+        if (bucket == waiter->bucket)
+            return;
+
+        mutex_unlock(&bucket->lock);
+    }
+}
+
+static void futex_waiter_unlock(struct futex_waiter *waiter)
+{
+    mutex_unlock(&waiter->bucket->lock);
+}
+
+static void futex_timer_callback(struct ktimer *timer)
+{
+    struct futex_waiter *waiter = container_of(timer, struct futex_waiter, timer);
+
+    waiter->timed_out = 1;
+    scheduler_task_wake(waiter->task);
+}
+
+static int futex_wait(struct user_buffer uaddr, uint32_t val, struct user_buffer utimeout)
+{
+    struct task *current = cpu_get_local()->current;
+    struct futex_waiter waiter = {
+        .entry = LIST_NODE_INIT(waiter.entry),
+        .task = current,
+        .timer = KTIMER_CALLBACK_INIT(waiter.timer, futex_timer_callback),
+    };
+    uint64_t timeout_ns = 0;
+    uint32_t cur;
+    int ret;
+
+    ret = futex_key_get(uaddr, &waiter.key);
+    if (ret)
+        return ret;
+
+    if (!user_buffer_is_null(utimeout)) {
+        struct timespec timeout;
+
+        ret = user_copy_to_kernel(&timeout, utimeout);
+        if (ret)
+            return ret;
+
+        if (timeout.tv_sec < 0 || timeout.tv_nsec < 0 || timeout.tv_nsec >= NSEC_PER_SEC)
+            return -EINVAL;
+
+        timeout_ns = (uint64_t)timeout.tv_sec * NSEC_PER_SEC + timeout.tv_nsec;
+    }
+
+    waiter.bucket = futex_bucket_get(&waiter.key);
+
+    futex_waiter_lock(&waiter);
+
+    /* Reading the value under the bucket lock is what makes this race-free
+     * against FUTEX_WAKE - a waker always changes the value before taking the
+     * bucket lock to wake us */
+    ret = user_copy_to_kernel(&cur, uaddr);
+    if (ret)
+        goto unlock;
+
+    if (cur != val) {
+        ret = -EAGAIN;
+        goto unlock;
+    }
+
+    list_add_tail(&waiter.bucket->waiters, &waiter.entry);
+
+    if (!user_buffer_is_null(utimeout))
+        timer_add_ns(&waiter.timer, timeout_ns);
+
+    ret = wait_queue_event_intr_cmd(&waiter.bucket->queue, waiter.woken || waiter.timed_out,
+                                    futex_waiter_unlock(&waiter),
+                                    futex_waiter_lock(&waiter));
+
+    if (!user_buffer_is_null(utimeout))
+        timer_cancel(&waiter.timer);
+
+    if (waiter.woken) {
+        ret = 0;
+        goto unlock;
+    }
+
+    /* Woken by a signal or the timeout, we're still in the waiter list */
+    list_del(&waiter.entry);
+
+    if (!ret)
+        ret = -ETIMEDOUT;
+    else
+        ret = -EINTR;
+
+  unlock:
+    futex_waiter_unlock(&waiter);
+    return ret;
+}
+
+/* Wakes up to nr waiters matching key, bucket->lock must be held */
+static int __futex_wake(struct futex_bucket *bucket, struct futex_key *key, int nr)
+{
+    struct futex_waiter *waiter, *nxt;
+    int woken = 0;
+
+    list_foreach_entry_safe(&bucket->waiters, waiter, nxt, entry) {
+        if (woken >= nr)
+            break;
+
+        if (!futex_key_equal(&waiter->key, key))
+            continue;
+
+        list_del(&waiter->entry);
+        waiter->woken = 1;
+        woken++;
+    }
+
+    if (woken)
+        wait_queue_wake(&bucket->queue);
+
+    return woken;
+}
+
+static int futex_wake(struct user_buffer uaddr, int nr)
+{
+    struct futex_key key;
+    int ret = futex_key_get(uaddr, &key);
+    if (ret)
+        return ret;
+
+    struct futex_bucket *bucket = futex_bucket_get(&key);
+
+    using_mutex(&bucket->lock)
+        ret = __futex_wake(bucket, &key, nr);
+
+    return ret;
+}
+
+static void futex_lock_two(struct futex_bucket *b1, struct futex_bucket *b2)
+{
+    /* Always lock in address order to avoid deadlocking with another requeue
+     * going the other direction */
+    if (b1 > b2) {
+        struct futex_bucket *tmp = b1;
+        b1 = b2;
+        b2 = tmp;
+    }
+
+    mutex_lock(&b1->lock);
+    if (b1 != b2)
+        mutex_lock(&b2->lock);
+}
+
+static void futex_unlock_two(struct futex_bucket *b1, struct futex_bucket *b2)
+{
+    mutex_unlock(&b1->lock);
+    if (b1 != b2)
+        mutex_unlock(&b2->lock);
+}
+
+static int futex_requeue(struct user_buffer uaddr, int nr_wake, int nr_requeue, struct user_buffer uaddr2)
+{
+    struct futex_key key1, key2;
+    struct futex_waiter *waiter, *nxt;
+    int requeued = 0;
+    int ret;
+
+    ret = futex_key_get(uaddr, &key1);
+    if (ret)
+        return ret;
+
+    ret = futex_key_get(uaddr2, &key2);
+    if (ret)
+        return ret;
+
+    struct futex_bucket *b1 = futex_bucket_get(&key1);
+    struct futex_bucket *b2 = futex_bucket_get(&key2);
+
+    futex_lock_two(b1, b2);
+
+    ret = __futex_wake(b1, &key1, nr_wake);
+
+    list_foreach_entry_safe(&b1->waiters, waiter, nxt, entry) {
+        if (requeued >= nr_requeue)
+            break;
+
+        if (!futex_key_equal(&waiter->key, &key1))
+            continue;
+
+        waiter->key = key2;
+
+        if (b1 != b2) {
+            list_del(&waiter->entry);
+            list_add_tail(&b2->waiters, &waiter->entry);
+            waiter->bucket = b2;
+        }
+
+        requeued++;
+    }
+
+    /* The requeued waiters are still registered on b1's wait_queue. Waking it
+     * makes them recheck their bucket and register on b2's queue instead */
+    if (requeued && b1 != b2)
+        wait_queue_wake(&b1->queue);
+
+    futex_unlock_two(b1, b2);
+
+    return ret;
+}
+
+int sys_futex(struct user_buffer uaddr, int op, uint32_t val, uintptr_t arg, struct user_buffer uaddr2)
+{
+    switch (op) {
+    case FUTEX_WAIT:
+        return futex_wait(uaddr, val, make_user_buffer(arg));
+
+    case FUTEX_WAKE:
+        return futex_wake(uaddr, (int)val);
+
+    case FUTEX_REQUEUE:
+        return futex_requeue(uaddr, (int)val, (int)arg, uaddr2);
+    }
+
+    return -EINVAL;
+}
+
+static void futex_init(void)
+{
+    int i;
+
+    for (i = 0; i < FUTEX_HASH_SIZE; i++) {
+        mutex_init(&futex_buckets[i].lock);
+        list_head_init(&futex_buckets[i].waiters);
+        wait_queue_init(&futex_buckets[i].queue);
+    }
+}
+initcall_core(futex, futex_init);
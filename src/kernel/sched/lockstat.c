@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/lockstat.h>
+#include <protura/fs/seq_file.h>
+#include <arch/irq.h>
+
+DEFINE_LOCK_CLASS(lockstat_spinlock_class, "spinlock");
+DEFINE_LOCK_CLASS(lockstat_mutex_class, "mutex");
+DEFINE_LOCK_CLASS(lockstat_rwlock_class, "rwlock");
+
+extern struct lock_class __lockstat_start, __lockstat_end;
+
+/*
+ * These are called from within spinlock_acquire() and friends, so they can't
+ * take any locks themselves. The counters are only ever touched with
+ * interrupts off, which is enough since we only run on one CPU.
+ */
+void lockstat_acquired(struct lock_class *class, int contended, uint64_t wait)
+{
+    uint32_t flags = irq_save();
+    irq_disable();
+
+    class->acquisitions++;
+
+    if (contended) {
+        class->contentions++;
+        class->wait_total += wait;
+
+        if (wait > class->wait_max)
+            class->wait_max = wait;
+    }
+
+    irq_restore(flags);
+}
+
+void lockstat_released(struct lock_class *class, uint64_t hold)
+{
+    uint32_t flags = irq_save();
+    irq_disable();
+
+    class->hold_total += hold;
+
+    if (hold > class->hold_max)
+        class->hold_max = hold;
+
+    irq_restore(flags);
+}
+
+static int lockstat_class_count(void)
+{
+    return &__lockstat_end - &__lockstat_start;
+}
+
+/* Offset zero is the header, the classes come after it */
+static int lockstat_seq_start(struct seq_file *seq)
+{
+    if (seq->iter_offset == lockstat_class_count() + 1)
+        flag_set(&seq->flags, SEQ_FILE_DONE);
+
+    return 0;
+}
+
+static int lockstat_seq_render(struct seq_file *seq)
+{
+    struct lock_class class;
+
+    if (seq->iter_offset == 0)
+        return seq_printf(seq, "name\tacquired\tcontended\twait_total\twait_max\thold_total\thold_max\n");
+
+    uint32_t flags = irq_save();
+    irq_disable();
+
+    class = (&__lockstat_start)[seq->iter_offset - 1];
+
+    irq_restore(flags);
+
+    return seq_printf(seq, "%s\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\n",
+            class.name, class.acquisitions, class.contentions,
+            class.wait_total, class.wait_max,
+            class.hold_total, class.hold_max);
+}
+
+static int lockstat_seq_next(struct seq_file *seq)
+{
+    seq->iter_offset++;
+
+    if (seq->iter_offset == lockstat_class_count() + 1)
+        flag_set(&seq->flags, SEQ_FILE_DONE);
+
+    return 0;
+}
+
+static void lockstat_seq_end(struct seq_file *seq)
+{
+
+}
+
+const static struct seq_file_ops lockstat_seq_file_ops = {
+    .start = lockstat_seq_start,
+    .next = lockstat_seq_next,
+    .render = lockstat_seq_render,
+    .end = lockstat_seq_end,
+};
+
+static int lockstat_file_seq_open(struct inode *inode, struct file *filp)
+{
+    return seq_open(filp, &lockstat_seq_file_ops);
+}
+
+const struct file_ops lockstat_file_ops = {
+    .open = lockstat_file_seq_open,
+    .lseek = seq_lseek,
+    .read = seq_read,
+    .release = seq_release,
+};
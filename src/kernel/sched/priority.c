@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/list.h>
+#include <protura/scheduler.h>
+#include <protura/task.h>
+#include <protura/sched.h>
+#include <protura/mm/user_check.h>
+#include "scheduler_internal.h"
+
+static int nice_clamp(int nice)
+{
+    if (nice < NICE_MIN)
+        return NICE_MIN;
+
+    if (nice > NICE_MAX)
+        return NICE_MAX;
+
+    return nice;
+}
+
+/* Anybody can lower the priority of their own tasks, but only root can raise
+ * the priority of a task */
+static int task_can_renice(struct task *current, struct task *t, int nice)
+{
+    uid_t euid = current->creds.euid;
+
+    if (euid == 0)
+        return 0;
+
+    if (t->creds.uid != euid && t->creds.euid != euid)
+        return -EPERM;
+
+    if (nice < t->nice)
+        return -EACCES;
+
+    return 0;
+}
+
+static int task_prio_matches(struct task *t, int which, int who)
+{
+    if (t->state == TASK_DEAD || t->state == TASK_ZOMBIE)
+        return 0;
+
+    switch (which) {
+    case PRIO_PROCESS:
+        return t->pid == who;
+
+    case PRIO_PGRP:
+        return t->pgid == who;
+
+    case PRIO_USER:
+        return t->creds.uid == who;
+    }
+
+    return 0;
+}
+
+static int prio_resolve_who(struct task *current, int which, int *who)
+{
+    if (*who)
+        return 0;
+
+    switch (which) {
+    case PRIO_PROCESS:
+        *who = current->pid;
+        return 0;
+
+    case PRIO_PGRP:
+        *who = current->pgid;
+        return 0;
+
+    case PRIO_USER:
+        *who = current->creds.uid;
+        return 0;
+    }
+
+    return -EINVAL;
+}
+
+int sys_nice(int inc)
+{
+    struct task *current = cpu_get_local()->current;
+    int nice = nice_clamp(current->nice + inc);
+
+    if (nice < current->nice && current->creds.euid != 0)
+        return -EPERM;
+
+    current->nice = nice;
+    return 0;
+}
+
+int sys_setpriority(int which, int who, int prio)
+{
+    struct task *current = cpu_get_local()->current;
+    struct task *t;
+    int found = 0;
+    int ret;
+
+    ret = prio_resolve_who(current, which, &who);
+    if (ret)
+        return ret;
+
+    prio = nice_clamp(prio);
+
+    using_spinlock(&ktasks.lock) {
+        list_foreach_entry(&ktasks.list, t, task_list_node) {
+            if (!task_prio_matches(t, which, who))
+                continue;
+
+            found = 1;
+
+            int err = task_can_renice(current, t, prio);
+            if (err) {
+                ret = err;
+                continue;
+            }
+
+            t->nice = prio;
+        }
+    }
+
+    if (!found)
+        return -ESRCH;
+
+    return ret;
+}
+
+int sys_getpriority(int which, int who)
+{
+    struct task *current = cpu_get_local()->current;
+    struct task *t;
+    int nice = NICE_MAX + 1;
+    int ret;
+
+    ret = prio_resolve_who(current, which, &who);
+    if (ret)
+        return ret;
+
+    /* With multiple matching tasks, the highest priority is returned */
+    using_spinlock(&ktasks.lock)
+        list_foreach_entry(&ktasks.list, t, task_list_node)
+            if (task_prio_matches(t, which, who) && t->nice < nice)
+                nice = t->nice;
+
+    if (nice > NICE_MAX)
+        return -ESRCH;
+
+    return __kNICE_TO_PRIO(nice);
+}
+
+int sys_sched_setscheduler(pid_t pid, int policy, struct user_buffer param)
+{
+    struct task *current = cpu_get_local()->current;
+    struct sched_param kparam;
+    struct task *t;
+    int ret;
+
+    ret = user_copy_to_kernel(&kparam, param);
+    if (ret)
+        return ret;
+
+    if (pid < 0)
+        return -EINVAL;
+
+    if (pid == 0)
+        pid = current->pid;
+
+    /* Only root can make a task real-time */
+    if (policy != SCHED_OTHER && current->creds.euid != 0)
+        return -EPERM;
+
+    t = scheduler_task_get(pid);
+    if (!t)
+        return -ESRCH;
+
+    ret = task_can_renice(current, t, t->nice);
+    if (!ret)
+        ret = __sched_task_set_policy(&ktasks, t, policy, kparam.sched_priority);
+
+    scheduler_task_put(t);
+
+    return ret;
+}
+
+int sys_sched_getscheduler(pid_t pid)
+{
+    struct task *current = cpu_get_local()->current;
+    struct task *t;
+    int policy;
+
+    if (pid < 0)
+        return -EINVAL;
+
+    if (pid == 0)
+        return current->sched_policy;
+
+    t = scheduler_task_get(pid);
+    if (!t)
+        return -ESRCH;
+
+    policy = t->sched_policy;
+
+    scheduler_task_put(t);
+
+    return policy;
+}
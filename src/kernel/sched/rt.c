@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/list.h>
+#include <protura/scheduler.h>
+#include <protura/task.h>
+#include <protura/sched.h>
+#include "scheduler_internal.h"
+
+/*
+ * SCHED_FIFO real-time scheduling
+ *
+ * SCHED_FIFO tasks sit in ktasks.rt_queue, sorted by priority. The scheduler
+ * checks it before the fair queue, so it will always pick a runnable
+ * SCHED_FIFO task before any SCHED_OTHER task. They don't have a timeslice:
+ * A SCHED_FIFO task that gets preempted goes back to the front of its
+ * priority level and is picked again, so it runs until it sleeps or yields,
+ * at which point it goes to the back of its priority level.
+ *
+ * This is intended for kernel threads that have to respond quickly, like the
+ * network receive and disk completion workqueues. Waking a SCHED_FIFO task
+ * also requests a reschedule, so it runs at the end of the current interrupt
+ * rather than at the next timer tick.
+ */
+
+void __sched_rt_enqueue(struct sched_task_list *list, struct task *task, int at_head)
+{
+    struct task *t;
+
+    list_foreach_entry(&list->rt_queue, t, sched_rt_node) {
+        if (t->rt_priority < task->rt_priority)
+            break;
+
+        if (at_head && t->rt_priority == task->rt_priority)
+            break;
+    }
+
+    list_add_before(&t->sched_rt_node, &task->sched_rt_node);
+}
+
+void __sched_rt_dequeue(struct sched_task_list *list, struct task *task)
+{
+    list_del(&task->sched_rt_node);
+}
+
+int __sched_task_set_policy(struct sched_task_list *list, struct task *t, int policy, int priority)
+{
+    int queued;
+
+    switch (policy) {
+    case SCHED_OTHER:
+        if (priority != 0)
+            return -EINVAL;
+        break;
+
+    case SCHED_FIFO:
+        if (priority < SCHED_PRIO_MIN || priority > SCHED_PRIO_MAX)
+            return -EINVAL;
+        break;
+
+    default:
+        return -EINVAL;
+    }
+
+    /* A task that isn't on the runqueue is put on the right queue when it is
+     * woken */
+    queued = flag_test(&t->flags, TASK_FLAG_QUEUED);
+
+    if (queued)
+        __sched_task_dequeue(list, t);
+
+    t->sched_policy = policy;
+    t->rt_priority = priority;
+
+    /* Its vruntime is stale after running as a real-time task, so it gets
+     * placed like a new task */
+    if (queued)
+        __sched_fair_task_add(list, t);
+
+    return 0;
+}
+
+int sched_task_set_policy(struct task *t, int policy, int priority)
+{
+    using_spinlock(&ktasks.lock)
+        return __sched_task_set_policy(&ktasks, t, policy, priority);
+}
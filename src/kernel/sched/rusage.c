@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/string.h>
+#include <protura/time.h>
+#include <protura/task.h>
+#include <protura/resource.h>
+#include <protura/mm/user_check.h>
+#include <arch/irq.h>
+#include <arch/timer.h>
+
+/*
+ * The usage of a task is only ever changed by the task itself (or by the
+ * scheduler and interrupt code running on its behalf), but it can be read by
+ * anybody, so every change and every read is done with interrupts off. That
+ * keeps the 64-bit counters from being read half-updated, since we only run
+ * on one CPU.
+ *
+ * timer_get_ns() interpolates between timer ticks using the TSC when it can,
+ * so short trips into the kernel are still charged accurately.
+ */
+static uint64_t task_rusage_charge(struct task *t)
+{
+    uint64_t now = timer_get_ns();
+    uint64_t delta = (now > t->usage_mark)? now - t->usage_mark: 0;
+
+    t->usage_mark = now;
+    return delta;
+}
+
+void task_rusage_enter_kernel(struct task *t)
+{
+    t->usage.utime_ns += task_rusage_charge(t);
+}
+
+void task_rusage_exit_kernel(struct task *t)
+{
+    t->usage.stime_ns += task_rusage_charge(t);
+}
+
+void task_rusage_switch_in(struct task *t)
+{
+    t->usage_mark = timer_get_ns();
+}
+
+void task_rusage_switch_out(struct task *t, int preempted)
+{
+    t->usage.stime_ns += task_rusage_charge(t);
+
+    if (preempted)
+        t->usage.nivcsw++;
+    else
+        t->usage.nvcsw++;
+}
+
+void task_rusage_fault(struct task *t, int major)
+{
+    irq_flags_t flags = irq_save();
+    irq_disable();
+
+    if (major)
+        t->usage.majflt++;
+    else
+        t->usage.minflt++;
+
+    irq_restore(flags);
+}
+
+void task_rusage_io(struct task *t, uint64_t read_bytes, uint64_t write_bytes)
+{
+    irq_flags_t flags = irq_save();
+    irq_disable();
+
+    t->usage.read_bytes += read_bytes;
+    t->usage.write_bytes += write_bytes;
+
+    irq_restore(flags);
+}
+
+static void task_rusage_add(struct task_rusage *dest, const struct task_rusage *src)
+{
+    dest->utime_ns += src->utime_ns;
+    dest->stime_ns += src->stime_ns;
+    dest->minflt += src->minflt;
+    dest->majflt += src->majflt;
+    dest->nvcsw += src->nvcsw;
+    dest->nivcsw += src->nivcsw;
+    dest->read_bytes += src->read_bytes;
+    dest->write_bytes += src->write_bytes;
+}
+
+void task_rusage_reap(struct task *parent, struct task *child)
+{
+    irq_flags_t flags = irq_save();
+    irq_disable();
+
+    task_rusage_add(&parent->child_usage, &child->usage);
+    task_rusage_add(&parent->child_usage, &child->child_usage);
+
+    irq_restore(flags);
+}
+
+void task_rusage_get(struct task *t, struct task_rusage *usage, struct task_rusage *child_usage)
+{
+    irq_flags_t flags = irq_save();
+    irq_disable();
+
+    /* The current task is in the kernel right now, anything since the last
+     * boundary hasn't been charged yet */
+    if (t == cpu_get_local()->current)
+        task_rusage_exit_kernel(t);
+
+    if (usage)
+        *usage = t->usage;
+
+    if (child_usage)
+        *child_usage = t->child_usage;
+
+    irq_restore(flags);
+}
+
+static void ns_to_rusage_timeval(uint64_t ns, struct __krusage_timeval *tv)
+{
+    tv->tv_sec = ns / NSEC_PER_SEC;
+    tv->tv_usec = (ns % NSEC_PER_SEC) / NSEC_PER_USEC;
+}
+
+void task_rusage_to_user(const struct task_rusage *usage, struct __krusage *ru)
+{
+    memset(ru, 0, sizeof(*ru));
+
+    ns_to_rusage_timeval(usage->utime_ns, &ru->ru_utime);
+    ns_to_rusage_timeval(usage->stime_ns, &ru->ru_stime);
+
+    ru->ru_minflt = usage->minflt;
+    ru->ru_majflt = usage->majflt;
+    ru->ru_nvcsw = usage->nvcsw;
+    ru->ru_nivcsw = usage->nivcsw;
+    ru->ru_read_bytes = usage->read_bytes;
+    ru->ru_write_bytes = usage->write_bytes;
+}
+
+int sys_getrusage(int who, struct user_buffer buf)
+{
+    struct task *current = cpu_get_local()->current;
+    struct task_rusage usage;
+    struct __krusage ru;
+
+    switch (who) {
+    case RUSAGE_SELF:
+        task_rusage_get(current, &usage, NULL);
+        break;
+
+    case RUSAGE_CHILDREN:
+        task_rusage_get(current, NULL, &usage);
+        break;
+
+    default:
+        return -EINVAL;
+    }
+
+    task_rusage_to_user(&usage, &ru);
+
+    return user_copy_from_kernel(buf, ru);
+}
+
+/* Returns the current time in the same clock ticks as sys_clock() */
+int sys_times(struct user_buffer buf)
+{
+    struct task *current = cpu_get_local()->current;
+    struct task_rusage usage, child_usage;
+    struct __ktms tms;
+    int ret;
+
+    task_rusage_get(current, &usage, &child_usage);
+
+    tms.tms_utime = usage.utime_ns / TIMER_NSEC_PER_TICK;
+    tms.tms_stime = usage.stime_ns / TIMER_NSEC_PER_TICK;
+    tms.tms_cutime = child_usage.utime_ns / TIMER_NSEC_PER_TICK;
+    tms.tms_cstime = child_usage.stime_ns / TIMER_NSEC_PER_TICK;
+
+    if (!user_buffer_is_null(buf)) {
+        ret = user_copy_from_kernel(buf, tms);
+        if (ret)
+            return ret;
+    }
+
+    return sys_clock();
+}
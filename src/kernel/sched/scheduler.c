@@ -16,6 +16,7 @@
 #include <protura/mm/memlayout.h>
 #include <protura/mm/palloc.h>
 #include <protura/signal.h>
+#include <protura/kstat.h>
 
 #include <arch/kernel_task.h>
 #include <arch/drivers/pic8259_timer.h>
@@ -28,9 +29,19 @@
 #include <protura/scheduler.h>
 #include "scheduler_internal.h"
 
+DEFINE_TRACEPOINT(sched_wake, "pid=%d");
+DEFINE_TRACEPOINT(sched_switch, "next=%d");
+DEFINE_TRACEPOINT(sched_switch_out, "pid=%d state=%d preempted=%d ran_us=%u");
+DEFINE_TRACEPOINT(task_free, "pid=%d");
+
+DEFINE_LOCK_CLASS(ktasks_lock_class, "ktasks.lock");
+
 struct sched_task_list ktasks = {
-    .lock = SPINLOCK_INIT(),
+    .lock = SPINLOCK_INIT_CLASS(ktasks_lock_class),
     .list = LIST_HEAD_INIT(ktasks.list),
+    .rt_queue = LIST_HEAD_INIT(ktasks.rt_queue),
+    .fair_queue = RB_ROOT_INIT,
+    .woken = LIST_HEAD_INIT(ktasks.woken),
     .dead = LIST_HEAD_INIT(ktasks.dead),
     .next_pid = 1,
 };
@@ -58,21 +69,117 @@ void scheduler_task_entry(void)
     spinlock_release(&ktasks.lock);
 }
 
+void __sched_task_enqueue(struct sched_task_list *list, struct task *task, int at_head)
+{
+    flag_set(&task->flags, TASK_FLAG_QUEUED);
+
+    if (sched_task_is_rt(task))
+        __sched_rt_enqueue(list, task, at_head);
+    else
+        __sched_fair_enqueue(list, task);
+}
+
+void __sched_task_dequeue(struct sched_task_list *list, struct task *task)
+{
+    if (list_node_is_in_list(&task->sched_woken_node))
+        list_del(&task->sched_woken_node);
+
+    if (!flag_test(&task->flags, TASK_FLAG_QUEUED))
+        return;
+
+    flag_clear(&task->flags, TASK_FLAG_QUEUED);
+
+    if (sched_task_is_rt(task))
+        __sched_rt_dequeue(list, task);
+    else
+        __sched_fair_dequeue(list, task);
+}
+
+/* A task that is still on the runqueue doesn't need to go on 'woken', the
+ * scheduler will see it's TASK_RUNNING when it gets to it */
+void __sched_task_woken(struct sched_task_list *list, struct task *task)
+{
+    if (flag_test(&task->flags, TASK_FLAG_QUEUED))
+        return;
+
+    if (!list_node_is_in_list(&task->sched_woken_node))
+        list_add_tail(&list->woken, &task->sched_woken_node);
+}
+
+void scheduler_task_queue_woken(struct task *task)
+{
+    irq_flags_t flags = irq_save();
+    irq_disable();
+
+    __sched_task_woken(&ktasks, task);
+
+    irq_restore(flags);
+}
+
+static int __sched_task_can_run(struct task *t)
+{
+    /* If a task was preempted, then we start it again, regardless of it's
+     * current state. It's possible they aren't actually TASK_RUNNING, which
+     * is why this check is needed. */
+    if (flag_test(&t->flags, TASK_FLAG_PREEMPTED)) {
+        flag_clear(&t->flags, TASK_FLAG_PREEMPTED);
+        return 1;
+    }
+
+    return t->state == TASK_RUNNING;
+}
+
+/* Returns NULL if there is nothing to run.
+ *
+ * Tasks only go to sleep while they're running, and they're taken off the
+ * runqueue when they switch out, so it's rare to find one here that can't
+ * run. If we do, it's dropped from the runqueue until it's woken. */
+struct task *__sched_task_pick(struct sched_task_list *list)
+{
+    struct task *t;
+    rb_node_t *node;
+
+    list_foreach_take_entry(&list->woken, t, sched_woken_node)
+        __sched_fair_task_wake(list, t);
+
+    while (!list_empty(&list->rt_queue)) {
+        t = list_first_entry(&list->rt_queue, struct task, sched_rt_node);
+
+        if (__sched_task_can_run(t))
+            return t;
+
+        __sched_task_dequeue(list, t);
+    }
+
+    while ((node = rb_first(&list->fair_queue))) {
+        t = rb_entry(node, struct task, sched_fair_node);
+
+        if (__sched_task_can_run(t)) {
+            __sched_fair_task_pick(list, t);
+            return t;
+        }
+
+        __sched_task_dequeue(list, t);
+    }
+
+    return NULL;
+}
+
 void scheduler_task_add(struct task *task)
 {
-    /* Add this task to the *end* of the list.
-     *
-     * This prevents an interesting issue that can arise from a very-quickly
-     * forking process preventing other processes from running. */
-    using_spinlock(&ktasks.lock)
+    using_spinlock(&ktasks.lock) {
         list_add_tail(&ktasks.list, &task->task_list_node);
+        __sched_fair_task_add(&ktasks, task);
+    }
 }
 
 void scheduler_task_remove(struct task *task)
 {
     /* Remove 'task' from the list of tasks to schedule. */
-    using_spinlock(&ktasks.lock)
+    using_spinlock(&ktasks.lock) {
         list_del(&task->task_list_node);
+        __sched_task_dequeue(&ktasks, task);
+    }
 }
 
 /* Interrupt state is preserved across an arch_context_switch */
@@ -112,6 +219,7 @@ void scheduler_task_mark_dead(struct task *t)
     t->state = TASK_DEAD;
 
     using_spinlock(&ktasks.lock) {
+        __sched_task_dequeue(&ktasks, t);
         list_del(&t->task_list_node);
         list_add(&ktasks.dead, &t->task_list_node);
     }
@@ -165,6 +273,7 @@ static void send_sig(struct task *t, int signal, int force)
         if (t->state == TASK_STOPPED) {
             t->ret_signal = TASK_SIGNAL_CONT;
             t->state = TASK_RUNNING;
+            __scheduler_task_woken(t);
             notify_parent = 1;
         }
 
@@ -178,8 +287,10 @@ static void send_sig(struct task *t, int signal, int force)
             || signal == SIGTTOU || signal == SIGTTIN)
         SIGSET_UNSET(&t->sig_pending, SIGCONT);
 
-    if (signal == SIGKILL && t->state == TASK_STOPPED)
+    if (signal == SIGKILL && t->state == TASK_STOPPED) {
         t->state = TASK_RUNNING;
+        __scheduler_task_woken(t);
+    }
 
     SIGSET_SET(&t->sig_pending, signal);
     if (force)
@@ -266,6 +377,7 @@ void scheduler_task_put(struct task *t)
 void scheduler(void)
 {
     struct task *t;
+    uint64_t start_ns, end_ns;
 
     /* We acquire but don't release this lock. This works because we
      * task_switch into other tasks, and those tasks will release the spinlock
@@ -276,51 +388,44 @@ void scheduler(void)
     while (1) {
         /* First we handle any dead tasks and clean them up. */
         list_foreach_take_entry(&ktasks.dead, t, task_list_node) {
-            kp(KP_TRACE, "Task: %p\n", t);
-            kp(KP_TRACE, "freeing dead task %p\n", t->name);
+            trace(task_free, t->pid);
             task_free(t);
         }
 
-        /* Select the first RUNNABLE task in the schedule list.
-         *
-         * We do a simple foreach over every task in the list to check them.
-         * After looping, we use list_ptr_is_head() to check if we reached the
-         * end of the list or not - If we did, then we use the kidle task for
-         * this cpu as our task.
-         *
-         * If we didn't reach the end of the list, then we found a task to run.
-         * We use 'list_new_last' to rotate the list such that the node after
-         * our selected task is the new head of the task list. This way, we
-         * keep the same ordering of tasks, but also ensure that the next time
-         * we schedule a task, we'll start with the task right after the one we
-         * just scheduled. */
-        list_foreach_entry(&ktasks.list, t, task_list_node) {
-            /* If a task was preempted, then we start it again, regardless of
-             * it's current state. It's possible they aren't actually
-             * TASK_RUNNING, which is why this check is needed. */
-            if (flag_test(&t->flags, TASK_FLAG_PREEMPTED)) {
-                flag_clear(&t->flags, TASK_FLAG_PREEMPTED);
-                break;
-            }
+        /* Select the highest priority real-time task, or the task that has
+         * had the least (weighted) CPU time. */
+        t = __sched_task_pick(&ktasks);
 
-            if (t->state == TASK_RUNNING)
-                break;
-        }
-
-        if (list_ptr_is_head(&ktasks.list, &t->task_list_node)) {
-            /* We execute this cpu's idle task if we didn't find a task to run */
+        /* We execute this cpu's idle task if we didn't find a task to run */
+        if (!t)
             t = cpu_get_local()->kidle;
-        } else {
-            list_new_last(&ktasks.list, &t->task_list_node);
-        }
 
         /* Set the running flag as we prepare to enter this task */
         flag_set(&t->flags, TASK_FLAG_RUNNING);
         cpu_get_local()->current = t;
 
+        trace(sched_switch, t->pid);
+
+        start_ns = timer_get_ns();
+        task_rusage_switch_in(t);
+
+        kstat_inc(KSTAT_CONTEXT_SWITCHES);
         task_switch(&cpu_get_local()->scheduler, t);
 
+        task_rusage_switch_out(t, flag_test(&t->flags, TASK_FLAG_PREEMPTED));
+        end_ns = timer_get_ns();
+
+        trace(sched_switch_out, t->pid, t->state, flag_test(&t->flags, TASK_FLAG_PREEMPTED),
+              (uint32_t)((end_ns - start_ns) / 1000));
+
         cpu_get_local()->current = NULL;
         flag_clear(&t->flags, TASK_FLAG_RUNNING);
+
+        /* Charge the task for the time it ran and move it to its new place in
+         * the runqueue. Dead tasks and kidle aren't on the runqueue, and are
+         * skipped. */
+        if (flag_test(&t->flags, TASK_FLAG_QUEUED))
+            __sched_fair_task_account(&ktasks, t, (end_ns > start_ns)? end_ns - start_ns: 0,
+                                      flag_test(&t->flags, TASK_FLAG_PREEMPTED));
     }
 }
@@ -3,7 +3,23 @@
 
 /* ktasks is the current list of tasks the scheduler is holding.
  *
- * 'list' is the current list of struct task tasks that the scheduler could schedule.
+ * 'list' is every struct task the scheduler knows about, in no particular
+ *      order, whether it is runnable or not. It is used for looking up tasks.
+ *
+ * 'rt_queue' and 'fair_queue' make up the runqueue, the tasks that could be
+ *      scheduled, see __sched_task_pick().
+ *      - 'rt_queue' holds the SCHED_FIFO tasks, sorted by priority, see rt.c.
+ *      - 'fair_queue' holds the rest, ordered by each task's 'vruntime', see
+ *        fair.c.
+ *
+ *      A task that switches out while it is sleeping or stopped is taken off
+ *      the runqueue, so the scheduler never has to walk past it.
+ *
+ * 'woken' holds tasks that were woken after being taken off the runqueue.
+ *      Wake-ups can happen from interrupts and with 'lock' already held, so
+ *      they can't take 'lock' to put the task back. Instead 'woken' is only
+ *      touched with interrupts disabled, and the scheduler moves the tasks
+ *      back onto the runqueue the next time it picks a task.
  *
  * 'dead' is a list of tasks that have been killed and need to be cleaned up.
  *      - The scheduler handles this because a task can't clean itself up from
@@ -11,6 +27,9 @@
  *
  * 'next_pid' is the next pid to assign to a new 'struct task'.
  *
+ * 'min_vruntime' only ever increases, and tracks the 'vruntime' of the most
+ *      recently picked task. New and woken tasks are placed relative to it.
+ *
  * 'lock' is a spinlock that needs to be held when you modify the list of tasks.
  *
  * Note that the locking is a little tricky to understand. In some cases, a
@@ -31,11 +50,39 @@ struct sched_task_list {
     struct spinlock lock;
     list_head_t list;
 
+    list_head_t rt_queue;
+    rb_root_t fair_queue;
+    list_head_t woken;
+
     list_head_t dead;
 
     pid_t next_pid;
+
+    uint64_t min_vruntime;
 };
 
 extern struct sched_task_list ktasks;
 
+static inline int sched_task_is_rt(struct task *t)
+{
+    return t->sched_policy == SCHED_FIFO;
+}
+
+/* These must be called with the sched_task_list lock held */
+void __sched_task_enqueue(struct sched_task_list *, struct task *, int at_head);
+void __sched_task_dequeue(struct sched_task_list *, struct task *);
+void __sched_task_woken(struct sched_task_list *, struct task *);
+struct task *__sched_task_pick(struct sched_task_list *);
+
+void __sched_fair_enqueue(struct sched_task_list *, struct task *);
+void __sched_fair_dequeue(struct sched_task_list *, struct task *);
+void __sched_fair_task_add(struct sched_task_list *, struct task *);
+void __sched_fair_task_wake(struct sched_task_list *, struct task *);
+void __sched_fair_task_pick(struct sched_task_list *, struct task *);
+void __sched_fair_task_account(struct sched_task_list *, struct task *, uint64_t runtime_ns, int preempted);
+
+void __sched_rt_enqueue(struct sched_task_list *, struct task *, int at_head);
+void __sched_rt_dequeue(struct sched_task_list *, struct task *);
+int __sched_task_set_policy(struct sched_task_list *, struct task *, int policy, int priority);
+
 #endif
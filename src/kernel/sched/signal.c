@@ -65,7 +65,7 @@ int sys_sigpending(struct user_buffer set)
 int sys_sigaction(int signum, struct user_buffer act, struct user_buffer oldact)
 {
     int entry = signum - 1;
-    struct sigaction *action = cpu_get_local()->current->sig_actions + entry;
+    struct sigaction *action = cpu_get_local()->current->sighand->actions + entry;
     int ret;
 
     if (signum < 1 || signum > NSIG)
@@ -98,7 +98,7 @@ int sys_sigaction(int signum, struct user_buffer act, struct user_buffer oldact)
 sighandler_t sys_signal(int signum, sighandler_t handler)
 {
     int entry = signum - 1;
-    struct sigaction *action = cpu_get_local()->current->sig_actions + entry;
+    struct sigaction *action = cpu_get_local()->current->sighand->actions + entry;
     sighandler_t old_handler;
 
     if (signum < 1 || signum > NSIG)
@@ -37,7 +37,7 @@ static void sleeper_callback(struct ktimer *timer)
     scheduler_task_wake(t);
 }
 
-static int sleeper_inner_ms(int ms, int check_signals)
+static int sleeper_inner_ns(uint64_t ns, int check_signals)
 {
     struct task *current = cpu_get_local()->current;
 
@@ -46,7 +46,7 @@ static int sleeper_inner_ms(int ms, int check_signals)
         .task = current,
     };
 
-    timer_add(&sleeper.timer, ms);
+    timer_add_ns(&sleeper.timer, ns);
 
     while (1) {
         if (check_signals)
@@ -72,12 +72,12 @@ static int sleeper_inner_ms(int ms, int check_signals)
 
 int task_sleep_ms(int ms)
 {
-    return sleeper_inner_ms(ms, 0);
+    return sleeper_inner_ns((uint64_t)ms * NSEC_PER_MSEC, 0);
 }
 
 int task_sleep_intr_ms(int ms)
 {
-    return sleeper_inner_ms(ms, 1);
+    return sleeper_inner_ns((uint64_t)ms * NSEC_PER_MSEC, 1);
 }
 
 int sys_sleep(int seconds)
@@ -87,10 +87,7 @@ int sys_sleep(int seconds)
 
 int sys_usleep(useconds_t useconds)
 {
-    /*
-     * This rounds up if the value is not an exact millisecond value
-     * This is necessary to ensure we sleep for *at least* useconds
-     */
-    useconds_t ms = (useconds + 999) / 1000;
-    return task_sleep_intr_ms(ms);
+    /* The ktimer rounds the deadline up to the next tick, so we're guaranteed
+     * to sleep for *at least* useconds */
+    return sleeper_inner_ns((uint64_t)useconds * NSEC_PER_USEC, 1);
 }
@@ -24,6 +24,10 @@
 #include <protura/wait.h>
 #include <protura/signal.h>
 #include <protura/task_api.h>
+#include <protura/uinfo.h>
+#include <protura/sched.h>
+#include <protura/mm/user_check.h>
+#include <protura/trace.h>
 
 #include <arch/spinlock.h>
 #include <arch/fake_task.h>
@@ -38,8 +42,15 @@
 #include <arch/cpu.h>
 #include <arch/task.h>
 
+DEFINE_TRACEPOINT(task_new, "pid=%d");
+DEFINE_TRACEPOINT(task_zombie, "pid=%d parent=%d");
+
 #define KERNEL_STACK_PAGES 2
 
+/* Size of the user stacks allocated by clone() for tasks sharing an
+ * address_space */
+#define CLONE_STACK_PAGES 64
+
 static atomic_t total_tasks = ATOMIC_INIT(0);
 
 const char *task_states[] = {
@@ -66,11 +77,141 @@ void task_print(char *buf, size_t size, struct task *task)
                         );
 }
 
+static struct task_files *task_files_new(void)
+{
+    struct task_files *files = kzalloc(sizeof(*files), PAL_KERNEL);
+
+    atomic_init(&files->refs, 1);
+    return files;
+}
+
+struct task_files *task_files_dup(struct task_files *files)
+{
+    atomic_inc(&files->refs);
+    return files;
+}
+
+void task_files_put(struct task_files *files)
+{
+    int i;
+
+    if (!atomic_dec_and_test(&files->refs))
+        return;
+
+    for (i = 0; i < NOFILE; i++) {
+        if (files->fds[i]) {
+            kp(KP_TRACE, "closing file %d\n", i);
+            vfs_close(files->fds[i]);
+        }
+    }
+
+    kfree(files);
+}
+
+static void task_files_copy(struct task_files *new, struct task_files *old)
+{
+    int i;
+
+    for (i = 0; i < NOFILE; i++) {
+        struct file *filp = old->fds[i];
+
+        /* Skip entries that are currently being assigned */
+        if (filp && (intptr_t)filp != -1)
+            new->fds[i] = file_dup(filp);
+    }
+
+    new->close_on_exec = old->close_on_exec;
+}
+
+static struct task_fs *task_fs_new(void)
+{
+    struct task_fs *fs = kzalloc(sizeof(*fs), PAL_KERNEL);
+
+    atomic_init(&fs->refs, 1);
+    spinlock_init(&fs->lock);
+    return fs;
+}
+
+struct task_fs *task_fs_dup(struct task_fs *fs)
+{
+    atomic_inc(&fs->refs);
+    return fs;
+}
+
+void task_fs_put(struct task_fs *fs)
+{
+    if (!atomic_dec_and_test(&fs->refs))
+        return;
+
+    if (fs->cwd)
+        inode_put(fs->cwd);
+
+    kfree(fs);
+}
+
+static struct task_sighand *task_sighand_new(void)
+{
+    struct task_sighand *sighand = kzalloc(sizeof(*sighand), PAL_KERNEL);
+
+    atomic_init(&sighand->refs, 1);
+    return sighand;
+}
+
+struct task_sighand *task_sighand_dup(struct task_sighand *sighand)
+{
+    atomic_inc(&sighand->refs);
+    return sighand;
+}
+
+void task_sighand_put(struct task_sighand *sighand)
+{
+    if (atomic_dec_and_test(&sighand->refs))
+        kfree(sighand);
+}
+
+int task_sighand_unshare(struct task *t)
+{
+    struct task_sighand *old = t->sighand;
+
+    if (atomic_get(&old->refs) == 1)
+        return 0;
+
+    struct task_sighand *new = task_sighand_new();
+    if (!new)
+        return -ENOMEM;
+
+    memcpy(new->actions, old->actions, sizeof(new->actions));
+
+    t->sighand = new;
+    task_sighand_put(old);
+    return 0;
+}
+
+int task_files_unshare(struct task *t)
+{
+    struct task_files *old = t->files;
+
+    if (atomic_get(&old->refs) == 1)
+        return 0;
+
+    struct task_files *new = task_files_new();
+    if (!new)
+        return -ENOMEM;
+
+    task_files_copy(new, old);
+
+    t->files = new;
+    task_files_put(old);
+    return 0;
+}
+
 void task_init(struct task *task)
 {
     memset(task, 0, sizeof(*task));
 
     list_node_init(&task->task_list_node);
+    list_node_init(&task->sched_rt_node);
+    list_node_init(&task->sched_woken_node);
     list_node_init(&task->task_sibling_list);
     list_head_init(&task->task_children);
     wait_queue_node_init(&task->wait);
@@ -81,6 +222,10 @@ void task_init(struct task *task)
     task->addrspc = kmalloc(sizeof(*task->addrspc), PAL_KERNEL);
     address_space_init(task->addrspc);
 
+    task->files = task_files_new();
+    task->fs = task_fs_new();
+    task->sighand = task_sighand_new();
+
     task->pid = scheduler_next_pid();
 
     task->state = TASK_RUNNING;
@@ -92,7 +237,7 @@ void task_init(struct task *task)
 
     arch_task_init(task);
 
-    kp(KP_TRACE, "Created task %d\n", task->pid);
+    trace(task_new, task->pid);
 }
 
 /* Initializes a new allocated task */
@@ -154,7 +299,7 @@ struct task *task_user_new_exec(const char *exe)
 
     arch_task_setup_stack_user_with_exec(t, exe);
 
-    t->cwd = inode_dup(ino_root);
+    t->fs->cwd = inode_dup(ino_root);
 
     return t;
 }
@@ -173,12 +318,69 @@ struct task *task_user_new(void)
     return t;
 }
 
-/* Creates a new processes that is a copy of 'parent'.
+/* Allocates a user stack for a task sharing its address_space, and sets it up
+ * to start executing `entry` with `arg` as its argument.
+ *
+ * The new stack is in the parent's address_space, which is the current one,
+ * so we can just write to it like any other userspace memory */
+static int task_clone_setup_stack(struct task *new, va_t entry, va_t arg)
+{
+    struct address_space *addrspc = new->addrspc;
+    struct vm_map *stack;
+    va_t sp;
+    int ret = 0;
+
+    stack = kmalloc(sizeof(*stack), PAL_KERNEL);
+    if (!stack)
+        return -ENOMEM;
+
+    vm_map_init(stack);
+
+    flag_set(&stack->flags, VM_MAP_READ);
+    flag_set(&stack->flags, VM_MAP_WRITE);
+
+    using_mutex(&addrspc->lock) {
+        ret = address_space_find_region(addrspc, (CLONE_STACK_PAGES + 1) * PG_SIZE, &stack->addr);
+        if (ret)
+            break;
+
+        /* Leave the bottom page unmapped as a guard page */
+        stack->addr.start += PG_SIZE;
+        address_space_vm_map_add(addrspc, stack);
+    }
+
+    if (ret) {
+        kfree(stack);
+        return ret;
+    }
+
+    new->user_stack = stack;
+
+    /* Entry is called like a regular function taking `arg`. The return
+     * address is NULL, so returning from it faults rather than running off
+     * into garbage - threads have to call exit() */
+    sp = stack->addr.end - sizeof(uint32_t) * 2;
+
+    ret = user_copy_from_kernel(make_user_buffer(sp + sizeof(uint32_t)), (uint32_t)arg);
+    if (ret)
+        return ret;
+
+    ret = user_copy_from_kernel(make_user_buffer(sp), (uint32_t)0);
+    if (ret)
+        return ret;
+
+    irq_frame_set_stack(new->context.frame, sp);
+    irq_frame_set_ip(new->context.frame, entry);
+    return 0;
+}
+
+/* Creates a new task that is a copy of 'parent', sharing the parts of it
+ * selected by `clone_flags`.
+ *
  * Note, the userspace code/data/etc. is copied, but not the kernel-space stuff
  * like the kernel stack. */
-struct task *task_fork(struct task *parent)
+struct task *task_clone(struct task *parent, flags_t clone_flags, va_t entry, va_t arg)
 {
-    int i;
     struct task *new = task_new();
     if (!new)
         return NULL;
@@ -186,20 +388,44 @@ struct task *task_fork(struct task *parent)
     strcpy(new->name, parent->name);
 
     arch_task_setup_stack_user(new);
-    address_space_copy(new->addrspc, parent->addrspc);
 
-    new->cwd = inode_dup(parent->cwd);
+    if (clone_flags & CLONE_VM) {
+        address_space_put(new->addrspc);
+        new->addrspc = address_space_dup(parent->addrspc);
+    } else {
+        address_space_copy(new->addrspc, parent->addrspc);
+    }
+
+    if (clone_flags & CLONE_FILES) {
+        task_files_put(new->files);
+        new->files = task_files_dup(parent->files);
+    } else {
+        task_files_copy(new->files, parent->files);
+    }
+
+    if (clone_flags & CLONE_FS) {
+        task_fs_put(new->fs);
+        new->fs = task_fs_dup(parent->fs);
+    } else {
+        using_spinlock(&parent->fs->lock)
+            new->fs->cwd = inode_dup(parent->fs->cwd);
+
+        new->fs->umask = parent->fs->umask;
+    }
 
-    for (i = 0; i < NOFILE; i++)
-        if (parent->files[i])
-            new->files[i] = file_dup(parent->files[i]);
+    if (clone_flags & CLONE_SIGHAND) {
+        task_sighand_put(new->sighand);
+        new->sighand = task_sighand_dup(parent->sighand);
+    }
 
     new->tty = parent->tty;
     new->pgid = parent->pgid;
     new->session_id = parent->session_id;
-    new->close_on_exec = parent->close_on_exec;
     new->sig_blocked = parent->sig_blocked;
-    new->umask = parent->umask;
+    new->sched_policy = parent->sched_policy;
+    new->rt_priority = parent->rt_priority;
+    new->nice = parent->nice;
+    new->vruntime = parent->vruntime;
 
     using_creds(&parent->creds) {
         new->creds.uid = parent->creds.uid;
@@ -213,12 +439,29 @@ struct task *task_fork(struct task *parent)
         memcpy(&new->creds.sup_groups, &parent->creds.sup_groups, sizeof(new->creds.sup_groups));
     }
 
-    new->parent = parent;
     memcpy(new->context.frame, parent->context.frame, sizeof(*new->context.frame));
 
+    /* Tasks sharing an address_space also share its uinfo task page, which
+     * keeps describing the task that created it */
+    if (!(clone_flags & CLONE_VM)) {
+        uinfo_map(new->addrspc, new);
+    } else if (task_clone_setup_stack(new, entry, arg)) {
+        task_free(new);
+        return NULL;
+    }
+
+    /* Set last, so that a failed clone doesn't signal the parent */
+    new->parent = parent;
+    uinfo_task_update_ppid(new);
+
     return new;
 }
 
+struct task *task_fork(struct task *parent)
+{
+    return task_clone(parent, 0, NULL, NULL);
+}
+
 void task_free(struct task *t)
 {
     atomic_dec(&total_tasks);
@@ -228,6 +471,7 @@ void task_free(struct task *t)
         task_make_zombie(t);
 
     pfree_va(t->kstack_bot, log2(KERNEL_STACK_PAGES));
+    arch_task_free(t);
 
     kfree(t);
 }
@@ -235,9 +479,8 @@ void task_free(struct task *t)
 void task_make_zombie(struct task *t)
 {
     struct task *child;
-    int i;
 
-    kp(KP_TRACE, "zombie: %d\n", t->pid);
+    trace(task_zombie, t->pid, t->parent? t->parent->pid: 0);
 
     flag_set(&t->flags, TASK_FLAG_KILLED);
 
@@ -253,61 +496,69 @@ void task_make_zombie(struct task *t)
         }
     }
 
-    /* Children of Zombie's are inherited by PID1. */
-    using_spinlock(&task_pid1->children_list_lock) {
-        list_foreach_take_entry(&t->task_children, child, task_sibling_list) {
-            /* The atomic swap guarentees consistency of the child->parent
-             * pointer.
-             *
-             * There is no actual race here, even without a lock on the
-             * 'child->parent' field, because a task will always be set to
-             * TASK_ZOMBIE *before* attempting to wake it's parent.
-             *
-             * The race would be if 'child' is in sys_exit() while we're making
-             * it's current parent a zombie. It's not an issue because
-             * sys_exit() always sets 'child->state' to TASK_ZOMBIE *before*
-             * caling scheduler_task_wake(child->parent). 
-             *
-             * Thus, by swaping in task_pid1 as the parent before checking for
-             * TASK_ZOMBIE, we guarentee that we get the correct functionality:
-             * If 'child->state' isn't TASK_ZOMBIE: 
-             *   There's no issue because even if they're in sys_exit(), they
-             *   haven't attempted to wake up the parent yet.
-             *
-             * If 'child->state' is TASK_ZOMBIE:
-             *   Then we call scheduler_task_wake(task_pid1) to ensure PID1
-             *   gets the wake-up. The worst case here is that PID1 recieves
-             *   two wake-ups - No big deal.
-             */
-            atomic_ptr_swap(&child->parent, task_pid1);
-
-            kp(KP_TRACE, "Init: Inheriting child %d\n", child->pid);
-            list_move(&task_pid1->task_children, &child->task_sibling_list);
-
-            if (child->state == TASK_ZOMBIE)
-                scheduler_task_send_signal(1, SIGCHLD, 0);
+    /* Children of Zombie's are inherited by PID1.
+     *
+     * Kernel threads never have children, and can exit before PID1 exists,
+     * such as the initcall threads. */
+    if (!list_empty(&t->task_children)) {
+        using_spinlock(&task_pid1->children_list_lock) {
+            list_foreach_take_entry(&t->task_children, child, task_sibling_list) {
+                /* The atomic swap guarentees consistency of the child->parent
+                 * pointer.
+                 *
+                 * There is no actual race here, even without a lock on the
+                 * 'child->parent' field, because a task will always be set to
+                 * TASK_ZOMBIE *before* attempting to wake it's parent.
+                 *
+                 * The race would be if 'child' is in sys_exit() while we're making
+                 * it's current parent a zombie. It's not an issue because
+                 * sys_exit() always sets 'child->state' to TASK_ZOMBIE *before*
+                 * caling scheduler_task_wake(child->parent). 
+                 *
+                 * Thus, by swaping in task_pid1 as the parent before checking for
+                 * TASK_ZOMBIE, we guarentee that we get the correct functionality:
+                 * If 'child->state' isn't TASK_ZOMBIE: 
+                 *   There's no issue because even if they're in sys_exit(), they
+                 *   haven't attempted to wake up the parent yet.
+                 *
+                 * If 'child->state' is TASK_ZOMBIE:
+                 *   Then we call scheduler_task_wake(task_pid1) to ensure PID1
+                 *   gets the wake-up. The worst case here is that PID1 recieves
+                 *   two wake-ups - No big deal.
+                 */
+                atomic_ptr_swap(&child->parent, task_pid1);
+                uinfo_task_update_ppid(child);
+
+                kp(KP_TRACE, "Init: Inheriting child %d\n", child->pid);
+                list_move(&task_pid1->task_children, &child->task_sibling_list);
+
+                if (child->state == TASK_ZOMBIE)
+                    scheduler_task_send_signal(1, SIGCHLD, 0);
+            }
         }
     }
 
-    for (i = 0; i < NOFILE; i++) {
-        if (t->files[i]) {
-            kp(KP_TRACE, "closing file %d\n", i);
-            vfs_close(t->files[i]);
-        }
-    }
+    task_files_put(t->files);
+    t->files = NULL;
+
+    task_fs_put(t->fs);
+    t->fs = NULL;
 
-    if (t->cwd)
-        inode_put(t->cwd);
+    task_sighand_put(t->sighand);
+    t->sighand = NULL;
 
-    if (!flag_test(&t->flags, TASK_FLAG_KERNEL)) {
-        address_space_clear(t->addrspc);
-        kfree(t->addrspc);
+    if (t->user_stack) {
+        using_mutex(&t->addrspc->lock)
+            address_space_vm_map_free(t->addrspc, t->user_stack);
+
+        t->user_stack = NULL;
     }
 
+    if (!flag_test(&t->flags, TASK_FLAG_KERNEL))
+        address_space_put(t->addrspc);
+
     t->state = TASK_ZOMBIE;
 
     if (t->parent)
         scheduler_task_send_signal(t->parent->pid, SIGCHLD, 0);
-
-    kp(KP_TRACE, "Task %s(%p): zombie\n", t->name, t);
 }
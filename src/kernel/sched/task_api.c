@@ -79,11 +79,18 @@ static void __fill_task_api_info(struct task_api_info *tinfo, struct task *task)
         break;
     }
 
-    memcpy(&tinfo->close_on_exec, &task->close_on_exec, sizeof(tinfo->close_on_exec));
+    /* Zombies have already released their file table */
+    if (task->files)
+        memcpy(&tinfo->close_on_exec, &task->files->close_on_exec, sizeof(tinfo->close_on_exec));
     memcpy(&tinfo->sig_pending, &task->sig_pending, sizeof(tinfo->sig_pending));
     memcpy(&tinfo->sig_blocked, &task->sig_blocked, sizeof(tinfo->sig_blocked));
 
     memcpy(tinfo->name, task->name, sizeof(tinfo->name));
+
+    struct task_rusage usage;
+
+    task_rusage_get(task, &usage, NULL);
+    task_rusage_to_user(&usage, &tinfo->usage);
 }
 
 static int scheduler_task_api_read(struct file *filp, struct user_buffer buf, size_t size)
@@ -169,7 +176,7 @@ static int task_api_fill_file_info(struct task_api_file_info *info)
         return -ESRCH;
 
     for (i = 0; i < NOFILE; i++) {
-        struct file *filp = task_fd_get(task, i);
+        struct file *filp = task->files? task_fd_get(task, i): NULL;
 
         if (!filp) {
             info->files[i].in_use = 0;
@@ -27,8 +27,8 @@
 int task_fd_get_empty(struct task *t)
 {
     int i;
-    for (i = 0; i < ARRAY_SIZE(t->files); i++)
-        if (cmpxchg(t->files + i, 0, -1) == 0)
+    for (i = 0; i < ARRAY_SIZE(t->files->fds); i++)
+        if (cmpxchg(t->files->fds + i, 0, -1) == 0)
             return i;
 
     return -1;
@@ -43,8 +43,8 @@ int task_fd_get_empty(struct task *t)
 int task_fd_assign_empty(struct task *t, struct file *filp)
 {
     int i;
-    for (i = 0; i < ARRAY_SIZE(t->files); i++)
-        if (cmpxchg(t->files + i, 0, (uintptr_t)filp) == 0)
+    for (i = 0; i < ARRAY_SIZE(t->files->fds); i++)
+        if (cmpxchg(t->files->fds + i, 0, (uintptr_t)filp) == 0)
             return i;
 
     return -1;
@@ -52,6 +52,6 @@ int task_fd_assign_empty(struct task *t, struct file *filp)
 
 void task_fd_release(struct task *t, int fd)
 {
-    t->files[fd] = NULL;
+    t->files->fds[fd] = NULL;
 }
 
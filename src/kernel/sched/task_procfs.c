@@ -70,3 +70,49 @@ struct file_ops task_file_ops = {
     .read = seq_read,
     .release = seq_release,
 };
+
+/* Times are in microseconds, the children columns only cover children that
+ * have been waited on */
+static int task_usage_seq_render(struct seq_file *seq)
+{
+    struct task *t = seq_list_get_entry(seq, struct task, task_list_node);
+    struct task_rusage usage, child_usage;
+
+    if (!t)
+        return seq_printf(seq, "Pid\tUtime\tStime\tMinflt\tMajflt\tVcsw\tIvcsw\tRead\tWrite\tCUtime\tCStime\tName\n");
+
+    task_rusage_get(t, &usage, &child_usage);
+
+    return seq_printf(seq, "%d\t%llu\t%llu\t%u\t%u\t%u\t%u\t%llu\t%llu\t%llu\t%llu\t\"%s\"\n",
+            t->pid,
+            usage.utime_ns / 1000,
+            usage.stime_ns / 1000,
+            usage.minflt,
+            usage.majflt,
+            usage.nvcsw,
+            usage.nivcsw,
+            usage.read_bytes,
+            usage.write_bytes,
+            child_usage.utime_ns / 1000,
+            child_usage.stime_ns / 1000,
+            t->name);
+}
+
+const static struct seq_file_ops task_usage_seq_file_ops = {
+    .start = task_seq_start,
+    .next = task_seq_next,
+    .render = task_usage_seq_render,
+    .end = task_seq_end,
+};
+
+static int task_usage_file_seq_open(struct inode *inode, struct file *filp)
+{
+    return seq_open(filp, &task_usage_seq_file_ops);
+}
+
+struct file_ops task_usage_file_ops = {
+    .open = task_usage_file_seq_open,
+    .lseek = seq_lseek,
+    .read = seq_read,
+    .release = seq_release,
+};
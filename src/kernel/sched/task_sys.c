@@ -23,8 +23,21 @@
 #include <protura/fs/fs.h>
 #include <protura/wait.h>
 #include <protura/signal.h>
+#include <protura/sched.h>
 
 
+/* Makes `new` a child of `current` and starts it running */
+static void task_start_child(struct task *current, struct task *new)
+{
+    kp(KP_TRACE, "Task %s: Locking list of children\n", current->name);
+    using_spinlock(&current->children_list_lock)
+        list_add(&current->task_children, &new->task_sibling_list);
+    kp(KP_TRACE, "Task %s: Unlocking list of children: %d\n", current->name, list_empty(&current->task_children));
+
+    irq_frame_set_syscall_ret(new->context.frame, 0);
+    scheduler_task_add(new);
+}
+
 pid_t __fork(struct task *current, pid_t pgrp)
 {
     struct task *new;
@@ -41,13 +54,7 @@ pid_t __fork(struct task *current, pid_t pgrp)
         else if (pgrp > 0)
             new->pgid = pgrp;
 
-        kp(KP_TRACE, "Task %s: Locking list of children\n", current->name);
-        using_spinlock(&current->children_list_lock)
-            list_add(&current->task_children, &new->task_sibling_list);
-        kp(KP_TRACE, "Task %s: Unlocking list of children: %d\n", current->name, list_empty(&current->task_children));
-
-        irq_frame_set_syscall_ret(new->context.frame, 0);
-        scheduler_task_add(new);
+        task_start_child(current, new);
     }
 
     if (new)
@@ -68,6 +75,35 @@ pid_t sys_fork_pgrp(pid_t pgrp)
     return __fork(t, pgrp);
 }
 
+#define CLONE_VALID_FLAGS (CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND)
+
+pid_t sys_clone(flags_t clone_flags, struct user_buffer entry, struct user_buffer arg)
+{
+    struct task *current = cpu_get_local()->current;
+    struct task *new;
+
+    if (clone_flags & ~CLONE_VALID_FLAGS)
+        return -EINVAL;
+
+    if ((clone_flags & CLONE_SIGHAND) && !(clone_flags & CLONE_VM))
+        return -EINVAL;
+
+    /* A task sharing our address_space gets a new stack, so it can't just
+     * return from the syscall like fork() */
+    if ((clone_flags & CLONE_VM) && user_buffer_is_null(entry))
+        return -EINVAL;
+
+    new = task_clone(current, clone_flags, entry.ptr, arg.ptr);
+    if (!new)
+        return -ENOMEM;
+
+    kp(KP_TRACE, "New cloned task: %d, flags: 0x%x\n", new->pid, clone_flags);
+
+    task_start_child(current, new);
+
+    return new->pid;
+}
+
 pid_t sys_getpid(void)
 {
     struct task *t = cpu_get_local()->current;
@@ -219,8 +255,10 @@ pid_t sys_waitpid(pid_t childpid, struct user_buffer wstatus, int options)
     if (!have_child)
         return -ECHILD;
 
-    if (kill_child)
+    if (kill_child) {
+        task_rusage_reap(t, child);
         scheduler_task_mark_dead(child);
+    }
 
     if (!user_buffer_is_null(wstatus)) {
         int ret = user_copy_from_kernel(wstatus, ret_status);
@@ -246,7 +284,7 @@ int sys_dup(int oldfd)
 
     fd_assign(newfd, file_dup(filp));
 
-    FD_CLR(newfd, &current->close_on_exec);
+    FD_CLR(newfd, &current->files->close_on_exec);
 
     return newfd;
 }
@@ -272,7 +310,7 @@ int sys_dup2(int oldfd, int newfd)
 
     fd_assign(newfd, file_dup(old_filp));
 
-    FD_CLR(newfd, &current->close_on_exec);
+    FD_CLR(newfd, &current->files->close_on_exec);
 
     return newfd;
 }
@@ -53,19 +53,36 @@ static inline void wait_queue_wake_node(struct wait_queue_node *node)
     work_schedule(&node->on_complete);
 }
 
-void wait_queue_register(struct wait_queue *queue, struct wait_queue_node *node)
+static void __wait_queue_register(struct wait_queue *queue, struct wait_queue_node *node, int exclusive)
 {
     using_spinlock(&queue->lock) {
         if (!list_node_is_in_list(&node->node)) {
-            list_add_tail(&queue->queue, &node->node);
+            /* Normal waiters go in front of the exclusive ones, so that
+             * wait_queue_wake_nr() can stop as soon as it has woken enough
+             * exclusive waiters */
+            if (exclusive)
+                list_add_tail(&queue->queue, &node->node);
+            else
+                list_add(&queue->queue, &node->node);
 
             node->queue = queue;
+            node->exclusive = exclusive;
         } else if (node->queue != queue) {
             panic("Node %p: Attempting to join multiple wait-queues\n", node);
         }
     }
 }
 
+void wait_queue_register(struct wait_queue *queue, struct wait_queue_node *node)
+{
+    __wait_queue_register(queue, node, 0);
+}
+
+void wait_queue_register_exclusive(struct wait_queue *queue, struct wait_queue_node *node)
+{
+    __wait_queue_register(queue, node, 1);
+}
+
 void wait_queue_unregister(struct wait_queue_node *node)
 {
     /* We clear node->queue on unregister or wake. To prevent a race here, we
@@ -94,6 +111,50 @@ void wait_queue_unregister(struct wait_queue_node *node)
     }
 }
 
+void wait_queue_unregister_exclusive(struct wait_queue *queue, struct wait_queue_node *node, int aborted)
+{
+    int woken = 0;
+
+    /* Unlike wait_queue_unregister(), the caller tells us which queue the
+     * node was registered on, so there's no race on reading node->queue. If
+     * the node isn't on the queue anymore, then a wake-up removed it */
+    using_spinlock(&queue->lock) {
+        if (list_node_is_in_list(&node->node)) {
+            list_del(&node->node);
+            node->queue = NULL;
+        } else {
+            woken = 1;
+        }
+    }
+
+    if (woken && aborted)
+        wait_queue_wake_one(queue);
+}
+
+int wait_queue_wake_nr(struct wait_queue *queue, int nr)
+{
+    int waken = 0;
+    struct wait_queue_node *node, *next;
+
+    using_spinlock(&queue->lock) {
+        list_foreach_entry_safe(&queue->queue, node, next, node) {
+            if (node->exclusive) {
+                if (!nr)
+                    break;
+
+                nr--;
+            }
+
+            list_del(&node->node);
+            node->queue = NULL;
+            wait_queue_wake_node(node);
+            waken++;
+        }
+    }
+
+    return waken;
+}
+
 int wait_queue_wake(struct wait_queue *queue)
 {
     int waken = 0;
@@ -109,3 +170,7 @@ int wait_queue_wake(struct wait_queue *queue)
 
     return waken;
 }
+
+#ifdef CONFIG_KERNEL_TESTS
+# include "wait_queue_test.c"
+#endif
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+/*
+ * Tests for wait_queue.c - included directly at the end of wait_queue.c
+ */
+
+#include <protura/types.h>
+#include <protura/wait.h>
+#include <protura/ktest.h>
+
+struct wait_test_node {
+    struct wait_queue_node node;
+    int woken;
+};
+
+static void wait_test_callback(struct work *work)
+{
+    struct wait_test_node *n = container_of(work, struct wait_test_node, node.on_complete);
+    n->woken++;
+}
+
+static void wait_test_node_init(struct wait_test_node *n)
+{
+    wait_queue_node_init(&n->node);
+    n->node.on_complete = (struct work)WORK_INIT_CALLBACK(n->node.on_complete, wait_test_callback);
+    n->woken = 0;
+}
+
+static void wait_queue_wake_nr_test(struct ktest *kt)
+{
+    struct wait_queue queue;
+    struct wait_test_node normal[2], excl[4];
+    int nr = KT_ARG(kt, 0, int);
+    int expected_excl = nr > ARRAY_SIZE(excl)? ARRAY_SIZE(excl): nr;
+    int i;
+
+    wait_queue_init(&queue);
+
+    /* Interleave the registrations, normal waiters should still always be
+     * woken no matter where they registered */
+    for (i = 0; i < ARRAY_SIZE(excl); i++) {
+        wait_test_node_init(excl + i);
+        wait_queue_register_exclusive(&queue, &excl[i].node);
+
+        if (i < ARRAY_SIZE(normal)) {
+            wait_test_node_init(normal + i);
+            wait_queue_register(&queue, &normal[i].node);
+        }
+    }
+
+    int ret = wait_queue_wake_nr(&queue, nr);
+
+    ktest_assert_equal(kt, ARRAY_SIZE(normal) + expected_excl, ret);
+
+    for (i = 0; i < ARRAY_SIZE(normal); i++)
+        ktest_assert_equal(kt, 1, normal[i].woken);
+
+    /* Exclusive waiters are woken in the order they registered */
+    for (i = 0; i < ARRAY_SIZE(excl); i++) {
+        ktest_assert_equal(kt, i < expected_excl, excl[i].woken);
+        ktest_assert_equal(kt, i >= expected_excl, list_node_is_in_list(&excl[i].node.node));
+    }
+
+    for (i = 0; i < ARRAY_SIZE(excl); i++)
+        wait_queue_unregister_exclusive(&queue, &excl[i].node, 0);
+
+    ktest_assert_equal(kt, 0, wait_queue_waiting(&queue));
+}
+
+static void wait_queue_exclusive_abort_test(struct ktest *kt)
+{
+    struct wait_queue queue;
+    struct wait_test_node first, second;
+
+    wait_queue_init(&queue);
+    wait_test_node_init(&first);
+    wait_test_node_init(&second);
+
+    wait_queue_register_exclusive(&queue, &first.node);
+    wait_queue_register_exclusive(&queue, &second.node);
+
+    wait_queue_wake_one(&queue);
+
+    ktest_assert_equal(kt, 1, first.woken);
+    ktest_assert_equal(kt, 0, second.woken);
+
+    /* The first waiter gives up, so its wake-up has to go to the second */
+    wait_queue_unregister_exclusive(&queue, &first.node, -ERESTARTSYS);
+
+    ktest_assert_equal(kt, 1, second.woken);
+    ktest_assert_equal(kt, 0, wait_queue_waiting(&queue));
+
+    /* A waiter that was never woken doesn't pass anything on */
+    wait_queue_register_exclusive(&queue, &first.node);
+    wait_queue_register_exclusive(&queue, &second.node);
+
+    wait_queue_unregister_exclusive(&queue, &first.node, -ERESTARTSYS);
+
+    ktest_assert_equal(kt, 1, second.woken);
+
+    wait_queue_unregister_exclusive(&queue, &second.node, 0);
+}
+
+static const struct ktest_unit wait_queue_test_units[] = {
+    KTEST_UNIT("wait-queue-wake-nr-test", wait_queue_wake_nr_test,
+            (KT_INT(0)),
+            (KT_INT(1)),
+            (KT_INT(3)),
+            (KT_INT(4)),
+            (KT_INT(100))),
+
+    KTEST_UNIT("wait-queue-exclusive-abort-test", wait_queue_exclusive_abort_test),
+};
+
+KTEST_MODULE_DEFINE("wait-queue", wait_queue_test_units);
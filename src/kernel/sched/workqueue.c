@@ -15,10 +15,145 @@
 #include <protura/snprintf.h>
 #include <protura/task.h>
 #include <protura/scheduler.h>
+#include <protura/sched.h>
 #include <protura/work.h>
+#include <protura/mutex.h>
+#include <protura/time.h>
+#include <protura/mm/kmalloc.h>
+#include <protura/fs/seq_file.h>
 
 static struct workqueue kwork = WORKQUEUE_INIT(kwork);
 
+/* Workers beyond a queue's `min_threads` exit after being idle this long */
+#define WORKQUEUE_IDLE_TIMEOUT_MS 5000
+
+#define KWORK_MAX_THREADS 8
+
+struct workqueue_worker {
+    list_node_t idle_entry;
+    struct workqueue *queue;
+    struct task *task;
+
+    struct ktimer idle_timer;
+    int idle_expired;
+};
+
+/* Every started workqueue, for the procfs stats */
+static mutex_t workqueue_list_lock = MUTEX_INIT(workqueue_list_lock);
+static list_head_t workqueue_list = LIST_HEAD_INIT(workqueue_list);
+
+/*
+ * Creating a task can sleep, and work gets queued from interrupt context, so
+ * new workers are always created by the manager thread. Queues that need a
+ * worker get put on `manager_list`.
+ */
+static spinlock_t manager_lock = SPINLOCK_INIT();
+static list_head_t manager_list = LIST_HEAD_INIT(manager_list);
+static struct task *manager_task;
+
+/* queue->lock must be held */
+static void __workqueue_enqueue(struct workqueue *queue, struct work *work)
+{
+    list_add_tail(&queue->work_list, &work->work_entry);
+    work->queued_ns = protura_monotonic_ns();
+
+    queue->stats.depth++;
+    if (queue->stats.depth > queue->stats.max_depth)
+        queue->stats.max_depth = queue->stats.depth;
+}
+
+/* queue->lock must be held */
+static struct work *__workqueue_dequeue(struct workqueue *queue)
+{
+    struct work *work = list_take_first(&queue->work_list, struct work, work_entry);
+    uint64_t latency = protura_monotonic_ns() - work->queued_ns;
+
+    queue->stats.depth--;
+    queue->stats.run_count++;
+    queue->stats.total_latency_ns += latency;
+    if (latency > queue->stats.max_latency_ns)
+        queue->stats.max_latency_ns = latency;
+
+    return work;
+}
+
+/* Hands the work in `work_list` to an idle worker, or asks the manager for a
+ * new worker if there are none. queue->lock must be held. */
+static void __workqueue_wake_worker(struct workqueue *queue)
+{
+    if (!list_empty(&queue->idle_workers)) {
+        struct workqueue_worker *worker = list_take_first(&queue->idle_workers, struct workqueue_worker, idle_entry);
+        queue->idle_count--;
+
+        scheduler_task_wake(worker->task);
+        return;
+    }
+
+    if (queue->spawn_pending || queue->worker_count >= queue->max_threads)
+        return;
+
+    queue->spawn_pending = 1;
+
+    using_spinlock(&manager_lock) {
+        list_add_tail(&manager_list, &queue->manager_entry);
+
+        if (manager_task)
+            scheduler_task_wake(manager_task);
+    }
+}
+
+static void workqueue_idle_timer_callback(struct ktimer *timer)
+{
+    struct workqueue_worker *worker = container_of(timer, struct workqueue_worker, idle_timer);
+
+    worker->idle_expired = 1;
+    scheduler_task_wake(worker->task);
+}
+
+/*
+ * Parks the worker on the queue's idle list until it is handed work.
+ *
+ * Called and returns with queue->lock held. Returns non-zero if the idle
+ * timeout expired and the worker should exit.
+ */
+static int workqueue_worker_idle(struct workqueue_worker *worker)
+{
+    struct workqueue *queue = worker->queue;
+    int can_retire = queue->worker_count > queue->min_threads;
+
+    /* Idle workers are handed work most recently idle first, so that the
+     * extra workers are the ones left to time out */
+    list_add(&queue->idle_workers, &worker->idle_entry);
+    queue->idle_count++;
+    worker->idle_expired = 0;
+
+    if (can_retire)
+        timer_add(&worker->idle_timer, WORKQUEUE_IDLE_TIMEOUT_MS);
+
+    sleep_event_spinlock(!list_node_is_in_list(&worker->idle_entry) || worker->idle_expired, &queue->lock);
+
+    /* timer_cancel() can yield, so it can't be called with the lock held */
+    if (can_retire) {
+        spinlock_release(&queue->lock);
+        timer_cancel(&worker->idle_timer);
+        spinlock_acquire(&queue->lock);
+    }
+
+    /* If we're no longer on the idle list, then we were handed work */
+    if (!list_node_is_in_list(&worker->idle_entry))
+        return 0;
+
+    list_del(&worker->idle_entry);
+    queue->idle_count--;
+
+    if (queue->worker_count <= queue->min_threads)
+        return 0;
+
+    queue->worker_count--;
+    queue->stats.workers_retired++;
+    return 1;
+}
+
 /*
  * `struct work` is designed such that a paticular instance of `struct work`
  * will only ever be run on one workqueue thread at a time (If running on a
@@ -31,56 +166,141 @@ static struct workqueue kwork = WORKQUEUE_INIT(kwork);
  * running, if the `WORK_SCHEDULED` flag is set, then we simply requeue the
  * work at the end of the list.
  */
-static int workqueue_thread(void *q)
+static int workqueue_worker_thread(void *p)
 {
-    struct workqueue *queue = q;
+    struct workqueue_worker *worker = p;
+    struct workqueue *queue = worker->queue;
     struct work *work = NULL;
     int clear_work = 0;
 
-    while (1) {
-        using_spinlock(&queue->lock) {
-            if (work) {
-                list_del(&work->work_entry);
+    spinlock_acquire(&queue->lock);
 
-                if (flag_test(&work->flags, WORK_SCHEDULED))
-                    list_add_tail(&queue->work_list, &work->work_entry);
-            }
+    while (1) {
+        if (work) {
+            list_del(&work->work_entry);
 
-            sleep_event_spinlock(!list_empty(&queue->work_list), &queue->lock);
+            if (flag_test(&work->flags, WORK_SCHEDULED))
+                __workqueue_enqueue(queue, work);
 
-            work = list_take_first(&queue->work_list, struct work, work_entry);
+            work = NULL;
+        }
 
-            clear_work = flag_test(&work->flags, WORK_ONESHOT);
-            if (!clear_work)
-                list_add_tail(&queue->work_running_list, &work->work_entry);
+        if (list_empty(&queue->work_list)) {
+            if (workqueue_worker_idle(worker))
+                break;
 
-            /* This is fine, since we're about to run it anyway */
-            flag_clear(&work->flags, WORK_SCHEDULED);
+            continue;
         }
 
+        work = __workqueue_dequeue(queue);
+
+        clear_work = flag_test(&work->flags, WORK_ONESHOT);
+        if (!clear_work)
+            list_add_tail(&queue->work_running_list, &work->work_entry);
+
+        /* This is fine, since we're about to run it anyway */
+        flag_clear(&work->flags, WORK_SCHEDULED);
+
+        /* If there's more work, get another worker started on it in case this
+         * one blocks */
+        if (!list_empty(&queue->work_list))
+            __workqueue_wake_worker(queue);
+
+        spinlock_release(&queue->lock);
+
         (work->callback) (work);
 
         if (clear_work)
             work = NULL;
+
+        spinlock_acquire(&queue->lock);
     }
 
+    spinlock_release(&queue->lock);
+
+    kfree(worker);
     return 0;
 }
 
-void workqueue_start_multiple(struct workqueue *queue, const char *thread_name, int thread_count)
+static int workqueue_worker_new(struct workqueue *queue)
 {
-    int i;
-    struct page *tmp_page = palloc(0, PAL_KERNEL);
+    char name[sizeof(((struct task *)NULL)->name)];
+    struct workqueue_worker *worker;
+    int id;
+
+    worker = kzalloc(sizeof(*worker), PAL_KERNEL);
+    if (!worker)
+        return -ENOMEM;
+
+    list_node_init(&worker->idle_entry);
+    worker->queue = queue;
+    worker->idle_timer = (struct ktimer)KTIMER_CALLBACK_INIT(worker->idle_timer, workqueue_idle_timer_callback);
+
+    using_spinlock(&queue->lock)
+        id = ++queue->next_worker_id;
 
-    queue->thread_count = thread_count;
+    snprintf(name, sizeof(name), "%s/%d", queue->name, id);
+    worker->task = task_kernel_new(name, workqueue_worker_thread, worker);
+    if (!worker->task) {
+        kfree(worker);
+        return -ENOMEM;
+    }
+
+    if (queue->rt_priority)
+        sched_task_set_policy(worker->task, SCHED_FIFO, queue->rt_priority);
 
-    for (i = 0; i < thread_count; i++) {
-        snprintf(tmp_page->virt, PG_SIZE, "%s/%d", thread_name, i + 1);
-        queue->work_threads[i] = task_kernel_new(tmp_page->virt, workqueue_thread, queue);
-        scheduler_task_add(queue->work_threads[i]);
+    using_spinlock(&queue->lock) {
+        queue->worker_count++;
+        queue->stats.workers_spawned++;
     }
 
-    pfree(tmp_page, 0);
+    scheduler_task_add(worker->task);
+    return 0;
+}
+
+static int workqueue_manager_thread(void *p)
+{
+    while (1) {
+        struct workqueue *queue;
+
+        using_spinlock(&manager_lock) {
+            sleep_event_spinlock(!list_empty(&manager_list), &manager_lock);
+
+            queue = list_take_first(&manager_list, struct workqueue, manager_entry);
+        }
+
+        int ret = workqueue_worker_new(queue);
+        if (ret)
+            kp(KP_WARNING, "workqueue: %s: Unable to spawn worker: %d\n", queue->name, ret);
+
+        using_spinlock(&queue->lock)
+            queue->spawn_pending = 0;
+    }
+
+    return 0;
+}
+
+void workqueue_start_pool(struct workqueue *queue, const char *thread_name, int min_threads, int max_threads)
+{
+    int i;
+
+    strncpy(queue->name, thread_name, sizeof(queue->name) - 1);
+    queue->name[sizeof(queue->name) - 1] = '\0';
+
+    queue->min_threads = min_threads;
+    queue->max_threads = max_threads;
+
+    for (i = 0; i < min_threads; i++)
+        if (workqueue_worker_new(queue))
+            panic("workqueue: %s: Unable to start workers!\n", queue->name);
+
+    using_mutex(&workqueue_list_lock)
+        list_add_tail(&workqueue_list, &queue->workqueue_entry);
+}
+
+void workqueue_start_multiple(struct workqueue *queue, const char *thread_name, int thread_count)
+{
+    workqueue_start_pool(queue, thread_name, thread_count, thread_count);
 }
 
 void workqueue_start(struct workqueue *queue, const char *thread_name)
@@ -93,13 +313,11 @@ void workqueue_add_work(struct workqueue *queue, struct work *work)
     using_spinlock(&queue->lock) {
         flag_set(&work->flags, WORK_SCHEDULED);
 
-        if (!list_node_is_in_list(&work->work_entry))
-            list_add_tail(&queue->work_list, &work->work_entry);
-
-        if (queue->thread_count) {
-            scheduler_task_wake(queue->work_threads[queue->wake_next_thread]);
-
-            queue->wake_next_thread = (queue->wake_next_thread + 1) % queue->thread_count;
+        /* If the work is already queued, or currently running, then the
+         * worker running it will requeue it when it's done */
+        if (!list_node_is_in_list(&work->work_entry)) {
+            __workqueue_enqueue(queue, work);
+            __workqueue_wake_worker(queue);
         }
     }
 }
@@ -145,9 +363,73 @@ int kwork_delay_unschedule(struct delay_work *work)
     return timer_del(&work->timer);
 }
 
+static int workqueue_seq_start(struct seq_file *seq)
+{
+    mutex_lock(&workqueue_list_lock);
+    return seq_list_start_header(seq, &workqueue_list);
+}
+
+static int workqueue_seq_render(struct seq_file *seq)
+{
+    struct workqueue *queue = seq_list_get_entry(seq, struct workqueue, workqueue_entry);
+    struct workqueue_stats stats;
+    int workers, idle, min, max;
+
+    if (!queue)
+        return seq_printf(seq, "name\tworkers\tidle\tmin\tmax\tdepth\tmax_depth\trun\tavg_latency_ns\tmax_latency_ns\tspawned\tretired\n");
+
+    using_spinlock(&queue->lock) {
+        stats = queue->stats;
+        workers = queue->worker_count;
+        idle = queue->idle_count;
+        min = queue->min_threads;
+        max = queue->max_threads;
+    }
+
+    uint64_t avg_latency = stats.run_count? stats.total_latency_ns / stats.run_count: 0;
+
+    return seq_printf(seq, "%s\t%d\t%d\t%d\t%d\t%d\t%d\t%llu\t%llu\t%llu\t%u\t%u\n",
+            queue->name, workers, idle, min, max,
+            stats.depth, stats.max_depth, stats.run_count,
+            avg_latency, stats.max_latency_ns,
+            stats.workers_spawned, stats.workers_retired);
+}
+
+static int workqueue_seq_next(struct seq_file *seq)
+{
+    return seq_list_next(seq, &workqueue_list);
+}
+
+static void workqueue_seq_end(struct seq_file *seq)
+{
+    mutex_unlock(&workqueue_list_lock);
+}
+
+const static struct seq_file_ops workqueue_seq_file_ops = {
+    .start = workqueue_seq_start,
+    .next = workqueue_seq_next,
+    .render = workqueue_seq_render,
+    .end = workqueue_seq_end,
+};
+
+static int workqueue_file_seq_open(struct inode *inode, struct file *filp)
+{
+    return seq_open(filp, &workqueue_seq_file_ops);
+}
+
+const struct file_ops workqueue_file_ops = {
+    .open = workqueue_file_seq_open,
+    .lseek = seq_lseek,
+    .read = seq_read,
+    .release = seq_release,
+};
+
 static void kwork_init(void)
 {
-    workqueue_start_multiple(&kwork, "kwork", 4);
+    manager_task = task_kernel_new("kworker-manager", workqueue_manager_thread, NULL);
+    scheduler_task_add(manager_task);
+
+    workqueue_start_pool(&kwork, "kwork", 1, KWORK_MAX_THREADS);
 }
 initcall_core(kwork, kwork_init);
 
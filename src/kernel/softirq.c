@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/list.h>
+#include <protura/softirq.h>
+#include <protura/fs/seq_file.h>
+#include <arch/asm.h>
+#include <arch/irq.h>
+#include <arch/tsc.h>
+
+struct softirq_stats {
+    uint64_t runs;
+    uint64_t total_ns;
+    uint64_t max_ns;
+};
+
+static const char *softirq_names[SOFTIRQ_COUNT] = {
+    [SOFTIRQ_TIMER] = "timer",
+    [SOFTIRQ_TASKLET] = "tasklet",
+};
+
+static void tasklet_softirq(void);
+
+/*
+ * Everything here is only touched with interrupts off, which is enough since
+ * we only run on one CPU.
+ */
+static void (*softirq_handlers[SOFTIRQ_COUNT]) (void) = {
+    [SOFTIRQ_TASKLET] = tasklet_softirq,
+};
+
+static flags_t softirq_pending;
+static struct softirq_stats softirq_stats[SOFTIRQ_COUNT];
+static uint32_t softirq_deferred;
+
+static list_head_t tasklet_list = LIST_HEAD_INIT(tasklet_list);
+
+void softirq_register(enum softirq_type type, void (*handler) (void))
+{
+    softirq_handlers[type] = handler;
+}
+
+void softirq_raise(enum softirq_type type)
+{
+    irq_flags_t flags = irq_save();
+    irq_disable();
+
+    flag_set(&softirq_pending, type);
+
+    irq_restore(flags);
+}
+
+static void softirq_call(enum softirq_type type)
+{
+    struct softirq_stats *stats = softirq_stats + type;
+    uint64_t start_tsc = 0, ns = 0;
+
+    if (tsc_is_usable())
+        start_tsc = rdtsc();
+
+    (softirq_handlers[type]) ();
+
+    if (start_tsc)
+        ns = tsc_cycles_to_ns(rdtsc() - start_tsc);
+
+    irq_flags_t flags = irq_save();
+    irq_disable();
+
+    stats->runs++;
+    stats->total_ns += ns;
+    if (ns > stats->max_ns)
+        stats->max_ns = ns;
+
+    irq_restore(flags);
+}
+
+/*
+ * The interrupt handler only calls this from the outermost interrupt, so an
+ * interrupt that comes in while we're running the handlers won't call this
+ * again, it just raises more softirqs for us to pick up on the next pass.
+ */
+void softirq_run(void)
+{
+    int restarts = SOFTIRQ_MAX_RESTART;
+    flags_t pending;
+    int i;
+
+    while ((pending = softirq_pending) && restarts--) {
+        softirq_pending = 0;
+
+        sti();
+
+        for (i = 0; i < SOFTIRQ_COUNT; i++)
+            if ((pending & F(i)) && softirq_handlers[i])
+                softirq_call(i);
+
+        cli();
+    }
+
+    if (softirq_pending)
+        softirq_deferred++;
+}
+
+void tasklet_schedule(struct tasklet *tasklet)
+{
+    irq_flags_t flags = irq_save();
+    irq_disable();
+
+    if (!flag_test(&tasklet->flags, TASKLET_SCHEDULED)) {
+        flag_set(&tasklet->flags, TASKLET_SCHEDULED);
+        list_add_tail(&tasklet_list, &tasklet->entry);
+        flag_set(&softirq_pending, SOFTIRQ_TASKLET);
+    }
+
+    irq_restore(flags);
+}
+
+static void tasklet_softirq(void)
+{
+    list_head_t list = LIST_HEAD_INIT(list);
+    struct tasklet *tasklet;
+
+    irq_flags_t flags = irq_save();
+    irq_disable();
+
+    list_splice_init(&list, &tasklet_list);
+
+    irq_restore(flags);
+
+    while (!list_empty(&list)) {
+        flags = irq_save();
+        irq_disable();
+
+        tasklet = list_take_first(&list, struct tasklet, entry);
+        flag_clear(&tasklet->flags, TASKLET_SCHEDULED);
+
+        irq_restore(flags);
+
+        (tasklet->callback) (tasklet);
+    }
+}
+
+static int softirq_seq_start(struct seq_file *seq)
+{
+    if (seq->iter_offset == SOFTIRQ_COUNT + 2)
+        flag_set(&seq->flags, SEQ_FILE_DONE);
+
+    return 0;
+}
+
+/* Offset zero is the header, then the softirqs, then the deferred count */
+static int softirq_seq_render(struct seq_file *seq)
+{
+    struct softirq_stats stats = { 0 };
+    uint32_t deferred;
+
+    if (seq->iter_offset == 0)
+        return seq_printf(seq, "name\truns\ttotal_us\tmax_us\n");
+
+    irq_flags_t flags = irq_save();
+    irq_disable();
+
+    if (seq->iter_offset <= SOFTIRQ_COUNT)
+        stats = softirq_stats[seq->iter_offset - 1];
+
+    deferred = softirq_deferred;
+
+    irq_restore(flags);
+
+    if (seq->iter_offset > SOFTIRQ_COUNT)
+        return seq_printf(seq, "deferred: %u\n", deferred);
+
+    return seq_printf(seq, "%s\t%llu\t%llu\t%llu\n", softirq_names[seq->iter_offset - 1],
+            stats.runs, stats.total_ns / 1000, stats.max_ns / 1000);
+}
+
+static int softirq_seq_next(struct seq_file *seq)
+{
+    seq->iter_offset++;
+
+    if (seq->iter_offset == SOFTIRQ_COUNT + 2)
+        flag_set(&seq->flags, SEQ_FILE_DONE);
+
+    return 0;
+}
+
+static void softirq_seq_end(struct seq_file *seq)
+{
+
+}
+
+const static struct seq_file_ops softirq_seq_file_ops = {
+    .start = softirq_seq_start,
+    .next = softirq_seq_next,
+    .render = softirq_seq_render,
+    .end = softirq_seq_end,
+};
+
+static int softirq_file_seq_open(struct inode *inode, struct file *filp)
+{
+    return seq_open(filp, &softirq_seq_file_ops);
+}
+
+const struct file_ops softirq_file_ops = {
+    .open = softirq_file_seq_open,
+    .lseek = seq_lseek,
+    .read = seq_read,
+    .release = seq_release,
+};
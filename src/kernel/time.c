@@ -15,10 +15,14 @@
 #include <protura/fs/procfs.h>
 #include <arch/timer.h>
 #include <protura/time.h>
+#include <protura/uinfo.h>
 
 time_t current_uptime = 0;
 time_t boot_time = 0;
 
+/* Monotonic time at the point boot_time was set */
+static uint64_t boot_time_mono_ns = 0;
+
 void protura_uptime_inc(void)
 {
     return atomic32_inc((atomic32_t *)&current_uptime);
@@ -36,7 +40,10 @@ void protura_uptime_reset(void)
 
 void protura_boot_time_set(time_t t)
 {
+    boot_time_mono_ns = timer_get_ns();
     boot_time = t;
+
+    uinfo_time_set_realtime_offset((int64_t)t * NSEC_PER_SEC - boot_time_mono_ns);
 }
 
 time_t protura_boot_time_get(void)
@@ -54,6 +61,16 @@ uint32_t protura_uptime_get_ms(void)
     return timer_get_ms();
 }
 
+uint64_t protura_monotonic_ns(void)
+{
+    return timer_get_ns();
+}
+
+uint64_t protura_realtime_ns(void)
+{
+    return (uint64_t)protura_boot_time_get() * NSEC_PER_SEC + protura_monotonic_ns() - boot_time_mono_ns;
+}
+
 static int protura_uptime_read(void *page, size_t page_size, size_t *len)
 {
     *len = snprintf(page, page_size, "%ld\n", protura_uptime_get());
@@ -94,11 +111,31 @@ int sys_time(struct user_buffer t)
 
 int sys_gettimeofday(struct user_buffer tv, struct user_buffer tz)
 {
-    uint32_t tick = timer_get_ticks();
+    uint64_t ns = protura_realtime_ns();
     struct timeval tmp;
 
-    tmp.tv_sec = tick / TIMER_TICKS_PER_SEC;
-    tmp.tv_usec = ((uint64_t)(tick % (TIMER_TICKS_PER_SEC)) * 1000000 / TIMER_TICKS_PER_SEC);
+    tmp.tv_sec = ns / NSEC_PER_SEC;
+    tmp.tv_usec = (ns % NSEC_PER_SEC) / NSEC_PER_USEC;
 
     return user_copy_from_kernel(tv, tmp);
 }
+
+int sys_clock_gettime(int clock_id, struct user_buffer ts)
+{
+    struct timespec tmp;
+
+    switch (clock_id) {
+    case CLOCK_REALTIME:
+        protura_ns_to_timespec(protura_realtime_ns(), &tmp);
+        break;
+
+    case CLOCK_MONOTONIC:
+        protura_ns_to_timespec(protura_monotonic_ns(), &tmp);
+        break;
+
+    default:
+        return -EINVAL;
+    }
+
+    return user_copy_from_kernel(ts, tmp);
+}
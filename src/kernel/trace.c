@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/string.h>
+#include <protura/initcall.h>
+#include <protura/atomic.h>
+#include <protura/task.h>
+#include <protura/trace.h>
+#include <protura/mm/palloc.h>
+#include <protura/mm/kmalloc.h>
+#include <protura/mm/user_check.h>
+#include <protura/fs/seq_file.h>
+#include <protura/fs/procfs.h>
+#include <arch/cpu.h>
+#include <arch/timer.h>
+
+/*
+ * Every CPU has its own ring of events. Writers reserve a slot by atomically
+ * incrementing `head`, so a trace() from an interrupt handler can't corrupt
+ * one that it interrupted. When the ring is full the oldest events are
+ * overwritten.
+ *
+ * A slot's `seq` is zero while it is being written, and is set to its
+ * reservation number plus one once the event is complete. Readers copy the
+ * event and then check `seq` again, so they never need to stop the writers.
+ */
+#define TRACE_BUFFER_ORDER CONFIG_TRACE_BUFFER_ORDER
+
+/* Protura only runs on one CPU at the moment */
+#define TRACE_CPUS 1
+
+struct trace_event {
+    uint64_t timestamp_ns;
+    uint32_t seq;
+    struct tracepoint *tp;
+    pid_t pid;
+    int cpu;
+    uint32_t args[TRACE_MAX_ARGS];
+};
+
+/* Keeps the ring capacity a power of two */
+STATIC_ASSERT(sizeof(struct trace_event) == 64);
+
+struct trace_ring {
+    atomic32_t head;
+
+    /* Events before this were thrown away by TRACEIO_CLEAR */
+    uint32_t cleared;
+    uint32_t capacity;
+    struct trace_event *events;
+};
+
+static struct trace_ring trace_rings[TRACE_CPUS];
+
+extern struct tracepoint __tracepoint_start, __tracepoint_end;
+
+#define tracepoint_foreach(tp) \
+    for (tp = &__tracepoint_start; tp < &__tracepoint_end; tp++)
+
+void __trace_event(struct tracepoint *tp, const uint32_t *args)
+{
+    struct cpu_info *cpu = cpu_get_local();
+    struct trace_ring *ring = trace_rings + cpu->cpu_id;
+
+    if (!ring->events)
+        return;
+
+    uint32_t reserved = atomic32_inc_return(&ring->head) - 1;
+    struct trace_event *event = ring->events + (reserved & (ring->capacity - 1));
+
+    event->seq = 0;
+    barrier();
+
+    event->timestamp_ns = timer_get_ns();
+    event->tp = tp;
+    event->pid = cpu->current? cpu->current->pid: 0;
+    event->cpu = cpu->cpu_id;
+    memcpy(event->args, args, sizeof(event->args));
+
+    barrier();
+    event->seq = reserved + 1;
+
+    tp->hits++;
+}
+
+static struct tracepoint *tracepoint_find(const char *name)
+{
+    struct tracepoint *tp;
+
+    tracepoint_foreach(tp)
+        if (strcmp(tp->name, name) == 0)
+            return tp;
+
+    return NULL;
+}
+
+static int trace_set_enabled(const char *name, int enabled)
+{
+    struct tracepoint *tp;
+
+    if (strcmp(name, "all") == 0) {
+        tracepoint_foreach(tp)
+            tp->enabled = enabled;
+
+        return 0;
+    }
+
+    tp = tracepoint_find(name);
+    if (!tp)
+        return -ENOENT;
+
+    tp->enabled = enabled;
+    return 0;
+}
+
+static void trace_clear(void)
+{
+    int i;
+
+    for (i = 0; i < TRACE_CPUS; i++)
+        trace_rings[i].cleared = atomic32_get(&trace_rings[i].head);
+}
+
+static int trace_ioctl(struct file *filp, int cmd, struct user_buffer ptr)
+{
+    struct task *current = cpu_get_local()->current;
+    struct trace_name name;
+    int ret;
+
+    if (current->creds.euid != 0)
+        return -EPERM;
+
+    switch (cmd) {
+    case TRACEIO_ENABLE:
+    case TRACEIO_DISABLE:
+        ret = user_copy_to_kernel(&name, ptr);
+        if (ret)
+            return ret;
+
+        name.name[TRACE_NAME_MAX - 1] = '\0';
+
+        return trace_set_enabled(name.name, cmd == TRACEIO_ENABLE);
+
+    case TRACEIO_CLEAR:
+        trace_clear();
+        return 0;
+    }
+
+    return -EINVAL;
+}
+
+static int trace_events_seq_start(struct seq_file *seq)
+{
+    if (seq->iter_offset == &__tracepoint_end - &__tracepoint_start + 1)
+        flag_set(&seq->flags, SEQ_FILE_DONE);
+
+    return 0;
+}
+
+/* Offset zero is the header, the tracepoints come after it */
+static int trace_events_seq_render(struct seq_file *seq)
+{
+    if (seq->iter_offset == 0)
+        return seq_printf(seq, "name\tenabled\thits\n");
+
+    struct tracepoint *tp = &__tracepoint_start + seq->iter_offset - 1;
+
+    return seq_printf(seq, "%s\t%d\t%u\n", tp->name, READ_ONCE(tp->enabled), READ_ONCE(tp->hits));
+}
+
+static int trace_events_seq_next(struct seq_file *seq)
+{
+    seq->iter_offset++;
+
+    if (seq->iter_offset == &__tracepoint_end - &__tracepoint_start + 1)
+        flag_set(&seq->flags, SEQ_FILE_DONE);
+
+    return 0;
+}
+
+static void trace_seq_end(struct seq_file *seq)
+{
+
+}
+
+const static struct seq_file_ops trace_events_seq_file_ops = {
+    .start = trace_events_seq_start,
+    .next = trace_events_seq_next,
+    .render = trace_events_seq_render,
+    .end = trace_seq_end,
+};
+
+static int trace_events_file_seq_open(struct inode *inode, struct file *filp)
+{
+    return seq_open(filp, &trace_events_seq_file_ops);
+}
+
+static const struct file_ops trace_events_file_ops = {
+    .open = trace_events_file_seq_open,
+    .lseek = seq_lseek,
+    .read = seq_read,
+    .ioctl = trace_ioctl,
+    .release = seq_release,
+};
+
+/*
+ * Reading /proc/trace/buffer takes a copy of every complete event currently
+ * in the rings, which is then formatted one line at a time.
+ */
+struct trace_snapshot {
+    int count;
+    struct trace_event events[];
+};
+
+static int trace_ring_copy(struct trace_ring *ring, struct trace_event *dest)
+{
+    uint32_t head = atomic32_get(&ring->head);
+    uint32_t start = (head > ring->capacity)? head - ring->capacity: 0;
+    uint32_t i;
+    int count = 0;
+
+    if (start < ring->cleared)
+        start = ring->cleared;
+
+    for (i = start; i != head; i++) {
+        struct trace_event *event = ring->events + (i & (ring->capacity - 1));
+
+        if (READ_ONCE(event->seq) != i + 1)
+            continue;
+
+        dest[count] = *event;
+        barrier();
+
+        /* Overwritten while we were copying it */
+        if (READ_ONCE(event->seq) != i + 1)
+            continue;
+
+        count++;
+    }
+
+    return count;
+}
+
+static struct trace_snapshot *trace_snapshot_take(void)
+{
+    struct trace_snapshot *snap;
+    uint32_t total = 0;
+    int i;
+
+    for (i = 0; i < TRACE_CPUS; i++)
+        total += trace_rings[i].capacity;
+
+    snap = kmalloc(sizeof(*snap) + sizeof(*snap->events) * total, PAL_KERNEL);
+    if (!snap)
+        return NULL;
+
+    snap->count = 0;
+
+    for (i = 0; i < TRACE_CPUS; i++)
+        if (trace_rings[i].events)
+            snap->count += trace_ring_copy(trace_rings + i, snap->events + snap->count);
+
+    return snap;
+}
+
+static int trace_buffer_seq_start(struct seq_file *seq)
+{
+    if (!seq->priv) {
+        seq->priv = trace_snapshot_take();
+        if (!seq->priv)
+            return -ENOMEM;
+    }
+
+    struct trace_snapshot *snap = seq->priv;
+
+    if (seq->iter_offset == snap->count)
+        flag_set(&seq->flags, SEQ_FILE_DONE);
+
+    return 0;
+}
+
+static int trace_buffer_seq_render(struct seq_file *seq)
+{
+    struct trace_snapshot *snap = seq->priv;
+    struct trace_event *event = snap->events + seq->iter_offset;
+    uint32_t *a = event->args;
+    int ret;
+
+    ret = seq_printf(seq, "%llu.%06llu %d %d %s: ",
+            event->timestamp_ns / 1000000000,
+            (event->timestamp_ns % 1000000000) / 1000,
+            event->cpu, event->pid, event->tp->name);
+    if (ret < 0)
+        return ret;
+
+    ret = seq_printf(seq, event->tp->fmt, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+    if (ret < 0)
+        return ret;
+
+    return seq_printf(seq, "\n");
+}
+
+static int trace_buffer_seq_next(struct seq_file *seq)
+{
+    struct trace_snapshot *snap = seq->priv;
+
+    seq->iter_offset++;
+
+    if (seq->iter_offset == snap->count)
+        flag_set(&seq->flags, SEQ_FILE_DONE);
+
+    return 0;
+}
+
+const static struct seq_file_ops trace_buffer_seq_file_ops = {
+    .start = trace_buffer_seq_start,
+    .next = trace_buffer_seq_next,
+    .render = trace_buffer_seq_render,
+    .end = trace_seq_end,
+};
+
+static int trace_buffer_file_seq_open(struct inode *inode, struct file *filp)
+{
+    return seq_open(filp, &trace_buffer_seq_file_ops);
+}
+
+static int trace_buffer_file_release(struct file *filp)
+{
+    struct seq_file *seq = filp->priv_data;
+
+    if (seq->priv)
+        kfree(seq->priv);
+
+    return seq_release(filp);
+}
+
+static const struct file_ops trace_buffer_file_ops = {
+    .open = trace_buffer_file_seq_open,
+    .lseek = seq_lseek,
+    .read = seq_read,
+    .release = trace_buffer_file_release,
+};
+
+static void trace_init(void)
+{
+    int i;
+
+    for (i = 0; i < TRACE_CPUS; i++) {
+        struct trace_event *events = palloc_va(TRACE_BUFFER_ORDER, PAL_KERNEL);
+        if (!events) {
+            kp(KP_WARNING, "trace: Unable to allocate ring buffer for CPU %d\n", i);
+            continue;
+        }
+
+        memset(events, 0, PG_SIZE << TRACE_BUFFER_ORDER);
+
+        trace_rings[i].capacity = (PG_SIZE << TRACE_BUFFER_ORDER) / sizeof(*events);
+        trace_rings[i].events = events;
+    }
+}
+initcall_core(trace, trace_init);
+
+static void trace_procfs_init(void)
+{
+    struct procfs_dir *trace_dir = procfs_register_dir(&procfs_root, "trace");
+
+    procfs_register_entry(trace_dir, "events", &trace_events_file_ops);
+    procfs_register_entry(trace_dir, "buffer", &trace_buffer_file_ops);
+}
+initcall_device(trace_procfs, trace_procfs_init);
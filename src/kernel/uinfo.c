@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2020 Matt Kilgore
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License v2 as published by the
+ * Free Software Foundation.
+ */
+
+#include <protura/types.h>
+#include <protura/debug.h>
+#include <protura/compiler.h>
+#include <protura/mm/kmalloc.h>
+#include <protura/mm/palloc.h>
+#include <protura/mm/memlayout.h>
+#include <protura/mm/ptable.h>
+#include <protura/mm/vm.h>
+#include <protura/task.h>
+#include <arch/irq.h>
+#include <arch/timer.h>
+#include <protura/uinfo.h>
+
+/* The uinfo pages sit directly below the program stack */
+STATIC_ASSERT(__kUINFO_TIME_ADDR + PG_SIZE == __kUINFO_TASK_ADDR);
+STATIC_ASSERT(__kUINFO_TASK_ADDR + PG_SIZE == CONFIG_KERNEL_BASE - CONFIG_KERNEL_PROGRAM_STACK * PG_SIZE);
+
+/* Lives in the kernel image so that it is usable before palloc is setup */
+static union {
+    struct uinfo_time time;
+    char page[PG_SIZE];
+} uinfo_time_page __align(PG_SIZE);
+
+static void uinfo_time_write_begin(struct uinfo_time *t)
+{
+    t->seq++;
+    barrier();
+}
+
+static void uinfo_time_write_end(struct uinfo_time *t)
+{
+    barrier();
+    t->seq++;
+}
+
+/*
+ * Writers are the timer interrupt and protura_boot_time_set(). The second
+ * only happens once during boot, so we only need to keep the timer interrupt
+ * out while updating.
+ */
+void uinfo_time_update(uint64_t tick_ns, uint64_t tick_tsc, uint32_t tsc_mult, uint32_t tsc_shift)
+{
+    struct uinfo_time *t = &uinfo_time_page.time;
+
+    uinfo_time_write_begin(t);
+
+    t->tsc_mult = tsc_mult;
+    t->tsc_shift = tsc_shift;
+    t->nsec_per_tick = TIMER_NSEC_PER_TICK;
+    t->tick_ns = tick_ns;
+    t->tick_tsc = tick_tsc;
+
+    uinfo_time_write_end(t);
+}
+
+void uinfo_time_set_realtime_offset(int64_t offset_ns)
+{
+    struct uinfo_time *t = &uinfo_time_page.time;
+    irq_flags_t irq_flags;
+
+    irq_flags = irq_save();
+    irq_disable();
+
+    uinfo_time_write_begin(t);
+    t->realtime_offset_ns = offset_ns;
+    uinfo_time_write_end(t);
+
+    irq_restore(irq_flags);
+}
+
+void uinfo_set_flags(uint32_t flags)
+{
+    uinfo_time_page.time.flags |= flags;
+}
+
+/* Writes to the uinfo pages are never valid, and there's nothing to fault in */
+static int uinfo_fill_page(struct vm_map *map, va_t address)
+{
+    return -EFAULT;
+}
+
+static const struct vm_map_ops uinfo_map_ops = {
+    .fill_page = uinfo_fill_page,
+};
+
+static void uinfo_add_map(struct address_space *addrspc, va_t addr, pa_t page)
+{
+    struct vm_map *map = kmalloc(sizeof(*map), PAL_KERNEL);
+    vm_map_init(map);
+
+    map->addr.start = addr;
+    map->addr.end = addr + PG_SIZE;
+    map->ops = &uinfo_map_ops;
+
+    /* The backing pages are not owned by the address_space. We also don't
+     * want the PTEs copied on fork, since the task page needs to be the new
+     * task's page. */
+    flag_set(&map->flags, VM_MAP_READ);
+    flag_set(&map->flags, VM_MAP_IGNORE);
+    flag_set(&map->flags, VM_MAP_NOFORK);
+
+    address_space_vm_map_add(addrspc, map);
+
+    page_table_map_entry(addrspc->page_dir, addr, page, map->flags, PCM_CACHED);
+}
+
+void uinfo_map(struct address_space *addrspc, struct task *t)
+{
+    if (!addrspc->uinfo_page) {
+        addrspc->uinfo_page = pzalloc(0, PAL_KERNEL);
+        if (!addrspc->uinfo_page)
+            panic("uinfo: Unable to allocate task page!\n");
+    }
+
+    struct uinfo_task *task_info = addrspc->uinfo_page->virt;
+
+    task_info->pid = t->pid;
+    task_info->ppid = t->parent? t->parent->pid: -1;
+
+    uinfo_add_map(addrspc, UINFO_TIME_ADDR, V2P(&uinfo_time_page));
+    uinfo_add_map(addrspc, UINFO_TASK_ADDR, page_to_pa(addrspc->uinfo_page));
+}
+
+void uinfo_task_update_ppid(struct task *t)
+{
+    struct uinfo_task *task_info;
+
+    if (!t->addrspc || !t->addrspc->uinfo_page)
+        return;
+
+    /* CLONE_VM tasks share the page of the task that owns the
+     * address_space, their own parent doesn't go in it */
+    task_info = t->addrspc->uinfo_page->virt;
+    if (task_info->pid == t->pid)
+        task_info->ppid = t->parent? t->parent->pid: -1;
+}
@@ -32,6 +32,7 @@
 #include <protura/fs/super.h>
 #include <protura/net/sys.h>
 #include <protura/utsname.h>
+#include <protura/time.h>
 #include <protura/ktest.h>
 
 static void syscall_open_test(struct ktest *kt)
@@ -233,6 +234,12 @@ static void syscall_gettimeofday_test(struct ktest *kt)
     ktest_assert_equal(kt, -EFAULT, ret);
 }
 
+static void syscall_clock_gettime_test(struct ktest *kt)
+{
+    int ret = sys_clock_gettime(CLOCK_MONOTONIC, KT_ARG(kt, 0, struct user_buffer));
+    ktest_assert_equal(kt, -EFAULT, ret);
+}
+
 static void syscall_setgroups_test(struct ktest *kt)
 {
     int ret = sys_setgroups(2, KT_ARG(kt, 0, struct user_buffer));
@@ -576,6 +583,11 @@ static const struct ktest_unit syscall_test_units[] = {
             (KT_USER_BUF(0xBFFFFFFE)),
             (KT_USER_BUF(0xC0200000))),
 
+    KTEST_UNIT("syscall-clock-gettime-test", syscall_clock_gettime_test,
+            (KT_USER_BUF(NULL)),
+            (KT_USER_BUF(0xBFFFFFFE)),
+            (KT_USER_BUF(0xC0200000))),
+
     KTEST_UNIT("syscall-setgroups-test", syscall_setgroups_test,
             (KT_USER_BUF(NULL)),
             (KT_USER_BUF(0xBFFFFFFE)),
@@ -13,6 +13,7 @@
 #include <protura/mm/memlayout.h>
 #include <protura/mm/kmalloc.h>
 #include <protura/mm/slab.h>
+#include <protura/kstat.h>
 
 /* An important note to readers:
  *
@@ -65,6 +66,9 @@ void kmalloc_oom(void)
 void *kmalloc(size_t size, int flags)
 {
     struct slab_alloc *slab;
+
+    kstat_inc(KSTAT_KMALLOCS);
+
     for (slab = kmalloc_slabs; slab->slab_name; slab++)
         if (size <= slab->object_size)
             return slab_malloc(slab, flags);
@@ -117,6 +121,9 @@ size_t ksize(void *p)
 void kfree(void *p)
 {
     struct slab_alloc *slab;
+
+    kstat_inc(KSTAT_KFREES);
+
     for (slab = kmalloc_slabs; slab->slab_name; slab++) {
         if (slab_has_addr(slab, p) == 0) {
             slab_free(slab, p);
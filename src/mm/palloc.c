@@ -19,6 +19,7 @@
 #include <protura/block/bcache.h>
 #include <protura/backtrace.h>
 #include <protura/mm/bootmem.h>
+#include <protura/kstat.h>
 
 #include <protura/mm/palloc.h>
 
@@ -46,8 +47,10 @@ struct page_buddy_alloc {
 
 static struct page_buddy_map buddy_maps[PALLOC_MAPS];
 
+DEFINE_LOCK_CLASS(buddy_allocator_lock_class, "buddy_allocator.lock");
+
 static struct page_buddy_alloc buddy_allocator = {
-    .lock = SPINLOCK_INIT(),
+    .lock = SPINLOCK_INIT_CLASS(buddy_allocator_lock_class),
     .pages = NULL,
     .page_count = 0,
 
@@ -146,11 +149,15 @@ void pfree(struct page *p, int order)
     if (!atomic_dec_and_test(&p->use_count))
         return;
 
+    kstat_add(KSTAT_PAGE_FREES, 1 << order);
+
     using_spinlock(&buddy_allocator.lock) {
         __pfree_add_pages(&buddy_allocator, p->page_number, order);
 
+        /* Freeing 2^order pages can satisfy at most 2^(order - i) waiters
+         * of order i */
         for (i = 0; i <= order; i++)
-            wait_queue_wake(&buddy_allocator.maps[i].wait_for_free);
+            wait_queue_wake_nr(&buddy_allocator.maps[i].wait_for_free, 1 << (order - i));
     }
 }
 
@@ -201,7 +208,7 @@ static void __palloc_sleep_for_enough_pages(struct page_buddy_alloc *alloc, int
         __oom();
     }
 
-    wait_queue_event_spinlock(&alloc->maps[order].wait_for_free, alloc->free_pages >= (1 << order), &alloc->lock);
+    wait_queue_event_spinlock_exclusive(&alloc->maps[order].wait_for_free, alloc->free_pages >= (1 << order), &alloc->lock);
 }
 
 static struct page *__palloc_phys_multiple(struct page_buddy_alloc *alloc, int order, unsigned int flags)
@@ -245,6 +252,9 @@ struct page *palloc(int order, unsigned int flags)
     using_spinlock(&buddy_allocator.lock)
         p = __palloc_phys_multiple(&buddy_allocator, order, flags);
 
+    if (p)
+        kstat_add(KSTAT_PAGE_ALLOCS, 1 << order);
+
     pa_t pa = page_to_pa(p);
     if (pa >= V2P(&kern_start) && pa < V2P(&kern_end)) {
         kp(KP_ERROR, "palloc() is returning a page that's part of the kernel!!!\n");
@@ -271,6 +281,8 @@ int palloc_unordered(list_head_t *head, int count, unsigned int flags)
         }
     }
 
+    kstat_add(KSTAT_PAGE_ALLOCS, count);
+
     return 0;
 }
 
@@ -46,12 +46,10 @@ static struct vm_map *create_bss(struct address_space *addrspc)
     return bss;
 }
 
-void *sys_sbrk(intptr_t increment)
+static void *__sbrk(struct address_space *addrspc, intptr_t increment)
 {
     struct vm_map *bss;
     va_t old;
-    struct task *t = cpu_get_local()->current;
-    struct address_space *addrspc = t->addrspc;
 
     bss = addrspc->bss;
 
@@ -71,21 +69,28 @@ void *sys_sbrk(intptr_t increment)
     return old;
 }
 
-void sys_brk(va_t new_end)
+void *sys_sbrk(intptr_t increment)
+{
+    struct address_space *addrspc = cpu_get_local()->current->addrspc;
+
+    using_mutex(&addrspc->lock)
+        return __sbrk(addrspc, increment);
+}
+
+static void __brk(struct address_space *addrspc, va_t new_end)
 {
     struct vm_map *bss;
-    struct task *t = cpu_get_local()->current;
     va_t new_end_aligned;
 
     new_end_aligned = PG_ALIGN(new_end);
-    bss = t->addrspc->bss;
+    bss = addrspc->bss;
 
-    t->addrspc->brk = new_end;
+    addrspc->brk = new_end;
 
     /* Check if we have a bss segment, and create a new one after the end of
      * the code segment if we don't */
     if (!bss)
-        bss = create_bss(t->addrspc);
+        bss = create_bss(addrspc);
 
     /* Expand or shrink the current bss segment */
     if (bss->addr.start >= new_end && bss->addr.end < new_end_aligned)
@@ -93,3 +98,11 @@ void sys_brk(va_t new_end)
     else if (bss->addr.start > new_end) /* Can happen since the "bss" can start at the end of the data segment */
         vm_map_resize(bss, (struct vm_region) { .start = bss->addr.start, .end = bss->addr.start + PG_SIZE });
 }
+
+void sys_brk(va_t new_end)
+{
+    struct address_space *addrspc = cpu_get_local()->current->addrspc;
+
+    using_mutex(&addrspc->lock)
+        __brk(addrspc, new_end);
+}
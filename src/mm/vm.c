@@ -30,16 +30,37 @@ static int mmap_private_fill_page(struct vm_map *map, va_t address)
 }
 
 
-int address_space_handle_pagefault(struct address_space *addrspc, va_t address)
+static int __address_space_handle_pagefault(struct address_space *addrspc, va_t address, int is_write)
 {
+    struct task *current = cpu_get_local()->current;
     struct vm_map *map;
+    int ret;
 
     list_foreach_entry(&addrspc->vm_maps, map, address_space_entry) {
         if (address >= map->addr.start && address < map->addr.end) {
+            pte_t *pte = page_table_get_entry(addrspc->page_dir, address);
+
+            if (is_write && !vm_map_is_writeable(map))
+                return -EFAULT;
+
+            /* If the page is already there, then either another task sharing
+             * this address_space faulted it in first, or this was a write to
+             * a page that isn't writable yet */
+            if (pte && pte_exists(pte) && (!is_write || pte_writable(pte))) {
+                task_rusage_fault(current, 0);
+                return 0;
+            }
+
             if (map->ops && map->ops->fill_page)
-                return (map->ops->fill_page) (map, address);
+                ret = (map->ops->fill_page) (map, address);
             else
-                return mmap_private_fill_page(map, address);
+                ret = mmap_private_fill_page(map, address);
+
+            /* Only file mappings have to do I/O to fill the page */
+            if (!ret)
+                task_rusage_fault(current, !!map->filp);
+
+            return ret;
         }
     }
 
@@ -47,6 +68,12 @@ int address_space_handle_pagefault(struct address_space *addrspc, va_t address)
     return -EFAULT;
 }
 
+int address_space_handle_pagefault(struct address_space *addrspc, va_t address, int is_write)
+{
+    using_mutex(&addrspc->lock)
+        return __address_space_handle_pagefault(addrspc, address, is_write);
+}
+
 void address_space_change(struct address_space *new)
 {
     struct task *current = cpu_get_local()->current;
@@ -55,30 +82,47 @@ void address_space_change(struct address_space *new)
     current->addrspc = new;
     page_table_change(new->page_dir);
 
-    address_space_clear(old);
-    kfree(old);
+    address_space_put(old);
 }
 
-void address_space_clear(struct address_space *addrspc)
+static void vm_map_free_pages(struct address_space *addrspc, struct vm_map *map)
 {
-    struct vm_map *map;
+    int page_count = (map->addr.end - map->addr.start) / PG_SIZE;
 
-    list_foreach_take_entry(&addrspc->vm_maps, map, address_space_entry) {
-        int page_count = (map->addr.end - map->addr.start) / PG_SIZE;
+    if (flag_test(&map->flags, VM_MAP_IGNORE))
+        page_table_zap_range(addrspc->page_dir, map->addr.start, page_count);
+    else
+        page_table_free_range(addrspc->page_dir, map->addr.start, page_count);
 
-        if (flag_test(&map->flags, VM_MAP_IGNORE))
-            page_table_zap_range(addrspc->page_dir, map->addr.start, page_count);
-        else
-            page_table_free_range(addrspc->page_dir, map->addr.start, page_count);
+    if (map->filp)
+        vfs_close(map->filp);
+}
 
-        if (map->filp)
-            vfs_close(map->filp);
+void address_space_clear(struct address_space *addrspc)
+{
+    struct vm_map *map;
 
+    list_foreach_take_entry(&addrspc->vm_maps, map, address_space_entry) {
+        vm_map_free_pages(addrspc, map);
         kfree(map);
     }
 
     page_table_free(addrspc->page_dir);
     addrspc->page_dir = NULL;
+
+    if (addrspc->uinfo_page) {
+        pfree(addrspc->uinfo_page, 0);
+        addrspc->uinfo_page = NULL;
+    }
+}
+
+void address_space_put(struct address_space *addrspc)
+{
+    if (!atomic_dec_and_test(&addrspc->refs))
+        return;
+
+    address_space_clear(addrspc);
+    kfree(addrspc);
 }
 
 static struct vm_map *vm_map_copy(struct address_space *new, struct address_space *old, struct vm_map *old_map)
@@ -143,8 +187,18 @@ void address_space_copy(struct address_space *new, struct address_space *old)
 
 void address_space_vm_map_add(struct address_space *addrspc, struct vm_map *map)
 {
-    list_add(&addrspc->vm_maps, &map->address_space_entry);
+    struct vm_map *cur;
+
     map->owner = addrspc;
+
+    list_foreach_entry(&addrspc->vm_maps, cur, address_space_entry) {
+        if (cur->addr.start > map->addr.start) {
+            list_add_before(&cur->address_space_entry, &map->address_space_entry);
+            return;
+        }
+    }
+
+    list_add_tail(&addrspc->vm_maps, &map->address_space_entry);
 }
 
 void address_space_vm_map_remove(struct address_space *addrspc, struct vm_map *map)
@@ -153,6 +207,13 @@ void address_space_vm_map_remove(struct address_space *addrspc, struct vm_map *m
     map->owner = NULL;
 }
 
+void address_space_vm_map_free(struct address_space *addrspc, struct vm_map *map)
+{
+    address_space_vm_map_remove(addrspc, map);
+    vm_map_free_pages(addrspc, map);
+    kfree(map);
+}
+
 static void vm_map_resize_start(struct vm_map *map, va_t new_start)
 {
     pgd_t *pgd = map->owner->page_dir;
@@ -194,33 +255,27 @@ void vm_map_resize(struct vm_map *map, struct vm_region new_size)
 
 int address_space_find_region(struct address_space *addrspc, size_t size, struct vm_region *region)
 {
-    struct vm_map *prev = NULL;
     struct vm_map *map;
+    va_t bottom = MMAP_START_ADDRS;
 
     size = ALIGN_2(size, PG_SIZE);
 
+    /* vm_maps is sorted, so we just walk it looking for the first gap above
+     * MMAP_START_ADDRS that is big enough */
     list_foreach_entry(&addrspc->vm_maps, map, address_space_entry) {
-        if (map->addr.start > MMAP_START_ADDRS)
+        if (map->addr.end <= bottom)
+            continue;
+
+        if (map->addr.start >= bottom && (size_t)(map->addr.start - bottom) >= size)
             break;
 
-        prev = map;
+        bottom = map->addr.end;
     }
 
-    va_t bottom;
-    if (prev)
-        bottom = ((MMAP_START_ADDRS < prev->addr.end)? prev->addr.end: MMAP_START_ADDRS);
-    else
-        bottom = MMAP_START_ADDRS;
-
-
-    /* Calculate the ammount of space we have in the intended MMAP location */
-    size_t space_after_addrs = (map->addr.start - bottom);
+    if (bottom + size > KMEM_PROG_STACK_END || bottom + size < bottom)
+        return -ENOMEM;
 
-    if (space_after_addrs >= size) {
-        region->start = bottom;
-        region->end = region->start + size;
-        return 0;
-    }
-
-    return -ENOMEM;
+    region->start = bottom;
+    region->end = bottom + size;
+    return 0;
 }
@@ -33,7 +33,7 @@ static void ip_raw_rx(struct protocol *proto, struct socket *sock, struct packet
 {
     using_mutex(&sock->recv_lock) {
         list_add_tail(&sock->recv_queue, &packet->packet_entry);
-        wait_queue_wake(&sock->recv_wait_queue);
+        wait_queue_wake_one(&sock->recv_wait_queue);
     }
 }
 
@@ -137,7 +137,6 @@ extern int tcp_max_log_level;
 #define kp_udp_warning(str, ...) kp_udp_check_level(KP_WARNING, str, ## __VA_ARGS__)
 #define kp_udp_error(str, ...)   kp_udp_check_level(KP_ERROR, str, ## __VA_ARGS__)
 
-#define kp_tcp_trace(str, ...)   kp_tcp_check_level(KP_TRACE, str, ## __VA_ARGS__)
 #define kp_tcp_debug(str, ...)   kp_tcp_check_level(KP_DEBUG, str, ## __VA_ARGS__)
 #define kp_tcp(str, ...)         kp_tcp_check_level(KP_NORMAL, str, ## __VA_ARGS__)
 #define kp_tcp_warning(str, ...) kp_tcp_check_level(KP_WARNING, str, ## __VA_ARGS__)
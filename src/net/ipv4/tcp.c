@@ -14,6 +14,7 @@
 #include <protura/wait.h>
 #include <protura/snprintf.h>
 #include <protura/list.h>
+#include <protura/trace.h>
 #include <arch/asm.h>
 
 #include <protura/net/socket.h>
@@ -23,6 +24,9 @@
 #include "ipv4.h"
 #include "tcp.h"
 
+DEFINE_TRACEPOINT(tcp_connect, "src="PRin_addr":%d dest="PRin_addr":%d");
+DEFINE_TRACEPOINT(tcp_connect_done, "state=%d err=%d");
+
 #define TCP_LOWEST_AUTOBIND_PORT 50000
 
 static struct protocol_ops tcp_protocol_ops;
@@ -110,8 +114,6 @@ static int tcp_connect(struct protocol *proto, struct socket *sock, const struct
 
     const struct sockaddr_in *in = (const struct sockaddr_in *)addr;
 
-    kp_tcp_trace("TCP connect...\n");
-
     if (len < sizeof(*in))
         return -EFAULT;
 
@@ -152,7 +154,8 @@ static int tcp_connect(struct protocol *proto, struct socket *sock, const struct
                 break;
             }
 
-            kp_tcp_trace("Adding tcp socket, src_port: %d, src_addr: "PRin_addr", dest_port: %d, dest_addr: "PRin_addr"\n", ntohs(test_lookup.src_port), Pin_addr(test_lookup.src_addr), ntohs(test_lookup.dest_port), Pin_addr(test_lookup.dest_addr));
+            trace(tcp_connect, Pin_addr(test_lookup.src_addr), ntohs(test_lookup.src_port),
+                  Pin_addr(test_lookup.dest_addr), ntohs(test_lookup.dest_port));
 
             __ipaf_add_socket(af, sock);
         }
@@ -173,7 +176,6 @@ static int tcp_connect(struct protocol *proto, struct socket *sock, const struct
         priv->snd_wl1 = 0;
         priv->rcv_nxt = 0;
 
-        kp_tcp_trace("TCP connect sending SYN packet...\n");
         tcp_send_syn(proto, sock);
         priv->snd_nxt++;
     }
@@ -189,7 +191,7 @@ static int tcp_connect(struct protocol *proto, struct socket *sock, const struct
     if (ret)
         return ret;
 
-    kp_tcp_trace("Socket: got state_changed signal current state: %d, last_err: %d\n", cur_state, last_err);
+    trace(tcp_connect_done, cur_state, last_err);
 
     if (last_err || cur_state != SOCKET_CONNECTED)
         return last_err;
@@ -228,8 +230,6 @@ static void tcp_release(struct protocol *proto, struct socket *sock)
     tcp_timers_reset(sock);
 
     using_mutex(&sock->recv_lock) {
-        kp_tcp_trace("Recv queue is empty: %d\n", list_empty(&sock->recv_queue));
-
         struct packet *packet;
 
         list_foreach_take_entry(&sock->recv_queue, packet, packet_entry)
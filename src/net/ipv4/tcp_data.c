@@ -13,6 +13,7 @@
 #include <protura/mm/kmalloc.h>
 #include <protura/snprintf.h>
 #include <protura/list.h>
+#include <protura/trace.h>
 #include <arch/asm.h>
 
 #include <protura/net/socket.h>
@@ -24,6 +25,9 @@
 
 #define TCP_DELACK_TIMER_MS 100
 
+DEFINE_TRACEPOINT(tcp_ooo_queue, "seq=%u len=%d rcv_nxt=%u");
+DEFINE_TRACEPOINT(tcp_recv_data, "seq=%u len=%d rcv_nxt=%u");
+
 /* out-of-order packets should be added to the queue in order of their segment */
 static void add_to_ooo_queue(struct socket *sock, struct packet *packet)
 {
@@ -31,23 +35,18 @@ static void add_to_ooo_queue(struct socket *sock, struct packet *packet)
 
     struct packet *cur, *tmp;
 
-    kp_tcp_trace("Adding packet to OOO queue...\n");
-
     /* FIXME: It may be unlikely, but segments could contain overlapping data,
      * and we should make sure we don't duplicate that data back to the caller */
     list_foreach_entry_safe(&sock->out_of_order_queue, cur, tmp, packet_entry) {
         struct tcp_packet_cb *cur_seg = &cur->cb.tcp;
 
         if (tcp_seq_before(seg->seq, cur_seg->seq)) {
-            kp_tcp_trace("Adding packet %u before packet %u\n", seg->seq, cur_seg->seq);
-
             /* list_add_tail places it before the current segment */
             list_add_tail(&cur->packet_entry, &packet->packet_entry);
             return;
         }
     }
 
-    kp_tcp_trace("Adding packet %u at the end!\n", seg->seq);
     /* The packet is past every entry in the queue */
     list_add_tail(&sock->out_of_order_queue, &packet->packet_entry);
 }
@@ -64,7 +63,7 @@ static void socket_recv_packet(struct socket *sock, struct packet *packet)
         tcp_fin(sock, packet);
     }
 
-    kp_tcp_trace("RECV packet seq: %u, len: %d, new rcv_nxt: %u\n", cur_seg->seq, packet_len(packet), priv->rcv_nxt);
+    trace(tcp_recv_data, cur_seg->seq, packet_len(packet), priv->rcv_nxt);
     list_add_tail(&sock->recv_queue, &packet->packet_entry);
 }
 
@@ -75,11 +74,9 @@ static void consolidate_ooo_queue(struct socket *sock)
     struct tcp_socket_private *priv = &sock->proto_private.tcp;
     struct packet *cur, *tmp;
 
-    kp_tcp_trace("OOO consolidation...\n");
     list_foreach_entry_safe(&sock->out_of_order_queue, cur, tmp, packet_entry) {
         struct tcp_packet_cb *cur_seg = &cur->cb.tcp;
 
-        kp_tcp_trace("OOO packet seq: %u, rcv_nxt: %u...\n", cur_seg->seq, priv->rcv_nxt);
         if (cur_seg->seq == priv->rcv_nxt) {
             list_del(&cur->packet_entry);
             socket_recv_packet(sock, cur);
@@ -97,14 +94,13 @@ void tcp_recv_data(struct protocol *proto, struct socket *sock, struct packet *p
         return;
     }
 
-    kp_tcp_trace("seq: %u, rcv_nxt: %u\n", seg->seq, priv->rcv_nxt);
     if (seg->seq == priv->rcv_nxt) {
 
         using_mutex(&sock->recv_lock) {
             socket_recv_packet(sock, packet);
             consolidate_ooo_queue(sock);
 
-            wait_queue_wake(&sock->recv_wait_queue);
+            wait_queue_wake_one(&sock->recv_wait_queue);
         }
 
         tcp_delack_timer_start(sock, TCP_DELACK_TIMER_MS);
@@ -114,6 +110,8 @@ void tcp_recv_data(struct protocol *proto, struct socket *sock, struct packet *p
          * add it to the out-of-order queue
          */
 
+        trace(tcp_ooo_queue, seg->seq, packet_len(packet), priv->rcv_nxt);
+
         using_mutex(&sock->recv_lock)
             add_to_ooo_queue(sock, packet);
 
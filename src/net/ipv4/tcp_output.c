@@ -13,6 +13,7 @@
 #include <protura/mm/kmalloc.h>
 #include <protura/snprintf.h>
 #include <protura/list.h>
+#include <protura/trace.h>
 #include <arch/asm.h>
 
 #include <protura/net/socket.h>
@@ -22,6 +23,10 @@
 #include "ipv4.h"
 #include "tcp.h"
 
+DEFINE_TRACEPOINT(tcp_send, "sport=%d dport=%d flags=0x%02x seq=%u ack_seq=%u len=%d");
+DEFINE_TRACEPOINT(tcp_send_noroute, "ret=%d");
+DEFINE_TRACEPOINT(tcp_send_reset, "src="PRin_addr" dest="PRin_addr);
+
 static void tcp_send_inner(struct protocol *proto, struct packet *packet)
 {
     struct tcp_packet_cb *cb = &packet->cb.tcp;
@@ -45,7 +50,7 @@ static void tcp_send_inner(struct protocol *proto, struct packet *packet)
     head->window = htons(cb->window);
     head->urg_ptr = htons(0);
 
-    kp_tcp_trace("TCP send packet, flags: 0x%02x, seq: %u, ack_seq: %u, len: %d\n", cb->flags.flags, cb->seq, cb->ack_seq, packet_len(packet));
+    trace(tcp_send, ntohs(head->source), ntohs(head->dest), cb->flags.flags, cb->seq, cb->ack_seq, packet_len(packet));
 
     packet->protocol_type = IPPROTO_TCP;
 
@@ -58,8 +63,8 @@ static void tcp_send_inner(struct protocol *proto, struct packet *packet)
 void tcp_send_raw(struct protocol *proto, struct packet *packet, n16 src_port, n32 dest_addr, n16 dest_port)
 {
     int ret = ip_packet_fill_raw(packet, dest_addr);
-    kp_tcp_trace("TCP send packet, ip route ret: %d\n", ret);
     if (ret) {
+        trace(tcp_send_noroute, ret);
         packet_free(packet);
         return;
     }
@@ -75,8 +80,8 @@ void tcp_send(struct protocol *proto, struct socket *sock, struct packet *packet
     struct ipv4_socket_private *ip_priv = &sock->af_private.ipv4;
 
     int ret = ip_packet_fill_route(sock, packet);
-    kp_tcp_trace("TCP send packet, ip route ret: %d\n", ret);
     if (ret) {
+        trace(tcp_send_noroute, ret);
         packet_free(packet);
         return;
     }
@@ -148,7 +153,7 @@ void tcp_send_reset(struct protocol *proto, struct packet *old_packet)
         cb->flags.rst = 1;
     }
 
-    kp_tcp_trace("RESET, SrcIP: "PRin_addr", DestIP: "PRin_addr"\n", Pin_addr(ip_head->source_ip), Pin_addr(ip_head->dest_ip));
+    trace(tcp_send_reset, Pin_addr(ip_head->source_ip), Pin_addr(ip_head->dest_ip));
     tcp_send_raw(proto, packet, tcp_head->dest, ip_head->source_ip, tcp_head->source);
 
   release_old_packet:
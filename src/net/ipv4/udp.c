@@ -117,7 +117,7 @@ void udp_rx(struct protocol *proto, struct socket *sock, struct packet *packet)
 
     using_mutex(&sock->recv_lock) {
         list_add_tail(&sock->recv_queue, &packet->packet_entry);
-        wait_queue_wake(&sock->recv_wait_queue);
+        wait_queue_wake_one(&sock->recv_wait_queue);
     }
 }
 
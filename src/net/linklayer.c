@@ -38,10 +38,8 @@ void packet_linklayer_rx(struct packet *packet)
 {
     struct ether_header *ehead;
 
-    using_netdev_write(packet->iface_rx) {
-        packet->iface_rx->metrics.rx_packets++;
-        packet->iface_rx->metrics.rx_bytes += packet_len(packet);
-    }
+    percpu_counter_inc(&packet->iface_rx->rx_packets);
+    percpu_counter_add(&packet->iface_rx->rx_bytes, packet_len(packet));
 
     ehead = packet->head;
     packet->ll_head = ehead;
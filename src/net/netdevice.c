@@ -151,8 +151,10 @@ static int ifreq_get_flags(struct ifreq *ifreq, struct net_interface *iface)
 
 static int ifreq_get_metrics(struct ifreq *ifreq, struct net_interface *iface)
 {
-    using_netdev_read(iface)
-        ifreq->ifr_metrics = iface->metrics;
+    ifreq->ifr_metrics.rx_packets = percpu_counter_sum(&iface->rx_packets);
+    ifreq->ifr_metrics.tx_packets = percpu_counter_sum(&iface->tx_packets);
+    ifreq->ifr_metrics.rx_bytes = percpu_counter_sum(&iface->rx_bytes);
+    ifreq->ifr_metrics.tx_bytes = percpu_counter_sum(&iface->tx_bytes);
 
     return 0;
 }
@@ -22,8 +22,12 @@
 #include <protura/net/linklayer.h>
 #include <protura/net.h>
 
+/* Packet processing runs as real-time so that it isn't starved by CPU-bound
+ * user tasks */
+#define PACKET_QUEUE_RT_PRIORITY 50
+
 static atomic_t queue_count = ATOMIC_INIT(0);
-static struct workqueue packet_queue = WORKQUEUE_INIT(packet_queue);
+static struct workqueue packet_queue = WORKQUEUE_INIT_RT(packet_queue, PACKET_QUEUE_RT_PRIORITY);
 
 static void packet_process(struct work *work)
 {
@@ -59,10 +63,8 @@ void net_packet_transmit(struct packet *packet)
     struct net_interface *iface = packet->iface_tx;
 
     if (flag_test(&iface->flags, NET_IFACE_UP)) {
-        using_netdev_write(iface) {
-            iface->metrics.tx_packets++;
-            iface->metrics.tx_bytes += packet_len(packet);
-        }
+        percpu_counter_inc(&iface->tx_packets);
+        percpu_counter_add(&iface->tx_bytes, packet_len(packet));
 
         using_spinlock(&iface->tx_lock)
             list_add_tail(&iface->tx_packet_queue, &packet->packet_entry);
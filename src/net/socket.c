@@ -20,6 +20,10 @@
 #include <protura/net/socket.h>
 #include <protura/net.h>
 
+DEFINE_LOCK_CLASS(socket_private_lock_class, "socket.private_lock");
+DEFINE_LOCK_CLASS(socket_recv_lock_class, "socket.recv_lock");
+DEFINE_LOCK_CLASS(socket_send_lock_class, "socket.send_lock");
+
 static mutex_t socket_list_lock = MUTEX_INIT(socket_list_lock);
 static atomic_t open_sockets = ATOMIC_INIT(0);
 static list_head_t socket_list = LIST_HEAD_INIT(socket_list);
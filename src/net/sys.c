@@ -372,9 +372,9 @@ int sys_socket(int afamily, int type, int protocol)
     }
 
     if (type & SOCK_CLOEXEC)
-        FD_SET(fd, &current->close_on_exec);
+        FD_SET(fd, &current->files->close_on_exec);
     else
-        FD_CLR(fd, &current->close_on_exec);
+        FD_CLR(fd, &current->files->close_on_exec);
 
     kp(KP_NORMAL, "Created socket: "PRinode"\n", Pinode(&inode->i));
 
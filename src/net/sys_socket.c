@@ -83,7 +83,7 @@ int socket_recvfrom(struct socket *socket, struct user_buffer buf, size_t len, i
     using_mutex(&socket->recv_lock) {
         if (list_empty(&socket->recv_queue)) {
             if (!nonblock)
-                ret = wait_queue_event_intr_mutex(&socket->recv_wait_queue, !list_empty(&socket->recv_queue), &socket->recv_lock);
+                ret = wait_queue_event_intr_mutex_exclusive(&socket->recv_wait_queue, !list_empty(&socket->recv_queue), &socket->recv_lock);
             else
                 ret = -EAGAIN;
         }
@@ -126,6 +126,11 @@ int socket_recvfrom(struct socket *socket, struct user_buffer buf, size_t len, i
                 list_del(&packet->packet_entry);
                 packet_free(packet);
             }
+
+            /* Receivers are woken one at a time, pass it on if there's still
+             * data left for the next one */
+            if (!list_empty(&socket->recv_queue))
+                wait_queue_wake_one(&socket->recv_wait_queue);
         }
     }
 
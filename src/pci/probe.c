@@ -11,6 +11,7 @@
 #include <protura/string.h>
 #include <protura/mm/kmalloc.h>
 #include <protura/snprintf.h>
+#include <protura/kparam.h>
 #include <arch/asm.h>
 
 #include <protura/fs/procfs.h>
@@ -67,6 +68,9 @@ static const struct pci_driver pci_drivers[] = {
 
 list_head_t pci_dev_list = LIST_HEAD_INIT(pci_dev_list);
 
+static int pci_msi_allowed = 1;
+KPARAM("pci.msi", &pci_msi_allowed, KPARAM_BOOL);
+
 #define PCI_CLASS_X \
     X(NONE, "No PCI Class"), \
     X(MASS_STORAGE, "Mass Storage Device"), \
@@ -312,6 +316,9 @@ static void pci_check_dev(struct pci_dev_info *dev)
     else if (cla)
         kp(KP_NORMAL, "  - %s\n", cla);
 
+    if (pci_find_capability(&dev->id, PCI_CAP_ID_MSI))
+        kp(KP_NORMAL, "  - MSI capable\n");
+
     pci_add_dev_entry(entry);
 
     if (dev->header_type & PCI_HEADER_IS_BRIDGE) {
@@ -420,3 +427,62 @@ int pci_has_interrupt_line(struct pci_dev *dev)
 
     return result == 0xFE;
 }
+
+uint8_t pci_find_capability(struct pci_dev *dev, uint8_t cap_id)
+{
+    uint16_t status = pci_config_read_uint16(dev, PCI_REG_STATUS);
+    uint8_t offset;
+    int i;
+
+    if (!(status & PCI_STATUS_CAP_LIST))
+        return 0;
+
+    offset = pci_config_read_uint8(dev, PCI_REG_CAP_PTR) & 0xFC;
+
+    /* The loop limit guards against a broken device giving us a cycle. There
+     * can't be more capabilities than fit in the config space after the
+     * header */
+    for (i = 0; offset && i < 48; i++) {
+        if (pci_config_read_uint8(dev, offset + PCI_CAP_REG_ID) == cap_id)
+            return offset;
+
+        offset = pci_config_read_uint8(dev, offset + PCI_CAP_REG_NEXT) & 0xFC;
+    }
+
+    return 0;
+}
+
+int pci_has_msi(struct pci_dev *dev)
+{
+    return pci_msi_allowed && pci_find_capability(dev, PCI_CAP_ID_MSI);
+}
+
+int pci_msi_enable(struct pci_dev *dev, uint32_t address, uint16_t data)
+{
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_ID_MSI);
+    uint16_t control, command;
+
+    if (!cap)
+        return -ENODEV;
+
+    control = pci_config_read_uint16(dev, cap + PCI_MSI_REG_CONTROL);
+
+    pci_config_write_uint32(dev, cap + PCI_MSI_REG_ADDR_LOW, address);
+
+    if (control & PCI_MSI_CONTROL_64BIT) {
+        pci_config_write_uint32(dev, cap + PCI_MSI_REG_ADDR_HIGH, 0);
+        pci_config_write_uint16(dev, cap + PCI_MSI_REG_DATA_64, data);
+    } else {
+        pci_config_write_uint16(dev, cap + PCI_MSI_REG_DATA_32, data);
+    }
+
+    /* We only ever ask for one vector */
+    control &= ~PCI_MSI_CONTROL_MME_MASK;
+    control |= PCI_MSI_CONTROL_ENABLE;
+    pci_config_write_uint16(dev, cap + PCI_MSI_REG_CONTROL, control);
+
+    command = pci_config_read_uint16(dev, PCI_REG_COMMAND);
+    pci_config_write_uint16(dev, PCI_REG_COMMAND, command | PCI_COMMAND_INT_DISABLE);
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+#!/bin/bash
+#
+# Boots the kernel, dumps /proc/boot_timing, and checks that the time taken to
+# get to init hasn't regressed
+#
+# Argument 1: Kernel image
+# Argument 2: First disk image
+# Argument 3: Second disk image
+# Argument 4: test results directory
+
+PREFIX="boot"
+
+KERNEL=$1
+DISK_ONE=$2
+DISK_TWO=$3
+TEST_PREFIX=$4
+
+QEMU_PID=
+
+# Arg 1: Argument file
+# Arg 2: Qemu debug log
+# Arg 3: Test output
+# Arg 4: Qemu error log
+function run_boot_test {
+    args=""
+    max_boot_to_init_us=0
+
+    . $1
+
+    timeout 120 qemu-system-i386 \
+        -serial file:$2 \
+        -debugcon file:$3 \
+        -d cpu_reset \
+        -drive format=raw,file=$DISK_ONE,cache=none,media=disk,index=0,if=ide \
+        -drive format=raw,file=$DISK_TWO,media=disk,index=1,if=ide \
+        -display none \
+        -no-reboot \
+        -kernel $KERNEL \
+        -append "init=/tests/boot/dump_boot_timing.sh reboot_on_panic=1" \
+        $args \
+        2> "$4" &
+
+    QEMU_PID=$!
+}
+
+function dump_kernel_log {
+    unset GREP_COLORS
+
+    cat "$1" | GREP_COLOR="1;31" grep --line-buffered --color=always -E "^.*\[E\].*$|$"
+}
+
+# Arg 1: Test output
+function dump_slowest_initcalls {
+    echo "Slowest initcalls:"
+    grep -v "_us" "$1" | sort -t$'\t' -k3 -n -r | head -n 5 | sed -e 's/^/    /'
+}
+
+TESTS=$(find ./tests/testcases/boot/ -name "*.args" | xargs basename -a -s .args)
+
+for test in $TESTS; do
+    TESTCASE=$test
+
+    TEST_ARGS=./tests/testcases/boot/$test.args
+
+    TEST_QEMU_LOG=${TEST_PREFIX}/$test.qemu.log
+    TEST_QEMU_ERR_LOG=${TEST_PREFIX}/$test.qemu.err.log
+    TEST_OUTPUT_LOG=${TEST_PREFIX}/$test.output.log
+
+    rm -fr $TEST_QEMU_LOG
+    touch $TEST_QEMU_LOG
+
+    rm -fr $TEST_OUTPUT_LOG
+    touch $TEST_OUTPUT_LOG
+
+    run_boot_test "$TEST_ARGS" "$TEST_QEMU_LOG" "$TEST_OUTPUT_LOG" "$TEST_QEMU_ERR_LOG"
+
+    wait $QEMU_PID
+    assert_success_named "Timeout" "Timeout! Kernel log:" dump_kernel_log "$TEST_QEMU_LOG"
+
+    BOOT_TO_INIT_US=$(awk -F'\t' '$1 == "boot_to_init_us" { print $2 }' "$TEST_OUTPUT_LOG")
+
+    [ -n "$BOOT_TO_INIT_US" ]
+    assert_success_named "Output" "No boot_to_init_us in /proc/boot_timing:" cat "$TEST_OUTPUT_LOG"
+
+    [ -n "$BOOT_TO_INIT_US" ] && [ "$BOOT_TO_INIT_US" -le "$max_boot_to_init_us" ]
+    assert_success_named "Boot time" "Boot to init took ${BOOT_TO_INIT_US}us, more than ${max_boot_to_init_us}us" dump_slowest_initcalls "$TEST_OUTPUT_LOG"
+done
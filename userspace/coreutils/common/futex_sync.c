@@ -0,0 +1,99 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+
+#include "sys_raw.h"
+#include "futex_sync.h"
+
+static inline uint32_t cmpxchg(volatile uint32_t *ptr, uint32_t old, uint32_t new)
+{
+    __atomic_compare_exchange_n(ptr, &old, new, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+    return old;
+}
+
+static inline uint32_t xchg(volatile uint32_t *ptr, uint32_t val)
+{
+    return __atomic_exchange_n(ptr, val, __ATOMIC_ACQUIRE);
+}
+
+void futex_mutex_lock(struct futex_mutex *mut)
+{
+    uint32_t c = cmpxchg(&mut->val, 0, 1);
+
+    if (!c)
+        return;
+
+    /* Mark the mutex as contended, so that the unlock knows to wake us */
+    if (c != 2)
+        c = xchg(&mut->val, 2);
+
+    while (c) {
+        sys_raw_futex(&mut->val, FUTEX_WAIT, 2, 0, NULL);
+        c = xchg(&mut->val, 2);
+    }
+}
+
+int futex_mutex_trylock(struct futex_mutex *mut)
+{
+    if (cmpxchg(&mut->val, 0, 1) == 0)
+        return 0;
+
+    errno = EBUSY;
+    return -1;
+}
+
+void futex_mutex_unlock(struct futex_mutex *mut)
+{
+    if (__atomic_fetch_sub(&mut->val, 1, __ATOMIC_RELEASE) != 1) {
+        __atomic_store_n(&mut->val, 0, __ATOMIC_RELEASE);
+        sys_raw_futex(&mut->val, FUTEX_WAKE, 1, 0, NULL);
+    }
+}
+
+int futex_cond_wait(struct futex_cond *cond, struct futex_mutex *mut)
+{
+    uint32_t seq = __atomic_load_n(&cond->seq, __ATOMIC_ACQUIRE);
+    int ret = 0;
+
+    cond->mutex = mut;
+    futex_mutex_unlock(mut);
+
+    /* If seq changed between the unlock and the wait, the futex returns
+     * EAGAIN right away and we don't miss the wakeup */
+    if (sys_raw_futex(&cond->seq, FUTEX_WAIT, seq, 0, NULL) == -1 && errno == EINTR)
+        ret = -1;
+
+    /* We may have been requeued onto the mutex by a broadcast, and other
+     * waiters may be behind us, so always take it as contended */
+    while (xchg(&mut->val, 2))
+        sys_raw_futex(&mut->val, FUTEX_WAIT, 2, 0, NULL);
+
+    if (ret)
+        errno = EINTR;
+
+    return ret;
+}
+
+void futex_cond_signal(struct futex_cond *cond)
+{
+    __atomic_fetch_add(&cond->seq, 1, __ATOMIC_RELEASE);
+    sys_raw_futex(&cond->seq, FUTEX_WAKE, 1, 0, NULL);
+}
+
+void futex_cond_broadcast(struct futex_cond *cond)
+{
+    struct futex_mutex *mut = cond->mutex;
+
+    __atomic_fetch_add(&cond->seq, 1, __ATOMIC_RELEASE);
+
+    if (!mut) {
+        sys_raw_futex(&cond->seq, FUTEX_WAKE, INT_MAX, 0, NULL);
+        return;
+    }
+
+    /* We hold the mutex, so it's safe to mark it contended. That ensures our
+     * unlock wakes the first of the requeued waiters */
+    xchg(&mut->val, 2);
+    sys_raw_futex(&cond->seq, FUTEX_REQUEUE, 1, INT_MAX, &mut->val);
+}
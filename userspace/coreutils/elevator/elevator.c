@@ -0,0 +1,132 @@
+// elevator - Display or change the I/O scheduler of a disk
+#define UTILITY_NAME "elevator"
+
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <protura/block/elevator.h>
+
+#include "arg_parser.h"
+
+#define ELEVATOR_FILE "/proc/elevator"
+
+static const char *arg_str = "[Flags] [disk elevator]";
+static const char *usage_str = "Display the I/O scheduler used by each disk, or change the one used by a disk.\n";
+static const char *arg_desc_str  = "disk: The disk to change, Ex. hda\n"
+                                   "elevator: One of the elevators listed for the disk\n";
+
+#define XARGS \
+    X(help, "help", 'h', 0, NULL, "Display help") \
+    X(version, "version", 'v', 0, NULL, "Display version information") \
+    X(last, NULL, '\0', 0, NULL, NULL)
+
+enum arg_index {
+  ARG_EXTRA = ARG_PARSER_EXTRA,
+  ARG_ERR = ARG_PARSER_ERR,
+  ARG_DONE = ARG_PARSER_DONE,
+#define X(enu, ...) ARG_ENUM(enu)
+  XARGS
+#undef X
+};
+
+static const struct arg args[] = {
+#define X(...) CREATE_ARG(__VA_ARGS__)
+  XARGS
+#undef X
+};
+
+const char *prog_name;
+
+static int elevator_list(void)
+{
+    char buf[1024];
+    ssize_t len;
+
+    int fd = open(ELEVATOR_FILE, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "%s: %s: %s\n", prog_name, ELEVATOR_FILE, strerror(errno));
+        return 1;
+    }
+
+    while ((len = read(fd, buf, sizeof(buf))) > 0)
+        fwrite(buf, 1, len, stdout);
+
+    if (len == -1)
+        fprintf(stderr, "%s: %s: %s\n", prog_name, ELEVATOR_FILE, strerror(errno));
+
+    close(fd);
+    return len == -1;
+}
+
+static int elevator_set(const char *disk, const char *elevator)
+{
+    struct elevator_select select;
+
+    memset(&select, 0, sizeof(select));
+    strncpy(select.disk, disk, sizeof(select.disk) - 1);
+    strncpy(select.elevator, elevator, sizeof(select.elevator) - 1);
+
+    int fd = open(ELEVATOR_FILE, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "%s: %s: %s\n", prog_name, ELEVATOR_FILE, strerror(errno));
+        return 1;
+    }
+
+    int err = ioctl(fd, ELEVATORIO_SET, &select);
+    if (err == -1)
+        fprintf(stderr, "%s: %s: %s\n", prog_name, disk, strerror(errno));
+
+    close(fd);
+    return err == -1;
+}
+
+int main(int argc, char **argv)
+{
+    enum arg_index ret;
+    const char *disk = NULL, *elevator = NULL;
+
+    prog_name = argv[0];
+
+    while ((ret = arg_parser(argc, argv, args)) != ARG_DONE) {
+        switch (ret) {
+        case ARG_help:
+            display_help_text(argv[0], arg_str, usage_str, arg_desc_str, args);
+            return 0;
+
+        case ARG_version:
+            printf("%s", version_text);
+            return 0;
+
+        case ARG_EXTRA:
+            if (!disk) {
+                disk = argarg;
+            } else if (!elevator) {
+                elevator = argarg;
+            } else {
+                fprintf(stderr, "%s: Unexpected argument '%s'\n", prog_name, argarg);
+                return 1;
+            }
+            break;
+
+        case ARG_ERR:
+        default:
+            return 0;
+        }
+    }
+
+    if (!disk)
+        return elevator_list();
+
+    if (!elevator) {
+        fprintf(stderr, "%s: No elevator given for %s\n", prog_name, disk);
+        return 1;
+    }
+
+    return elevator_set(disk, elevator);
+}
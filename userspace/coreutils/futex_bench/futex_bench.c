@@ -0,0 +1,130 @@
+// futex_bench - Benchmark the futex-based mutex and condvar helpers
+#define UTILITY_NAME "futex_bench"
+
+#include "common.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "sys_raw.h"
+#include "futex_sync.h"
+
+/*
+ * Compares the cost of the futex mutex paths against the old alternative of
+ * spinning with yield(). Every number is in TSC cycles per operation.
+ *
+ * The contended numbers come from CLONE_VM threads all hammering one mutex,
+ * and double as a check that the threads really share memory.
+ */
+
+#define ITERATIONS 100000
+#define THREADS 4
+
+static struct futex_mutex contended_mut = FUTEX_MUTEX_INIT;
+static volatile int contended_counter;
+
+static inline uint64_t rdtsc(void)
+{
+    uint32_t a, d;
+
+    asm volatile("rdtsc" : "=a" (a), "=d" (d));
+
+    return ((uint64_t)a) | (((uint64_t)d) << 32);
+}
+
+static void report(const char *name, uint64_t cycles)
+{
+    printf("%-24s %12llu cycles total, %6llu cycles/op\n", name,
+            (unsigned long long)cycles,
+            (unsigned long long)(cycles / ITERATIONS));
+}
+
+static void contended_thread(void *arg)
+{
+    int i;
+
+    for (i = 0; i < ITERATIONS / THREADS; i++) {
+        futex_mutex_lock(&contended_mut);
+        contended_counter++;
+        futex_mutex_unlock(&contended_mut);
+    }
+
+    _exit(0);
+}
+
+static uint64_t contended_run(void)
+{
+    pid_t pids[THREADS];
+    uint64_t start;
+    int i;
+
+    contended_counter = 0;
+
+    start = rdtsc();
+    for (i = 0; i < THREADS; i++) {
+        pids[i] = sys_raw_clone(CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND, contended_thread, NULL);
+        if (pids[i] == -1) {
+            perror("clone");
+            exit(1);
+        }
+    }
+
+    for (i = 0; i < THREADS; i++)
+        waitpid(pids[i], NULL, 0);
+
+    uint64_t cycles = rdtsc() - start;
+
+    if (contended_counter != (ITERATIONS / THREADS) * THREADS) {
+        printf("contended counter is %d, expected %d!\n", contended_counter, (ITERATIONS / THREADS) * THREADS);
+        exit(1);
+    }
+
+    return cycles;
+}
+
+int main(int argc, char **argv)
+{
+    struct futex_mutex mut = FUTEX_MUTEX_INIT;
+    struct futex_cond cond = FUTEX_COND_INIT;
+    volatile uint32_t word = 0;
+    uint64_t start;
+    int i;
+
+    start = rdtsc();
+    for (i = 0; i < ITERATIONS; i++) {
+        futex_mutex_lock(&mut);
+        futex_mutex_unlock(&mut);
+    }
+    report("mutex lock/unlock", rdtsc() - start);
+
+    /* Force the contended unlock path, which always does a FUTEX_WAKE */
+    start = rdtsc();
+    for (i = 0; i < ITERATIONS; i++) {
+        futex_mutex_lock(&mut);
+        mut.val = 2;
+        futex_mutex_unlock(&mut);
+    }
+    report("mutex contended unlock", rdtsc() - start);
+
+    start = rdtsc();
+    for (i = 0; i < ITERATIONS; i++)
+        futex_cond_signal(&cond);
+    report("cond signal", rdtsc() - start);
+
+    start = rdtsc();
+    for (i = 0; i < ITERATIONS; i++)
+        sys_raw_futex(&word, FUTEX_WAIT, 1, 0, NULL);
+    report("FUTEX_WAIT (EAGAIN)", rdtsc() - start);
+
+    start = rdtsc();
+    for (i = 0; i < ITERATIONS; i++)
+        sys_raw_syscall3(SYSCALL_YIELD, 0, 0, 0);
+    report("yield", rdtsc() - start);
+
+    report("mutex contended (threads)", contended_run());
+
+    return 0;
+}
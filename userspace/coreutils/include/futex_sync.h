@@ -0,0 +1,42 @@
+#ifndef COMMON_FUTEX_SYNC_H
+#define COMMON_FUTEX_SYNC_H
+
+#include <stdint.h>
+
+/*
+ * Simple mutex and condition variable built on the futex() syscall. The
+ * uncontended paths never enter the kernel.
+ *
+ * The futex is keyed on the address space, so these only synchronize tasks
+ * that share their memory.
+ */
+
+/* 0: unlocked, 1: locked, 2: locked with (possible) waiters */
+struct futex_mutex {
+    volatile uint32_t val;
+};
+
+#define FUTEX_MUTEX_INIT { .val = 0 }
+
+struct futex_cond {
+    volatile uint32_t seq;
+    struct futex_mutex *mutex;
+};
+
+#define FUTEX_COND_INIT { .seq = 0, .mutex = NULL }
+
+void futex_mutex_lock(struct futex_mutex *);
+int futex_mutex_trylock(struct futex_mutex *);
+void futex_mutex_unlock(struct futex_mutex *);
+
+/* Returns zero on a wake-up, -1 with errno set to EINTR if a signal
+ * interrupted the wait. The mutex is always re-acquired before returning. */
+int futex_cond_wait(struct futex_cond *, struct futex_mutex *);
+void futex_cond_signal(struct futex_cond *);
+
+/* Must be called with the mutex held. Rather than waking every waiter just to
+ * have them fight over the mutex, only one is woken and the rest are
+ * requeued onto the mutex */
+void futex_cond_broadcast(struct futex_cond *);
+
+#endif
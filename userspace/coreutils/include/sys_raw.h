@@ -0,0 +1,103 @@
+#ifndef COMMON_SYS_RAW_H
+#define COMMON_SYS_RAW_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <protura/syscall.h>
+#include <protura/sched.h>
+#include <protura/futex.h>
+
+#ifndef FUTEX_WAIT
+# define FUTEX_WAIT    __kFUTEX_WAIT
+# define FUTEX_WAKE    __kFUTEX_WAKE
+# define FUTEX_REQUEUE __kFUTEX_REQUEUE
+#endif
+
+#ifndef CLONE_VM
+# define CLONE_VM      __kCLONE_VM
+# define CLONE_FS      __kCLONE_FS
+# define CLONE_FILES   __kCLONE_FILES
+# define CLONE_SIGHAND __kCLONE_SIGHAND
+#endif
+
+#ifndef PRIO_PROCESS
+# define PRIO_PROCESS __kPRIO_PROCESS
+# define PRIO_PGRP    __kPRIO_PGRP
+# define PRIO_USER    __kPRIO_USER
+#endif
+
+/*
+ * Direct access to Protura syscalls that newlib doesn't (yet) have wrappers
+ * for. The kernel returns -errno on failure, the wrappers turn that into the
+ * normal -1 and errno convention.
+ */
+
+static inline int sys_raw_syscall3(int sys, int arg1, int arg2, int arg3)
+{
+    int ret;
+
+    asm volatile("int $0x81"
+                 : "=a" (ret)
+                 : "a" (sys), "b" (arg1), "c" (arg2), "d" (arg3)
+                 : "memory");
+
+    return ret;
+}
+
+static inline int sys_raw_syscall5(int sys, int arg1, int arg2, int arg3, int arg4, int arg5)
+{
+    int ret;
+
+    asm volatile("int $0x81"
+                 : "=a" (ret)
+                 : "a" (sys), "b" (arg1), "c" (arg2), "d" (arg3), "S" (arg4), "D" (arg5)
+                 : "memory");
+
+    return ret;
+}
+
+static inline int sys_raw_ret(int ret)
+{
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+
+    return ret;
+}
+
+static inline int sys_raw_setpriority(int which, int who, int prio)
+{
+    return sys_raw_ret(sys_raw_syscall3(SYSCALL_SETPRIORITY, which, who, prio));
+}
+
+/* Returns the nice value directly - since -1 is a valid nice value, clear
+ * errno beforehand to check for errors */
+static inline int sys_raw_getpriority(int which, int who)
+{
+    int ret = sys_raw_syscall3(SYSCALL_GETPRIORITY, which, who, 0);
+
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+
+    return __kNICE_TO_PRIO(ret);
+}
+
+/* `arg` is a `struct timespec *` for FUTEX_WAIT, and the number of waiters
+ * to requeue for FUTEX_REQUEUE */
+static inline int sys_raw_futex(volatile uint32_t *uaddr, int op, uint32_t val, uintptr_t arg, volatile uint32_t *uaddr2)
+{
+    return sys_raw_ret(sys_raw_syscall5(SYSCALL_FUTEX, (int)uaddr, op, (int)val, (int)arg, (int)uaddr2));
+}
+
+/* With CLONE_VM the kernel allocates the child's stack and starts it at
+ * `entry(arg)`. `entry` must never return, it has to finish with _exit().
+ * Returns the child's pid, the child itself never returns from this call. */
+static inline int sys_raw_clone(int flags, void (*entry)(void *), void *arg)
+{
+    return sys_raw_ret(sys_raw_syscall3(SYSCALL_CLONE, flags, (int)entry, (int)arg));
+}
+
+#endif
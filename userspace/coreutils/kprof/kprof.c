@@ -0,0 +1,168 @@
+// kprof - Control the kernel sampling profiler
+#define UTILITY_NAME "kprof"
+
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <protura/kprof.h>
+
+#include "arg_parser.h"
+
+#define KPROF_FLAT_FILE "/proc/kprof/flat"
+#define KPROF_FOLDED_FILE "/proc/kprof/folded"
+
+static const char *arg_str = "[Flags] <command>";
+static const char *usage_str = "Control the kernel sampling profiler.\n";
+static const char *arg_desc_str  = "command: One of:\n"
+                                   "  start  - Start taking samples\n"
+                                   "  stop   - Stop taking samples, keeping the recorded ones\n"
+                                   "  reset  - Throw away all the recorded samples\n"
+                                   "  status - Display the profiler state\n"
+                                   "  flat   - Display the samples per function\n"
+                                   "  folded - Display the samples as folded stacks, for flamegraph.pl\n";
+
+#define XARGS \
+    X(help, "help", 'h', 0, NULL, "Display help") \
+    X(version, "version", 'v', 0, NULL, "Display version information") \
+    X(depth, "depth", 'd', 1, "N", "Record N return addresses per sample with start (Default 0)") \
+    X(last, NULL, '\0', 0, NULL, NULL)
+
+enum arg_index {
+  ARG_EXTRA = ARG_PARSER_EXTRA,
+  ARG_ERR = ARG_PARSER_ERR,
+  ARG_DONE = ARG_PARSER_DONE,
+#define X(enu, ...) ARG_ENUM(enu)
+  XARGS
+#undef X
+};
+
+static const struct arg args[] = {
+#define X(...) CREATE_ARG(__VA_ARGS__)
+  XARGS
+#undef X
+};
+
+const char *prog_name;
+
+static int kprof_dump(const char *file)
+{
+    char buf[1024];
+    ssize_t len;
+
+    int fd = open(file, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "%s: %s: %s\n", prog_name, file, strerror(errno));
+        return 1;
+    }
+
+    while ((len = read(fd, buf, sizeof(buf))) > 0)
+        fwrite(buf, 1, len, stdout);
+
+    if (len == -1)
+        fprintf(stderr, "%s: %s: %s\n", prog_name, file, strerror(errno));
+
+    close(fd);
+    return len == -1;
+}
+
+static int kprof_control(int cmd, void *arg)
+{
+    int fd = open(KPROF_FLAT_FILE, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "%s: %s: %s\n", prog_name, KPROF_FLAT_FILE, strerror(errno));
+        return 1;
+    }
+
+    int err = ioctl(fd, cmd, arg);
+    if (err == -1)
+        fprintf(stderr, "%s: ioctl: %s\n", prog_name, strerror(errno));
+
+    close(fd);
+    return err == -1;
+}
+
+static int kprof_status(void)
+{
+    struct kprof_status status;
+    memset(&status, 0, sizeof(status));
+
+    if (kprof_control(KPROFIO_STATUS, &status))
+        return 1;
+
+    printf("State: %s\n", status.running? "running": "stopped");
+    printf("Depth: %d\n", status.depth);
+    printf("Rate: %dHz\n", status.sample_hz);
+    printf("Samples: %u\n", status.samples);
+    printf("Overwritten: %u\n", status.overwritten);
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    enum arg_index ret;
+    const char *command = NULL;
+    int depth = 0;
+
+    prog_name = argv[0];
+
+    while ((ret = arg_parser(argc, argv, args)) != ARG_DONE) {
+        switch (ret) {
+        case ARG_help:
+            display_help_text(argv[0], arg_str, usage_str, arg_desc_str, args);
+            return 0;
+
+        case ARG_version:
+            printf("%s", version_text);
+            return 0;
+
+        case ARG_depth:
+            depth = atoi(argarg);
+            if (depth < 0 || depth > KPROF_MAX_DEPTH) {
+                fprintf(stderr, "%s: Depth must be between 0 and %d\n", prog_name, KPROF_MAX_DEPTH);
+                return 1;
+            }
+            break;
+
+        case ARG_EXTRA:
+            if (!command) {
+                command = argarg;
+            } else {
+                fprintf(stderr, "%s: Unexpected argument '%s'\n", prog_name, argarg);
+                return 1;
+            }
+            break;
+
+        case ARG_ERR:
+        default:
+            return 0;
+        }
+    }
+
+    if (!command) {
+        display_help_text(argv[0], arg_str, usage_str, arg_desc_str, args);
+        return 1;
+    }
+
+    if (strcmp(command, "start") == 0)
+        return kprof_control(KPROFIO_START, &depth);
+    else if (strcmp(command, "stop") == 0)
+        return kprof_control(KPROFIO_STOP, NULL);
+    else if (strcmp(command, "reset") == 0)
+        return kprof_control(KPROFIO_RESET, NULL);
+    else if (strcmp(command, "status") == 0)
+        return kprof_status();
+    else if (strcmp(command, "flat") == 0)
+        return kprof_dump(KPROF_FLAT_FILE);
+    else if (strcmp(command, "folded") == 0)
+        return kprof_dump(KPROF_FOLDED_FILE);
+
+    fprintf(stderr, "%s: Unknown command '%s'\n", prog_name, command);
+    return 1;
+}
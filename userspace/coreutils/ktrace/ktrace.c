@@ -0,0 +1,175 @@
+// ktrace - Control the kernel tracepoints
+#define UTILITY_NAME "ktrace"
+
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <protura/trace.h>
+
+#include "arg_parser.h"
+
+#define TRACE_EVENTS_FILE "/proc/trace/events"
+#define TRACE_BUFFER_FILE "/proc/trace/buffer"
+
+static const char *arg_str = "[Flags] <command> [tracepoints...]";
+static const char *usage_str = "Control the kernel tracepoints.\n";
+static const char *arg_desc_str  = "command: One of:\n"
+                                   "  list    - Display every tracepoint and whether it is enabled\n"
+                                   "  enable  - Enable the listed tracepoints, or 'all'\n"
+                                   "  disable - Disable the listed tracepoints, or 'all'\n"
+                                   "  clear   - Throw away all the recorded events\n"
+                                   "  show    - Display the recorded events\n";
+
+#define XARGS \
+    X(help, "help", 'h', 0, NULL, "Display help") \
+    X(version, "version", 'v', 0, NULL, "Display version information") \
+    X(last, NULL, '\0', 0, NULL, NULL)
+
+enum arg_index {
+  ARG_EXTRA = ARG_PARSER_EXTRA,
+  ARG_ERR = ARG_PARSER_ERR,
+  ARG_DONE = ARG_PARSER_DONE,
+#define X(enu, ...) ARG_ENUM(enu)
+  XARGS
+#undef X
+};
+
+static const struct arg args[] = {
+#define X(...) CREATE_ARG(__VA_ARGS__)
+  XARGS
+#undef X
+};
+
+#define MAX_NAMES 32
+
+const char *prog_name;
+
+static int ktrace_dump(const char *file)
+{
+    char buf[1024];
+    ssize_t len;
+
+    int fd = open(file, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "%s: %s: %s\n", prog_name, file, strerror(errno));
+        return 1;
+    }
+
+    while ((len = read(fd, buf, sizeof(buf))) > 0)
+        fwrite(buf, 1, len, stdout);
+
+    if (len == -1)
+        fprintf(stderr, "%s: %s: %s\n", prog_name, file, strerror(errno));
+
+    close(fd);
+    return len == -1;
+}
+
+static int ktrace_set(int cmd, const char **names, int name_count)
+{
+    int i, ret = 0;
+
+    if (!name_count) {
+        fprintf(stderr, "%s: No tracepoints given\n", prog_name);
+        return 1;
+    }
+
+    int fd = open(TRACE_EVENTS_FILE, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "%s: %s: %s\n", prog_name, TRACE_EVENTS_FILE, strerror(errno));
+        return 1;
+    }
+
+    for (i = 0; i < name_count; i++) {
+        struct trace_name name;
+
+        memset(&name, 0, sizeof(name));
+        strncpy(name.name, names[i], sizeof(name.name) - 1);
+
+        if (ioctl(fd, cmd, &name) == -1) {
+            fprintf(stderr, "%s: %s: %s\n", prog_name, names[i], strerror(errno));
+            ret = 1;
+        }
+    }
+
+    close(fd);
+    return ret;
+}
+
+static int ktrace_clear(void)
+{
+    int fd = open(TRACE_EVENTS_FILE, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "%s: %s: %s\n", prog_name, TRACE_EVENTS_FILE, strerror(errno));
+        return 1;
+    }
+
+    int err = ioctl(fd, TRACEIO_CLEAR, NULL);
+    if (err == -1)
+        fprintf(stderr, "%s: ioctl: %s\n", prog_name, strerror(errno));
+
+    close(fd);
+    return err == -1;
+}
+
+int main(int argc, char **argv)
+{
+    enum arg_index ret;
+    const char *command = NULL;
+    const char *names[MAX_NAMES];
+    int name_count = 0;
+
+    prog_name = argv[0];
+
+    while ((ret = arg_parser(argc, argv, args)) != ARG_DONE) {
+        switch (ret) {
+        case ARG_help:
+            display_help_text(argv[0], arg_str, usage_str, arg_desc_str, args);
+            return 0;
+
+        case ARG_version:
+            printf("%s", version_text);
+            return 0;
+
+        case ARG_EXTRA:
+            if (!command) {
+                command = argarg;
+            } else if (name_count < MAX_NAMES) {
+                names[name_count++] = argarg;
+            } else {
+                fprintf(stderr, "%s: Too many tracepoints, at most %d can be given\n", prog_name, MAX_NAMES);
+                return 1;
+            }
+            break;
+
+        case ARG_ERR:
+        default:
+            return 0;
+        }
+    }
+
+    if (!command) {
+        display_help_text(argv[0], arg_str, usage_str, arg_desc_str, args);
+        return 1;
+    }
+
+    if (strcmp(command, "list") == 0)
+        return ktrace_dump(TRACE_EVENTS_FILE);
+    else if (strcmp(command, "enable") == 0)
+        return ktrace_set(TRACEIO_ENABLE, names, name_count);
+    else if (strcmp(command, "disable") == 0)
+        return ktrace_set(TRACEIO_DISABLE, names, name_count);
+    else if (strcmp(command, "clear") == 0)
+        return ktrace_clear();
+    else if (strcmp(command, "show") == 0)
+        return ktrace_dump(TRACE_BUFFER_FILE);
+
+    fprintf(stderr, "%s: Unknown command '%s'\n", prog_name, command);
+    return 1;
+}
@@ -0,0 +1,113 @@
+// nice - Run a command with a modified scheduling priority
+#define UTILITY_NAME "nice"
+
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "arg_parser.h"
+#include "sys_raw.h"
+
+static const char *arg_str = "[Flags] [command [args]]";
+static const char *usage_str = "Run command with an adjusted niceness, or print the current niceness.\n";
+static const char *arg_desc_str  = "command: The command to run, along with its arguments.\n"
+                                   "Niceness ranges from -20 (highest priority) to 19 (lowest priority).\n";
+
+#define XARGS \
+    X(help, "help", 'h', 0, NULL, "Display help") \
+    X(version, "version", 'v', 0, NULL, "Display version information") \
+    X(adjustment, "adjustment", 'n', 1, "N", "Add N to the niceness (Default 10)") \
+    X(pid, "pid", 'p', 1, "pid", "Set the niceness of an existing process to N instead") \
+    X(last, NULL, '\0', 0, NULL, NULL)
+
+enum arg_index {
+  ARG_EXTRA = ARG_PARSER_EXTRA,
+  ARG_ERR = ARG_PARSER_ERR,
+  ARG_DONE = ARG_PARSER_DONE,
+#define X(enu, ...) ARG_ENUM(enu)
+  XARGS
+#undef X
+};
+
+static const struct arg args[] = {
+#define X(...) CREATE_ARG(__VA_ARGS__)
+  XARGS
+#undef X
+};
+
+static int adjustment = 10;
+static int adjustment_given = 0;
+static pid_t target_pid = 0;
+static char **command = NULL;
+
+int main(int argc, char **argv)
+{
+    enum arg_index ret;
+
+    while (!command && (ret = arg_parser(argc, argv, args)) != ARG_DONE) {
+        switch (ret) {
+        case ARG_help:
+            display_help_text(argv[0], arg_str, usage_str, arg_desc_str, args);
+            return 0;
+        case ARG_version:
+            printf("%s", version_text);
+            return 0;
+
+        case ARG_adjustment:
+            adjustment = atoi(argarg);
+            adjustment_given = 1;
+            break;
+
+        case ARG_pid:
+            target_pid = atoi(argarg);
+            break;
+
+        case ARG_EXTRA:
+            /* Everything from the first non-flag argument on is the command */
+            command = argv + current_arg - 1;
+            break;
+
+        case ARG_ERR:
+        default:
+            return 1;
+        }
+    }
+
+    if (target_pid) {
+        if (!adjustment_given) {
+            fprintf(stderr, "%s: -p requires a niceness given via -n\n", argv[0]);
+            return 1;
+        }
+
+        if (sys_raw_setpriority(PRIO_PROCESS, target_pid, adjustment) == -1) {
+            perror("setpriority");
+            return 1;
+        }
+
+        return 0;
+    }
+
+    errno = 0;
+    int nice = sys_raw_getpriority(PRIO_PROCESS, 0);
+    if (nice == -1 && errno) {
+        perror("getpriority");
+        return 1;
+    }
+
+    if (!command) {
+        printf("%d\n", nice);
+        return 0;
+    }
+
+    if (sys_raw_setpriority(PRIO_PROCESS, 0, nice + adjustment) == -1)
+        perror("setpriority");
+
+    execvp(command[0], command);
+
+    perror(command[0]);
+    return 127;
+}
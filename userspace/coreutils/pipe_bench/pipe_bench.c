@@ -0,0 +1,129 @@
+// pipe_bench - Benchmark many readers blocking on a single pipe
+#define UTILITY_NAME "pipe_bench"
+
+#include "common.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/*
+ * A single writer pushes small messages into a pipe that N readers are all
+ * blocked reading from. Every message can only satisfy one reader, so with
+ * the old wake-everybody wait queues the cost per message grew with N. With
+ * exclusive wake-ups it should stay close to flat.
+ *
+ * Every number is in TSC cycles.
+ */
+
+#define MESSAGES 20000
+#define MAX_READERS 32
+
+static inline uint64_t rdtsc(void)
+{
+    uint32_t a, d;
+
+    asm volatile("rdtsc" : "=a" (a), "=d" (d));
+
+    return ((uint64_t)a) | (((uint64_t)d) << 32);
+}
+
+static void reader(int data_fd, int result_fd)
+{
+    uint32_t msg;
+    int count = 0;
+
+    while (read(data_fd, &msg, sizeof(msg)) == sizeof(msg))
+        count++;
+
+    write(result_fd, &count, sizeof(count));
+    _exit(0);
+}
+
+static int run(int readers)
+{
+    int data[2], result[2];
+    pid_t pids[MAX_READERS];
+    uint64_t start, cycles;
+    uint32_t i;
+    int total = 0;
+    int r;
+
+    if (pipe(data) || pipe(result)) {
+        perror("pipe");
+        return 1;
+    }
+
+    for (r = 0; r < readers; r++) {
+        pids[r] = fork();
+        if (pids[r] == -1) {
+            perror("fork");
+            return 1;
+        }
+
+        if (pids[r] == 0) {
+            close(data[1]);
+            close(result[0]);
+            reader(data[0], result[1]);
+        }
+    }
+
+    close(data[0]);
+    close(result[1]);
+
+    /* Give the readers a chance to all block on the empty pipe */
+    sleep(1);
+
+    start = rdtsc();
+    for (i = 0; i < MESSAGES; i++)
+        write(data[1], &i, sizeof(i));
+
+    close(data[1]);
+
+    for (r = 0; r < readers; r++)
+        waitpid(pids[r], NULL, 0);
+
+    cycles = rdtsc() - start;
+
+    for (r = 0; r < readers; r++) {
+        int count;
+
+        if (read(result[0], &count, sizeof(count)) == sizeof(count))
+            total += count;
+    }
+
+    close(result[0]);
+
+    printf("%3d readers: %12llu cycles total, %6llu cycles/message\n", readers,
+            (unsigned long long)cycles,
+            (unsigned long long)(cycles / MESSAGES));
+
+    if (total != MESSAGES) {
+        printf("Readers got %d messages, expected %d!\n", total, MESSAGES);
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int max_readers = 16;
+    int readers;
+
+    if (argc > 1)
+        max_readers = atoi(argv[1]);
+
+    if (max_readers < 1 || max_readers > MAX_READERS) {
+        fprintf(stderr, "%s: Reader count must be between 1 and %d\n", argv[0], MAX_READERS);
+        return 1;
+    }
+
+    for (readers = 1; readers <= max_readers; readers *= 2)
+        if (run(readers))
+            return 1;
+
+    return 0;
+}
@@ -30,6 +30,7 @@ static const char *arg_desc_str  = "";
     X(version, "version", 'v', 0, NULL, "Display version information") \
     X(lng, "long", 'l', 0, NULL, "Long format") \
     X(signals, "signal", 's', 0, NULL, "Display signal information") \
+    X(usage, "usage", 'u', 0, NULL, "Display resource usage") \
     X(kernel, "kernel", 'k', 0, NULL, "Display kernel threads") \
     X(last, NULL, '\0', 0, NULL, NULL)
 
@@ -52,6 +53,7 @@ enum ps_display {
     PS_NORMAL,
     PS_LIST,
     PS_SIGNAL,
+    PS_USAGE,
 };
 
 static const char *task_state_strs[] = {
@@ -164,6 +166,52 @@ static void print_signal_format(void)
     util_display_render(&display);
 }
 
+static void print_usage_time(struct util_line *line, struct __krusage_timeval *tv)
+{
+    util_line_printf_ar(line, "%ld.%02ld", (long)tv->tv_sec, (long)tv->tv_usec / 10000);
+}
+
+static void print_usage_format(void)
+{
+    struct task_api_info *t, *end = tinfo + task_count;
+
+    struct util_line *header = util_display_next_line(&display);
+    util_line_strdup(header, "PID");
+    util_line_strdup(header, "UTIME");
+    util_line_strdup(header, "STIME");
+    util_line_strdup(header, "MINFLT");
+    util_line_strdup(header, "MAJFLT");
+    util_line_strdup(header, "VCSW");
+    util_line_strdup(header, "IVCSW");
+    util_line_strdup(header, "READ");
+    util_line_strdup(header, "WRITE");
+    util_line_strdup(header, "CMD");
+
+    for (t = tinfo; t != end; t++) {
+        if (t->is_kernel && !show_kernel_tasks)
+            continue;
+
+        struct util_line *line = util_display_next_line(&display);
+
+        util_line_printf_ar(line, "%d", t->pid);
+        print_usage_time(line, &t->usage.ru_utime);
+        print_usage_time(line, &t->usage.ru_stime);
+        util_line_printf_ar(line, "%ld", t->usage.ru_minflt);
+        util_line_printf_ar(line, "%ld", t->usage.ru_majflt);
+        util_line_printf_ar(line, "%ld", t->usage.ru_nvcsw);
+        util_line_printf_ar(line, "%ld", t->usage.ru_nivcsw);
+        util_line_printf_ar(line, "%llu", t->usage.ru_read_bytes);
+        util_line_printf_ar(line, "%llu", t->usage.ru_write_bytes);
+
+        if (t->is_kernel)
+            util_line_printf(line, "[%s]", t->name);
+        else
+            util_line_printf(line, "%s", t->name);
+    }
+
+    util_display_render(&display);
+}
+
 int main(int argc, char **argv)
 {
     enum arg_index ret;
@@ -172,6 +220,7 @@ int main(int argc, char **argv)
         [PS_NORMAL] = print_list_format,
         [PS_LIST] = print_list_format,
         [PS_SIGNAL] = print_signal_format,
+        [PS_USAGE] = print_usage_format,
     };
 
     while ((ret = arg_parser(argc, argv, args)) != ARG_DONE) {
@@ -191,6 +240,10 @@ int main(int argc, char **argv)
             display_choice = PS_SIGNAL;
             break;
 
+        case ARG_usage:
+            display_choice = PS_USAGE;
+            break;
+
         case ARG_kernel:
             show_kernel_tasks = 1;
             break;
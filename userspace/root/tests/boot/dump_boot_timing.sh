@@ -0,0 +1,3 @@
+#!/bin/run_test
+
+cat /proc/boot_timing > /dev/qemudbg
@@ -0,0 +1,151 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "sys_raw.h"
+
+/*
+ * Checks that each of the CLONE_* flags actually shares its state between
+ * the two tasks. Every thread does its one thing and exits, and the parent
+ * checks the result once it has waited on it.
+ */
+
+static volatile int shared_value;
+static volatile int shared_fd = -1;
+static volatile int shared_fd_ret;
+static volatile sig_atomic_t handler_ran;
+
+static int failures;
+
+static void check(int passed, const char *name)
+{
+    printf("%s: %s\n", passed? "PASS": "FAIL", name);
+
+    if (!passed)
+        failures++;
+}
+
+/* Returns the thread's exit code, or -1 if it didn't exit normally */
+static int run_thread(int flags, void (*entry)(void *))
+{
+    int wstatus;
+    pid_t pid = sys_raw_clone(flags, entry, NULL);
+
+    if (pid == -1) {
+        perror("clone()");
+        return -1;
+    }
+
+    if (waitpid(pid, &wstatus, 0) == -1) {
+        perror("waitpid()");
+        return -1;
+    }
+
+    if (!WIFEXITED(wstatus))
+        return -1;
+
+    return WEXITSTATUS(wstatus);
+}
+
+static void vm_thread(void *arg)
+{
+    shared_value = 42;
+    _exit(0);
+}
+
+static void fd_open_thread(void *arg)
+{
+    shared_fd = dup(STDOUT_FILENO);
+    _exit(0);
+}
+
+static void fd_check_thread(void *arg)
+{
+    shared_fd_ret = fcntl(shared_fd, F_GETFD);
+    _exit(0);
+}
+
+static void chdir_thread(void *arg)
+{
+    _exit(chdir("/bin")? 1: 0);
+}
+
+static void handle_usr1(int sig)
+{
+    handler_ran = 1;
+}
+
+static void sighand_thread(void *arg)
+{
+    signal(SIGUSR1, handle_usr1);
+    _exit(0);
+}
+
+/* exec() gives the thread a new address space, and the stack clone() gave it
+ * stays behind in ours. Neither side should be hurt by that. */
+static void exec_thread(void *arg)
+{
+    execl("/bin/echo", "echo", "clone_test: exec from a thread", NULL);
+    _exit(127);
+}
+
+int main(int argc, char **argv)
+{
+    char cwd[256], new_cwd[256];
+
+    shared_value = 0;
+    check(run_thread(CLONE_VM, vm_thread) == 0 && shared_value == 42,
+          "CLONE_VM write is visible to the parent");
+
+    check(run_thread(CLONE_VM | CLONE_FILES, fd_open_thread) == 0
+          && shared_fd != -1
+          && fcntl(shared_fd, F_GETFD) != -1,
+          "CLONE_FILES fd opened by the thread is open in the parent");
+
+    if (shared_fd != -1)
+        close(shared_fd);
+
+    check(run_thread(CLONE_VM | CLONE_FILES, fd_check_thread) == 0
+          && shared_fd_ret == -1,
+          "CLONE_FILES fd closed by the parent is closed in the thread");
+
+    if (!getcwd(cwd, sizeof(cwd))) {
+        perror("getcwd()");
+        return 1;
+    }
+
+    check(run_thread(CLONE_VM | CLONE_FS, chdir_thread) == 0
+          && getcwd(new_cwd, sizeof(new_cwd))
+          && strcmp(new_cwd, "/bin") == 0,
+          "CLONE_FS chdir() by the thread changes the parent's cwd");
+
+    chdir(cwd);
+
+    signal(SIGUSR1, SIG_DFL);
+    check(run_thread(CLONE_VM | CLONE_SIGHAND, sighand_thread) == 0
+          && kill(getpid(), SIGUSR1) == 0
+          && handler_ran,
+          "CLONE_SIGHAND handler installed by the thread is used by the parent");
+
+    shared_value = 0;
+    check(run_thread(CLONE_VM | CLONE_FILES | CLONE_FS | CLONE_SIGHAND, exec_thread) == 0,
+          "exec() from a CLONE_VM thread");
+
+    check(run_thread(CLONE_VM, vm_thread) == 0 && shared_value == 42,
+          "CLONE_VM still works after a thread exec()'d");
+
+    if (failures) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,95 @@
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <protura/syscall.h>
+#include <protura/uinfo.h>
+
+/*
+ * Null syscall benchmark - times getpid() made via `int 0x81` against the
+ * same syscall made via `sysenter`, if the kernel supports it.
+ */
+
+#define ITERATIONS 100000
+
+static const struct uinfo_time *uinfo_time = (const struct uinfo_time *)__kUINFO_TIME_ADDR;
+
+static inline uint64_t rdtsc(void)
+{
+    uint32_t a, d;
+
+    asm volatile("rdtsc" : "=a" (a), "=d" (d));
+
+    return ((uint64_t)a) | (((uint64_t)d) << 32);
+}
+
+static inline int syscall_int(int sys)
+{
+    int ret;
+
+    asm volatile("int $0x81"
+                 : "=a" (ret)
+                 : "a" (sys)
+                 : "memory");
+
+    return ret;
+}
+
+static inline int syscall_sysenter(int sys)
+{
+    int ret;
+
+    asm volatile("pushl $1f\n"
+                 "pushl %%ecx\n"
+                 "pushl %%edx\n"
+                 "pushl %%ebp\n"
+                 "movl %%esp, %%ebp\n"
+                 "sysenter\n"
+                 "1:\n"
+                 "popl %%ebp\n"
+                 "popl %%edx\n"
+                 "popl %%ecx\n"
+                 "addl $4, %%esp\n"
+                 : "=a" (ret)
+                 : "a" (sys)
+                 : "memory");
+
+    return ret;
+}
+
+static void report(const char *name, uint64_t cycles)
+{
+    printf("%-10s %12llu cycles total, %6llu cycles/call\n", name,
+            (unsigned long long)cycles,
+            (unsigned long long)(cycles / ITERATIONS));
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t start, end;
+    int i;
+
+    start = rdtsc();
+    for (i = 0; i < ITERATIONS; i++)
+        syscall_int(SYSCALL_GETPID);
+    end = rdtsc();
+    report("int 0x81", end - start);
+
+    if (!(uinfo_time->flags & __kUINFO_FLAG_SYSENTER)) {
+        printf("sysenter is not supported by this kernel or CPU\n");
+        return 0;
+    }
+
+    if (syscall_sysenter(SYSCALL_GETPID) != syscall_int(SYSCALL_GETPID)) {
+        printf("sysenter and int 0x81 getpid() results do not match!\n");
+        return 1;
+    }
+
+    start = rdtsc();
+    for (i = 0; i < ITERATIONS; i++)
+        syscall_sysenter(SYSCALL_GETPID);
+    end = rdtsc();
+    report("sysenter", end - start);
+
+    return 0;
+}
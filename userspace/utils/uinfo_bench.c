@@ -0,0 +1,133 @@
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <protura/uinfo.h>
+
+/*
+ * Compares getpid(), getppid() and gettimeofday() done via syscalls against
+ * reading the answers out of the uinfo pages.
+ */
+
+#define ITERATIONS 100000
+
+static const struct uinfo_time *uinfo_time = (const struct uinfo_time *)__kUINFO_TIME_ADDR;
+static const struct uinfo_task *uinfo_task = (const struct uinfo_task *)__kUINFO_TASK_ADDR;
+
+static inline uint64_t rdtsc(void)
+{
+    uint32_t a, d;
+
+    asm volatile("rdtsc" : "=a" (a), "=d" (d));
+
+    return ((uint64_t)a) | (((uint64_t)d) << 32);
+}
+
+static uint64_t uinfo_monotonic_ns(void)
+{
+    uint32_t seq;
+    uint64_t ns, offset;
+
+    do {
+        while ((seq = uinfo_time->seq) & 1)
+            ;
+
+        ns = uinfo_time->tick_ns;
+        offset = 0;
+
+        if (uinfo_time->tsc_mult) {
+            uint64_t now = rdtsc();
+
+            if (now > uinfo_time->tick_tsc)
+                offset = ((now - uinfo_time->tick_tsc) * uinfo_time->tsc_mult) >> uinfo_time->tsc_shift;
+
+            if (offset >= uinfo_time->nsec_per_tick)
+                offset = uinfo_time->nsec_per_tick - 1;
+        }
+
+        asm volatile("": : :"memory");
+    } while (seq != uinfo_time->seq);
+
+    return ns + offset;
+}
+
+static void uinfo_gettimeofday(struct timeval *tv)
+{
+    uint32_t seq;
+    int64_t realtime_offset;
+    uint64_t ns;
+
+    do {
+        seq = uinfo_time->seq;
+        realtime_offset = uinfo_time->realtime_offset_ns;
+        asm volatile("": : :"memory");
+    } while ((seq & 1) || seq != uinfo_time->seq);
+
+    ns = uinfo_monotonic_ns() + realtime_offset;
+
+    tv->tv_sec = ns / 1000000000;
+    tv->tv_usec = (ns % 1000000000) / 1000;
+}
+
+static void report(const char *name, uint64_t start, uint64_t end)
+{
+    uint64_t total = end - start;
+
+    printf("%-22s %10llu ns total, %6llu ns/call\n", name,
+            (unsigned long long)total,
+            (unsigned long long)(total / ITERATIONS));
+}
+
+int main(int argc, char **argv)
+{
+    struct timeval tv;
+    volatile pid_t pid;
+    uint64_t start;
+    int i;
+
+    if (getpid() != uinfo_task->pid || getppid() != uinfo_task->ppid) {
+        printf("uinfo pid/ppid do not match syscall results!\n");
+        return 1;
+    }
+
+    start = uinfo_monotonic_ns();
+    for (i = 0; i < ITERATIONS; i++)
+        pid = getpid();
+    report("getpid() syscall", start, uinfo_monotonic_ns());
+
+    start = uinfo_monotonic_ns();
+    for (i = 0; i < ITERATIONS; i++)
+        pid = uinfo_task->pid;
+    report("getpid() uinfo", start, uinfo_monotonic_ns());
+
+    start = uinfo_monotonic_ns();
+    for (i = 0; i < ITERATIONS; i++)
+        pid = getppid();
+    report("getppid() syscall", start, uinfo_monotonic_ns());
+
+    start = uinfo_monotonic_ns();
+    for (i = 0; i < ITERATIONS; i++)
+        pid = uinfo_task->ppid;
+    report("getppid() uinfo", start, uinfo_monotonic_ns());
+
+    start = uinfo_monotonic_ns();
+    for (i = 0; i < ITERATIONS; i++)
+        gettimeofday(&tv, NULL);
+    report("gettimeofday() syscall", start, uinfo_monotonic_ns());
+
+    start = uinfo_monotonic_ns();
+    for (i = 0; i < ITERATIONS; i++)
+        uinfo_gettimeofday(&tv);
+    report("gettimeofday() uinfo", start, uinfo_monotonic_ns());
+
+    (void)pid;
+
+    gettimeofday(&tv, NULL);
+    printf("syscall time: %ld.%06ld\n", (long)tv.tv_sec, (long)tv.tv_usec);
+    uinfo_gettimeofday(&tv);
+    printf("uinfo time:   %ld.%06ld\n", (long)tv.tv_sec, (long)tv.tv_usec);
+
+    return 0;
+}